@@ -0,0 +1,476 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "coreinfo.h"
+#include "crc32c.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <link.h>
+#include <stddef.h>
+#include <sys/procfs.h>
+#include <algorithm>
+#include <map>
+
+#define align_power(address, alignSize) \
+(((address) + ((ADDRESS) 1 << (alignSize)) - 1) & ((ADDRESS) -1 << (alignSize)))
+
+//! The most dynamic entries of the executable that are searched for DT_DEBUG
+#define MAX_DYNAMIC_ENTRIES 1024
+//! The most modules that are followed in the link map, in case it is corrupted in to a loop
+#define MAX_MODULES 65536
+
+typedef struct elf_prstatus Status;
+typedef struct elf_prpsinfo Info;
+
+/*!
+  * \brief Order the PT_LOAD segments by their address
+  */
+static bool byAddress(const Phdr *first, const Phdr *second)
+{
+    return first->p_vaddr < second->p_vaddr;
+}
+
+/*!
+  * \brief Find the segment that follows an address, used to search \a loads
+  */
+static bool isBefore(ADDRESS address, const Phdr *header)
+{
+    return address < header->p_vaddr;
+}
+
+CoreInfo::CoreInfo()
+    : pid(0),
+    signal(0),
+    phdrAddress(0),
+    phdrCount(0),
+    hasChecksums(false),
+    headersChecksum(0),
+    checkResult(NULL)
+{
+}
+
+bool CoreInfo::read(const char *fileName)
+{
+    if (!reader.initalize(fileName))
+        return false;
+
+    const Ehdr *header = reader.elfFileHeader();
+    if ((header->e_type != ET_CORE) || (header->e_ident[EI_CLASS] != (sizeof(ADDRESS) == 8 ? ELFCLASS64 : ELFCLASS32)))
+        LOG_RETURN(LOG_ERR, false, "'%s' is not a core file of this architecture.", fileName);
+
+    const Phdr *headers = reader.programHeader();
+    for (int i = 0; i < header->e_phnum; i++)
+    {
+        if ((headers[i].p_type == PT_LOAD) && headers[i].p_filesz
+            && reader.getDataByOffset(headers[i].p_offset + headers[i].p_filesz - 1))
+            loads.push_back(&headers[i]);
+    }
+    std::sort(loads.begin(), loads.end(), byAddress);
+
+    for (int i = 0; i < header->e_phnum; i++)
+    {
+        if (headers[i].p_type == PT_NOTE)
+            readNotes(&headers[i]);
+    }
+
+    //The modules from the note are only a fallback for the link map
+    std::vector<Module> noteModules;
+    noteModules.swap(modules);
+    if (!readLinkMap())
+        modules.swap(noteModules);
+
+    if (!pid && !threads.empty())
+        pid = threads.front().pid;
+    return true;
+}
+
+void CoreInfo::readNotes(const Phdr *header)
+{
+    const char *current = reader.getDataByOffset(header->p_offset);
+    if (!current || !header->p_filesz || !reader.getDataByOffset(header->p_offset + header->p_filesz - 1))
+        return;
+    const char *end = current + header->p_filesz;
+
+    while (current + sizeof(Nhdr) <= end)
+    {
+        const Nhdr *note = (const Nhdr *)current;
+        const char *name = current + sizeof(Nhdr);
+        const char *desc = name + align_power(note->n_namesz, 2);
+        if ((note->n_namesz > (size_t)(end - name)) || (note->n_descsz > (size_t)(end - desc)))
+            break;
+        current = desc + align_power(note->n_descsz, 2);
+
+        std::string owner(name, strnlen(name, note->n_namesz));
+        std::vector<NoteType>::iterator type = noteTypes.begin();
+        while ((type != noteTypes.end()) && ((type->type != note->n_type) || (type->name != owner)))
+            ++type;
+        if (type == noteTypes.end())
+        {
+            NoteType newType = { owner, note->n_type, 0, 0 };
+            type = noteTypes.insert(noteTypes.end(), newType);
+        }
+        type->count++;
+        type->size += note->n_descsz;
+
+        if (owner == RICH_CORE_NOTE_NAME)
+        {
+            if (note->n_type == NT_RICHCORE_MODULES)
+                readModuleNote(desc, desc + note->n_descsz);
+            else if (note->n_type == NT_RICHCORE_CHECKSUMS)
+                readChecksumNote(desc, desc + note->n_descsz);
+            continue;
+        }
+
+        if ((note->n_type == NT_PRSTATUS) && (note->n_descsz >= sizeof(Status)))
+        {
+            Status status;
+            memcpy(&status, desc, sizeof(status));
+            Thread thread;
+            thread.pid = status.pr_pid;
+            thread.signal = status.pr_cursig;
+            thread.programCounter = (ADDRESS)status.pr_reg[PC_OFFSET];
+            thread.stackPointer = (ADDRESS)status.pr_reg[ESP_OFFSET];
+            //The kernel writes the thread that caused the dump first, the same as the reducer assumes
+            if (thread.signal && !signal)
+                signal = thread.signal;
+            threads.push_back(thread);
+        }
+        else if ((note->n_type == NT_PRPSINFO) && (note->n_descsz >= sizeof(Info)))
+        {
+            Info info;
+            memcpy(&info, desc, sizeof(info));
+            pid = info.pr_pid;
+            executable.assign(info.pr_psargs, strnlen(info.pr_psargs, sizeof(info.pr_psargs)));
+        }
+        else if (note->n_type == NT_AUXV)
+        {
+            for (const char *entry = desc; entry + sizeof(Auxv) <= desc + note->n_descsz; entry += sizeof(Auxv))
+            {
+                Auxv aux;
+                memcpy(&aux, entry, sizeof(aux));
+                if (aux.a_type == AT_PHDR)
+                    phdrAddress = (ADDRESS)aux.a_un.a_val;
+                else if (aux.a_type == AT_PHNUM)
+                    phdrCount = (ADDRESS)aux.a_un.a_val;
+                else if (aux.a_type == AT_NULL)
+                    break;
+            }
+        }
+    }
+}
+
+void CoreInfo::readModuleNote(const char *desc, const char *descEnd)
+{
+    //see defines.h for the layout of the note
+    const char *start = desc;
+    uint32_t count;
+    if (desc + sizeof(count) > descEnd)
+        return;
+    memcpy(&count, desc, sizeof(count));
+    desc += sizeof(count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t base;
+        if (desc + 2 * sizeof(uint64_t) >= descEnd)
+            return;
+        memcpy(&base, desc, sizeof(base));
+        desc += 2 * sizeof(uint64_t);
+
+        //the build id is skipped
+        desc += strnlen(desc, descEnd - desc) + 1;
+        if (desc >= descEnd)
+            return;
+
+        size_t nameLength = strnlen(desc, descEnd - desc);
+        if (desc + nameLength >= descEnd)
+            return;
+        Module module;
+        module.address = (ADDRESS)base;
+        module.name.assign(desc, nameLength);
+        modules.push_back(module);
+        desc += nameLength + 1;
+        desc = start + align_power(desc - start, 2);
+    }
+}
+
+void CoreInfo::readChecksumNote(const char *desc, const char *descEnd)
+{
+    //see defines.h for the layout of the note
+    uint32_t count;
+    const size_t entrySize = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+    if (desc + 2 * sizeof(uint32_t) > descEnd)
+        return;
+    memcpy(&count, desc, sizeof(count));
+    memcpy(&headersChecksum, desc + sizeof(count), sizeof(headersChecksum));
+    desc += 2 * sizeof(uint32_t);
+    if (count > (size_t)(descEnd - desc) / entrySize)
+        return;
+
+    checksums.resize(count);
+    for (uint32_t i = 0; i < count; i++, desc += entrySize)
+    {
+        memcpy(&checksums[i].offset, desc, sizeof(uint64_t));
+        memcpy(&checksums[i].size, desc + sizeof(uint64_t), sizeof(uint64_t));
+        memcpy(&checksums[i].crc, desc + 2 * sizeof(uint64_t), sizeof(uint32_t));
+    }
+    hasChecksums = true;
+}
+
+bool CoreInfo::check()
+{
+    //The note is at the end of the file, so a file that was cut short is found by its headers
+    checkResult = "invalid";
+    const Phdr *headers = reader.programHeader();
+    for (int i = 0; i < reader.elfFileHeader()->e_phnum; i++)
+    {
+        if (headers[i].p_filesz && !reader.getDataByOffset(headers[i].p_offset + headers[i].p_filesz - 1))
+            return false;
+    }
+
+    if (!hasChecksums)
+    {
+        checkResult = "none";
+        return true;
+    }
+
+    size_t headersSize = reader.elfFileHeader()->e_phoff + (reader.elfFileHeader()->e_phnum * sizeof(Phdr));
+    if (!reader.getDataByOffset(headersSize - 1)
+        || (crc32c_update(0, reader.elfFileHeader(), headersSize) != headersChecksum))
+        return false;
+
+    for (size_t i = 0; i < checksums.size(); i++)
+    {
+        const Checksum &checksum = checksums.at(i);
+        const char *data = reader.getDataByOffset(checksum.offset);
+        if (checksum.size && (!data || !reader.getDataByOffset(checksum.offset + checksum.size - 1)))
+            return false;
+        if (crc32c_update(0, data, checksum.size) != checksum.crc)
+            return false;
+    }
+
+    checkResult = "valid";
+    return true;
+}
+
+bool CoreInfo::readLinkMap()
+{
+    if (!phdrAddress || !phdrCount)
+        return false;
+
+    //The program headers of the executable are in its first page, which the kernel always dumps
+    const Phdr *headers = (const Phdr *)getData(phdrAddress, phdrCount * sizeof(Phdr));
+    if (!headers)
+        return false;
+
+    ADDRESS bias = 0;
+    ADDRESS dynamicAddress = 0;
+    for (ADDRESS i = 0; i < phdrCount; i++)
+    {
+        Phdr phdr;
+        memcpy(&phdr, &headers[i], sizeof(phdr));
+        if (phdr.p_type == PT_PHDR)
+            bias = phdrAddress - phdr.p_vaddr;
+        else if (phdr.p_type == PT_DYNAMIC)
+            dynamicAddress = phdr.p_vaddr;
+    }
+    if (!dynamicAddress)
+        return false;
+
+    ADDRESS debugAddress = 0;
+    for (ADDRESS i = 0; i < MAX_DYNAMIC_ENTRIES; i++)
+    {
+        const char *data = getData(bias + dynamicAddress + i * sizeof(Elf_Dyn), sizeof(Elf_Dyn));
+        if (!data)
+            return false;
+        Elf_Dyn dynamic;
+        memcpy(&dynamic, data, sizeof(dynamic));
+        if (dynamic.d_tag == DT_NULL)
+            break;
+        if (dynamic.d_tag == DT_DEBUG)
+        {
+            debugAddress = (ADDRESS)dynamic.d_un.d_ptr;
+            break;
+        }
+    }
+
+    const char *data = debugAddress ? getData(debugAddress, sizeof(struct r_debug)) : NULL;
+    if (!data)
+        return false;
+    ADDRESS entry;
+    memcpy(&entry, data + offsetof(struct r_debug, r_map), sizeof(entry));
+
+    for (size_t i = 0; entry && (i < MAX_MODULES); i++)
+    {
+        if (!(data = getData(entry, sizeof(struct link_map))))
+            return !modules.empty();
+
+        ADDRESS nameAddress;
+        Module module;
+        memcpy(&module.address, data + offsetof(struct link_map, l_addr), sizeof(module.address));
+        memcpy(&nameAddress, data + offsetof(struct link_map, l_name), sizeof(nameAddress));
+        memcpy(&entry, data + offsetof(struct link_map, l_next), sizeof(entry));
+        //The executable and the vdso have an empty name
+        if (getString(nameAddress, module.name) && !module.name.empty())
+            modules.push_back(module);
+    }
+    return !modules.empty();
+}
+
+const char *CoreInfo::getData(ADDRESS address, size_t size)
+{
+    std::vector<const Phdr *>::const_iterator next = std::upper_bound(loads.begin(), loads.end(), address, isBefore);
+    if (next == loads.begin())
+        return NULL;
+
+    const Phdr *header = *(next - 1);
+    ADDRESS offset = address - header->p_vaddr;
+    if ((offset >= header->p_filesz) || (size > header->p_filesz - offset))
+        return NULL;
+
+    return reader.getDataByOffset(header->p_offset + offset);
+}
+
+bool CoreInfo::getString(ADDRESS address, std::string &string)
+{
+    const char *data = getData(address, 1);
+    if (!data)
+        return false;
+
+    //The string ends in the same segment, or it is cut at the end of the segment
+    std::vector<const Phdr *>::const_iterator next = std::upper_bound(loads.begin(), loads.end(), address, isBefore);
+    const Phdr *header = *(next - 1);
+    size_t available = header->p_filesz - (address - header->p_vaddr);
+    string.assign(data, strnlen(data, std::min(available, (size_t)PATH_MAX)));
+    return true;
+}
+
+void CoreInfo::toJson(const char *fileName, std::string &json) const
+{
+    char buffer[256];
+
+    json += "{\"file\":";
+    appendString(json, fileName, strlen(fileName));
+    snprintf(buffer, sizeof(buffer), ",\"pid\":%d,\"signal\":%d,\"executable\":", pid, signal);
+    json += buffer;
+    appendString(json, executable.c_str(), executable.size());
+
+    snprintf(buffer, sizeof(buffer), ",\"thread_count\":%u,\"threads\":[", (unsigned int)threads.size());
+    json += buffer;
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        const Thread &thread = threads.at(i);
+        snprintf(buffer, sizeof(buffer), "%s{\"pid\":%d,\"signal\":%d,\"pc\":\"0x%llx\",\"sp\":\"0x%llx\"}",
+                 i ? "," : "", thread.pid, thread.signal, (unsigned long long)thread.programCounter,
+                 (unsigned long long)thread.stackPointer);
+        json += buffer;
+    }
+
+    //The checksums are unique keys of the segments, so they are given even when they are not checked
+    std::map<uint64_t, const Checksum *> checksumByOffset;
+    for (size_t i = 0; i < checksums.size(); i++)
+        checksumByOffset[checksums.at(i).offset] = &checksums.at(i);
+
+    json += "],\"segments\":[";
+    const Phdr *headers = reader.programHeader();
+    for (int i = 0; i < reader.elfFileHeader()->e_phnum; i++)
+    {
+        const Phdr &header = headers[i];
+        const char *type = (header.p_type == PT_LOAD) ? "LOAD" : (header.p_type == PT_NOTE) ? "NOTE" : NULL;
+        char typeName[16];
+        if (!type)
+        {
+            snprintf(typeName, sizeof(typeName), "0x%x", (unsigned int)header.p_type);
+            type = typeName;
+        }
+        snprintf(buffer, sizeof(buffer), "%s{\"type\":\"%s\",\"vaddr\":\"0x%llx\",\"offset\":%llu,\"filesz\":%llu,"
+                 "\"memsz\":%llu,\"flags\":\"%c%c%c\"", i ? "," : "", type, (unsigned long long)header.p_vaddr,
+                 (unsigned long long)header.p_offset, (unsigned long long)header.p_filesz,
+                 (unsigned long long)header.p_memsz, (header.p_flags & PF_R) ? 'r' : '-',
+                 (header.p_flags & PF_W) ? 'w' : '-', (header.p_flags & PF_X) ? 'x' : '-');
+        json += buffer;
+
+        std::map<uint64_t, const Checksum *>::const_iterator checksum = checksumByOffset.find(header.p_offset);
+        if (header.p_filesz && (checksum != checksumByOffset.end()) && (checksum->second->size == header.p_filesz))
+        {
+            snprintf(buffer, sizeof(buffer), ",\"crc32c\":\"%08x\"", (unsigned int)checksum->second->crc);
+            json += buffer;
+        }
+        json += '}';
+    }
+
+    json += "],\"modules\":[";
+    for (size_t i = 0; i < modules.size(); i++)
+    {
+        snprintf(buffer, sizeof(buffer), "%s{\"address\":\"0x%llx\",\"name\":", i ? "," : "",
+                 (unsigned long long)modules.at(i).address);
+        json += buffer;
+        appendString(json, modules.at(i).name.c_str(), modules.at(i).name.size());
+        json += '}';
+    }
+
+    json += "],\"notes\":[";
+    for (size_t i = 0; i < noteTypes.size(); i++)
+    {
+        const NoteType &type = noteTypes.at(i);
+        json += i ? ",{\"name\":" : "{\"name\":";
+        appendString(json, type.name.c_str(), type.name.size());
+        snprintf(buffer, sizeof(buffer), ",\"type\":%u,\"count\":%u,\"size\":%u}", (unsigned int)type.type,
+                 (unsigned int)type.count, (unsigned int)type.size);
+        json += buffer;
+    }
+    json += ']';
+
+    if (checkResult)
+    {
+        json += ",\"checksums\":\"";
+        json += checkResult;
+        json += '"';
+    }
+    json += '}';
+}
+
+void CoreInfo::appendString(std::string &json, const char *string, size_t length)
+{
+    json += '"';
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned char c = string[i];
+        if ((c == '"') || (c == '\\'))
+        {
+            json += '\\';
+            json += c;
+        }
+        else if (c < 0x20)
+        {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            json += escaped;
+        }
+        else
+            json += c;
+    }
+    json += '"';
+}
@@ -0,0 +1,187 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file coreinfo.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class CoreInfo
+  * \brief Summarize a core file as JSON without a debugger.
+  * The core is mapped in to memory through MappedCoreReader, without libelf, and only the program headers,
+  * the notes and the few pages that hold the link map are read, so a core of any size is summarized in
+  * milliseconds.  The modules are taken from the link map of the dynamic linker, found through the AT_PHDR entry of the
+  * auxiliary vector.  When the link map is not in the core the NT_RICHCORE_MODULES note is used instead.
+  * The segments of a reduced core are checked against its NT_RICHCORE_CHECKSUMS note by check().
+  */
+
+#ifndef COREINFO_H
+#define COREINFO_H
+
+#include "defines.h"
+#include "mappedcorereader.h"
+#include <string>
+#include <vector>
+
+class CoreInfo
+{
+public:
+    /*!
+      * \brief Constructor
+      */
+    CoreInfo();
+
+    /*!
+      * \brief Read the summary of a core file
+      * \param fileName The core file to read
+      * \return true on success, false if the file is not an elf core file
+      */
+    bool read(const char *fileName);
+
+    /*!
+      * \brief Check the segments and the headers against the NT_RICHCORE_CHECKSUMS note
+      * \return false if the file was cut short or any of the checksums does not match, true otherwise
+      * The result is added to the summary as "checksums": "valid", "invalid" or "none" if the core does
+      * not have the note.
+      */
+    bool check();
+
+    /*!
+      * \brief Write the summary as a single line JSON object
+      * \param fileName The name of the file to put in the summary
+      * \param json The object is appended to it, without a newline
+      */
+    void toJson(const char *fileName, std::string &json) const;
+
+private:
+    /*!
+      * \brief The state of a thread, from its NT_PRSTATUS note
+      */
+    struct Thread
+    {
+        int pid;                //!< The id of the thread
+        int signal;             //!< The signal that is pending for the thread, 0 if none
+        ADDRESS programCounter; //!< The program counter of the thread
+        ADDRESS stackPointer;   //!< The stack pointer of the thread
+    };
+
+    /*!
+      * \brief The number and size of the notes that have the same owner and type
+      */
+    struct NoteType
+    {
+        std::string name;       //!< The owner of the notes
+        Elf_Word type;          //!< The type of the notes
+        size_t count;           //!< The number of the notes
+        size_t size;            //!< The total size of the descriptions of the notes
+    };
+
+    /*!
+      * \brief A module of the process
+      */
+    struct Module
+    {
+        ADDRESS address;        //!< The load bias from the link map, or the lowest address from the module note
+        std::string name;       //!< The path of the module
+    };
+
+    /*!
+      * \brief The checksum of the data of a segment, from the NT_RICHCORE_CHECKSUMS note
+      */
+    struct Checksum
+    {
+        uint64_t offset;        //!< The file offset of the segment
+        uint64_t size;          //!< The size of the data of the segment
+        uint32_t crc;           //!< The CRC-32C of the data
+    };
+
+    /*!
+      * \brief Read the notes of a PT_NOTE segment
+      */
+    void readNotes(const Phdr *header);
+
+    /*!
+      * \brief Read a NT_RICHCORE_CHECKSUMS note
+      */
+    void readChecksumNote(const char *desc, const char *descEnd);
+
+    /*!
+      * \brief Read the list of the modules from the link map of the dynamic linker
+      * \return false if the link map can not be found in the core
+      */
+    bool readLinkMap();
+
+    /*!
+      * \brief Read the list of the modules from a NT_RICHCORE_MODULES note
+      */
+    void readModuleNote(const char *desc, const char *descEnd);
+
+    /*!
+      * \brief Get the data of the core at a virtual address
+      * \param address The address of the data
+      * \param size The number of bytes that must be in the core after \a address
+      * \return A pointer to the data, or NULL if the core does not hold all of it
+      */
+    const char *getData(ADDRESS address, size_t size);
+
+    /*!
+      * \brief Read a NUL terminated string from the core
+      * \return false if the string is not in the core
+      */
+    bool getString(ADDRESS address, std::string &string);
+
+    /*!
+      * \brief Append a string to a JSON document with the needed quoting
+      */
+    static void appendString(std::string &json, const char *string, size_t length);
+
+private:
+    //! The core file
+    MappedCoreReader reader;
+    //! The PT_LOAD segments that have data in the file, sorted by their address
+    std::vector<const Phdr *> loads;
+    //! The id of the process
+    int pid;
+    //! The signal that caused the dump, 0 if there is none
+    int signal;
+    //! The command line of the process from NT_PRPSINFO
+    std::string executable;
+    //! The threads in the order of the core
+    std::vector<Thread> threads;
+    //! The types of the notes in the order that they are first found
+    std::vector<NoteType> noteTypes;
+    //! The modules of the process
+    std::vector<Module> modules;
+    //! The address of the program headers of the executable from AT_PHDR
+    ADDRESS phdrAddress;
+    //! The number of the program headers of the executable from AT_PHNUM
+    ADDRESS phdrCount;
+    //! true if the core has a NT_RICHCORE_CHECKSUMS note that could be read
+    bool hasChecksums;
+    //! The checksum of the elf header and the program headers
+    uint32_t headersChecksum;
+    //! The checksums of the segments in the order of the note
+    std::vector<Checksum> checksums;
+    //! The result of check(), NULL if it was not run
+    const char *checkResult;
+};
+
+#endif // COREINFO_H
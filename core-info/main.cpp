@@ -0,0 +1,160 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "coreinfo.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../config.h"
+
+/*!
+  * \brief The work that is shared by the summarizing threads
+  */
+typedef struct
+{
+    std::vector<std::string> inputs;     //!< The core files to summarize
+    std::vector<std::string> results;    //!< The JSON summary of each of the files
+    std::vector<bool> isRead;            //!< true for the files that could be read
+    std::vector<bool> isValid;           //!< false for the files whose checksums do not match
+    bool isChecked;                      //!< true to check the checksums of the reduced cores
+    size_t next;                         //!< The index of the next file to be summarized
+    pthread_mutex_t lock;                //!< Protects \a next
+} Work;
+
+void printUsage(char *progName)
+{
+    std::cout << "\n\nUsage:" << std::endl;
+    std::cout << "\t" << progName << " [-options] [core file...]" << std::endl;
+    std::cout << "Options:\n"
+            "\t[-j number of threads]\n"
+            "\t[-c check the checksums of reduced cores]\n"
+            "\tWithout files the names of the files are read from stdin, one per line.";
+    std::cout << std::endl;
+}
+
+void *summarizeFiles(void *data)
+{
+    Work *work = (Work *)data;
+    while (true)
+    {
+        pthread_mutex_lock(&work->lock);
+        size_t index = work->next++;
+        pthread_mutex_unlock(&work->lock);
+        if (index >= work->inputs.size())
+            break;
+
+        CoreInfo info;
+        const char *fileName = work->inputs.at(index).c_str();
+        if (info.read(fileName))
+        {
+            if (work->isChecked)
+                work->isValid[index] = info.check();
+            info.toJson(fileName, work->results.at(index));
+            work->isRead[index] = true;
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    char *progName = argv[0];
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    bool check = false;
+    int c;
+
+    while ((c = getopt(argc, argv, "hcj:")) != -1)
+    {
+        switch (c)
+        {
+        case 'c':
+            check = true;
+            break;
+        case 'j':
+            jobs = strtol(optarg, NULL, 0);
+            break;
+        case 'h':
+        default:
+            printUsage(progName);
+            return -1;
+        }
+    }
+
+    Work work;
+    for (int i = optind; i < argc; i++)
+        work.inputs.push_back(argv[i]);
+    if (work.inputs.empty())
+    {
+        char line[PATH_MAX];
+        while (fgets(line, sizeof(line), stdin))
+        {
+            line[strcspn(line, "\n")] = '\0';
+            if (line[0])
+                work.inputs.push_back(line);
+        }
+    }
+    if (jobs < 1)
+        jobs = 1;
+    if ((size_t)jobs > work.inputs.size())
+        jobs = work.inputs.size();
+
+    work.results.resize(work.inputs.size());
+    work.isRead.resize(work.inputs.size(), false);
+    work.isValid.resize(work.inputs.size(), true);
+    work.isChecked = check;
+    work.next = 0;
+    pthread_mutex_init(&work.lock, NULL);
+
+    std::vector<pthread_t> threads(jobs);
+    for (long i = 0; i < jobs; i++)
+        pthread_create(&threads[i], NULL, summarizeFiles, &work);
+    for (long i = 0; i < jobs; i++)
+        pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&work.lock);
+
+    //One JSON object per line, in the order of the input
+    int failed = 0;
+    for (unsigned int i = 0; i < work.inputs.size(); i++)
+    {
+        if (!work.isRead[i])
+        {
+            std::cerr << work.inputs.at(i) << ": not a core file" << std::endl;
+            failed++;
+            continue;
+        }
+        std::cout << work.results.at(i) << '\n';
+        if (!work.isValid[i])
+        {
+            std::cerr << work.inputs.at(i) << ": checksums do not match" << std::endl;
+            failed++;
+        }
+    }
+
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "mappedcorereader.h"
+
+#include <string.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+MappedCoreReader::MappedCoreReader()
+    : image(NULL),
+    fileSize(0),
+    elfHeader(NULL),
+    programHeaders(NULL)
+{
+}
+
+MappedCoreReader::~MappedCoreReader()
+{
+    close();
+}
+
+bool MappedCoreReader::initalize(const char *fileName)
+{
+    close();
+    if (!fileName)
+        LOG_RETURN(LOG_ERR, false, "Uninitialized pointer for fileName");
+
+    int fd = open(fileName, O_RDONLY, 0);
+    if (fd < 0)
+        LOG_RETURN(LOG_ERR, false, "Opening file '%s' failed.", fileName);
+
+    //The mapping stays valid when the file is closed
+    struct stat buf;
+    void *mapping = MAP_FAILED;
+    if ((fstat(fd, &buf) == 0) && (buf.st_size >= (off_t)sizeof(Ehdr)))
+        mapping = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED)
+        LOG_RETURN(LOG_ERR, false, "Mapping file '%s' failed.", fileName);
+
+    image = (char *)mapping;
+    fileSize = buf.st_size;
+    if (memcmp(image, ELFMAG, SELFMAG) != 0)
+    {
+        close();
+        LOG_RETURN(LOG_ERR, false, "'%s' does not appear to be an elf file.", fileName);
+    }
+
+    const Ehdr *header = (const Ehdr *)image;
+    if ((header->e_phentsize != sizeof(Phdr)) || (header->e_phoff > fileSize)
+        || (header->e_phnum * sizeof(Phdr) > fileSize - header->e_phoff))
+    {
+        close();
+        LOG_RETURN(LOG_ERR, false, "The program headers of '%s' are not valid.", fileName);
+    }
+
+    elfHeader = header;
+    programHeaders = (const Phdr *)(image + header->e_phoff);
+    return true;
+}
+
+const char *MappedCoreReader::getDataByOffset(size_t offset) const
+{
+    if (offset < fileSize)
+        return image + offset;
+
+    return NULL;
+}
+
+void MappedCoreReader::close()
+{
+    if (image)
+    {
+        munmap(image, fileSize);
+        image = NULL;
+    }
+    fileSize = 0;
+    elfHeader = NULL;
+    programHeaders = NULL;
+}
@@ -0,0 +1,96 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file mappedcorereader.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class MappedCoreReader
+  * \brief Read a core file that is mapped in to memory, without libelf.
+  * Only the pages that are used are read from the disk, so the headers and the notes of a core of any
+  * size are read in milliseconds.  The elf header and the program headers are checked to be within the
+  * file, the data of the segments is checked by the caller through getDataByOffset().
+  */
+
+#ifndef MAPPEDCOREREADER_H
+#define MAPPEDCOREREADER_H
+
+#include "defines.h"
+#include <stddef.h>
+
+class MappedCoreReader
+{
+public:
+    /*!
+      * \brief Constructor
+      */
+    MappedCoreReader();
+
+    /*!
+      * \brief Destructor, unmaps the file
+      */
+    ~MappedCoreReader();
+
+    /*!
+      * \brief Map a core file in to memory
+      * \param fileName The path and filename of the core file to read
+      * \return true on success, false if the file can not be mapped or is not an elf file
+      */
+    bool initalize(const char *fileName);
+
+    /*!
+      * \brief Get a pointer to the elf header of the mapped file
+      * \return A pointer to the header or NULL if no file is mapped
+      */
+    inline const Ehdr *elfFileHeader() const { return elfHeader; }
+
+    /*!
+      * \brief Get a pointer to the program headers of the mapped file
+      * \return A pointer to the e_phnum program headers or NULL if no file is mapped
+      */
+    inline const Phdr *programHeader() const { return programHeaders; }
+
+    /*!
+      * \brief Get a pointer to the data at an offset from the beginning of the file
+      * \param offset The offset of the data
+      * \return A pointer to the data if \a offset is within the file, NULL otherwise
+      */
+    const char *getDataByOffset(size_t offset) const;
+
+private:
+    /*!
+      * \brief Unmap the file
+      */
+    void close();
+
+private:
+    //! The start of the mapping, NULL if no file is mapped
+    char *image;
+    //! The size of the mapped file
+    size_t fileSize;
+    //! The elf header at the start of \a image
+    const Ehdr *elfHeader;
+    //! The program headers in \a image
+    const Phdr *programHeaders;
+};
+
+#endif // MAPPEDCOREREADER_H
@@ -0,0 +1,97 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file corewriter.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class CoreWriter
+  * \brief The interface for the classes that write the reduced core file.
+  * The reducer selects the segments of the origional core file that are to be kept and hands them to
+  * the writer, which stores them in its own output format.
+  */
+
+#ifndef COREWRITER_H
+#define COREWRITER_H
+
+#include "defines.h"
+#include <stddef.h>
+#include <vector>
+
+class CoreWriter
+{
+public:
+    /*!
+      * \brief destructor
+      */
+    virtual ~CoreWriter() {}
+
+    /*!
+      * \brief initalize the class so that we can start to create the new core file.
+      * \param fileName The path of the file to which we are going to write the finished core file
+      * \param numberOfSegments The number of segments that are going to be created.
+      * \param initalSizeOfData The inital amount of space to reserve for the file.
+      * \return true on success, false otherwise
+      */
+    virtual bool initalize(const char *fileName, size_t numberOfSegments, size_t initalSizeOfData) = 0;
+
+    /*!
+      * \brief Take the description of the process from the elf header of the origional core file
+      * \param header A pointer to the elf header of the origional core file
+      */
+    virtual void copyElfHeader(const Ehdr *header) = 0;
+
+    /*!
+      * \brief copy a segment from the origional core file to this file
+      * \param programHeader The program header that contains the information about the segment
+      * \param data A pointer to the data for the segment that is to be copied
+      * \param overwriteData The data to replace some existing data in the segment with
+      * \param overwriteOffset The position relative to the start of the segment into which \a overwriteData is to be copied
+      * \param overwriteSize The amount of the segment that is going to be overwritten by \a overwriteData
+      * \returns On success a pointer to the copy of the segment data, NULL otherwise
+      */
+    virtual const char *copySegment(const Phdr *programHeader, const char *data,
+                                    const char *overwriteData = NULL, size_t overwriteOffset = 0,
+                                    size_t overwriteSize = 0) = 0;
+
+    /*!
+      * \brief copy a number of segments from the origional core file to this file, in their order
+      * \param programHeaders The program headers of the segments
+      * \param data A pointer to the data of each segment
+      * \return true on success, false otherwise
+      */
+    virtual bool copySegments(const std::vector<const Phdr *> &programHeaders, const std::vector<const char *> &data)
+    {
+        for (size_t i = 0; i < programHeaders.size(); i++)
+            if (!copySegment(programHeaders[i], data[i]))
+                return false;
+        return true;
+    }
+
+    /*!
+      * \brief Write the finished file to disk, should be called once at the end of processing
+      * \return true on success false otherwise.
+      */
+    virtual bool write() = 0;
+};
+
+#endif // COREWRITER_H
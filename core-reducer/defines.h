@@ -106,6 +106,11 @@ typedef Elf32_Dyn Elf_Dyn;
   * define a new type for the note section structure that can be used to mask 32/64 bit differences in the underlying library
   */
 typedef Elf32_Nhdr Nhdr;
+/*!
+  * \typedef Elf32_Sym Sym
+  * define a new type for the symbol table entry that can be used to mask 32/64 bit differences in the underlying library
+  */
+typedef Elf32_Sym Sym;
 /*!
   * \def LM_NAME
   * The offset in the link map structure that points to the name string of the library that is referenced by this link
@@ -153,6 +158,11 @@ typedef Elf64_Dyn Elf_Dyn;
   * define a new type for the note section structure that can be used to mask 32/64 bit differences in the underlying library
   */
 typedef Elf64_Nhdr Nhdr;
+/*!
+  * \typedef Elf64_Sym Sym
+  * define a new type for the symbol table entry that can be used to mask 32/64 bit differences in the underlying library
+  */
+typedef Elf64_Sym Sym;
 /*!
   * \def LM_NAME
   * The offset in the link map structure that points to the name string of the library that is referenced by this link
@@ -161,4 +171,108 @@ typedef Elf64_Nhdr Nhdr;
 typedef Elf64_auxv_t Auxv; 
 #endif
 
+#ifdef ARM_REGS
+/*!
+  * \brief The offset pointer in to the registry buffer that holds the value of R13 (aka esp)
+  * \sa gdb-7.0/gdb/arm-tdep.c
+  */
+#define ESP_OFFSET 13
+/*!
+  * \brief The offset pointer in to the registry buffer that holds the value of R14 (aka lr)
+  */
+#define LR_OFFSET 14
+/*!
+  * \brief The offset pointer in to the registry buffer that holds the value of R15 (aka pc)
+  */
+#define PC_OFFSET 15
+/*!
+  * \brief The offset pointer in to the registry buffer that holds the value of R11 (aka fp)
+  */
+#define FP_OFFSET 11
+#elif defined(__x86_64__)
+/*!
+  * \brief The offset pointer in to the registry buffer that holds the value of the RSP (%rsp)
+  * \sa sys/reg.h
+  */
+#define ESP_OFFSET 19
+/*!
+  * \brief The offset pointer in to the registry buffer that holds the value of the RIP (%rip)
+  */
+#define PC_OFFSET 16
+/*!
+  * \brief The offset pointer in to the registry buffer that holds the value of the RBP (%rbp)
+  */
+#define FP_OFFSET 4
+#else
+/*!
+  * \brief The offset pointer in tothe registry buffer that holds the value of the ESP (%esp)
+  * \sa sys/reg.h
+  * \sa gdb-7.0/gdb/i386-linux-tdep.c
+  */
+#define ESP_OFFSET 15
+/*!
+  * \brief The offset pointer in to the registry buffer that holds the value of the EIP (%eip)
+  */
+#define PC_OFFSET 12
+/*!
+  * \brief The offset pointer in to the registry buffer that holds the value of the EBP (%ebp)
+  */
+#define FP_OFFSET 5
+#endif
+
+#ifndef NT_FILE
+/*!
+  * \def NT_FILE
+  * The note type of the list of the file backed mappings of the process, missing from older elf.h
+  */
+#define NT_FILE 0x46494c45
+#endif
+
+#ifndef NT_GNU_BUILD_ID
+/*!
+  * \def NT_GNU_BUILD_ID
+  * The note type of the unique build id of an elf file, missing from older elf.h
+  */
+#define NT_GNU_BUILD_ID 3
+#define ELF_NOTE_GNU "GNU"
+#endif
+
+/*!
+  * \def CRASHING_THREAD
+  * The index of the crashing thread among the NT_PRSTATUS notes of a core.  The kernel writes the notes of
+  * the thread that received the fatal signal first.  pr_cursig holds the signal in the notes of every
+  * thread, so it does not tell the crashing thread apart.
+  */
+#define CRASHING_THREAD 0
+
+/*!
+  * \def RICH_CORE_NOTE_NAME
+  * The owner name of the notes that the core reducer adds to the reduced core file
+  */
+#define RICH_CORE_NOTE_NAME "RichCore"
+
+/*!
+  * \def NT_RICHCORE_BACKTRACE
+  * The note type of the backtraces that are made when the core is reduced, see unwinder.h for the layout.
+  * Debuggers interpret the types of unknown owners as the kernel types, so the value must not clash with them.
+  */
+#define NT_RICHCORE_BACKTRACE 0x52430001
+
+/*!
+  * \def NT_RICHCORE_MODULES
+  * The note type of the list of the elf files that were mapped in to the crashed process.
+  * The description is a uint32_t count followed by count entries of: uint64_t base, uint64_t size,
+  * the NUL terminated hex GNU build id (empty if unknown) and the NUL terminated path, padded to 4 bytes.
+  */
+#define NT_RICHCORE_MODULES 0x52430002
+
+/*!
+  * \def NT_RICHCORE_CHECKSUMS
+  * The note type of the CRC-32C checksums of the reduced core file, see crc32c.h.  The description is a
+  * uint32_t count, the uint32_t checksum of the elf header and the program headers and then count entries
+  * of: uint64_t file offset, uint64_t size and uint32_t checksum, one for the data of each segment except
+  * the segment of this note, in the order of the program headers.
+  */
+#define NT_RICHCORE_CHECKSUMS 0x52430003
+
 #endif // DEFINES_H
@@ -22,7 +22,10 @@
  */
 
 #include "elfbinaryreader.h"
+#include "symbolindex.h"
 
+#include <cxxabi.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
@@ -44,7 +47,9 @@ ElfBinaryReader::ElfBinaryReader()
     m_classSize(0),
     programHeaders(NULL),
     programHeaderNumber(0),
-    sectionHeaderStringIndex(0)
+    sectionHeaderStringIndex(0),
+    symbolIndex(NULL),
+    isSymbolIndexCreated(false)
 {
     current.section = NULL;
     current.sectionHeader = NULL;
@@ -227,8 +232,93 @@ Phdr *ElfBinaryReader::getSegmentByType(Elf_Word type)
 	return NULL; 
 }
 
+std::string ElfBinaryReader::buildId()
+{
+    const CurrentSectionData *sectionData = getSectionByName(".note.gnu.build-id");
+    if (!sectionData)
+        return std::string();
+
+    Elf_Data *data = elf_getdata(sectionData->section, NULL);
+    if (!data || !data->d_buf)
+        return std::string();
+
+    return readBuildId((const char *)data->d_buf, data->d_size);
+}
+
+std::string ElfBinaryReader::readBuildId(const char *notes, size_t size)
+{
+    std::string id;
+    const char *current = notes;
+    const char *end = notes + size;
+    while (current + sizeof(Nhdr) <= end)
+    {
+        const Nhdr *note = (const Nhdr *)current;
+        const char *name = current + sizeof(Nhdr);
+        const unsigned char *desc = (const unsigned char *)name + ((note->n_namesz + 3) & ~3);
+        if ((note->n_type == NT_GNU_BUILD_ID) && (note->n_namesz == sizeof(ELF_NOTE_GNU))
+            && (memcmp(name, ELF_NOTE_GNU, sizeof(ELF_NOTE_GNU)) == 0)
+            && ((const char *)desc + note->n_descsz <= end))
+        {
+            static const char hex[] = "0123456789abcdef";
+            for (unsigned int i = 0; i < note->n_descsz; i++)
+            {
+                id += hex[desc[i] >> 4];
+                id += hex[desc[i] & 0xf];
+            }
+            break;
+        }
+        current = (const char *)desc + ((note->n_descsz + 3) & ~3);
+    }
+
+    return id;
+}
+
+const char *ElfBinaryReader::findSymbol(ADDRESS address, ADDRESS *offset)
+{
+    if (!isSymbolIndexCreated)
+    {
+        isSymbolIndexCreated = true;
+        symbolIndex = new SymbolIndex();
+        if (!symbolIndex->create(this))
+        {
+            delete symbolIndex;
+            symbolIndex = NULL;
+        }
+    }
+
+    if (!symbolIndex)
+        return NULL;
+    return symbolIndex->findSymbol(address, offset);
+}
+
+std::string ElfBinaryReader::demangle(const char *name)
+{
+    if (!name)
+        return std::string();
+
+    //Only C++ names are mangled, a plain C name such as "f" would otherwise be read as a type
+    if (strncmp(name, "_Z", 2) != 0)
+        return name;
+
+    int status = 0;
+    char *demangled = abi::__cxa_demangle(name, NULL, NULL, &status);
+    if (!demangled)
+        return name;
+
+    std::string result(demangled);
+    free(demangled);
+    return result;
+}
+
 void ElfBinaryReader::close()
 {
+    if (symbolIndex)
+    {
+        delete symbolIndex;
+        symbolIndex = NULL;
+    }
+    isSymbolIndexCreated = false;
+
     if (file)
     {
         elf_end(file);
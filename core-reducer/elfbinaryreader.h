@@ -38,6 +38,9 @@
 #include <string>
 #include <libelf.h>
 
+//forward declerations
+class SymbolIndex;
+
 /*!
   * \brief A structure to store the most recently found section that matched certian criteria
   * This is done because it is common to request the same section multiple times in a row.  And under
@@ -77,6 +80,12 @@ public:
       */
     const Phdr *programHeader() const { return programHeaders; }
 
+    /*!
+      * \brief Get the number of program headers
+      * \returns The number of entries in programHeader()
+      */
+    size_t programHeaderCount() const { return programHeaderNumber; }
+
     /*!
       * \brief Get the bit size of the underlying elf file.
       * \returns Either ELFCLASS32 or ELFCLASS64
@@ -121,6 +130,37 @@ public:
 
 	Phdr *getSegmentByType(Elf_Word type);
 
+    /*!
+      * \brief Get the GNU build id of the file from its .note.gnu.build-id section
+      * \returns The build id as a lower case hex string, or an empty string if the file does not have one
+      */
+    std::string buildId();
+
+    /*!
+      * \brief Find the GNU build id in the contents of a notes section or segment
+      * \param notes A pointer to the notes
+      * \param size The size of the notes
+      * \returns The build id as a lower case hex string, or an empty string if there is no build id note
+      */
+    static std::string readBuildId(const char *notes, size_t size);
+
+    /*!
+      * \brief Find the function that contains an address
+      * \param address The address to look up, relative to the link address of the file
+      * \param offset If not NULL set to the offset of \a address from the start of the function
+      * \returns The raw (mangled) name of the function, or NULL if the address is not in a known function
+      * The symbol index is built from .symtab and .dynsym the first time it is needed.
+      * \sa SymbolIndex
+      */
+    const char *findSymbol(ADDRESS address, ADDRESS *offset = NULL);
+
+    /*!
+      * \brief Demangle a C++ symbol name
+      * \param name The raw name of the symbol
+      * \returns The demangled name, or \a name unchanged if it is not a mangled C++ name
+      */
+    static std::string demangle(const char *name);
+
     /*!
       * \brief Close the underlying file handles
       */
@@ -188,6 +228,12 @@ private:
 
     //! The section index of the section header strings (.shstrtab)
     size_t sectionHeaderStringIndex;
+
+    //! The functions of the file, created by the first call to findSymbol()
+    SymbolIndex *symbolIndex;
+
+    //! true once the creation of \a symbolIndex has been attempted
+    bool isSymbolIndexCreated;
 };
 
 #endif // ELFBINARYREADER_H
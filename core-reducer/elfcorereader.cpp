@@ -23,6 +23,7 @@
 
 #include "elfcorereader.h"
 
+#include <string.h>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -74,6 +75,21 @@ bool ElfCoreReader::initalize(const char *fileName)
     return true;
 }
 
+bool ElfCoreReader::initalize(char *image, size_t size)
+{
+    if (!image || (size < sizeof(Ehdr)) || (memcmp(image, ELFMAG, SELFMAG) != 0))
+        LOG_RETURN(LOG_ERR, false, "The core image does not appear to be an elf file.");
+
+    //The image is not read through libelf, its layout is checked here
+    elfHeader = (Ehdr *)image;
+    if ((elfHeader->e_phentsize != sizeof(Phdr)) || (elfHeader->e_phoff + elfHeader->e_phnum * sizeof(Phdr) > size))
+        LOG_RETURN(LOG_ERR, false, "The program headers of the core image are not valid.");
+
+    programHeaders = (Phdr *)(image + elfHeader->e_phoff);
+    fileSize = size;
+    return true;
+}
+
 const Phdr *ElfCoreReader::getSegmentByAddress(ADDRESS toMatch)
 {
     int first = 0;
@@ -111,6 +127,37 @@ const Phdr *ElfCoreReader::getSegmentByIndex(size_t index)
     return NULL;
 }
 
+bool ElfCoreReader::readFileNote(const char *desc, size_t size, std::vector<FileMapping> &mappings)
+{
+    //The core comes from a crashed process, nothing in it is trusted
+    if (size < 2 * sizeof(ADDRESS))
+        return false;
+
+    const ADDRESS *file = (const ADDRESS *)desc;
+    ADDRESS count = file[0];
+    ADDRESS pageSize = file[1];
+    if (count > (size / sizeof(ADDRESS) - 2) / 3)
+        return false;
+
+    const char *name = (const char *)(file + 2 + (count * 3));
+    const char *end = desc + size;
+    for (ADDRESS i = 0; i < count; i++)
+    {
+        const char *nameEnd = (const char *)memchr(name, '\0', end - name);
+        if (!nameEnd)
+            return false;
+
+        FileMapping mapping;
+        mapping.start = file[2 + (i * 3)];
+        mapping.end = file[3 + (i * 3)];
+        mapping.fileOffset = file[4 + (i * 3)] * pageSize;
+        mapping.name = name;
+        mappings.push_back(mapping);
+        name = nameEnd + 1;
+    }
+    return true;
+}
+
 const char *ElfCoreReader::getDataByOffset(size_t offset)
 {
     if (offset < fileSize)
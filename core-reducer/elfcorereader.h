@@ -37,10 +37,22 @@
 #include <libelf.h>
 #include "defines.h"
 #include <string>
+#include <vector>
 
 class ElfCoreReader
 {
 public:
+    /*!
+      * \brief A file backed memory mapping of the process, as read from the NT_FILE note
+      */
+    struct FileMapping
+    {
+        ADDRESS start;      //!< The first address of the mapping
+        ADDRESS end;        //!< The address one past the end of the mapping
+        ADDRESS fileOffset; //!< The offset in the file in bytes at which the mapping starts
+        const char *name;   //!< The path of the mapped file, it points in to the note
+    };
+
     /*!
       * \brief Constructor
       */
@@ -58,6 +70,14 @@ public:
       */
     bool initalize(const char *fileName);
 
+    /*!
+      * \brief Initalize the instance to work with a core image in memory
+      * \param image The start of the image, it must stay valid as long as the instance is used
+      * \param size The size of the image in bytes
+      * \return true on success, false otherwise
+      */
+    bool initalize(char *image, size_t size);
+
     /*!
       * \brief Get a pointer to the elf header of the underlying elf file
       * \return A pointer tot he header or NULL if the header is not present
@@ -102,6 +122,18 @@ public:
       */
     const Phdr *getSegmentByIndex(size_t index);
 
+    /*!
+      * \brief Read the file mappings from the description of an NT_FILE note
+      * \param desc The description of the note
+      * \param size The size of \a desc in bytes
+      * \param mappings The mappings are appended to this
+      * \return true if the whole note was read, false if it is cut or corrupt.  The mappings before
+      * the first one that does not fit in \a size are still appended.
+      * The description is the count and the page size, then count * (start, end, page offset) and
+      * finally the count file names, each ended by a '\0'.
+      */
+    static bool readFileNote(const char *desc, size_t size, std::vector<FileMapping> &mappings);
+
 private:
     /*!
       * \brief close the uderlying core file
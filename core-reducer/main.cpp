@@ -24,9 +24,17 @@
 #include "reducer.h"
 #include "rawelfwriter.h"
 #include "elfcorereader.h"
+#include "processsnapshot.h"
+#include "reductionpolicy.h"
 
 #include <iostream>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "../config.h"
 
@@ -40,7 +48,22 @@ void printUsage(char *progName)
             "\t-e executable\n"
             "\t[-a memory address]\n"
             "\t[-m maps file]\n"
-            "\t[-s]";
+            "\t[-d stack depth of non crashing threads]\n"
+            "\t[-c code window around program counters in anonymous memory]\n"
+            "\t[-f output format, elf (default) or minidump]\n"
+            "\t[-u maximum frames in a backtrace, 0 disables the backtraces]\n"
+            "\t[-t time limit of the unwinder in microseconds]\n"
+            "\t[-b backtrace text file]\n"
+            "\t[-s]\n"
+            "\t[--policy=policy file with the settings of the executable]\n"
+            "\t[--byte-budget=most bytes kept besides the stack of the crashing thread]\n"
+            "\t[--heap-depth=levels of pointers followed from the stacks in to the heap]\n"
+            "\t[--mappings=globs of the mapped files kept whole]\n"
+            "\t[--layout=packed (default) or aligned, memory segments at page aligned offsets that can be mapped]\n"
+            "\t[--threads=threads finding and copying the stacks, 0 for one per processor (default)]\n"
+            "\t[--notes=note types kept, e.g. prpsinfo,auxv,file,fpregset:crashing (default all)]\n"
+            "\t[--pid=process id --snapshot, reduce a running process instead of the input core]\n"
+            "\t[--pid=process id with -i, take only the notes from the input core and the memory from the process]";
     std::cout << std::endl;
 }
 
@@ -52,13 +75,65 @@ int main(int argc, char **argv)
     char *executable = NULL;
     char *mapsFile = NULL;
     ADDRESS heapAddress = 0;
-    bool stacksOnlyMode = false;
+    const char *policyFile = NULL;
+    ReductionPolicy::Settings commandLine;
+    Reducer::OutputFormat outputFormat = Reducer::ElfFormat;
+    size_t unwindFrames = 32;
+    long unwindTimeLimit = 20000;
+    char *backtraceFile = NULL;
+    int pid = 0;
+    bool isSnapshot = false;
+    unsigned int threads = 0;
+    char executablePath[PATH_MAX];
     int c;
 
-    while ((c = getopt(argc, argv, "hsi:o:e:a:m:")) != -1)
+    static const struct option options[] = {
+        { "pid", required_argument, NULL, 'p' },
+        { "snapshot", no_argument, NULL, 'S' },
+        { "policy", required_argument, NULL, 'P' },
+        { "byte-budget", required_argument, NULL, 'B' },
+        { "heap-depth", required_argument, NULL, 'H' },
+        { "mappings", required_argument, NULL, 'M' },
+        { "notes", required_argument, NULL, 'N' },
+        { "threads", required_argument, NULL, 'T' },
+        { "layout", required_argument, NULL, 'L' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    //The options given override the policy file
+    while ((c = getopt_long(argc, argv, "hsi:o:e:a:m:d:c:f:u:t:b:p:S", options, NULL)) != -1)
     {
+        bool isValid = true;
         switch (c)
         {
+        case 'P':
+            policyFile = optarg;
+            break;
+        case 'B':
+            isValid = commandLine.set("byte-budget", optarg);
+            break;
+        case 'H':
+            isValid = commandLine.set("heap-depth", optarg);
+            break;
+        case 'M':
+            isValid = commandLine.set("mappings", optarg);
+            break;
+        case 'N':
+            isValid = commandLine.set("notes", optarg);
+            break;
+        case 'L':
+            isValid = commandLine.set("layout", optarg);
+            break;
+        case 'T':
+            threads = strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            pid = strtol(optarg, NULL, 10);
+            break;
+        case 'S':
+            // take the state of a running process, it is stopped only while its memory is read
+            isSnapshot = true;
+            break;
         case 'i':
             inputFile = optarg;
             break;
@@ -74,10 +149,38 @@ int main(int argc, char **argv)
         case 'a':
             heapAddress = strtol(optarg, NULL, 16);
             break;
+        case 'd':
+            // bytes of stack to keep above the stack pointer of the threads that did not crash
+            isValid = commandLine.set("stack-depth", optarg);
+            break;
+        case 'c':
+            // bytes of runtime generated code to keep on each side of the pc, 0 to disable
+            isValid = commandLine.set("code-window", optarg);
+            break;
+        case 'f':
+            if (strcmp(optarg, "minidump") == 0)
+            {
+                outputFormat = Reducer::MinidumpFormat;
+            }
+            else if (strcmp(optarg, "elf") != 0)
+            {
+                printUsage(progName);
+                return -1;
+            }
+            break;
+        case 'u':
+            unwindFrames = strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            unwindTimeLimit = strtol(optarg, NULL, 0);
+            break;
+        case 'b':
+            backtraceFile = optarg;
+            break;
         case 's':
             // stacks only mode - copy only the stacks and notes sections from the origional core file
             //so we will have no debug information in the output file
-            stacksOnlyMode = true;
+            commandLine.set("link-map", "false");
             break;
         case 'h':
             printUsage(progName);
@@ -88,24 +191,101 @@ int main(int argc, char **argv)
             return -1;
             break;
         }
+        if (!isValid)
+        {
+            printUsage(progName);
+            return -1;
+        }
+    }
+
+    if ((pid > 0) && !executable)
+    {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "/proc/%d/exe", pid);
+        ssize_t length = readlink(path, executablePath, sizeof(executablePath) - 1);
+        if (length > 0)
+        {
+            executablePath[length] = '\0';
+            executable = executablePath;
+        }
     }
 
-    if (!outFile || !executable || !inputFile)
+    if (!outFile || !executable || (isSnapshot ? (pid <= 0) : !inputFile))
     {
         //There has been an error parsing some args so assume user error
         printUsage(progName);
         return -1;
     }
 
+    ReductionPolicy::Settings settings;
+    settings.codeWindow = 4096;
+    if (policyFile)
+    {
+        ReductionPolicy policy;
+        if (!policy.load(policyFile))
+        {
+            std::cerr << "Can not read the policy file " << policyFile << std::endl;
+            return -1;
+        }
+        settings.apply(policy.match(executable, ""));
+    }
+    settings.apply(commandLine);
+
     Reducer *reducer = new Reducer(outFile, heapAddress);
+    reducer->setStackDepth(settings.stackDepth);
+    reducer->setCodeWindow(settings.codeWindow);
+    reducer->setByteBudget(settings.byteBudget);
+    reducer->setHeapDepth(settings.heapDepth);
+    reducer->setMappingPatterns(settings.mappings);
+    reducer->setNoteFilter(settings.notes);
+    reducer->setThreads(threads);
+    reducer->setPageAligned(settings.isPageAligned);
+    reducer->setOutputFormat(outputFormat);
+    reducer->setUnwindLimits(unwindFrames, unwindTimeLimit);
+    reducer->setBacktraceFile(backtraceFile);
+
+    ProcessSnapshot snapshot;
+    snapshot.setCodeWindow(settings.codeWindow);
+    snapshot.setMappingPatterns(settings.mappings);
+    bool isMemoryRead = isSnapshot;
+    if (!isSnapshot && (pid > 0))
+    {
+        //The input is the core the kernel is writing, the process stays until all of it was read
+        int fd = (strcmp(inputFile, "-") == 0) ? STDIN_FILENO : open(inputFile, O_RDONLY);
+        std::string start;
+        isMemoryRead = (fd >= 0) && ProcessSnapshot::readCoreStart(fd, start)
+                       && snapshot.capture(pid, start.data(), start.size());
+        char buffer[65536];
+        while ((fd >= 0) && (read(fd, buffer, sizeof(buffer)) > 0))
+            ;
+        if (fd > STDIN_FILENO)
+            close(fd);
+        if (!isMemoryRead)
+        {
+            std::cerr << "Can not read the memory of process " << pid << std::endl;
+            delete(reducer);
+            return -1;
+        }
+    }
+    else if (isSnapshot)
+    {
+        if (!snapshot.capture(pid))
+        {
+            std::cerr << "Can not take a snapshot of process " << pid << std::endl;
+            delete(reducer);
+            return -1;
+        }
+        std::cerr << "Process " << pid << " was stopped for " << snapshot.stoppedTime() << " us" << std::endl;
+    }
 
-    if (!reducer->initalize(inputFile, executable))
+    if (!(isMemoryRead ? reducer->initalize(snapshot.image(), snapshot.imageSize(), executable)
+                     : reducer->initalize(inputFile, executable)))
     {
         delete(reducer);
         return -1;
     }
 
-    reducer->run(stacksOnlyMode, mapsFile);
+    reducer->run(!settings.isLinkMapIncluded, mapsFile);
 
     delete(reducer);
     return 0;
@@ -0,0 +1,618 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "minidumpwriter.h"
+#include "elfcorereader.h"
+
+#include <elf.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <stdio.h>
+#include <sys/utsname.h>
+
+#define align_power(address, alignSize) \
+(((address) + ((ADDRESS) 1 << (alignSize)) - 1) & ((ADDRESS) -1 << (alignSize)))
+
+//! The owner name of the notes written by the kernel
+#define CORE_NOTE_NAME "CORE"
+
+/*
+  * The minidump file format, see google-breakpad/src/google_breakpad/common/minidump_format.h
+  * All structures are packed, the Linux writers of breakpad and crashpad produce the same layout.
+  */
+//! "MDMP"
+#define MD_HEADER_SIGNATURE 0x504d444d
+#define MD_HEADER_VERSION 0x0000a793
+
+#define MD_THREAD_LIST_STREAM 3
+#define MD_MODULE_LIST_STREAM 4
+#define MD_MEMORY_LIST_STREAM 5
+#define MD_EXCEPTION_STREAM 6
+#define MD_SYSTEM_INFO_STREAM 7
+#define MD_LINUX_CMD_LINE 0x47670004
+#define MD_LINUX_AUXV 0x47670008
+
+#define MD_CPU_ARCHITECTURE_X86 0
+#define MD_CPU_ARCHITECTURE_ARM 5
+#define MD_CPU_ARCHITECTURE_AMD64 9
+#define MD_CPU_ARCHITECTURE_ARM64 12
+#define MD_CPU_ARCHITECTURE_UNKNOWN 0xffff
+#define MD_OS_LINUX 0x8201
+
+#define MD_CONTEXT_X86_FULL 0x00010007
+#define MD_CONTEXT_AMD64_FULL 0x00100007
+#define MD_CONTEXT_ARM_INTEGER 0x40000002
+
+typedef struct
+{
+    uint32_t signature;
+    uint32_t version;
+    uint32_t stream_count;
+    uint32_t stream_directory_rva;
+    uint32_t checksum;
+    uint32_t time_date_stamp;
+    uint64_t flags;
+} __attribute__((packed)) MDRawHeader;
+
+typedef struct
+{
+    uint32_t data_size;
+    uint32_t rva;
+} __attribute__((packed)) MDLocationDescriptor;
+
+typedef struct
+{
+    uint64_t start_of_memory_range;
+    MDLocationDescriptor memory;
+} __attribute__((packed)) MDMemoryDescriptor;
+
+typedef struct
+{
+    uint32_t stream_type;
+    MDLocationDescriptor location;
+} __attribute__((packed)) MDRawDirectory;
+
+typedef struct
+{
+    uint32_t thread_id;
+    uint32_t suspend_count;
+    uint32_t priority_class;
+    uint32_t priority;
+    uint64_t teb;
+    MDMemoryDescriptor stack;
+    MDLocationDescriptor thread_context;
+} __attribute__((packed)) MDRawThread;
+
+typedef struct
+{
+    uint64_t base_of_image;
+    uint32_t size_of_image;
+    uint32_t checksum;
+    uint32_t time_date_stamp;
+    uint32_t module_name_rva;
+    uint32_t version_info[13];
+    MDLocationDescriptor cv_record;
+    MDLocationDescriptor misc_record;
+    uint64_t reserved0;
+    uint64_t reserved1;
+} __attribute__((packed)) MDRawModule;
+
+typedef struct
+{
+    uint32_t exception_code;
+    uint32_t exception_flags;
+    uint64_t exception_record;
+    uint64_t exception_address;
+    uint32_t number_parameters;
+    uint32_t __align;
+    uint64_t exception_information[15];
+} __attribute__((packed)) MDException;
+
+typedef struct
+{
+    uint32_t thread_id;
+    uint32_t __align;
+    MDException exception_record;
+    MDLocationDescriptor thread_context;
+} __attribute__((packed)) MDRawExceptionStream;
+
+typedef struct
+{
+    uint16_t processor_architecture;
+    uint16_t processor_level;
+    uint16_t processor_revision;
+    uint8_t number_of_processors;
+    uint8_t product_type;
+    uint32_t major_version;
+    uint32_t minor_version;
+    uint32_t build_number;
+    uint32_t platform_id;
+    uint32_t csd_version_rva;
+    uint16_t suite_mask;
+    uint16_t reserved2;
+    uint8_t cpu[24];
+} __attribute__((packed)) MDRawSystemInfo;
+
+#ifdef ARM_REGS
+typedef struct
+{
+    uint32_t context_flags;
+    uint32_t iregs[16];
+    uint32_t cpsr;
+    uint64_t fpscr;
+    uint64_t regs[32];
+    uint32_t extra[8];
+} __attribute__((packed)) MDRawContext;
+#elif defined(__x86_64__)
+typedef struct
+{
+    uint64_t p1_home, p2_home, p3_home, p4_home, p5_home, p6_home;
+    uint32_t context_flags;
+    uint32_t mx_csr;
+    uint16_t cs, ds, es, fs, gs, ss;
+    uint32_t eflags;
+    uint64_t dr0, dr1, dr2, dr3, dr6, dr7;
+    uint64_t rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi;
+    uint64_t r8, r9, r10, r11, r12, r13, r14, r15;
+    uint64_t rip;
+    uint8_t flt_save[512];
+    uint8_t vector_register[416];
+    uint64_t vector_control;
+    uint64_t debug_control;
+    uint64_t last_branch_to_rip;
+    uint64_t last_branch_from_rip;
+    uint64_t last_exception_to_rip;
+    uint64_t last_exception_from_rip;
+} __attribute__((packed)) MDRawContext;
+#else
+typedef struct
+{
+    uint32_t context_flags;
+    uint32_t dr0, dr1, dr2, dr3, dr6, dr7;
+    uint8_t float_save[112];
+    uint32_t gs, fs, es, ds;
+    uint32_t edi, esi, ebx, edx, ecx, eax;
+    uint32_t ebp, eip, cs, eflags, esp, ss;
+    uint8_t extended_registers[512];
+} __attribute__((packed)) MDRawContext;
+#endif
+
+MinidumpWriter::MinidumpWriter()
+    : streamCount(0),
+    fd(-1),
+    machine(EM_NONE),
+    isWritten(false)
+{
+}
+
+MinidumpWriter::~MinidumpWriter()
+{
+    write();
+    close();
+}
+
+bool MinidumpWriter::initalize(const char *fileName, size_t numberOfSegments, size_t initalSizeOfData)
+{
+    if (!fileName)
+        LOG_RETURN(LOG_ERR, false, "File name not initalized ");
+
+    if ((fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+        LOG_RETURN(LOG_ERR, false, "Opening file '%s' failed.", fileName);
+
+    buffer.reserve(sizeof(MDRawHeader) + (numberOfSegments * sizeof(MDMemoryDescriptor)) + initalSizeOfData);
+    //The header is filled in once the location of the stream directory is known
+    append(NULL, sizeof(MDRawHeader));
+    return true;
+}
+
+void MinidumpWriter::copyElfHeader(const Ehdr *header)
+{
+    if (!header)
+        LOG_RETURN(LOG_ERR, , "Elf Header error: ");
+
+    machine = header->e_machine;
+}
+
+const char *MinidumpWriter::copySegment(const Phdr *headerToCopy, const char *data,
+                                        const char *overwriteData, size_t overwriteOffset,
+                                        size_t overwriteSize)
+{
+    if (!headerToCopy || !data)
+        LOG_RETURN(LOG_ERR, NULL, "No data in this segment/Not a valid segment.");
+
+    if (headerToCopy->p_type == PT_NOTE)
+    {
+        readNotes(data, headerToCopy->p_filesz);
+        return data;
+    }
+
+    Memory range;
+    range.start = headerToCopy->p_vaddr;
+    range.size = headerToCopy->p_filesz;
+    range.rva = append(data, headerToCopy->p_filesz);
+
+    if (overwriteData && ((overwriteOffset + overwriteSize) < headerToCopy->p_filesz))
+        memcpy(&buffer[range.rva + overwriteOffset], overwriteData, overwriteSize);
+
+    memory.push_back(range);
+    return &buffer[range.rva];
+}
+
+void MinidumpWriter::readNotes(const char *notes, size_t size)
+{
+    const Nhdr *current = (const Nhdr *)notes;
+    const Nhdr *end = (const Nhdr *)(notes + size);
+
+    while (current < end)
+    {
+        const char *name = (const char *)(current + 1);
+        const char *desc = name + align_power(current->n_namesz, 2);
+        const Nhdr *next = (const Nhdr *)(desc + align_power(current->n_descsz, 2));
+
+        //The types of other owners, such as the backtrace note of the reducer, have other meanings
+        if ((current->n_namesz != sizeof(CORE_NOTE_NAME)) || (memcmp(name, CORE_NOTE_NAME, sizeof(CORE_NOTE_NAME)) != 0))
+        {
+            current = next;
+            continue;
+        }
+
+        if (current->n_type == NT_PRSTATUS)
+        {
+            Thread thread;
+            memcpy(&thread.status, desc, sizeof(thread.status));
+            thread.pid = thread.status.pr_pid;
+            thread.signal = thread.status.pr_cursig;
+            //The thread that received the fatal signal is the first, see CRASHING_THREAD
+            threads.push_back(thread);
+        }
+        else if (current->n_type == NT_PRPSINFO)
+        {
+            const struct elf_prpsinfo *info = (const struct elf_prpsinfo *)desc;
+            commandLine.assign(info->pr_psargs, strnlen(info->pr_psargs, sizeof(info->pr_psargs)));
+        }
+        else if (current->n_type == NT_AUXV)
+        {
+            auxv.assign(desc, current->n_descsz);
+        }
+        else if (current->n_type == NT_FILE)
+        {
+            size_t descSize = ((const char *)end > desc) ? (const char *)end - desc : 0;
+            if (current->n_descsz < descSize)
+                descSize = current->n_descsz;
+            std::vector<ElfCoreReader::FileMapping> mappings;
+            ElfCoreReader::readFileNote(desc, descSize, mappings);
+            for (unsigned int i = 0; i < mappings.size(); i++)
+            {
+                //consecutive mappings of the same file make up one module
+                if (!modules.empty() && (modules.back().name == mappings.at(i).name))
+                {
+                    modules.back().end = mappings.at(i).end;
+                }
+                else
+                {
+                    Module module;
+                    module.base = mappings.at(i).start;
+                    module.end = mappings.at(i).end;
+                    module.name = mappings.at(i).name;
+                    modules.push_back(module);
+                }
+            }
+        }
+
+        current = next;
+    }
+}
+
+uint32_t MinidumpWriter::append(const void *data, size_t size)
+{
+    uint32_t rva = buffer.size();
+    if (data)
+        buffer.insert(buffer.end(), (const char *)data, (const char *)data + size);
+    else
+        buffer.resize(buffer.size() + size, 0);
+    return rva;
+}
+
+uint32_t MinidumpWriter::appendString(const std::string &string)
+{
+    //The strings are UTF-16, the paths and versions written here are plain ASCII
+    uint32_t length = string.size() * sizeof(uint16_t);
+    uint32_t rva = append(&length, sizeof(length));
+    for (unsigned int i = 0; i < string.size(); i++)
+    {
+        uint16_t character = (unsigned char)string[i];
+        append(&character, sizeof(character));
+    }
+    uint16_t terminator = 0;
+    append(&terminator, sizeof(terminator));
+    return rva;
+}
+
+uint32_t MinidumpWriter::appendContext(const Thread &thread)
+{
+    MDRawContext context;
+    memset(&context, 0, sizeof(context));
+    const elf_greg_t *regs = thread.status.pr_reg;
+
+#ifdef ARM_REGS
+    context.context_flags = MD_CONTEXT_ARM_INTEGER;
+    //r0 - r15 are stored in order followed by the cpsr
+    for (int i = 0; i < 16; i++)
+        context.iregs[i] = regs[i];
+    context.cpsr = regs[16];
+#elif defined(__x86_64__)
+    //see the order of struct user_regs_struct in sys/user.h
+    context.context_flags = MD_CONTEXT_AMD64_FULL;
+    context.r15 = regs[0];
+    context.r14 = regs[1];
+    context.r13 = regs[2];
+    context.r12 = regs[3];
+    context.rbp = regs[4];
+    context.rbx = regs[5];
+    context.r11 = regs[6];
+    context.r10 = regs[7];
+    context.r9 = regs[8];
+    context.r8 = regs[9];
+    context.rax = regs[10];
+    context.rcx = regs[11];
+    context.rdx = regs[12];
+    context.rsi = regs[13];
+    context.rdi = regs[14];
+    context.rip = regs[16];
+    context.cs = regs[17];
+    context.eflags = regs[18];
+    context.rsp = regs[19];
+    context.ss = regs[20];
+    context.ds = regs[23];
+    context.es = regs[24];
+    context.fs = regs[25];
+    context.gs = regs[26];
+#else
+    //see the order of struct user_regs_struct in sys/user.h
+    context.context_flags = MD_CONTEXT_X86_FULL;
+    context.ebx = regs[0];
+    context.ecx = regs[1];
+    context.edx = regs[2];
+    context.esi = regs[3];
+    context.edi = regs[4];
+    context.ebp = regs[5];
+    context.eax = regs[6];
+    context.ds = regs[7];
+    context.es = regs[8];
+    context.fs = regs[9];
+    context.gs = regs[10];
+    context.eip = regs[12];
+    context.cs = regs[13];
+    context.eflags = regs[14];
+    context.esp = regs[15];
+    context.ss = regs[16];
+#endif
+
+    return append(&context, sizeof(context));
+}
+
+void MinidumpWriter::addStream(uint32_t type, uint32_t rva, uint32_t size)
+{
+    MDRawDirectory entry;
+    entry.stream_type = type;
+    entry.location.rva = rva;
+    entry.location.data_size = size;
+    directory.insert(directory.end(), (const char *)&entry, (const char *)&entry + sizeof(entry));
+    streamCount++;
+}
+
+const MinidumpWriter::Memory *MinidumpWriter::findMemory(ADDRESS address) const
+{
+    for (unsigned int i = 0; i < memory.size(); i++)
+    {
+        if ((memory.at(i).start <= address) && (address < memory.at(i).start + memory.at(i).size))
+            return &memory.at(i);
+    }
+    return NULL;
+}
+
+void MinidumpWriter::writeThreadList()
+{
+    contextOffsets.clear();
+    for (unsigned int i = 0; i < threads.size(); i++)
+        contextOffsets.push_back(appendContext(threads.at(i)));
+
+    uint32_t count = threads.size();
+    uint32_t rva = append(&count, sizeof(count));
+    for (unsigned int i = 0; i < threads.size(); i++)
+    {
+        MDRawThread thread;
+        memset(&thread, 0, sizeof(thread));
+        thread.thread_id = threads.at(i).pid;
+        thread.thread_context.rva = contextOffsets.at(i);
+        thread.thread_context.data_size = sizeof(MDRawContext);
+
+        const Memory *stack = findMemory(threads.at(i).status.pr_reg[ESP_OFFSET]);
+        if (stack)
+        {
+            thread.stack.start_of_memory_range = stack->start;
+            thread.stack.memory.data_size = stack->size;
+            thread.stack.memory.rva = stack->rva;
+        }
+        append(&thread, sizeof(thread));
+    }
+    addStream(MD_THREAD_LIST_STREAM, rva, buffer.size() - rva);
+}
+
+void MinidumpWriter::writeModuleList()
+{
+    std::vector<uint32_t> nameOffsets;
+    for (unsigned int i = 0; i < modules.size(); i++)
+        nameOffsets.push_back(appendString(modules.at(i).name));
+
+    uint32_t count = modules.size();
+    uint32_t rva = append(&count, sizeof(count));
+    for (unsigned int i = 0; i < modules.size(); i++)
+    {
+        MDRawModule module;
+        memset(&module, 0, sizeof(module));
+        module.base_of_image = modules.at(i).base;
+        module.size_of_image = modules.at(i).end - modules.at(i).base;
+        module.module_name_rva = nameOffsets.at(i);
+        append(&module, sizeof(module));
+    }
+    addStream(MD_MODULE_LIST_STREAM, rva, buffer.size() - rva);
+}
+
+void MinidumpWriter::writeMemoryList()
+{
+    uint32_t count = memory.size();
+    uint32_t rva = append(&count, sizeof(count));
+    for (unsigned int i = 0; i < memory.size(); i++)
+    {
+        MDMemoryDescriptor descriptor;
+        descriptor.start_of_memory_range = memory.at(i).start;
+        descriptor.memory.data_size = memory.at(i).size;
+        descriptor.memory.rva = memory.at(i).rva;
+        append(&descriptor, sizeof(descriptor));
+    }
+    addStream(MD_MEMORY_LIST_STREAM, rva, buffer.size() - rva);
+}
+
+void MinidumpWriter::writeExceptionStream()
+{
+    if (threads.empty())
+        return;
+
+    const Thread &thread = threads.at(CRASHING_THREAD);
+    MDRawExceptionStream exception;
+    memset(&exception, 0, sizeof(exception));
+    exception.thread_id = thread.pid;
+    //On Linux the exception code is the signal number
+    exception.exception_record.exception_code = thread.signal;
+    exception.exception_record.exception_address = thread.status.pr_reg[PC_OFFSET];
+    exception.thread_context.rva = contextOffsets.at(CRASHING_THREAD);
+    exception.thread_context.data_size = sizeof(MDRawContext);
+
+    uint32_t rva = append(&exception, sizeof(exception));
+    addStream(MD_EXCEPTION_STREAM, rva, sizeof(exception));
+}
+
+void MinidumpWriter::writeSystemInfo()
+{
+    MDRawSystemInfo info;
+    memset(&info, 0, sizeof(info));
+
+    switch (machine)
+    {
+    case EM_386:
+        info.processor_architecture = MD_CPU_ARCHITECTURE_X86;
+        break;
+    case EM_X86_64:
+        info.processor_architecture = MD_CPU_ARCHITECTURE_AMD64;
+        break;
+    case EM_ARM:
+        info.processor_architecture = MD_CPU_ARCHITECTURE_ARM;
+        break;
+#ifdef EM_AARCH64
+    case EM_AARCH64:
+        info.processor_architecture = MD_CPU_ARCHITECTURE_ARM64;
+        break;
+#endif
+    default:
+        info.processor_architecture = MD_CPU_ARCHITECTURE_UNKNOWN;
+        break;
+    }
+
+    long processors = sysconf(_SC_NPROCESSORS_CONF);
+    info.number_of_processors = (processors > 0 && processors < 256) ? processors : 0;
+    info.platform_id = MD_OS_LINUX;
+
+    //The kernel version is stored in the version numbers and in full in the csd version string
+    std::string version;
+    struct utsname name;
+    if (uname(&name) == 0)
+    {
+        unsigned int major = 0, minor = 0, build = 0;
+        sscanf(name.release, "%u.%u.%u", &major, &minor, &build);
+        info.major_version = major;
+        info.minor_version = minor;
+        info.build_number = build;
+        version = std::string(name.sysname) + " " + name.release + " " + name.version + " " + name.machine;
+    }
+    info.csd_version_rva = appendString(version);
+
+    uint32_t rva = append(&info, sizeof(info));
+    addStream(MD_SYSTEM_INFO_STREAM, rva, sizeof(info));
+}
+
+void MinidumpWriter::writeLinuxStreams()
+{
+    if (!commandLine.empty())
+    {
+        uint32_t rva = append(commandLine.data(), commandLine.size());
+        addStream(MD_LINUX_CMD_LINE, rva, commandLine.size());
+    }
+    if (!auxv.empty())
+    {
+        uint32_t rva = append(auxv.data(), auxv.size());
+        addStream(MD_LINUX_AUXV, rva, auxv.size());
+    }
+}
+
+bool MinidumpWriter::write()
+{
+    if (isWritten || buffer.empty())
+        return true;
+
+    writeThreadList();
+    writeModuleList();
+    writeMemoryList();
+    writeExceptionStream();
+    writeSystemInfo();
+    writeLinuxStreams();
+
+    uint32_t directoryOffset = append(&directory[0], directory.size());
+
+    MDRawHeader header;
+    memset(&header, 0, sizeof(header));
+    header.signature = MD_HEADER_SIGNATURE;
+    header.version = MD_HEADER_VERSION;
+    header.stream_count = streamCount;
+    header.stream_directory_rva = directoryOffset;
+    header.time_date_stamp = time(NULL);
+    memcpy(&buffer[0], &header, sizeof(header));
+
+    isWritten = true;
+    if (::write(fd, &buffer[0], buffer.size()) != (ssize_t)buffer.size())
+        LOG_RETURN(LOG_ERR, false, "Error writing file to disk");
+
+    return true;
+}
+
+void MinidumpWriter::close()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
@@ -0,0 +1,229 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file minidumpwriter.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class MinidumpWriter
+  * \brief Write the reduced core in the Breakpad/Crashpad minidump format instead of as an elf file.
+  * The thread list, the thread contexts and the exception record are taken from the NT_PRSTATUS notes,
+  * the module list from the NT_FILE note and every PT_LOAD segment is added to the memory list.
+  * The file is built in memory and is only written to disk when it is complete.
+  */
+
+#ifndef MINIDUMPWRITER_H
+#define MINIDUMPWRITER_H
+
+#include "defines.h"
+#include "corewriter.h"
+#include <sys/procfs.h>
+#include <string>
+#include <vector>
+
+class MinidumpWriter : public CoreWriter
+{
+public:
+    /*!
+      * \brief Constructor
+      */
+    MinidumpWriter();
+
+    /*!
+      * \brief destructor
+      */
+    virtual ~MinidumpWriter();
+
+    /*!
+      * \brief initalize the class so that we can start to create the new minidump file.
+      * \param fileName The path of the file to which we are going to write the finished file
+      * \param numberOfSegments The number of segments that are going to be copied.
+      * \param initalSizeOfData The inital amount of space to reserve for the file.
+      * \return true on success, false otherwise
+      */
+    virtual bool initalize(const char *fileName, size_t numberOfSegments, size_t initalSizeOfData);
+
+    /*!
+      * \brief Take the machine type of the crashed process from the elf header of the core file
+      * \param header A pointer to the elf header of the origional core file
+      */
+    virtual void copyElfHeader(const Ehdr *header);
+
+    /*!
+      * \brief Add a segment of the origional core file to the minidump
+      * A PT_NOTE segment is parsed for the threads, modules and command line, the data of a PT_LOAD segment
+      * is added to the memory list.
+      * \param programHeader The program header that contains the information about the segment
+      * \param data A pointer to the data for the segment that is to be copied
+      * \param overwriteData The data to replace some existing data in the segment with
+      * \param overwriteOffset The position relative to the start of the segment into which \a overwriteData is to be copied
+      * \param overwriteSize The amount of the segment that is going to be overwritten by \a overwriteData
+      * \returns On success a pointer to the copy of the segment data, NULL otherwise
+      */
+    virtual const char *copySegment(const Phdr *programHeader, const char *data,
+                                    const char *overwriteData = NULL, size_t overwriteOffset = 0,
+                                    size_t overwriteSize = 0);
+
+    /*!
+      * \brief Add the streams and the stream directory and write the file to disk
+      * \return true on success false otherwise.
+      */
+    virtual bool write();
+
+private:
+    /*!
+      * \brief A thread of the crashed process
+      */
+    struct Thread
+    {
+        int pid;                       //!< The id of the thread
+        int signal;                    //!< The signal that was pending for the thread
+        struct elf_prstatus status;    //!< A copy of the register state of the thread
+    };
+
+    /*!
+      * \brief A file that was mapped in to the crashed process
+      */
+    struct Module
+    {
+        ADDRESS base;     //!< The lowest address of the file mappings
+        ADDRESS end;      //!< The address one past the end of the highest file mapping
+        std::string name; //!< The path of the file
+    };
+
+    /*!
+      * \brief A range of memory that was added to the memory list
+      */
+    struct Memory
+    {
+        ADDRESS start;    //!< The virtual memory address of the range
+        uint32_t size;    //!< The size of the range
+        uint32_t rva;     //!< The offset of the copy of the memory in the file
+    };
+
+    /*!
+      * \brief Read the threads, the file mappings and the command line from a notes segment
+      * \param notes A pointer to the start of the notes
+      * \param size The size of the notes segment
+      */
+    void readNotes(const char *notes, size_t size);
+
+    /*!
+      * \brief Add data to the end of the file
+      * \param data A pointer to the data to add, if NULL the space is zero filled
+      * \param size The amount of data to add
+      * \return The offset of the data within the file
+      */
+    uint32_t append(const void *data, size_t size);
+
+    /*!
+      * \brief Add a string to the end of the file as a length prefixed UTF-16 MDString
+      * \param string The string to add
+      * \return The offset of the string within the file
+      */
+    uint32_t appendString(const std::string &string);
+
+    /*!
+      * \brief Add the register state of a thread to the end of the file in the minidump context format
+      * \param thread The thread whose registers are to be written
+      * \return The offset of the context within the file
+      */
+    uint32_t appendContext(const Thread &thread);
+
+    /*!
+      * \brief Add an entry to the stream directory
+      * \param type The MD_*_STREAM type of the stream
+      * \param rva The offset of the stream in the file
+      * \param size The size of the stream
+      */
+    void addStream(uint32_t type, uint32_t rva, uint32_t size);
+
+    /*!
+      * \brief Find the memory list entry that contains an address
+      * \param address The address to find
+      * \return A pointer to the entry or NULL if the memory is not in the minidump
+      */
+    const Memory *findMemory(ADDRESS address) const;
+
+    /*!
+      * \brief Add the thread list stream, the contexts of the threads are written with it
+      */
+    void writeThreadList();
+
+    /*!
+      * \brief Add the module list stream and the names of the modules
+      */
+    void writeModuleList();
+
+    /*!
+      * \brief Add the memory list stream that describes the memory copied by copySegment()
+      */
+    void writeMemoryList();
+
+    /*!
+      * \brief Add the exception stream for the thread that received the fatal signal
+      */
+    void writeExceptionStream();
+
+    /*!
+      * \brief Add the system information stream for the machine the reducer runs on
+      */
+    void writeSystemInfo();
+
+    /*!
+      * \brief Add the Linux specific command line and auxiliary vector streams
+      */
+    void writeLinuxStreams();
+
+    /*!
+      * \brief close the underlying file handle
+      */
+    void close();
+
+private:
+    //! The minidump file as it is built
+    std::vector<char> buffer;
+    //! The raw stream directory entries
+    std::vector<char> directory;
+    //! The number of entries in the stream directory
+    uint32_t streamCount;
+    //! descriptor for system file
+    int fd;
+    //! The elf machine type of the crashed process
+    Elf_Word machine;
+    //! The threads in the order in which they were found in the notes
+    std::vector<Thread> threads;
+    //! The offset of the context of each of the threads, written by writeThreadList()
+    std::vector<uint32_t> contextOffsets;
+    //! The files that were mapped in to the process
+    std::vector<Module> modules;
+    //! The memory ranges that have been copied
+    std::vector<Memory> memory;
+    //! The command line of the process
+    std::string commandLine;
+    //! The auxiliary vector of the process
+    std::string auxv;
+    //! True once the file has been written
+    bool isWritten;
+};
+
+#endif // MINIDUMPWRITER_H
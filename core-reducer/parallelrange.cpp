@@ -0,0 +1,98 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "parallelrange.h"
+
+#include <pthread.h>
+#include <unistd.h>
+#include <vector>
+
+//The most threads that are started, the work is memory bound long before this
+#define MAX_PARALLEL_THREADS 16
+
+/*!
+  * \brief A part of the range that is run in a thread
+  */
+struct RangePart
+{
+    ParallelRange::Work work;   //!< The function to run
+    void *context;              //!< The context of \a work
+    size_t begin;               //!< The first item
+    size_t end;                 //!< The item after the last
+};
+
+/*!
+  * \brief The start routine of a thread, runs its part of the range
+  */
+static void *runPart(void *argument)
+{
+    RangePart *part = (RangePart *)argument;
+    part->work(part->context, part->begin, part->end);
+    return NULL;
+}
+
+void ParallelRange::run(size_t count, unsigned int threads, size_t minimum, Work work, void *context)
+{
+    if (!threads)
+        threads = processors();
+    if (minimum && (count / minimum < threads))
+        threads = count / minimum;
+    if (threads <= 1)
+    {
+        if (count)
+            work(context, 0, count);
+        return;
+    }
+
+    std::vector<RangePart> parts(threads);
+    std::vector<pthread_t> workers(threads);
+    std::vector<bool> isStarted(threads, false);
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        parts[i].work = work;
+        parts[i].context = context;
+        parts[i].begin = (count * i) / threads;
+        parts[i].end = (count * (i + 1)) / threads;
+    }
+
+    //the calling thread takes the first part
+    for (unsigned int i = 1; i < threads; i++)
+        isStarted[i] = (pthread_create(&workers[i], NULL, runPart, &parts[i]) == 0);
+    runPart(&parts[0]);
+
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        if (isStarted[i])
+            pthread_join(workers[i], NULL);
+        else
+            runPart(&parts[i]);
+    }
+}
+
+unsigned int ParallelRange::processors()
+{
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processors > MAX_PARALLEL_THREADS)
+        return MAX_PARALLEL_THREADS;
+    return (processors > 0) ? processors : 1;
+}
@@ -0,0 +1,66 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file parallelrange.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class ParallelRange
+  * \brief Run a function over a range of items that is split between threads.
+  * Each thread is given a contiguous part of the range, so the results stored by the index of the
+  * item are the same as if the range was run in one thread.
+  */
+
+#ifndef PARALLELRANGE_H
+#define PARALLELRANGE_H
+
+#include <stddef.h>
+
+class ParallelRange
+{
+public:
+    /*!
+      * \brief The function that is run for a part of the range
+      * \param context The context given to run()
+      * \param begin The first item of the part
+      * \param end The item after the last item of the part
+      */
+    typedef void (*Work)(void *context, size_t begin, size_t end);
+
+    /*!
+      * \brief Run a function over the items 0 to count - 1 and wait for all of it to finish
+      * \param count The number of items
+      * \param threads The most threads to use, 0 for one per processor.  The calling thread is one of them.
+      * \param minimum The fewest items that are worth a thread of their own
+      * \param work The function to run
+      * \param context Passed to \a work
+      * If a thread can not be started its part is run in the calling thread.
+      */
+    static void run(size_t count, unsigned int threads, size_t minimum, Work work, void *context);
+
+    /*!
+      * \brief Get the number of threads that run() uses for 0
+      */
+    static unsigned int processors();
+};
+
+#endif // PARALLELRANGE_H
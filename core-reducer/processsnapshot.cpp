@@ -0,0 +1,905 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "processsnapshot.h"
+#include "reductionpolicy.h"
+
+#include <algorithm>
+#include <set>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+#include <link.h>
+#include <sys/ptrace.h>
+#include <sys/procfs.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+
+//The ptrace requests of newer kernels, missing from older headers
+#ifndef PTRACE_GETREGSET
+#define PTRACE_GETREGSET 0x4204
+#endif
+#ifndef PTRACE_SEIZE
+#define PTRACE_SEIZE 0x4206
+#endif
+#ifndef PTRACE_INTERRUPT
+#define PTRACE_INTERRUPT 0x4207
+#endif
+#ifndef PTRACE_EVENT_STOP
+#define PTRACE_EVENT_STOP 128
+#endif
+
+//The bytes below the stack pointer that a function may use without moving it
+#define STACK_RED_ZONE 128
+//The most entries followed in the link map, it is not trusted to end
+#define MAX_LINK_MAP_ENTRIES 4096
+//The most ranges read with one system call
+#define READ_BATCH 1024
+//The most pages kept in the page cache
+#define PAGE_CACHE_SIZE 64
+//The most bytes of headers and notes read from the beginning of a core
+#define MAX_CORE_START (16 * 1024 * 1024)
+//The note name of the kernel notes
+#define CORE_NOTE_NAME "CORE"
+
+#define align_power(address, alignSize) \
+(((address) + ((ADDRESS) 1 << (alignSize)) - 1) & ((ADDRESS) -1 << (alignSize)))
+
+//The identification of the native core files
+#if __WORDSIZE == 32
+#define CORE_CLASS ELFCLASS32
+#else
+#define CORE_CLASS ELFCLASS64
+#endif
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+#define CORE_DATA ELFDATA2LSB
+#else
+#define CORE_DATA ELFDATA2MSB
+#endif
+#if defined(__x86_64__)
+#define CORE_MACHINE EM_X86_64
+#elif defined(__i386__)
+#define CORE_MACHINE EM_386
+#elif defined(__aarch64__)
+#define CORE_MACHINE EM_AARCH64
+#else
+#define CORE_MACHINE EM_ARM
+#endif
+
+typedef struct elf_prstatus Status;
+typedef struct elf_prpsinfo Info;
+
+/*!
+  * \brief Read the memory of another process
+  * \return The number of bytes read, -1 on errors
+  */
+static ssize_t readProcessMemory(pid_t pid, const struct iovec *local, unsigned long localCount,
+                                 const struct iovec *remote, unsigned long remoteCount)
+{
+#ifdef SYS_process_vm_readv
+    return syscall(SYS_process_vm_readv, pid, local, localCount, remote, remoteCount, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+/*!
+  * \brief Read from a descriptor until a string has grown to a size
+  * \return true if the size was reached, false on errors or at the end of the input
+  */
+static bool readUntil(int fd, std::string &contents, size_t size)
+{
+    char buffer[4096];
+    while (contents.size() < size)
+    {
+        ssize_t count = read(fd, buffer, std::min(sizeof(buffer), size - contents.size()));
+        if ((count < 0) && (errno == EINTR))
+            continue;
+        if (count <= 0)
+            return false;
+        contents.append(buffer, count);
+    }
+    return true;
+}
+
+/*!
+  * \brief Read a whole file of /proc
+  * \return true on success, false if the file can not be read
+  */
+static bool readProcFile(const char *fileName, std::string &contents)
+{
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    char buffer[4096];
+    ssize_t count;
+    contents.clear();
+    while ((count = read(fd, buffer, sizeof(buffer))) > 0)
+        contents.append(buffer, count);
+    close(fd);
+    return count == 0;
+}
+
+ProcessSnapshot::ProcessSnapshot()
+    : pid(0),
+    codeWindow(4096),
+    pageSize(4096),
+    memory(-1),
+    isDumping(false),
+    isStopped(false),
+    stopped(0)
+{
+}
+
+ProcessSnapshot::~ProcessSnapshot()
+{
+    resumeThreads();
+    if (memory >= 0)
+        close(memory);
+}
+
+bool ProcessSnapshot::capture(pid_t pid)
+{
+    this->pid = pid;
+    pageSize = sysconf(_SC_PAGESIZE);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool success = stopThreads() && readThreads() && readProcess();
+    if (success)
+    {
+        selectRanges();
+        success = createImage();
+    }
+    resumeThreads();
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stopped = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+
+    if (!success)
+        data.clear();
+    return success;
+}
+
+bool ProcessSnapshot::capture(pid_t pid, const char *core, size_t size)
+{
+    this->pid = pid;
+    pageSize = sysconf(_SC_PAGESIZE);
+    isDumping = true;
+
+    //The threads are already stopped by the kernel, which waits for the core to be read
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/%d/mem", pid);
+    memory = open(path, O_RDONLY);
+    if (memory < 0)
+        LOG_RETURN(LOG_ERR, false, "Can not open the memory of process %d: %s", pid, strerror(errno));
+
+    bool success = readCoreNotes(core, size) && readMappings();
+    if (success)
+    {
+        selectRanges();
+        success = createImage();
+    }
+
+    if (!success)
+        data.clear();
+    return success;
+}
+
+bool ProcessSnapshot::readCoreStart(int fd, std::string &start)
+{
+    //The kernel writes the program headers and the notes before any of the memory
+    if (!readUntil(fd, start, sizeof(Ehdr)))
+        return false;
+
+    const Ehdr *header = (const Ehdr *)start.data();
+    if ((memcmp(header->e_ident, ELFMAG, SELFMAG) != 0) || (header->e_ident[EI_CLASS] != CORE_CLASS)
+        || (header->e_type != ET_CORE) || (header->e_phentsize != sizeof(Phdr)) || !header->e_phnum
+        || (header->e_phnum == PN_XNUM) || (header->e_phoff > MAX_CORE_START))
+        return false;
+
+    size_t headersEnd = header->e_phoff + header->e_phnum * sizeof(Phdr);
+    if (!readUntil(fd, start, headersEnd))
+        return false;
+
+    header = (const Ehdr *)start.data();
+    const Phdr *headers = (const Phdr *)(start.data() + header->e_phoff);
+    for (unsigned int i = 0; i < header->e_phnum; i++)
+    {
+        if (headers[i].p_type != PT_NOTE)
+            continue;
+        if ((headers[i].p_offset < headersEnd) || (headers[i].p_offset + headers[i].p_filesz > MAX_CORE_START))
+            return false;
+        return readUntil(fd, start, headers[i].p_offset + headers[i].p_filesz);
+    }
+    return false;
+}
+
+bool ProcessSnapshot::readCoreNotes(const char *core, size_t size)
+{
+    const Ehdr *header = (const Ehdr *)core;
+    if ((size < sizeof(Ehdr)) || (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0)
+        || (header->e_ident[EI_CLASS] != CORE_CLASS) || (header->e_machine != CORE_MACHINE)
+        || (header->e_phentsize != sizeof(Phdr)) || (header->e_phoff + header->e_phnum * sizeof(Phdr) > size))
+        LOG_RETURN(LOG_ERR, false, "The core of process %d is not a native core", pid);
+
+    const Phdr *headers = (const Phdr *)(core + header->e_phoff);
+    for (unsigned int i = 0; i < header->e_phnum; i++)
+    {
+        if ((headers[i].p_type == PT_NOTE) && (headers[i].p_offset + headers[i].p_filesz <= size))
+        {
+            notes.assign(core + headers[i].p_offset, core + headers[i].p_offset + headers[i].p_filesz);
+            break;
+        }
+    }
+
+    //The notes are kept as the kernel wrote them, the thread that crashed is the first one
+    for (size_t offset = 0; offset + sizeof(Nhdr) <= notes.size();)
+    {
+        const Nhdr *note = (const Nhdr *)&notes[offset];
+        size_t desc = offset + align_power(sizeof(Nhdr) + note->n_namesz, 2);
+        size_t next = desc + align_power(note->n_descsz, 2);
+        if ((next > notes.size()) || (next <= offset))
+            break;
+
+        if ((note->n_type == NT_PRSTATUS) && (note->n_descsz >= sizeof(Status)))
+        {
+            Thread thread;
+            thread.tid = ((const Status *)&notes[desc])->pr_pid;
+            thread.signal = ((const Status *)&notes[desc])->pr_cursig;
+            thread.status.assign(&notes[desc], &notes[desc] + note->n_descsz);
+            threads.push_back(thread);
+        }
+        else if (note->n_type == NT_AUXV)
+        {
+            auxv.assign(&notes[desc], note->n_descsz);
+        }
+        else if ((note->n_type == NT_PRPSINFO) && (note->n_descsz >= sizeof(Info))
+                 && (((const Info *)&notes[desc])->pr_pid != pid))
+        {
+            LOG_RETURN(LOG_ERR, false, "The core is not of process %d", pid);
+        }
+        offset = next;
+    }
+
+    if (threads.empty())
+        LOG_RETURN(LOG_ERR, false, "The core of process %d has no threads", pid);
+    return true;
+}
+
+bool ProcessSnapshot::stopThreads()
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+
+    //The threads that are started while the others are seized show up when the directory is read again
+    std::set<pid_t> seized;
+    for (bool isNew = true; isNew;)
+    {
+        isNew = false;
+        DIR *dir = opendir(path);
+        if (!dir)
+            LOG_RETURN(LOG_ERR, false, "Can not list the threads of process %d", pid);
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)))
+        {
+            pid_t tid = strtol(entry->d_name, NULL, 10);
+            if ((tid <= 0) || seized.count(tid))
+                continue;
+
+            if (ptrace((__ptrace_request)PTRACE_SEIZE, tid, NULL, NULL) != 0)
+            {
+                //the thread exited
+                if (errno == ESRCH)
+                    continue;
+                closedir(dir);
+                LOG_RETURN(LOG_ERR, false, "Can not attach to thread %d: %s", tid, strerror(errno));
+            }
+            seized.insert(tid);
+            isStopped = true;
+            isNew = true;
+
+            Thread thread;
+            thread.tid = tid;
+            thread.signal = 0;
+            threads.push_back(thread);
+            ptrace((__ptrace_request)PTRACE_INTERRUPT, tid, NULL, NULL);
+        }
+        closedir(dir);
+    }
+
+    //The stops are waited for only after all of the threads were interrupted, so they stop together
+    for (unsigned int i = 0; i < threads.size();)
+    {
+        int status = 0;
+        pid_t result;
+        while (((result = waitpid(threads.at(i).tid, &status, __WALL)) < 0) && (errno == EINTR))
+            ;
+        if ((result < 0) || !WIFSTOPPED(status))
+        {
+            threads.erase(threads.begin() + i);
+            continue;
+        }
+
+        //A signal that stopped the thread before the interrupt did is delivered when it is resumed
+        if ((status >> 16) != PTRACE_EVENT_STOP)
+            threads.at(i).signal = WSTOPSIG(status);
+        i++;
+    }
+
+    //The debugger takes the first thread as the one that stopped the process, which is the main thread
+    for (unsigned int i = 1; i < threads.size(); i++)
+    {
+        if (threads.at(i).tid == pid)
+            std::swap(threads.at(0), threads.at(i));
+    }
+
+    if (threads.empty())
+        LOG_RETURN(LOG_ERR, false, "Process %d has no threads left", pid);
+    return true;
+}
+
+void ProcessSnapshot::resumeThreads()
+{
+    if (!isStopped)
+        return;
+
+    for (unsigned int i = 0; i < threads.size(); i++)
+        ptrace(PTRACE_DETACH, threads.at(i).tid, NULL, (void *)(long)threads.at(i).signal);
+    isStopped = false;
+}
+
+bool ProcessSnapshot::readThreads()
+{
+    for (unsigned int i = 0; i < threads.size(); i++)
+    {
+        Status status;
+        memset(&status, 0, sizeof(status));
+        struct iovec registers = { &status.pr_reg, sizeof(status.pr_reg) };
+        if (ptrace((__ptrace_request)PTRACE_GETREGSET, threads.at(i).tid, (void *)NT_PRSTATUS, &registers) != 0)
+            LOG_RETURN(LOG_ERR, false, "Can not read the registers of thread %d: %s", threads.at(i).tid,
+                       strerror(errno));
+
+        status.pr_pid = threads.at(i).tid;
+        status.pr_cursig = threads.at(i).signal;
+        threads.at(i).status.assign((char *)&status, (char *)&status + sizeof(status));
+    }
+    return true;
+}
+
+bool ProcessSnapshot::readProcess()
+{
+    if (!readMappings())
+        return false;
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/%d/auxv", pid);
+    if (!readProcFile(path, auxv))
+        LOG_RETURN(LOG_ERR, false, "Can not read the auxiliary vector of process %d", pid);
+
+    snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+    readProcFile(path, commandLine);
+    std::replace(commandLine.begin(), commandLine.end(), '\0', ' ');
+    while (!commandLine.empty() && (commandLine[commandLine.size() - 1] == ' '))
+        commandLine.erase(commandLine.size() - 1);
+
+    snprintf(path, sizeof(path), "/proc/%d/comm", pid);
+    readProcFile(path, command);
+    if (!command.empty() && (command[command.size() - 1] == '\n'))
+        command.erase(command.size() - 1);
+    return true;
+}
+
+bool ProcessSnapshot::readMappings()
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/%d/maps", pid);
+    FILE *file = fopen(path, "r");
+    if (!file)
+        LOG_RETURN(LOG_ERR, false, "Can not read the mappings of process %d", pid);
+
+    char line[PATH_MAX + 128];
+    while (fgets(line, sizeof(line), file))
+    {
+        //start-end perms offset dev inode path
+        unsigned long start, end, offset;
+        char permissions[5];
+        int pathStart = 0;
+        if (sscanf(line, "%lx-%lx %4s %lx %*s %*s %n", &start, &end, permissions, &offset, &pathStart) < 4)
+            continue;
+
+        Mapping mapping;
+        mapping.start = start;
+        mapping.end = end;
+        mapping.offset = offset;
+        mapping.flags = ((permissions[0] == 'r') ? PF_R : 0) | ((permissions[1] == 'w') ? PF_W : 0)
+                        | ((permissions[2] == 'x') ? PF_X : 0);
+        mapping.path = pathStart ? line + pathStart : "";
+        if (!mapping.path.empty() && (mapping.path[mapping.path.size() - 1] == '\n'))
+            mapping.path.erase(mapping.path.size() - 1);
+        mappings.push_back(mapping);
+    }
+    fclose(file);
+
+    if (mappings.empty())
+        LOG_RETURN(LOG_ERR, false, "Process %d has no mappings", pid);
+    return true;
+}
+
+void ProcessSnapshot::selectRanges()
+{
+    for (unsigned int i = 0; i < threads.size(); i++)
+    {
+        const Status *status = (const Status *)&threads.at(i).status[0];
+
+        //The live part of the stack, from the stack pointer to the end of its mapping
+        ADDRESS stackPointer = (ADDRESS)status->pr_reg[ESP_OFFSET];
+        int stack = findMapping(stackPointer);
+        if (stack >= 0)
+            addRange(std::max(stackPointer - STACK_RED_ZONE, mappings.at(stack).start), mappings.at(stack).end);
+
+        //Code generated at runtime has no file on disk, so the memory is its only copy
+#ifdef LR_OFFSET
+        ADDRESS addresses[] = { (ADDRESS)status->pr_reg[PC_OFFSET], (ADDRESS)status->pr_reg[LR_OFFSET] };
+#else
+        ADDRESS addresses[] = { (ADDRESS)status->pr_reg[PC_OFFSET] };
+#endif
+        for (unsigned int j = 0; codeWindow && (j < sizeof(addresses) / sizeof(addresses[0])); j++)
+        {
+            int code = findMapping(addresses[j]);
+            if ((code < 0) || !(mappings.at(code).flags & PF_X) || isFile(mappings.at(code)))
+                continue;
+
+            const Mapping &mapping = mappings.at(code);
+            if (mapping.end - mapping.start <= 2 * codeWindow)
+                addRange(mapping.start, mapping.end);
+            else
+                addRange(std::max(addresses[j] - codeWindow, mapping.start),
+                         std::min(addresses[j] + codeWindow, mapping.end));
+        }
+    }
+
+    //The kernel dumps the written mappings of a file whole, the reducer keeps those that it is asked to
+    for (unsigned int i = 0; !mappingPatterns.empty() && (i < mappings.size()); i++)
+    {
+        const Mapping &mapping = mappings.at(i);
+        if (isFile(mapping) && (mapping.flags & PF_W)
+            && ReductionPolicy::isMappingWanted(mappingPatterns, mapping.path))
+            addRange(mapping.start, mapping.end);
+    }
+
+    selectElfHeaders();
+    selectLinkMap();
+}
+
+void ProcessSnapshot::selectElfHeaders()
+{
+    //As the kernel does, the first page of a mapped elf file, the build id is found from its notes
+    for (unsigned int i = 0; i < mappings.size(); i++)
+    {
+        const Mapping &mapping = mappings.at(i);
+        Ehdr header;
+        if (mapping.offset || !isFile(mapping) || !(mapping.flags & PF_R)
+            || !readMemory(mapping.start, &header, sizeof(header)) || (memcmp(header.e_ident, ELFMAG, SELFMAG) != 0)
+            || (header.e_ident[EI_CLASS] != CORE_CLASS) || (header.e_phentsize != sizeof(Phdr)) || !header.e_phnum)
+            continue;
+
+        addRange(mapping.start, mapping.start + pageSize);
+
+        std::vector<Phdr> headers(header.e_phnum);
+        if (!readMemory(mapping.start + header.e_phoff, &headers[0], headers.size() * sizeof(Phdr)))
+            continue;
+
+        ADDRESS bias = mapping.start;
+        for (unsigned int j = 0; j < headers.size(); j++)
+        {
+            if ((headers[j].p_type == PT_LOAD) && (headers[j].p_offset == 0))
+            {
+                bias = mapping.start - headers[j].p_vaddr;
+                break;
+            }
+        }
+        for (unsigned int j = 0; j < headers.size(); j++)
+        {
+            if (headers[j].p_type == PT_NOTE)
+                addRange(bias + headers[j].p_vaddr, bias + headers[j].p_vaddr + headers[j].p_filesz);
+        }
+    }
+}
+
+void ProcessSnapshot::selectLinkMap()
+{
+    //AT_PHDR is where the program headers of the executable are loaded, the dynamic section follows from them
+    ADDRESS headersAddress = 0;
+    size_t headersCount = 0;
+    for (const Auxv *aux = (const Auxv *)auxv.data();
+         ((const char *)(aux + 1) <= auxv.data() + auxv.size()) && (aux->a_type != AT_NULL); aux++)
+    {
+        if (aux->a_type == AT_PHDR)
+            headersAddress = aux->a_un.a_val;
+        else if (aux->a_type == AT_PHNUM)
+            headersCount = aux->a_un.a_val;
+    }
+
+    std::vector<Phdr> headers(headersCount);
+    if (!headersAddress || headers.empty()
+        || !readMemory(headersAddress, &headers[0], headers.size() * sizeof(Phdr)))
+        return;
+
+    ADDRESS bias = 0;
+    for (unsigned int i = 0; i < headers.size(); i++)
+    {
+        if (headers[i].p_type == PT_PHDR)
+            bias = headersAddress - headers[i].p_vaddr;
+    }
+
+    std::vector<Elf_Dyn> dynamic;
+    ADDRESS dynamicAddress = 0;
+    for (unsigned int i = 0; i < headers.size(); i++)
+    {
+        if ((headers[i].p_type == PT_DYNAMIC) && (headers[i].p_filesz >= sizeof(Elf_Dyn)))
+        {
+            dynamicAddress = bias + headers[i].p_vaddr;
+            dynamic.resize(headers[i].p_filesz / sizeof(Elf_Dyn));
+        }
+    }
+    if (dynamic.empty() || !readMemory(dynamicAddress, &dynamic[0], dynamic.size() * sizeof(Elf_Dyn)))
+        return;
+    addRange(dynamicAddress, dynamicAddress + dynamic.size() * sizeof(Elf_Dyn));
+
+    //DT_DEBUG is set by the dynamic linker to its r_debug, which starts the list of the loaded objects
+    ADDRESS debug = 0;
+    for (unsigned int i = 0; (i < dynamic.size()) && (dynamic[i].d_tag != DT_NULL); i++)
+    {
+        if (dynamic[i].d_tag == DT_DEBUG)
+            debug = dynamic[i].d_un.d_ptr;
+    }
+
+    struct r_debug debugState;
+    if (!debug || !readMemory(debug, &debugState, sizeof(debugState)))
+        return;
+    addRange(debug, debug + sizeof(debugState));
+
+    std::set<ADDRESS> visited;
+    ADDRESS entry = (ADDRESS)debugState.r_map;
+    while (entry && visited.insert(entry).second && (visited.size() <= MAX_LINK_MAP_ENTRIES))
+    {
+        struct link_map link;
+        if (!readMemory(entry, &link, sizeof(link)))
+            break;
+        addRange(entry, entry + sizeof(link));
+
+        std::string name;
+        if (link.l_name && (readString((ADDRESS)link.l_name, name) >= 0))
+            addRange((ADDRESS)link.l_name, (ADDRESS)link.l_name + name.size() + 1);
+        entry = (ADDRESS)link.l_next;
+    }
+}
+
+bool ProcessSnapshot::addRange(ADDRESS start, ADDRESS end)
+{
+    int index = findMapping(start);
+    if ((index < 0) || !(mappings.at(index).flags & PF_R) || (end <= start))
+        return false;
+
+    const Mapping &mapping = mappings.at(index);
+    Range range;
+    range.start = std::max(start & ~(pageSize - 1), mapping.start);
+    range.end = std::min((end + pageSize - 1) & ~(pageSize - 1), mapping.end);
+    range.mapping = index;
+    range.offset = 0;
+    ranges.push_back(range);
+    return true;
+}
+
+bool ProcessSnapshot::isFile(const Mapping &mapping)
+{
+    return !mapping.path.empty() && (mapping.path[0] == '/');
+}
+
+bool ProcessSnapshot::isBefore(const Range &first, const Range &second)
+{
+    return first.start < second.start;
+}
+
+int ProcessSnapshot::findMapping(ADDRESS address) const
+{
+    int first = 0;
+    int last = (int)mappings.size() - 1;
+    while (first <= last)
+    {
+        int middle = (first + last) / 2;
+        if (address < mappings[middle].start)
+            last = middle - 1;
+        else if (address >= mappings[middle].end)
+            first = middle + 1;
+        else
+            return middle;
+    }
+    return -1;
+}
+
+bool ProcessSnapshot::readMemory(ADDRESS address, void *buffer, size_t size)
+{
+    //The headers and the link map are read in small pieces close to each other, each page is read once
+    char *target = (char *)buffer;
+    while (size)
+    {
+        ADDRESS page = address & ~(pageSize - 1);
+        const char *contents = readPage(page);
+        if (!contents)
+            return false;
+
+        size_t count = std::min(size, (size_t)(page + pageSize - address));
+        memcpy(target, contents + (address - page), count);
+        target += count;
+        address += count;
+        size -= count;
+    }
+    return true;
+}
+
+const char *ProcessSnapshot::readPage(ADDRESS page)
+{
+    std::map<ADDRESS, std::vector<char> >::iterator cached = pages.find(page);
+    if (cached != pages.end())
+        return &cached->second[0];
+
+    if (pages.size() >= PAGE_CACHE_SIZE)
+    {
+        pages.erase(pageOrder.front());
+        pageOrder.pop_front();
+    }
+
+    std::vector<char> &contents = pages[page];
+    contents.resize(pageSize);
+    if (!readDirect(page, &contents[0], pageSize))
+    {
+        pages.erase(page);
+        return NULL;
+    }
+    pageOrder.push_back(page);
+    return &contents[0];
+}
+
+bool ProcessSnapshot::readDirect(ADDRESS address, void *buffer, size_t size)
+{
+    struct iovec local = { buffer, size };
+    struct iovec remote = { (void *)address, size };
+    if (!isDumping && (readProcessMemory(pid, &local, 1, &remote, 1) == (ssize_t)size))
+        return true;
+
+    //A kernel without process_vm_readv, the tracer can read the memory file
+    if ((memory < 0) && ((errno == ENOSYS) || (errno == EPERM)))
+    {
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "/proc/%d/mem", pid);
+        memory = open(path, O_RDONLY);
+    }
+    return (memory >= 0) && (pread(memory, buffer, size, address) == (ssize_t)size);
+}
+
+ssize_t ProcessSnapshot::readString(ADDRESS address, std::string &text)
+{
+    //Read up to the end of each page, the next one may not be mapped
+    text.clear();
+    while (text.size() < PATH_MAX)
+    {
+        char buffer[PATH_MAX];
+        size_t size = std::min((size_t)(pageSize - (address & (pageSize - 1))), sizeof(buffer));
+        if (!readMemory(address, buffer, size))
+            return -1;
+
+        const char *end = (const char *)memchr(buffer, '\0', size);
+        text.append(buffer, end ? end - buffer : size);
+        if (end)
+            return text.size();
+        address += size;
+    }
+    return -1;
+}
+
+void ProcessSnapshot::addNote(Elf_Word type, const void *desc, size_t size)
+{
+    Nhdr header;
+    header.n_namesz = sizeof(CORE_NOTE_NAME);
+    header.n_descsz = size;
+    header.n_type = type;
+
+    notes.insert(notes.end(), (const char *)&header, (const char *)&header + sizeof(header));
+    notes.insert(notes.end(), CORE_NOTE_NAME, CORE_NOTE_NAME + sizeof(CORE_NOTE_NAME));
+    notes.resize(align_power(notes.size(), 2), 0);
+    notes.insert(notes.end(), (const char *)desc, (const char *)desc + size);
+    notes.resize(align_power(notes.size(), 2), 0);
+}
+
+void ProcessSnapshot::createNotes()
+{
+    for (unsigned int i = 0; i < threads.size(); i++)
+        addNote(NT_PRSTATUS, &threads.at(i).status[0], threads.at(i).status.size());
+
+    Info info;
+    memset(&info, 0, sizeof(info));
+    info.pr_pid = pid;
+    strncpy(info.pr_fname, command.c_str(), sizeof(info.pr_fname) - 1);
+    strncpy(info.pr_psargs, commandLine.c_str(), sizeof(info.pr_psargs) - 1);
+    addNote(NT_PRPSINFO, &info, sizeof(info));
+    addNote(NT_AUXV, auxv.data(), auxv.size());
+
+    //count, page size, then count * (start, end, page offset) and finally count file names
+    std::vector<ADDRESS> files(2);
+    std::string names;
+    for (unsigned int i = 0; i < mappings.size(); i++)
+    {
+        if (!isFile(mappings.at(i)))
+            continue;
+        files.push_back(mappings.at(i).start);
+        files.push_back(mappings.at(i).end);
+        files.push_back(mappings.at(i).offset / pageSize);
+        names.append(mappings.at(i).path.c_str(), mappings.at(i).path.size() + 1);
+    }
+    files[0] = (files.size() - 2) / 3;
+    files[1] = pageSize;
+    std::vector<char> fileNote((char *)&files[0], (char *)&files[0] + files.size() * sizeof(ADDRESS));
+    fileNote.insert(fileNote.end(), names.begin(), names.end());
+    addNote(NT_FILE, &fileNote[0], fileNote.size());
+}
+
+bool ProcessSnapshot::createImage()
+{
+    //The ranges of a mapping that overlap or touch are read as one
+    std::sort(ranges.begin(), ranges.end(), isBefore);
+    std::vector<Range> merged;
+    for (unsigned int i = 0; i < ranges.size(); i++)
+    {
+        if (!merged.empty() && (merged.back().mapping == ranges.at(i).mapping)
+            && (ranges.at(i).start <= merged.back().end))
+            merged.back().end = std::max(merged.back().end, ranges.at(i).end);
+        else
+            merged.push_back(ranges.at(i));
+    }
+    ranges.swap(merged);
+
+    //The notes of a core the kernel is writing are used as they are
+    if (!isDumping)
+        createNotes();
+
+    //Every mapping is listed, the ranges that were read are segments of their own within it.  The
+    //mappings that are not read are left out when the headers would not fit in e_phnum otherwise.
+    bool isLayoutListed = (1 + mappings.size() + ranges.size() < PN_XNUM);
+    if (!isLayoutListed && (1 + ranges.size() >= PN_XNUM))
+        LOG_RETURN(LOG_ERR, false, "Process %d has too many ranges to read (%u)", pid,
+                   (unsigned int)ranges.size());
+
+    std::vector<Phdr> headers(1);
+    memset(&headers[0], 0, sizeof(Phdr));
+    headers[0].p_type = PT_NOTE;
+    headers[0].p_filesz = notes.size();
+    headers[0].p_align = 4;
+    unsigned int next = 0;
+    for (unsigned int i = 0; i < mappings.size(); i++)
+    {
+        Phdr header;
+        memset(&header, 0, sizeof(header));
+        header.p_type = PT_LOAD;
+        header.p_flags = mappings.at(i).flags;
+        header.p_align = pageSize;
+        header.p_vaddr = mappings.at(i).start;
+        header.p_memsz = mappings.at(i).end - mappings.at(i).start;
+        if (isLayoutListed && ((next >= ranges.size()) || (ranges.at(next).start != mappings.at(i).start)))
+            headers.push_back(header);
+
+        for (; (next < ranges.size()) && (ranges.at(next).mapping == i); next++)
+        {
+            header.p_vaddr = ranges.at(next).start;
+            header.p_filesz = header.p_memsz = ranges.at(next).end - ranges.at(next).start;
+            headers.push_back(header);
+        }
+    }
+
+    size_t offset = sizeof(Ehdr) + headers.size() * sizeof(Phdr);
+    headers[0].p_offset = offset;
+    offset += notes.size();
+    for (unsigned int i = 0, range = 0; i < headers.size(); i++)
+    {
+        if (!headers[i].p_filesz || (headers[i].p_type != PT_LOAD))
+            continue;
+        headers[i].p_offset = offset;
+        ranges.at(range++).offset = offset;
+        offset += headers[i].p_filesz;
+    }
+
+    data.assign(offset, 0);
+    Ehdr *header = (Ehdr *)&data[0];
+    memcpy(header->e_ident, ELFMAG, SELFMAG);
+    header->e_ident[EI_CLASS] = CORE_CLASS;
+    header->e_ident[EI_DATA] = CORE_DATA;
+    header->e_ident[EI_VERSION] = EV_CURRENT;
+    header->e_type = ET_CORE;
+    header->e_machine = CORE_MACHINE;
+    header->e_version = EV_CURRENT;
+    header->e_phoff = sizeof(Ehdr);
+    header->e_ehsize = sizeof(Ehdr);
+    header->e_phentsize = sizeof(Phdr);
+    header->e_phnum = headers.size();
+    memcpy(&data[sizeof(Ehdr)], &headers[0], headers.size() * sizeof(Phdr));
+    if (!notes.empty())
+        memcpy(&data[headers[0].p_offset], &notes[0], notes.size());
+
+    return readRanges() != 0;
+}
+
+size_t ProcessSnapshot::readRanges()
+{
+    size_t total = 0;
+    if (isDumping)
+    {
+        for (unsigned int i = 0; i < ranges.size(); i++)
+        {
+            size_t size = ranges.at(i).end - ranges.at(i).start;
+            if (pread(memory, &data[ranges.at(i).offset], size, ranges.at(i).start) == (ssize_t)size)
+                total += size;
+        }
+        return total;
+    }
+
+    std::vector<struct iovec> local(ranges.size()), remote(ranges.size());
+    for (unsigned int i = 0; i < ranges.size(); i++)
+    {
+        local[i].iov_base = &data[ranges.at(i).offset];
+        remote[i].iov_base = (void *)ranges.at(i).start;
+        local[i].iov_len = remote[i].iov_len = ranges.at(i).end - ranges.at(i).start;
+    }
+
+    size_t i = 0;
+    while (i < ranges.size())
+    {
+        size_t end = std::min(i + READ_BATCH, ranges.size());
+        ssize_t count = readProcessMemory(pid, &local[i], end - i, &remote[i], end - i);
+        if (count <= 0)
+        {
+            //The first range can not be read at all, or the system call is not available
+            if (readDirect(ranges.at(i).start, local[i].iov_base, local[i].iov_len))
+                total += local[i].iov_len;
+            i++;
+            continue;
+        }
+
+        //The reading stops at a range that can not be read, what was not read of it is left as zeros
+        total += count;
+        while ((i < end) && ((size_t)count >= local[i].iov_len))
+            count -= local[i++].iov_len;
+        if (i < end)
+            i++;
+    }
+    return total;
+}
@@ -0,0 +1,311 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file processsnapshot.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class ProcessSnapshot
+  * \brief Create a core image of a running process that holds only what the core reducer keeps.
+  * The threads are stopped with PTRACE_SEIZE and PTRACE_INTERRUPT, their registers are read with
+  * PTRACE_GETREGSET and the memory is read with process_vm_readv, a batch of ranges in each call.
+  * Only the live part of the stacks, the code around the program counters in anonymous memory, the
+  * first page and the notes of the mapped elf files, the dynamic section of the executable and the
+  * r_debug and link_map structures with their names are read.  The threads are resumed as soon as
+  * the memory is read, the reducing is done afterwards.
+  *
+  * The image has the layout of a kernel core: the notes (NT_PRSTATUS for each thread with the main
+  * thread first, NT_PRPSINFO, NT_AUXV and NT_FILE) and a PT_LOAD segment for every mapping, with the
+  * ranges that were read as segments of their own.  The memory that was not read has no data, as the
+  * kernel does for the mappings it does not dump.  The image can be read by ElfCoreReader.
+  *
+  * A process that the kernel is dumping through core_pattern is not stopped again: the notes are taken
+  * from the beginning of the core the kernel writes, the same ranges are read from /proc/pid/mem through
+  * a small page cache and the rest of the core is not needed.  The kernel keeps the memory of the process
+  * until the whole core was read, so the caller reads the rest of it only after the capture.
+  */
+
+#ifndef PROCESSSNAPSHOT_H
+#define PROCESSSNAPSHOT_H
+
+#include "defines.h"
+#include <sys/types.h>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+class ProcessSnapshot
+{
+public:
+    /*!
+      * \brief Constructor
+      */
+    ProcessSnapshot();
+
+    /*!
+      * \brief Destructor, resumes the threads if they are still stopped
+      */
+    ~ProcessSnapshot();
+
+    /*!
+      * \brief Set the amount of code that is read around the program counters in anonymous memory
+      * \param window The number of bytes on each side of the address, 0 for none
+      */
+    void setCodeWindow(size_t window) { codeWindow = window; }
+
+    /*!
+      * \brief Set the mapped files whose written memory is read whole, as the reducer keeps it
+      * \param patterns The globs of the mappings setting of ReductionPolicy
+      */
+    void setMappingPatterns(const std::vector<std::string> &patterns) { mappingPatterns = patterns; }
+
+    /*!
+      * \brief Stop the process, read its state and resume it
+      * \param pid The process id of the process
+      * \return true if the image was created, false otherwise
+      */
+    bool capture(pid_t pid);
+
+    /*!
+      * \brief Read the state of a process that the kernel is dumping, with the memory from /proc/pid/mem
+      * \param pid The process id of the process
+      * \param core The beginning of the core of the process, up to the end of its notes
+      * \param size The size of \a core in bytes
+      * \return true if the image was created, false otherwise
+      */
+    bool capture(pid_t pid, const char *core, size_t size);
+
+    /*!
+      * \brief Read the beginning of a core, the elf header, the program headers and the notes
+      * \param fd The descriptor the core is read from
+      * \param start Appended with what was read, also when the reading fails
+      * \return true if the notes were read, false otherwise
+      */
+    static bool readCoreStart(int fd, std::string &start);
+
+    /*!
+      * \brief Get the core image of the process
+      * \return The start of the image, NULL if it has not been created
+      */
+    char *image() { return data.empty() ? NULL : &data[0]; }
+
+    /*!
+      * \brief Get the size of the core image in bytes
+      */
+    size_t imageSize() const { return data.size(); }
+
+    /*!
+      * \brief Get the time the threads were stopped for
+      * \return The time in microseconds
+      */
+    long stoppedTime() const { return stopped; }
+
+private:
+    //! A thread of the process
+    struct Thread
+    {
+        pid_t tid;                  //!< The id of the thread
+        int signal;                 //!< A signal that was about to be delivered when the thread stopped, 0 if none
+        std::vector<char> status;   //!< The NT_PRSTATUS note description
+    };
+
+    //! A memory mapping of the process, as listed in /proc/pid/maps
+    struct Mapping
+    {
+        ADDRESS start;      //!< The first address of the mapping
+        ADDRESS end;        //!< The address one past the end of the mapping
+        ADDRESS offset;     //!< The offset in to the mapped file
+        Elf_Word flags;     //!< The permissions as PF_R, PF_W and PF_X
+        std::string path;   //!< The mapped file, or the name of a special mapping, empty if anonymous
+    };
+
+    //! A range of memory that is read, page aligned and within a single mapping
+    struct Range
+    {
+        ADDRESS start;      //!< The first address of the range
+        ADDRESS end;        //!< The address one past the end of the range
+        size_t mapping;     //!< The index of the mapping in \a mappings
+        size_t offset;      //!< The offset of the data in the image
+    };
+
+    /*!
+      * \brief Seize and stop every thread of the process, including the threads that it starts meanwhile
+      * \return true on success, false if a thread could not be stopped
+      */
+    bool stopThreads();
+
+    /*!
+      * \brief Detach from the threads, which resumes them
+      */
+    void resumeThreads();
+
+    /*!
+      * \brief Read the registers of the threads
+      * \return true on success, false otherwise
+      */
+    bool readThreads();
+
+    /*!
+      * \brief Read the mappings, the auxiliary vector and the command line of the process
+      * \return true on success, false otherwise
+      */
+    bool readProcess();
+
+    /*!
+      * \brief Read the mappings of the process from /proc/pid/maps
+      * \return true on success, false otherwise
+      */
+    bool readMappings();
+
+    /*!
+      * \brief Take the notes, the registers and the auxiliary vector from the beginning of a kernel core
+      * \return true on success, false if the core is not a native core or has no notes
+      */
+    bool readCoreNotes(const char *core, size_t size);
+
+    /*!
+      * \brief Select the ranges of memory that the core reducer uses
+      */
+    void selectRanges();
+
+    /*!
+      * \brief Select the first page and the notes of each mapped elf file
+      */
+    void selectElfHeaders();
+
+    /*!
+      * \brief Select the dynamic section of the executable and follow the link map from it
+      */
+    void selectLinkMap();
+
+    /*!
+      * \brief Add a range of memory to be read
+      * \param start The first address, rounded down to a page
+      * \param end The address one past the end, rounded up to a page and cut to the end of the mapping
+      * \return true if the range is within a readable mapping, false otherwise
+      */
+    bool addRange(ADDRESS start, ADDRESS end);
+
+    /*!
+      * \brief Determine if a mapping is backed by a file
+      */
+    static bool isFile(const Mapping &mapping);
+
+    /*!
+      * \brief Order the ranges by their addresses
+      */
+    static bool isBefore(const Range &first, const Range &second);
+
+    /*!
+      * \brief Find the mapping that contains an address
+      * \return The index of the mapping, -1 if the address is not mapped
+      */
+    int findMapping(ADDRESS address) const;
+
+    /*!
+      * \brief Read memory of the process through the page cache, while the ranges are being selected
+      * \return true if all of \a size bytes were read, false otherwise
+      */
+    bool readMemory(ADDRESS address, void *buffer, size_t size);
+
+    /*!
+      * \brief Get a page of the process from the page cache, reading it if it is not there
+      * \param page The address of the page
+      * \return The contents of the page, NULL if it can not be read
+      */
+    const char *readPage(ADDRESS page);
+
+    /*!
+      * \brief Read memory of the process with process_vm_readv, or from /proc/pid/mem
+      * \return true if all of \a size bytes were read, false otherwise
+      */
+    bool readDirect(ADDRESS address, void *buffer, size_t size);
+
+    /*!
+      * \brief Read a NUL terminated string of the process
+      * \return The length of the string, -1 if it can not be read
+      */
+    ssize_t readString(ADDRESS address, std::string &text);
+
+    /*!
+      * \brief Create the notes of a running process
+      */
+    void createNotes();
+
+    /*!
+      * \brief Lay out the core image and read the selected ranges in to it
+      * \return true if any memory was read, false otherwise
+      */
+    bool createImage();
+
+    /*!
+      * \brief Read the selected ranges in to the image, as many in each system call as it takes
+      * \return The number of bytes read
+      */
+    size_t readRanges();
+
+    /*!
+      * \brief Append a note owned by "CORE" to \a notes
+      */
+    void addNote(Elf_Word type, const void *desc, size_t size);
+
+private:
+    //! The process id of the process
+    pid_t pid;
+    //! The threads, the main thread first
+    std::vector<Thread> threads;
+    //! The mappings in the order of their addresses
+    std::vector<Mapping> mappings;
+    //! The selected ranges
+    std::vector<Range> ranges;
+    //! The contents of /proc/pid/auxv
+    std::string auxv;
+    //! The command line of the process, with spaces between the arguments
+    std::string commandLine;
+    //! The name of the command of the process
+    std::string command;
+    //! The notes of the image
+    std::vector<char> notes;
+    //! The core image
+    std::vector<char> data;
+    //! The pages read while the ranges are selected, by their addresses
+    std::map<ADDRESS, std::vector<char> > pages;
+    //! The addresses of the cached pages in the order they were read, the first one is dropped first
+    std::deque<ADDRESS> pageOrder;
+    //! The number of bytes of code read around the program counters
+    size_t codeWindow;
+    //! The globs of the mapped files that are read whole
+    std::vector<std::string> mappingPatterns;
+    //! The size of a page
+    ADDRESS pageSize;
+    //! A descriptor of /proc/pid/mem, used if process_vm_readv is not available or the process is dumped
+    int memory;
+    //! true if the kernel is dumping the process, the notes were taken from its core
+    bool isDumping;
+    //! true while the threads are stopped
+    bool isStopped;
+    //! The time the threads were stopped for, in microseconds
+    long stopped;
+};
+
+#endif // PROCESSSNAPSHOT_H
@@ -22,6 +22,8 @@
  */
 
 #include "rawelfwriter.h"
+#include "parallelrange.h"
+#include "crc32c.h"
 
 #include <elf.h>
 #include <stdlib.h>
@@ -32,6 +34,19 @@
 //add 512 bytes to file buffer each time realloc is called in LM map creation method
 #define LM_BUFFER_DATA_SIZE 512
 
+//The most bytes copied in one piece by copySegments(), so that a large segment is shared by the threads
+#define COPY_PIECE_SIZE (256 * 1024)
+//The fewest pieces that are worth a copying thread of their own
+#define MIN_PIECES_PER_THREAD 16
+//The fewest segments that are worth a checksumming thread of their own
+#define MIN_SUMS_PER_THREAD 16
+//The last program header is reserved for the note of the checksums
+#define CHECKSUM_HEADERS 1
+//The most padding written at a time to an output that can not seek
+#define ZERO_BUFFER_SIZE 4096
+//The size of an entry of the NT_RICHCORE_CHECKSUMS note, see defines.h
+#define CHECKSUM_ENTRY_SIZE (2 * sizeof(uint64_t) + sizeof(uint32_t))
+
 #if __WORDSIZE == 32
 /*!
   * \def R_DEBUG_STRUCT_SIZE The size of the r_debug struct
@@ -56,6 +71,27 @@ typedef struct linkMapStruct
     ADDRESS previousLinkMapStruct; //!< A pointer to the previous link map struct
 } LinkMap;
 
+/*!
+  * \brief A piece of a segment that copySegments() copies
+  */
+struct CopyPiece
+{
+    char *to;           //!< The position in the buffer
+    const char *from;   //!< The data of the segment
+    size_t size;        //!< The number of bytes
+};
+
+/*!
+  * \brief The checksum of the data of a segment that write() calculates
+  */
+struct SegmentSum
+{
+    uint64_t offset;    //!< The file offset of the segment
+    uint64_t size;      //!< The size of the data of the segment
+    const char *data;   //!< The data in the buffer
+    uint32_t crc;       //!< The checksum of the data
+};
+
 
 RawElfWriter::RawElfWriter()
     : buffer(NULL),
@@ -69,7 +105,10 @@ RawElfWriter::RawElfWriter()
     previousLinkAddress(0),
     currentLinkMapSize(0),
     linkMapHeadAddress(0),
-    isBufferSorted(false)
+    linkMapHeader(0),
+    copyThreads(1),
+    pageSize(0),
+    padding(0)
 {
 }
 
@@ -87,11 +126,12 @@ bool RawElfWriter::initalize(const char *fileName, size_t numberOfSegments, size
     if ((fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
         LOG_RETURN(LOG_ERR, false, "Opening file '%s' failed.", fileName);
 
-    currentBufferSize = sizeof(Ehdr) + (numberOfSegments * sizeof(Phdr)) + initalSizeOfData;
+    currentBufferSize = sizeof(Ehdr) + ((numberOfSegments + CHECKSUM_HEADERS) * sizeof(Phdr)) + initalSizeOfData;
     if (!(buffer = (char *)malloc(currentBufferSize * sizeof(char))))
         LOG_RETURN(LOG_ERR, false, "Not enough memory to create output file.");
 
-    numProgramHeaders = numberOfSegments;
+    numProgramHeaders = numberOfSegments + CHECKSUM_HEADERS;
+    segmentPositions.resize(numProgramHeaders);
     //the elf header starts at byte 0 and takes sizeof(EHdr) bytes
     elfHeader = (Ehdr *)buffer;
     offset += sizeof(Ehdr);
@@ -150,7 +190,7 @@ const char *RawElfWriter::copySegment(const Phdr *headerToCopy, const char *data
 
     //See if we have already used all of the previously assigned
     //Program headers
-    if (currentProgramHeader >= numProgramHeaders)
+    if (currentProgramHeader >= numProgramHeaders - CHECKSUM_HEADERS)
         LOG_RETURN(LOG_ERR, NULL, "Incorrect number of program headers assigned.");
 
     if ((offset + headerToCopy->p_filesz) > currentBufferSize)
@@ -163,7 +203,7 @@ const char *RawElfWriter::copySegment(const Phdr *headerToCopy, const char *data
     //We want to save almost all of the Program Header intact
     memcpy(&programHeaders[currentProgramHeader], headerToCopy, sizeof(Phdr));
     //but the offset will have to change to match this files offset
-    programHeaders[currentProgramHeader].p_offset = offset;
+    alignSegment(currentProgramHeader);
 
     //copy the data portion of the segment
     char *writePointer = buffer + offset;
@@ -183,6 +223,111 @@ const char *RawElfWriter::copySegment(const Phdr *headerToCopy, const char *data
     return writePointer;
 }
 
+bool RawElfWriter::copySegments(const std::vector<const Phdr *> &headersToCopy, const std::vector<const char *> &data)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < headersToCopy.size(); i++)
+    {
+        if (!headersToCopy[i] || !data[i])
+            LOG_RETURN(LOG_ERR, false, "No data in this segment/Not a valid segment.");
+        size += headersToCopy[i]->p_filesz;
+    }
+
+    if (currentProgramHeader + headersToCopy.size() > numProgramHeaders - CHECKSUM_HEADERS)
+        LOG_RETURN(LOG_ERR, false, "Incorrect number of program headers assigned.");
+
+    if ((offset + size) > currentBufferSize)
+    {
+        if (!reallocate(size))
+            return false;
+    }
+
+    //The offsets are the same as copySegment() gives them, so the file does not depend on the threads
+    std::vector<CopyPiece> pieces;
+    for (size_t i = 0; i < headersToCopy.size(); i++)
+    {
+        memcpy(&programHeaders[currentProgramHeader], headersToCopy[i], sizeof(Phdr));
+        alignSegment(currentProgramHeader);
+        currentProgramHeader++;
+
+        for (size_t copied = 0; copied < headersToCopy[i]->p_filesz; copied += COPY_PIECE_SIZE)
+        {
+            CopyPiece piece;
+            piece.to = buffer + offset + copied;
+            piece.from = data[i] + copied;
+            piece.size = headersToCopy[i]->p_filesz - copied;
+            if (piece.size > COPY_PIECE_SIZE)
+                piece.size = COPY_PIECE_SIZE;
+            pieces.push_back(piece);
+        }
+        offset += headersToCopy[i]->p_filesz;
+    }
+
+    ParallelRange::run(pieces.size(), copyThreads, MIN_PIECES_PER_THREAD, copyData, &pieces);
+    return true;
+}
+
+void RawElfWriter::copyData(void *context, size_t begin, size_t end)
+{
+    const std::vector<CopyPiece> &pieces = *(const std::vector<CopyPiece> *)context;
+    for (size_t i = begin; i < end; i++)
+        memcpy(pieces[i].to, pieces[i].from, pieces[i].size);
+}
+
+void RawElfWriter::sumData(void *context, size_t begin, size_t end)
+{
+    std::vector<SegmentSum> &sums = *(std::vector<SegmentSum> *)context;
+    for (size_t i = begin; i < end; i++)
+        sums[i].crc = crc32c_update(0, sums[i].data, sums[i].size);
+}
+
+void RawElfWriter::alignSegment(size_t index)
+{
+    Phdr &header = programHeaders[index];
+    //Only the memory segments are mapped, the notes are read
+    if (pageSize && (header.p_type == PT_LOAD))
+    {
+        //The file offset is made congruent to the address, as the kernel writes it
+        size_t skipped = (header.p_vaddr - (offset + padding)) & (pageSize - 1);
+        if (skipped)
+        {
+            holes.push_back(std::make_pair(offset, skipped));
+            padding += skipped;
+        }
+        header.p_align = pageSize;
+    }
+    header.p_offset = offset + padding;
+    segmentPositions.at(index) = offset;
+}
+
+Phdr &RawElfWriter::insertProgramHeader(size_t position)
+{
+    //The headers that are not used yet are at the end, there is room for one more
+    memmove(&programHeaders[position + 1], &programHeaders[position],
+            (currentProgramHeader - position) * sizeof(Phdr));
+    segmentPositions.insert(segmentPositions.begin() + position, 0);
+    segmentPositions.pop_back();
+    currentProgramHeader++;
+
+    memset(&programHeaders[position], 0, sizeof(Phdr));
+    return programHeaders[position];
+}
+
+bool RawElfWriter::overwrite(ADDRESS address, const char *data, size_t size)
+{
+    for (size_t i = 0; i < currentProgramHeader; i++)
+    {
+        const Phdr &header = programHeaders[i];
+        if ((header.p_type == PT_LOAD) && (header.p_vaddr <= address)
+            && (address + size <= header.p_vaddr + header.p_filesz))
+        {
+            memcpy(buffer + segmentPositions.at(i) + (address - header.p_vaddr), data, size);
+            return true;
+        }
+    }
+    LOG_RETURN(LOG_ERR, false, "The memory to overwrite is not in the file.");
+}
+
 bool RawElfWriter::reallocate(size_t amountRequired)
 {
     currentBufferSize += amountRequired;
@@ -199,13 +344,24 @@ bool RawElfWriter::reallocate(size_t amountRequired)
     return true;
 }
 
-void RawElfWriter::startLinkMapSegment(ADDRESS heapAddress)
+bool RawElfWriter::startLinkMapSegment(ADDRESS heapAddress)
 {
-    programHeaders[currentProgramHeader].p_type = PT_LOAD;
-    programHeaders[currentProgramHeader].p_vaddr = heapAddress;
-    programHeaders[currentProgramHeader].p_flags = ( PF_R | PF_W );
-    programHeaders[currentProgramHeader].p_offset = offset;
-    programHeaders[currentProgramHeader].p_align = 0x1;
+    if (currentProgramHeader >= numProgramHeaders - CHECKSUM_HEADERS)
+        LOG_RETURN(LOG_ERR, false, "Incorrect number of program headers assigned.");
+
+    //The notes come first and then the memory by its address, the segment goes before the first higher one
+    linkMapHeader = 0;
+    while ((linkMapHeader < currentProgramHeader) && ((programHeaders[linkMapHeader].p_type != PT_LOAD)
+                                                      || (programHeaders[linkMapHeader].p_vaddr < heapAddress)))
+        linkMapHeader++;
+
+    Phdr &header = insertProgramHeader(linkMapHeader);
+    header.p_type = PT_LOAD;
+    header.p_vaddr = heapAddress;
+    header.p_flags = ( PF_R | PF_W );
+    header.p_align = 0x1;
+    alignSegment(linkMapHeader);
+    return true;
 }
 
 ADDRESS RawElfWriter::createR_DebugStruct()
@@ -235,7 +391,7 @@ ADDRESS RawElfWriter::addR_DebugStruct(const char *rDebugStart)
 
     offset += R_DEBUG_STRUCT_SIZE;
 
-    linkMapHeadAddress = programHeaders[currentProgramHeader].p_vaddr + R_DEBUG_STRUCT_SIZE;
+    linkMapHeadAddress = programHeaders[linkMapHeader].p_vaddr + R_DEBUG_STRUCT_SIZE;
     //set the r_debug::link_map pointer to point to our link map
     memcpy(writePointer + sizeof(ADDRESS), &linkMapHeadAddress, sizeof(ADDRESS));
 
@@ -328,46 +484,40 @@ ADDRESS RawElfWriter::addLinkMapSegment(const char *linkMapStart, const char *st
 void RawElfWriter::finalizeLinkMapSegment()
 {
     //finish writing the headers
-    programHeaders[currentProgramHeader].p_filesz = offset - programHeaders[currentProgramHeader].p_offset;
-    programHeaders[currentProgramHeader].p_memsz = offset - programHeaders[currentProgramHeader].p_offset;
-}
-
-/*!
-  * \brief Compare two program header virtual memory address values to determine which is the smaller
-  * \param first The first variable to comapre against
-  * \param second The second variable to compare to
-  * \returns A negative value if a < b, a positive value if b > a or 0 if a == b
-  * Provided as a callback method that can be used with qsort to sort the program headers of the output
-  * file into ascending order based on virtual memory address.
-  */
-int compareProgramHeaders(const void *first, const void *second)
-{
-    if (((Phdr *)first)->p_vaddr < ((Phdr *)second)->p_vaddr)
-        return -1;
-    else if (((Phdr *)first)->p_vaddr > ((Phdr *)second)->p_vaddr)
-        return 1;
-    else
-        return 0;
-}
-
-void RawElfWriter::sortBuffer()
-{
-    if (isBufferSorted || !buffer || !programHeaders)
-        return;
-
-    qsort(programHeaders, numProgramHeaders, sizeof(Phdr), compareProgramHeaders);
-
-    isBufferSorted = true;
+    programHeaders[linkMapHeader].p_filesz = offset + padding - programHeaders[linkMapHeader].p_offset;
+    programHeaders[linkMapHeader].p_memsz = offset + padding - programHeaders[linkMapHeader].p_offset;
 }
 
 bool RawElfWriter::write()
 {
     if (buffer)
     {
-        if (!isBufferSorted)
-            sortBuffer();
-
-        if (::write(fd, buffer, offset * sizeof(char)) != (ssize_t)offset)
+        char *checksums = addChecksumNote();
+        //The headers are summed once they are all set
+        if (checksums)
+        {
+            uint32_t crc = crc32c_update(0, buffer, sizeof(Ehdr) + (numProgramHeaders * sizeof(Phdr)));
+            memcpy(checksums + sizeof(uint32_t), &crc, sizeof(crc));
+        }
+
+        //The padding before the page aligned segments is not in the buffer, it is left as holes in the file.
+        //A pipe, such as -o /dev/stdout, can not seek, so the padding is written to it as zeros.
+        bool isSeekable = holes.empty() || (lseek(fd, 0, SEEK_CUR) >= 0);
+        size_t written = 0;
+        for (size_t i = 0; i <= holes.size(); i++)
+        {
+            size_t end = (i < holes.size()) ? holes[i].first : offset;
+            if (::write(fd, buffer + written, end - written) != (ssize_t)(end - written))
+                LOG_RETURN(LOG_ERR, false, "Error writing file to disk");
+            if (i < holes.size())
+            {
+                if (isSeekable ? (lseek(fd, holes[i].second, SEEK_CUR) < 0) : !writeZeros(holes[i].second))
+                    LOG_RETURN(LOG_ERR, false, "Error writing file to disk");
+            }
+            written = end;
+        }
+        //a hole at the end is not made by lseek alone
+        if (!holes.empty() && isSeekable && (ftruncate(fd, offset + padding) != 0))
             LOG_RETURN(LOG_ERR, false, "Error writing file to disk");
 
         free(buffer);
@@ -377,6 +527,76 @@ bool RawElfWriter::write()
     return true;
 }
 
+bool RawElfWriter::writeZeros(size_t size)
+{
+    char zeros[ZERO_BUFFER_SIZE];
+    memset(zeros, 0, sizeof(zeros));
+    while (size > 0)
+    {
+        size_t length = (size > sizeof(zeros)) ? sizeof(zeros) : size;
+        if (::write(fd, zeros, length) != (ssize_t)length)
+            return false;
+        size -= length;
+    }
+    return true;
+}
+
+char *RawElfWriter::addChecksumNote()
+{
+    std::vector<SegmentSum> sums;
+    for (size_t i = 0; i < currentProgramHeader; i++)
+    {
+        const Phdr &header = programHeaders[i];
+        if (!header.p_filesz || (segmentPositions.at(i) + header.p_filesz > offset))
+            continue;
+
+        SegmentSum sum;
+        sum.offset = header.p_offset;
+        sum.size = header.p_filesz;
+        sum.data = buffer + segmentPositions.at(i);
+        sum.crc = 0;
+        sums.push_back(sum);
+    }
+    ParallelRange::run(sums.size(), copyThreads, MIN_SUMS_PER_THREAD, sumData, &sums);
+
+    Nhdr note;
+    note.n_namesz = sizeof(RICH_CORE_NOTE_NAME);
+    note.n_descsz = 2 * sizeof(uint32_t) + (sums.size() * CHECKSUM_ENTRY_SIZE);
+    note.n_type = NT_RICHCORE_CHECKSUMS;
+    size_t nameSize = (sizeof(RICH_CORE_NOTE_NAME) + 3) & ~3;
+    size_t size = sizeof(Nhdr) + nameSize + ((note.n_descsz + 3) & ~3);
+    if ((offset + size > currentBufferSize) && !reallocate(size))
+        return NULL;
+
+    //The note goes after the other notes, its data is at the end of the file
+    size_t index = 0;
+    while ((index < currentProgramHeader) && (programHeaders[index].p_type == PT_NOTE))
+        index++;
+    Phdr &header = insertProgramHeader(index);
+    header.p_type = PT_NOTE;
+    header.p_offset = offset + padding;
+    header.p_filesz = size;
+    header.p_align = 4;
+    segmentPositions.at(index) = offset;
+
+    char *position = buffer + offset;
+    memset(position, 0, size);
+    memcpy(position, &note, sizeof(Nhdr));
+    memcpy(position + sizeof(Nhdr), RICH_CORE_NOTE_NAME, sizeof(RICH_CORE_NOTE_NAME));
+    char *desc = position + sizeof(Nhdr) + nameSize;
+    uint32_t count = sums.size();
+    memcpy(desc, &count, sizeof(count));
+    char *entry = desc + 2 * sizeof(uint32_t);
+    for (size_t i = 0; i < sums.size(); i++, entry += CHECKSUM_ENTRY_SIZE)
+    {
+        memcpy(entry, &sums[i].offset, sizeof(uint64_t));
+        memcpy(entry + sizeof(uint64_t), &sums[i].size, sizeof(uint64_t));
+        memcpy(entry + 2 * sizeof(uint64_t), &sums[i].crc, sizeof(uint32_t));
+    }
+    offset += size;
+    return desc;
+}
+
 void RawElfWriter::close()
 {
     if (fd)
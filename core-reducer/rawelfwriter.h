@@ -27,17 +27,22 @@
   * \class RawElfWriter
   * \brief Dispence with libelf functions for writing a core file.
   * The core file is treated as a malloc'd buffer that grows to accomodate the reduced core file.
-  * it is only written to the output file when the file structure is complete.
+  * it is only written to the output file when the file structure is complete.  Just before it is written a
+  * NT_RICHCORE_CHECKSUMS note with the CRC-32C of each segment is added, so that a damaged file can be
+  * found without reading it with a debugger.
   */
 
 #ifndef RAWELFWRITER_H
 #define RAWELFWRITER_H
 
 #include "defines.h"
+#include "corewriter.h"
 #include <string>
+#include <utility>
+#include <vector>
 
 
-class RawElfWriter
+class RawElfWriter : public CoreWriter
 {
 public:
     /*!
@@ -48,25 +53,27 @@ public:
     /*!
       * \brief destructor
       */
-    ~RawElfWriter();
+    virtual ~RawElfWriter();
 
     /*!
       * \brief initalize the class so that we can start to create the new core file.
       * \param fileName The path of the file to which we are going to write the finished core file
-      * \param numberOfSegments The number of segments that are going to be created.
+      * \param numberOfSegments The number of segments that are going to be created, one more is added for the checksums
       * \param initalSizeOfData The inital amount of space to reserve for the file.
       * \return true on success, false otherwise
       */
-    bool initalize(const char *fileName, size_t numberOfSegments, size_t initalSizeOfData);
+    virtual bool initalize(const char *fileName, size_t numberOfSegments, size_t initalSizeOfData);
 
     /*!
       * \brief A convenience method to copy the elf header from one core file to our reduced core file
       * \param header A pointer to the header file that is to be copied
       */
-    void copyElfHeader(const Ehdr *header);
+    virtual void copyElfHeader(const Ehdr *header);
 
     /*!
       * \brief copy a segment from the one core file to this file
+      * The notes are copied first and then the memory in the order of its addresses, the program headers are
+      * not sorted afterwards.
       * When the data is being copied it is possible to over write a portion of the new segment with
       * some specified data.
       * \param programHeader The program header that contains the information about the segment
@@ -76,16 +83,53 @@ public:
       * \param overwriteSize The amount of the segment that is going to be overwritten by \a overwriteData
       * \returns On success a pointer to the start of the data segment in the new file, similar to strcpy, NULL otherwise
       */
-    const char *copySegment(const Phdr *programHeader, const char *data,
-                            const char *overwriteData = NULL, size_t overwriteOffset = 0,
-                            size_t overwriteSize = 0);
+    virtual const char *copySegment(const Phdr *programHeader, const char *data,
+                                    const char *overwriteData = NULL, size_t overwriteOffset = 0,
+                                    size_t overwriteSize = 0);
+
+    /*!
+      * \brief copy a number of segments from the one core file to this file, in their order
+      * The segments are given in the order of copySegment().  The offsets of all the segments are assigned
+      * first, then the data is copied by up to \a copyThreads threads in to the disjoint parts of the buffer.
+      * \param programHeaders The program headers of the segments
+      * \param data A pointer to the data of each segment
+      * \return true on success, false otherwise
+      */
+    virtual bool copySegments(const std::vector<const Phdr *> &programHeaders, const std::vector<const char *> &data);
+
+    /*!
+      * \brief Overwrite some of the memory of a segment that was copied
+      * \param address The address of the memory to overwrite
+      * \param data The data to write
+      * \param size The size of \a data
+      * \return true on success, false if the memory is not in a single segment of the file
+      */
+    bool overwrite(ADDRESS address, const char *data, size_t size);
+
+    /*!
+      * \brief Set the number of threads that copy the segments in copySegments()
+      * \param count The number of threads, 0 for one per processor
+      */
+    void setThreads(unsigned int count) { copyThreads = count; }
+
+    /*!
+      * \brief Lay the memory segments out so that they can be mapped from the file
+      * \param size The page size, a power of 2, or 0 to store the segments back to back
+      * The file offset of each PT_LOAD segment is congruent to its address modulo \a size, as in a
+      * core written by the kernel.  The padding this needs is not kept in memory.  It is written as holes,
+      * which take no space on disk on a file system with sparse files but do on vfat, or as zeros when the
+      * output is a pipe.  Must be set before the first segment is copied.
+      */
+    void setPageSize(size_t size) { pageSize = size; }
 
     /*!
       * \brief Start the creation of a segment that will contain the link map data
       * \param heapAddress The Virtual memory address that will represent the start of the r_debug struct
-      * This method must be called before \a addR_DebugStruct() and \a addlinkMapSegment()
+      * \return true on success, false if there is no program header left for the segment
+      * This method must be called before \a addR_DebugStruct() and \a addlinkMapSegment().  The data of the
+      * segment comes after the copied segments, its program header is put among them by its address.
       */
-    void startLinkMapSegment(ADDRESS heapAddress);
+    bool startLinkMapSegment(ADDRESS heapAddress);
 
     /*!
       * \brief Create a new r_debug segment to our new file.
@@ -135,7 +179,7 @@ public:
       * \brief This method writes the memory buffer to file and should be called once at the end of processing
       * \return true on success false otherwise.
       */
-    bool write();
+    virtual bool write();
 
 private:
     /*!
@@ -151,13 +195,52 @@ private:
     bool reallocate(size_t amountRequired);
 
     /*!
-      * \brief Sort the Program headers so that the lowest Virtual memory address segments come first
-      * Only the Program headers have to be sorted.  The data to which they point does not have to be moved
-      * because these data segments are referenced by a file offset that is contained within the program header.
-      * The headers should be sorted to allow for more efficient search algorithms to be used when trying to
-      * locate a segment by virtual memory address.
+      * \brief Write zeros to the output file, for the padding when it can not seek
+      * \param size The number of zeros
+      * \return true on success, false otherwise
+      */
+    bool writeZeros(size_t size);
+
+    /*!
+      * \brief Make room for a program header among the ones that are used
+      * \param position The index that the new program header gets, the headers from it on are moved up by one
+      * \return The new program header, zeroed
+      * The program headers are kept in the order of their addresses, so that a segment can be looked up
+      * by a binary search, without sorting them.  The data to which they point is not moved, it is
+      * referenced by the file offset in the program header.
+      */
+    Phdr &insertProgramHeader(size_t position);
+
+    /*!
+      * \brief Copy a part of the data of copySegments(), run by ParallelRange
+      * \param context The vector of the copies to make
+      * \param begin The first copy of the part
+      * \param end The copy after the last of the part
+      */
+    static void copyData(void *context, size_t begin, size_t end);
+
+    /*!
+      * \brief Calculate the checksums of a part of the segments of addChecksumNote(), run by ParallelRange
+      * \param context The vector of the segments to sum
+      * \param begin The first segment of the part
+      * \param end The segment after the last of the part
+      */
+    static void sumData(void *context, size_t begin, size_t end);
+
+    /*!
+      * \brief Add the NT_RICHCORE_CHECKSUMS note of the segments to the end of the file
+      * \return The description of the note, in which the checksum of the headers is still to be set, or NULL
+      * The data of the segments is final by now, the link map and the DT_DEBUG pointer are written after
+      * the segments are copied, so the segments are summed here rather than while they are copied.
+      */
+    char *addChecksumNote();
+
+    /*!
+      * \brief Set the file offset of a segment that starts at the current offset
+      * \param index The index of the program header of the segment in the file
+      * With a \a pageSize a memory segment is moved to the offset that matches its address.
       */
-    void sortBuffer();
+    void alignSegment(size_t index);
 
 private:
     //! The buffer that is used to create the elf file
@@ -182,8 +265,18 @@ private:
     size_t currentLinkMapSize;
     //! The address of the start of the link map within the new core file
     ADDRESS linkMapHeadAddress;
-    //! Determine if the buffer is sorted. Only the Program Headers addresss' have to be sorted
-    bool isBufferSorted;
+    //! The index of the program header of the link map segment
+    size_t linkMapHeader;
+    //! The number of threads that copy the segments, 0 for one per processor
+    unsigned int copyThreads;
+    //! The page size that the memory segments are aligned to, 0 for none
+    size_t pageSize;
+    //! The bytes of padding in the file before \a offset, the file offset is \a offset + \a padding
+    size_t padding;
+    //! The padding as the position in the buffer that it comes before and its size
+    std::vector<std::pair<size_t, size_t> > holes;
+    //! The position in the buffer of the data of each program header
+    std::vector<size_t> segmentPositions;
 };
 
 #endif // RAWELFWRITER_H
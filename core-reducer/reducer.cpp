@@ -25,14 +25,24 @@
 #include "elfcorereader.h"
 #include "elfbinaryreader.h"
 #include "rawelfwriter.h"
+#include "minidumpwriter.h"
 #include "procinterface.h"
+#include "unwinder.h"
+#include "reductionpolicy.h"
+#include "parallelrange.h"
+#include "regionset.h"
 
 #include "../config.h"
 
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <sys/procfs.h>
 #include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <set>
 
 //add some additional space on the stack
 #define STACK_ADDITION 128
@@ -40,20 +50,121 @@
 // predefined heap address, will be used if an application does not have heap
 #define PREDEFINED_HEAP_ADDRESS 4
 
-#ifdef ARM_REGS
+//The bytes kept of a heap object that a pointer leads to, the size of the object is not known
+#define HEAP_OBJECT_SIZE 256
+//The most heap objects kept, the pointers are not trusted to lead anywhere useful
+#define MAX_HEAP_OBJECTS 4096
+
+//The default limits of the unwinder, the crash path must not be stalled by a corrupt stack
+#define DEFAULT_UNWIND_FRAMES 32
+#define DEFAULT_UNWIND_TIME_LIMIT 20000
+
+//The fewest threads of the process whose stacks are worth a thread of the reducer
+#define MIN_STACKS_PER_THREAD 256
+
+//The register notes that older elf.h files do not have
+#ifndef NT_SIGINFO
+#define NT_SIGINFO 0x53494749
+#endif
+#ifndef NT_X86_XSTATE
+#define NT_X86_XSTATE 0x202
+#endif
+#ifndef NT_ARM_VFP
+#define NT_ARM_VFP 0x400
+#endif
+#ifndef NT_ARM_TLS
+#define NT_ARM_TLS 0x401
+#endif
+#ifndef NT_ARM_SVE
+#define NT_ARM_SVE 0x405
+#endif
+#ifndef NT_ARM_PAC_MASK
+#define NT_ARM_PAC_MASK 0x406
+#endif
+
 /*!
-  * \brief The offset pointer in to the registry buffer that holds the value of R13 (aka esp)
-  * \sa gdb-7.0/gdb/arm-tdep.c
+  * \brief The names of the note types that can be given to Reducer::setNoteFilter()
   */
-#define ESP_OFFSET 13
-#else
+static const struct
+{
+    const char *name;
+    Elf_Word type;
+} noteNames[] = {
+    { "prstatus", NT_PRSTATUS },
+    { "fpregset", NT_FPREGSET },
+    { "prpsinfo", NT_PRPSINFO },
+    { "auxv", NT_AUXV },
+    { "file", NT_FILE },
+    { "siginfo", NT_SIGINFO },
+    { "prxfpreg", NT_PRXFPREG },
+    { "xstate", NT_X86_XSTATE },
+    { "arm-vfp", NT_ARM_VFP },
+    { "arm-tls", NT_ARM_TLS },
+    { "arm-sve", NT_ARM_SVE },
+    { "arm-pac", NT_ARM_PAC_MASK }
+};
+
 /*!
-  * \brief The offset pointer in tothe registry buffer that holds the value of the ESP (%esp)
-  * \sa sys/reg.h
-  * \sa gdb-7.0/gdb/i386-linux-tdep.c
+  * \brief Parse a list of note types for Reducer::setNoteFilter()
+  * \param notes The comma separated list
+  * \param kept Set to the types, true for those kept only for the crashing thread
+  * \param isAll Set to true if the list is "all"
+  * \return true on success, false if a type is not known
   */
-#define ESP_OFFSET 15
-#endif
+static bool parseNoteFilter(const std::string &notes, std::map<Elf_Word, bool> &kept, bool &isAll)
+{
+    kept.clear();
+    isAll = (notes == "all");
+    if (isAll)
+        return true;
+
+    for (size_t start = 0; start < notes.size();)
+    {
+        size_t end = notes.find(',', start);
+        if (end == std::string::npos)
+            end = notes.size();
+        std::string name = notes.substr(start, end - start);
+        start = end + 1;
+
+        bool isCrashingOnly = false;
+        size_t colon = name.find(':');
+        if (colon != std::string::npos)
+        {
+            if (name.compare(colon, std::string::npos, ":crashing") != 0)
+                return false;
+            isCrashingOnly = true;
+            name.erase(colon);
+        }
+        if (name.empty())
+            continue;
+
+        bool isFound = false;
+        for (size_t i = 0; i < sizeof(noteNames) / sizeof(noteNames[0]); i++)
+        {
+            if (name == noteNames[i].name)
+            {
+                kept[noteNames[i].type] = isCrashingOnly;
+                isFound = true;
+                break;
+            }
+        }
+        if (!isFound)
+        {
+            //a type that has no name is given as a number
+            char *numberEnd = NULL;
+            unsigned long type = strtoul(name.c_str(), &numberEnd, 0);
+            if (*numberEnd || !isdigit(name[0]))
+                return false;
+            kept[type] = isCrashingOnly;
+        }
+    }
+    return true;
+}
+
+/*!
+  * \def ELF_MAGIC_SIZE The number of bytes at the start of an Elf file that identify it
+  */
+#define ELF_MAGIC_SIZE 4
 
 typedef struct elf_prstatus Status;
 typedef struct elf_prpsinfo Info;
@@ -66,12 +177,27 @@ Reducer::Reducer(const char *output, ADDRESS heap)
     :   coreReader(NULL),
     binaryReader(NULL),
     coreWriter(NULL),
+    elfWriter(NULL),
+    debugPointerAddress(0),
+    linkMapAddress(0),
     dynamicAddressFromExecutable(0),
     dynamicSectionSizeFromExecutable(0),
     interpAddress(0),
     interpreter(0),
     output(output),
     heapAddress(heap),
+    stackDepth(0),
+    codeWindow(0),
+    outputFormat(ElfFormat),
+    unwindFrames(DEFAULT_UNWIND_FRAMES),
+    unwindTimeLimit(DEFAULT_UNWIND_TIME_LIMIT),
+    backtraceFile(NULL),
+    byteBudget(0),
+    bytesKept(0),
+    heapDepth(0),
+    isPageAligned(false),
+    threadCount(1),
+    isEveryNoteKept(true),
     processId(INT_MAX),
     executableName(NULL),
 	phdrAddr(0)
@@ -94,12 +220,7 @@ Reducer::~Reducer()
     {
         delete(coreWriter);
         coreWriter = NULL;
-    }
-
-    while (!dynamiclyCreatedHeaders.empty())
-    {
-        delete dynamiclyCreatedHeaders.back();
-        dynamiclyCreatedHeaders.pop_back();
+        elfWriter = NULL;
     }
 
     //These are only references now.  The objects have been deleted
@@ -119,17 +240,131 @@ bool Reducer::initalize(const char *core, const char *binary)
     if (!coreReader->initalize(core))
         return false;
 
+    return readCore(binary);
+}
+
+bool Reducer::initalize(char *image, size_t size, const char *binary)
+{
+    if (elf_version(EV_CURRENT) == EV_NONE)
+        LOG_RETURN(LOG_ERR, false, "Unable to determine the elf version to use");
+
+    coreReader = new ElfCoreReader();
+    if (!coreReader->initalize(image, size))
+        return false;
+
+    return readCore(binary);
+}
+
+bool Reducer::readCore(const char *binary)
+{
     //read the note section from the core dump as it contains alot of useful information
     //e.g. process id, ESPs for the process and all threads
     if (!getNotes())
         return false;
 
+    //The program headers have all that is needed, the sections are only read if they can not be used
+    if (!probeExecutable(binary) && !readExecutableSections(binary))
+        return false;
+
+    return true;
+}
+
+ADDRESS Reducer::getLoadBias(const Phdr *headers, size_t count, ADDRESS headersOffset)
+{
+    //A position independent executable is loaded away from its link address, AT_PHDR tells where
+    if (!phdrAddr)
+        return 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (headers[i].p_type == PT_PHDR)
+            return phdrAddr - headers[i].p_vaddr;
+    }
+
+    //Without PT_PHDR the address of the headers is found through the segment that loads them
+    for (size_t i = 0; i < count; i++)
+    {
+        if ((headers[i].p_type == PT_LOAD) && (headersOffset >= headers[i].p_offset)
+            && (headersOffset - headers[i].p_offset < headers[i].p_filesz))
+            return phdrAddr - (headers[i].p_vaddr + (headersOffset - headers[i].p_offset));
+    }
+    return 0;
+}
+
+bool Reducer::probeExecutable(const char *binary)
+{
+    int fd = open(binary, O_RDONLY);
+    if (fd < 0)
+        LOG_RETURN(LOG_ERR, false, "Opening file '%s' failed.", binary);
+
+    Ehdr header;
+    if ((pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header))
+        || (memcmp(header.e_ident, ELFMAG, SELFMAG) != 0)
+        || (header.e_ident[EI_CLASS] != coreReader->elfFileHeader()->e_ident[EI_CLASS])
+        || (header.e_phentsize != sizeof(Phdr)) || (header.e_phnum == PN_XNUM))
+    {
+        ::close(fd);
+        LOG_RETURN(LOG_INFO, false, "Can not use the program headers of '%s'", binary);
+    }
+
+    std::vector<Phdr> headers(header.e_phnum);
+    size_t headersSize = header.e_phnum * sizeof(Phdr);
+    if (headers.empty() || (pread(fd, &headers[0], headersSize, header.e_phoff) != (ssize_t)headersSize))
+    {
+        ::close(fd);
+        LOG_RETURN(LOG_INFO, false, "Can not read the program headers of '%s'", binary);
+    }
+
+    ADDRESS loadBias = getLoadBias(&headers[0], headers.size(), header.e_phoff);
+    const Phdr *interp = NULL;
+    for (unsigned int i = 0; i < headers.size(); i++)
+    {
+        if (headers[i].p_type == PT_DYNAMIC)
+        {
+            dynamicAddressFromExecutable = headers[i].p_vaddr + loadBias;
+            dynamicSectionSizeFromExecutable = headers[i].p_filesz;
+        }
+        else if (headers[i].p_type == PT_INTERP)
+        {
+            interp = &headers[i];
+        }
+    }
+
+    if (!dynamicAddressFromExecutable)
+    {
+        ::close(fd);
+        LOG(LOG_INFO, "No dynamic segment in '%s', it may be a statically linked file!", binary);
+        return true;
+    }
+
+    //The address at which the dynamic linker will be loaded, and its name
+    if (interp && interp->p_filesz && (interp->p_filesz < PATH_MAX))
+    {
+        interpAddress = interp->p_vaddr + loadBias;
+        interpreter = (char *)calloc(interp->p_filesz + 1, 1);
+        if (interpreter && (pread(fd, interpreter, interp->p_filesz, interp->p_offset) != (ssize_t)interp->p_filesz))
+        {
+            free(interpreter);
+            interpreter = NULL;
+        }
+    }
+    else
+    {
+        LOG(LOG_INFO, "Unable to find the interpreter segment in a dynamic binary.");
+    }
+
+    ::close(fd);
+    return true;
+}
+
+bool Reducer::readExecutableSections(const char *binary)
+{
     binaryReader = new ElfBinaryReader();
     if (!binaryReader->initalize(binary))
         return false;
 
-	Phdr *phdr = binaryReader->getSegmentByType(PT_PHDR);
-	ADDRESS loadBias = phdrAddr - phdr->p_vaddr;
+    const Ehdr *header = binaryReader->elfHeader();
+    ADDRESS loadBias = getLoadBias(binaryReader->programHeader(), binaryReader->programHeaderCount(), header->e_phoff);
     //get the dynamic section from the binary executable
     const CurrentSectionData *binarySectionData = binaryReader->getSectionByType(SHT_DYNAMIC);
     if (binarySectionData)
@@ -168,12 +403,33 @@ bool Reducer::initalize(const char *core, const char *binary)
     return true;
 }
 
+bool Reducer::setNoteFilter(const std::string &notes)
+{
+    return parseNoteFilter(notes, keptNotes, isEveryNoteKept);
+}
+
+bool Reducer::isNoteFilterValid(const std::string &notes)
+{
+    std::map<Elf_Word, bool> kept;
+    bool isAll;
+    return parseNoteFilter(notes, kept, isAll);
+}
+
 void Reducer::run(bool stacksOnly, const char *mapsFile)
 {
     checkHeapAddress();
     getStacks();
+    getCodeWindows();
+    getNamedMappings();
+    getReachableHeap();
+    getBacktraces();
+    getModuleManifest();
+    //The link map only has a meaning to a debugger loading an elf core
+    if (!stacksOnly && (outputFormat == ElfFormat))
+        getDynamicSection(mapsFile);
+    filterNotes();
     copyInitalSegmentsToOutput(stacksOnly);
-    if (!stacksOnly)
+    if (!stacksOnly && elfWriter)
         copyDynamicSectionInformation(mapsFile);
 
     //Finish writing the file to disk
@@ -229,7 +485,18 @@ bool Reducer::getNotes()
         if (current->n_type == NT_PRSTATUS)
         {
             Status *status = (Status *)((char *)(current + 1) + align_power(current->n_namesz, 2));
-            stackPointerAddresses.push_back((ADDRESS)status->pr_reg[ESP_OFFSET]);
+            ThreadState thread;
+            thread.pid = status->pr_pid;
+            thread.stackPointer = (ADDRESS)status->pr_reg[ESP_OFFSET];
+            thread.programCounter = (ADDRESS)status->pr_reg[PC_OFFSET];
+            thread.framePointer = (ADDRESS)status->pr_reg[FP_OFFSET];
+#ifdef LR_OFFSET
+            thread.linkRegister = (ADDRESS)status->pr_reg[LR_OFFSET];
+#else
+            thread.linkRegister = 0;
+#endif
+            //The thread that received the fatal signal is the first, see CRASHING_THREAD
+            threads.push_back(thread);
             //The main process should have the lowest pid.  All the threads that are created
             //from it should have a higher process id
             if (status->pr_pid < processId)
@@ -241,6 +508,16 @@ bool Reducer::getNotes()
             //The first part of a programs arguments "argv[0]" should be the applications name
             //but not just the name it should include its path
             executableName = info->pr_psargs;
+        }
+        else if (current->n_type == NT_FILE)
+        {
+            const char *desc = (char *)(current + 1) + align_power(current->n_namesz, 2);
+            size_t size = ((char *)end > desc) ? (char *)end - desc : 0;
+            if (current->n_descsz < size)
+                size = current->n_descsz;
+            if (!ElfCoreReader::readFileNote(desc, size, fileMappings))
+                LOG(LOG_WARNING, "The NT_FILE note is cut or corrupt, %u file mappings were read",
+                    (unsigned int)fileMappings.size());
         }
 		else if (current->n_type == NT_AUXV)
 		{
@@ -269,64 +546,430 @@ bool Reducer::getNotes()
     return true;
 }
 
+void Reducer::filterNotes()
+{
+    if (isEveryNoteKept)
+        return;
+
+    const Phdr *noteSegment = coreReader->getSegmentByType(PT_NOTE);
+    const char *current = coreReader->getDataByOffset(noteSegment->p_offset);
+    const char *end = current + noteSegment->p_filesz;
+    //the notes before the first NT_PRSTATUS belong to the first thread
+    size_t thread = 0;
+    bool isThreadSeen = false;
+
+    filteredNotes.clear();
+    while (current + sizeof(Nhdr) <= end)
+    {
+        const Nhdr *note = (const Nhdr *)current;
+        const char *name = (const char *)(note + 1);
+        const char *desc = name + align_power(note->n_namesz, 2);
+        const char *next = desc + align_power(note->n_descsz, 2);
+        if (next > end)
+            break;
+        current = next;
+
+        if (note->n_type == NT_PRSTATUS)
+        {
+            if (isThreadSeen)
+                thread++;
+            isThreadSeen = true;
+        }
+        else
+        {
+            std::map<Elf_Word, bool>::const_iterator kept = keptNotes.find(note->n_type);
+            if (kept == keptNotes.end())
+                continue;
+            //the process wide notes are written with the first thread, they are not per thread
+            bool isProcessNote = (note->n_type == NT_PRPSINFO) || (note->n_type == NT_AUXV)
+                                 || (note->n_type == NT_FILE) || (note->n_type == NT_SIGINFO);
+            if (kept->second && !isProcessNote && (thread != CRASHING_THREAD))
+                continue;
+        }
+
+        //The kept note is written again with its name and description padded to 4 bytes
+        size_t offset = filteredNotes.size();
+        filteredNotes.resize(offset + sizeof(Nhdr) + align_power(note->n_namesz, 2)
+                             + align_power(note->n_descsz, 2), 0);
+        memcpy(&filteredNotes[offset], note, sizeof(Nhdr));
+        offset += sizeof(Nhdr);
+        memcpy(&filteredNotes[offset], name, note->n_namesz);
+        offset += align_power(note->n_namesz, 2);
+        memcpy(&filteredNotes[offset], desc, note->n_descsz);
+    }
+
+    LOG(LOG_DEBUG, "Kept %u bytes of the %u bytes of notes", (unsigned int)filteredNotes.size(),
+        (unsigned int)noteSegment->p_filesz);
+
+    memcpy(&filteredNotesHeader, noteSegment, sizeof(Phdr));
+    filteredNotesHeader.p_filesz = filteredNotes.size();
+    filteredNotesHeader.p_align = 4;
+    std::replace(wantedHeaders.begin(), wantedHeaders.end(), noteSegment, (const Phdr *)&filteredNotesHeader);
+}
+
 void Reducer::getStacks()
 {
-    for (unsigned int i = 0; i < stackPointerAddresses.size(); i++)
+    //The stacks are found in parallel, but they are added in order so that the output is always the same
+    stackRanges.resize(threads.size());
+    ParallelRange::run(threads.size(), threadCount, MIN_STACKS_PER_THREAD, findStacks, this);
+
+    //The crashing thread comes first, its stack is kept whole and the byte budget is spent on the others
+    for (unsigned int n = 0; n < stackRanges.size(); n++)
     {
-        const Phdr *coreSegment = coreReader->getSegmentByAddress(stackPointerAddresses.at(i));
-        if (!coreSegment)
+        const StackRange &stack = stackRanges.at(n);
+        if (!stack.segment)
             continue;
 
-        Phdr *toStore = new Phdr;
-        memcpy(toStore, coreSegment, sizeof(Phdr));
+        //Threads sharing the same stack area are collapsed in to a single segment
+        if (n == CRASHING_THREAD)
+            addSegmentRange(stack.segment, stack.start, stack.end);
+        else
+            addBudgetedRange(stack.segment, stack.start, stack.end);
+    }
+}
+
+void Reducer::findStacks(void *context, size_t begin, size_t end)
+{
+    Reducer *reducer = (Reducer *)context;
+    for (size_t n = begin; n < end; n++)
+    {
+        ADDRESS stackPointer = reducer->threads.at(n).stackPointer;
+        StackRange &stack = reducer->stackRanges.at(n);
+        stack.segment = reducer->coreReader->getSegmentByAddress(stackPointer);
+        if (!stack.segment)
+            continue;
 
         //stacks grow downwards so the data between the top of the stack (esp) and the base of the
         //memory section is just junk data !! (hopefully :))
-        if (stackPointerAddresses.at(i) - STACK_ADDITION > toStore->p_vaddr)
-            toStore->p_vaddr = stackPointerAddresses.at(i) - STACK_ADDITION;
+        stack.start = stack.segment->p_vaddr;
+        if (stackPointer - STACK_ADDITION > stack.start)
+            stack.start = stackPointer - STACK_ADDITION;
         //The size of the stack that we are interested in is the area between the the high level
         //memory address of the section and the esp
-        toStore->p_filesz = (coreSegment->p_vaddr + coreSegment->p_filesz) - toStore->p_vaddr;
-        toStore->p_memsz = toStore->p_filesz;
-        //The offset into the file from where we want to copy the data is the esp.
-        toStore->p_offset += (toStore->p_vaddr - coreSegment->p_vaddr);
-        //store so it can be copied to the output core file later
-        wantedHeaders.push_back(toStore);
-		//These headers are are created and as such must be deleted correctly;
-        dynamiclyCreatedHeaders.push_back(toStore);
+        stack.end = stack.segment->p_vaddr + stack.segment->p_filesz;
+        //Only the crashing thread is guaranteed its whole stack, for the others the top frames are enough
+        if (reducer->stackDepth && (n != CRASHING_THREAD) && (stackPointer + reducer->stackDepth < stack.end))
+            stack.end = stackPointer + reducer->stackDepth;
     }
 }
 
-void Reducer::generateDynamicSectionInformation()
+void Reducer::getCodeWindows()
 {
-    // prepare new program header
-    Phdr newHeader;
-    newHeader.p_align = 1;
-    newHeader.p_flags = PF_R;
-    newHeader.p_memsz = newHeader.p_filesz = dynamicSectionSizeFromExecutable;
-    newHeader.p_vaddr = dynamicAddressFromExecutable;
-    newHeader.p_offset = 0;
-    newHeader.p_type = PT_LOAD;
-    newHeader.p_paddr = 0;
+    if (!codeWindow)
+        return;
 
-    int size = newHeader.p_filesz/sizeof(Elf_Dyn);
+    for (unsigned int i = 0; i < threads.size(); i++)
+    {
+        //The link register is checked as well, a crash may happen in a call out of the generated code
+        ADDRESS addresses[] = { threads.at(i).programCounter, threads.at(i).linkRegister };
+        for (unsigned int j = 0; j < sizeof(addresses) / sizeof(addresses[0]); j++)
+        {
+            if (!addresses[j])
+                continue;
+
+            const Phdr *coreSegment = coreReader->getSegmentByAddress(addresses[j]);
+            if (!coreSegment || !isAnonymousCode(coreSegment))
+                continue;
+
+            //Small areas are kept whole
+            ADDRESS start = coreSegment->p_vaddr;
+            ADDRESS end = coreSegment->p_vaddr + coreSegment->p_filesz;
+            if (coreSegment->p_filesz > (2 * codeWindow))
+            {
+                if (addresses[j] - codeWindow > start)
+                    start = addresses[j] - codeWindow;
+                if (addresses[j] + codeWindow < end)
+                    end = addresses[j] + codeWindow;
+            }
+
+            addBudgetedRange(coreSegment, start, end);
+        }
+    }
+}
+
+void Reducer::getNamedMappings()
+{
+    for (unsigned int i = 0; (i < fileMappings.size()) && !mappingPatterns.empty(); i++)
+    {
+        const FileMapping &mapping = fileMappings.at(i);
+        if (!ReductionPolicy::isMappingWanted(mappingPatterns, mapping.name))
+            continue;
 
-    Elf_Dyn *dyn = new Elf_Dyn[size];
-    memset(dyn, 0, newHeader.p_filesz);
+        //Only the part of the mapping that the kernel dumped is there to keep
+        for (unsigned int j = 0; j < coreReader->elfFileHeader()->e_phnum; j++)
+        {
+            const Phdr *coreSegment = coreReader->getSegmentByIndex(j);
+            if (!coreSegment || (coreSegment->p_type != PT_LOAD) || !coreSegment->p_filesz)
+                continue;
+            ADDRESS start = std::max((ADDRESS)coreSegment->p_vaddr, mapping.start);
+            ADDRESS end = std::min((ADDRESS)(coreSegment->p_vaddr + coreSegment->p_filesz), mapping.end);
+            if ((start < end) && !addBudgetedRange(coreSegment, start, end))
+                return;
+        }
+    }
+}
+
+void Reducer::getReachableHeap()
+{
+    //The words of the kept stacks that point in to the heap lead to the objects the threads were using
+    std::vector<std::pair<ADDRESS, ADDRESS> > scan;
+    for (RegionSet::const_iterator i = keptRegions.begin(); heapDepth && (i != keptRegions.end()); ++i)
+    {
+        const Phdr *coreSegment = coreReader->getSegmentByAddress(i->second.start);
+        if (coreSegment && !isHeapSegment(coreSegment))
+            scan.push_back(std::make_pair(i->second.start, i->second.end));
+    }
+
+    std::set<ADDRESS> followed;
+    for (unsigned int level = 0; (level < heapDepth) && !scan.empty(); level++)
+    {
+        std::vector<std::pair<ADDRESS, ADDRESS> > next;
+        for (unsigned int i = 0; i < scan.size(); i++)
+        {
+            size_t size = scan.at(i).second - scan.at(i).first;
+            const char *data = getBufferAtAddress(scan.at(i).first, size);
+            for (size_t offset = 0; data && (offset + sizeof(ADDRESS) <= size); offset += sizeof(ADDRESS))
+            {
+                ADDRESS pointer;
+                memcpy(&pointer, data + offset, sizeof(pointer));
+                pointer &= ~(ADDRESS)(sizeof(ADDRESS) - 1);
+                const Phdr *coreSegment = coreReader->getSegmentByAddress(pointer);
+                if (!coreSegment || !isHeapSegment(coreSegment) || !followed.insert(pointer).second)
+                    continue;
+
+                ADDRESS end = std::min(pointer + HEAP_OBJECT_SIZE,
+                                       (ADDRESS)(coreSegment->p_vaddr + coreSegment->p_filesz));
+                if ((followed.size() > MAX_HEAP_OBJECTS) || !addBudgetedRange(coreSegment, pointer, end))
+                    return;
+                next.push_back(std::make_pair(pointer, end));
+            }
+        }
+        scan.swap(next);
+    }
+}
+
+bool Reducer::isHeapSegment(const Phdr *coreSegment)
+{
+    if ((coreSegment->p_type != PT_LOAD) || !(coreSegment->p_flags & PF_W) || (coreSegment->p_flags & PF_X)
+        || !coreSegment->p_filesz)
+        return false;
+
+    for (unsigned int i = 0; i < fileMappings.size(); i++)
+    {
+        if ((fileMappings.at(i).start <= coreSegment->p_vaddr) && (coreSegment->p_vaddr < fileMappings.at(i).end))
+            return false;
+    }
+    for (unsigned int i = 0; i < threads.size(); i++)
+    {
+        if ((coreSegment->p_vaddr <= threads.at(i).stackPointer)
+            && (threads.at(i).stackPointer < coreSegment->p_vaddr + coreSegment->p_memsz))
+            return false;
+    }
+    return true;
+}
+
+bool Reducer::addBudgetedRange(const Phdr *coreSegment, ADDRESS start, ADDRESS end)
+{
+    //A range is cut from its end, so a stack keeps the frames nearest to its stack pointer
+    if (byteBudget)
+    {
+        if (bytesKept >= byteBudget)
+            return false;
+        if (end - start > byteBudget - bytesKept)
+            end = start + (byteBudget - bytesKept);
+    }
+    //Memory that was kept already does not count again
+    bytesKept += addSegmentRange(coreSegment, start, end);
+    return true;
+}
+
+void Reducer::getBacktraces()
+{
+    if (!unwindFrames)
+        return;
+
+    //The origional core is used, so the frames are followed beyond the stack that is kept
+    Unwinder unwinder(coreReader, unwindFrames, unwindTimeLimit);
+    for (unsigned int i = 0; i < fileMappings.size(); i++)
+    {
+        unwinder.addModule(fileMappings.at(i).name, fileMappings.at(i).start,
+                           fileMappings.at(i).end, fileMappings.at(i).fileOffset);
+    }
+
+    //The crashing thread is unwound first so that it is not the one cut short by the time limit
+    for (unsigned int i = 0; i < threads.size(); i++)
+    {
+        unwinder.unwind(threads.at(i).pid, (i == CRASHING_THREAD), threads.at(i).programCounter,
+                        threads.at(i).stackPointer, threads.at(i).framePointer);
+    }
+
+    std::vector<char> desc;
+    unwinder.createNoteDescription(desc);
+    addRichCoreNote(NT_RICHCORE_BACKTRACE, desc);
+
+    if (backtraceFile)
+        unwinder.writeText(backtraceFile);
+}
+
+void Reducer::getModuleManifest()
+{
+    std::vector<char> desc;
+    uint32_t count = 0;
+    desc.resize(sizeof(count));
+
+    for (unsigned int i = 0; i < fileMappings.size();)
+    {
+        //The mappings of a file follow each other, together they make up the module
+        const char *name = fileMappings.at(i).name;
+        ADDRESS base = fileMappings.at(i).start;
+        ADDRESS end = fileMappings.at(i).end;
+        bool isFromStart = (fileMappings.at(i).fileOffset == 0);
+        for (i++; (i < fileMappings.size()) && (strcmp(fileMappings.at(i).name, name) == 0); i++)
+            end = fileMappings.at(i).end;
+
+        //Data files are mapped too, only the files with code in them are modules
+        if (!isExecutableMapping(base, end))
+            continue;
+
+        //The build id of the file that was loaded, the file on disk may have been replaced since
+        std::string id;
+        if (isFromStart)
+            id = getBuildIdFromCore(base);
+        if (id.empty())
+        {
+            ElfBinaryReader reader;
+            if (reader.initalize(name))
+                id = reader.buildId();
+        }
+
+        uint64_t range[] = { base, end - base };
+        desc.insert(desc.end(), (char *)range, (char *)range + sizeof(range));
+        desc.insert(desc.end(), id.c_str(), id.c_str() + id.size() + 1);
+        desc.insert(desc.end(), name, name + strlen(name) + 1);
+        desc.resize(align_power(desc.size(), 2), 0);
+        count++;
+    }
+
+    if (!count)
+        return;
+
+    memcpy(&desc[0], &count, sizeof(count));
+    addRichCoreNote(NT_RICHCORE_MODULES, desc);
+}
+
+bool Reducer::isExecutableMapping(ADDRESS start, ADDRESS end)
+{
+    //Segments that were not dumped are still listed, with a file size of 0
+    const Phdr *headers = coreReader->programHeader();
+    for (int i = 0; i < coreReader->elfFileHeader()->e_phnum; i++)
+    {
+        if ((headers[i].p_type == PT_LOAD) && (headers[i].p_flags & PF_X)
+            && (start <= headers[i].p_vaddr) && (headers[i].p_vaddr < end))
+            return true;
+    }
+    return false;
+}
+
+std::string Reducer::getBuildIdFromCore(ADDRESS base)
+{
+    //The kernel dumps the first page of a mapped elf file, which holds the elf and program headers
+    const Ehdr *header = (const Ehdr *)getBufferAtAddress(base, sizeof(Ehdr));
+    if (!header || (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0)
+        || (header->e_ident[EI_CLASS] != coreReader->elfFileHeader()->e_ident[EI_CLASS]))
+        return std::string();
+
+    const Phdr *headers = (const Phdr *)getBufferAtAddress(base + header->e_phoff, header->e_phnum * sizeof(Phdr));
+    if (!headers)
+        return std::string();
+
+    //The difference between the address the file was linked at and the address it was loaded at
+    ADDRESS bias = base;
+    for (int i = 0; i < header->e_phnum; i++)
+    {
+        if ((headers[i].p_type == PT_LOAD) && (headers[i].p_offset == 0))
+        {
+            bias = base - headers[i].p_vaddr;
+            break;
+        }
+    }
+
+    for (int i = 0; i < header->e_phnum; i++)
+    {
+        if (headers[i].p_type != PT_NOTE)
+            continue;
+
+        const char *notes = getBufferAtAddress(bias + headers[i].p_vaddr, headers[i].p_filesz);
+        if (!notes)
+            continue;
+
+        std::string id = ElfBinaryReader::readBuildId(notes, headers[i].p_filesz);
+        if (!id.empty())
+            return id;
+    }
+    return std::string();
+}
+
+void Reducer::addRichCoreNote(Elf_Word type, const std::vector<char> &desc)
+{
+    Nhdr header;
+    header.n_namesz = sizeof(RICH_CORE_NOTE_NAME);
+    header.n_descsz = desc.size();
+    header.n_type = type;
+
+    richCoreNotes.insert(richCoreNotes.end(), (char *)&header, (char *)&header + sizeof(header));
+    richCoreNotes.insert(richCoreNotes.end(), RICH_CORE_NOTE_NAME, RICH_CORE_NOTE_NAME + sizeof(RICH_CORE_NOTE_NAME));
+    richCoreNotes.resize(align_power(richCoreNotes.size(), 2), 0);
+    richCoreNotes.insert(richCoreNotes.end(), desc.begin(), desc.end());
+    richCoreNotes.resize(align_power(richCoreNotes.size(), 2), 0);
+}
+
+bool Reducer::isAnonymousCode(const Phdr *coreSegment)
+{
+    if (!(coreSegment->p_flags & PF_X) || !coreSegment->p_filesz)
+        return false;
+
+    for (unsigned int i = 0; i < fileMappings.size(); i++)
+    {
+        if ((fileMappings.at(i).start <= coreSegment->p_vaddr) && (coreSegment->p_vaddr < fileMappings.at(i).end))
+            return false;
+    }
+
+    //Without NT_FILE (older kernels) the only file backed code that is in the core is the first page
+    //of a mapped Elf file, which is written so that the debugger can find the build id.
+    const char *data = coreReader->getDataByOffset(coreSegment->p_offset);
+    if (!data || ((coreSegment->p_filesz >= ELF_MAGIC_SIZE) && (memcmp(data, ELFMAG, ELF_MAGIC_SIZE) == 0)))
+        return false;
+
+    return true;
+}
+
+size_t Reducer::addSegmentRange(const Phdr *coreSegment, ADDRESS start, ADDRESS end)
+{
+    const char *data = coreReader->getDataByOffset(coreSegment->p_offset) + (start - coreSegment->p_vaddr);
+    return keptRegions.add(start, end, coreSegment->p_flags, data);
+}
+
+void Reducer::generateDynamicSectionInformation()
+{
+    int size = dynamicSectionSizeFromExecutable / sizeof(Elf_Dyn);
+    if (size <= 0)
+        return;
+
+    generatedDynamic.resize(size);
+    memset(&generatedDynamic[0], 0, size * sizeof(Elf_Dyn));
     //ensure that only the last element in the array is a pointer to null aka DT_NULL
     // overwrite the content
     // GDB firstly read the executable file to find the location of DT_DEBUG and after that it
     // is read from the coredump, so to speed-up we can just set every value to heapAddress
     for (int i = 0; i < size-1; i++)
-        dyn[i].d_un.d_val = heapAddress;
-
-    // add it to the target
-    coreWriter->copySegment(&newHeader, (char *)dyn);
+        generatedDynamic[i].d_un.d_val = heapAddress;
 
-    delete [] dyn;
+    // add it to the target, it is not in the core so it is not merged with any kept memory
+    keptRegions.add(dynamicAddressFromExecutable, dynamicAddressFromExecutable + size * sizeof(Elf_Dyn),
+                    PF_R, (const char *)&generatedDynamic[0]);
 }
 
-void Reducer::copyDynamicSectionInformation(const char *mapsFile)
+void Reducer::getDynamicSection(const char *mapsFile)
 {
     const Phdr *coreSegment = coreReader->getSegmentByAddress(dynamicAddressFromExecutable);
     if (!coreSegment)
@@ -336,7 +979,7 @@ void Reducer::copyDynamicSectionInformation(const char *mapsFile)
         if (mapsFile)
         {
             generateDynamicSectionInformation();
-            createLinkMapInOutputFile(heapAddress, mapsFile);
+            linkMapAddress = heapAddress;
         }
         return;
     }
@@ -344,34 +987,36 @@ void Reducer::copyDynamicSectionInformation(const char *mapsFile)
     //Try to find the link map from the dynamic section
     Elf_Dyn *current = (Elf_Dyn *)((char *)coreReader->elfFileHeader() + coreSegment->p_offset
                                    + (dynamicAddressFromExecutable - coreSegment->p_vaddr));
+    Elf_Dyn *end = (Elf_Dyn *)((char *)coreReader->elfFileHeader() + coreSegment->p_offset + coreSegment->p_filesz);
 
-    //a var used to calculate the offset of the DT_DEBUG dynamic section's address pointer
-    //This address pointer has to be overwritten to make it point to the start of our r_debug
-    //section.  Once this is overwritten then gdb can follow the link map correctly
-    size_t offset = dynamicAddressFromExecutable - coreSegment->p_vaddr;
-
-    while (current->d_tag != DT_NULL)
+    //The DT_DEBUG dynamic section's address pointer has to be overwritten to make it point to the start
+    //of our r_debug section.  Once this is overwritten then gdb can follow the link map correctly
+    for (; (current < end) && (current->d_tag != DT_NULL); current++)
     {
         if (current->d_tag == DT_DEBUG)
         {
-            //the offset should be shifted to point to the second variable of the struct
-            //see elf.h
-            offset += sizeof(Elf_SWord);
-            coreWriter->copySegment(coreSegment, coreReader->getDataByOffset(coreSegment->p_offset),
-                                    (char *)&heapAddress, offset, sizeof(ADDRESS));
-            if(mapsFile)
-                // maps file is given, use it to generate new debug information
-                createLinkMapInOutputFile(current->d_un.d_ptr, mapsFile);
-            else
-                // else use original debug info
-                copyLinkMapToOutputFile(current->d_un.d_ptr);
+            //the whole memory area is kept, it is merged with the other memory kept from it
+            addSegmentRange(coreSegment, coreSegment->p_vaddr, coreSegment->p_vaddr + coreSegment->p_filesz);
+            debugPointerAddress = coreSegment->p_vaddr + ((char *)&current->d_un - coreReader->getDataByOffset(coreSegment->p_offset));
+            linkMapAddress = current->d_un.d_ptr;
             break;
         }
-        offset += sizeof(Elf_Dyn);
-        current++;
     }
 }
 
+void Reducer::copyDynamicSectionInformation(const char *mapsFile)
+{
+    if (debugPointerAddress)
+        elfWriter->overwrite(debugPointerAddress, (const char *)&heapAddress, sizeof(ADDRESS));
+
+    if(mapsFile)
+        // maps file is given, use it to generate new debug information
+        createLinkMapInOutputFile(linkMapAddress, mapsFile);
+    else
+        // else use original debug info
+        copyLinkMapToOutputFile(linkMapAddress);
+}
+
 void Reducer::copyLinkMapToOutputFile(ADDRESS start)
 {
     //The structure for DT_DEBUG may exist but it's pointer to r_debug info may be 0x0 meaning that
@@ -380,16 +1025,17 @@ void Reducer::copyLinkMapToOutputFile(ADDRESS start)
         return;
 
     //The output file is not initalized yet ??
-    if (!coreWriter)
+    if (!elfWriter)
         return;
 
     //Initalize a segment for the link map
-    coreWriter->startLinkMapSegment(heapAddress);
+    if (!elfWriter->startLinkMapSegment(heapAddress))
+        return;
 
     const char *r_debugBuffer = getBufferAtAddress(start);
     //copy the r_debug structure to the new segment
     //and find the actual start of the link_map structure
-    start = coreWriter->addR_DebugStruct(r_debugBuffer);
+    start = elfWriter->addR_DebugStruct(r_debugBuffer);
     ADDRESS stringAddress = 0;
 
     while (start)
@@ -409,11 +1055,11 @@ void Reducer::copyLinkMapToOutputFile(ADDRESS start)
 
         //write the Link map structure and address to the output file
         //And get the address of the next link in the LM_LINK_MAP returned
-        start = coreWriter->addLinkMapSegment(linkMapBuffer, stringBuffer);
+        start = elfWriter->addLinkMapSegment(linkMapBuffer, stringBuffer);
     }
 
     //finish the segment for the link map
-    coreWriter->finalizeLinkMapSegment();
+    elfWriter->finalizeLinkMapSegment();
 }
 
 void Reducer::createLinkMapInOutputFile(ADDRESS start, const char *mapsFile)
@@ -424,7 +1070,7 @@ void Reducer::createLinkMapInOutputFile(ADDRESS start, const char *mapsFile)
         return;
 
     //The output file is not initalized yet ??
-    if (!coreWriter)
+    if (!elfWriter)
         return;
 
     // generate list of shared objects
@@ -436,23 +1082,37 @@ void Reducer::createLinkMapInOutputFile(ADDRESS start, const char *mapsFile)
         return;
 
     //Initalize a segment for the link map
-    coreWriter->startLinkMapSegment(heapAddress);
+    if (!elfWriter->startLinkMapSegment(heapAddress))
+        return;
 
     //create the r_debug structure in the new segment
-    start = coreWriter->createR_DebugStruct();
+    start = elfWriter->createR_DebugStruct();
 
     //add empty first link map item (should be so by GDB)
-    coreWriter->createAndAddLinkMapSegment(0, 0, false, true);
+    elfWriter->createAndAddLinkMapSegment(0, 0, false, true);
 
     int size = soList->size();
     for (int i = 0; i < size; i++)
     {
-        coreWriter->createAndAddLinkMapSegment(soList->at(i).addr, soList->at(i).name.c_str(),
-                                               (i==(size-1)), false);
+        elfWriter->createAndAddLinkMapSegment(soList->at(i).addr, soList->at(i).name.c_str(),
+                                              (i==(size-1)), false);
     }
 
     //finish the segment for the link map
-    coreWriter->finalizeLinkMapSegment();
+    elfWriter->finalizeLinkMapSegment();
+}
+
+const char *Reducer::getBufferAtAddress(ADDRESS start, size_t size)
+{
+    const Phdr *coreSegment = coreReader->getSegmentByAddress(start);
+    if (!coreSegment || (start + size > coreSegment->p_vaddr + coreSegment->p_filesz))
+        return NULL;
+
+    size_t offset = coreSegment->p_offset + (start - coreSegment->p_vaddr);
+    //The core may have been cut short
+    if (size && !coreReader->getDataByOffset(offset + size - 1))
+        return NULL;
+    return coreReader->getDataByOffset(offset);
 }
 
 const char *Reducer::getBufferAtAddress(ADDRESS start)
@@ -469,29 +1129,92 @@ const char *Reducer::getBufferAtAddress(ADDRESS start)
     return buf;
 }
 
+size_t Reducer::getPageSize()
+{
+    //The kernel aligns the memory segments of a core to the page size of the process
+    size_t pageSize = 0;
+    for (unsigned int i = 0; i < coreReader->elfFileHeader()->e_phnum; i++)
+    {
+        const Phdr *coreSegment = coreReader->getSegmentByIndex(i);
+        if (coreSegment && (coreSegment->p_type == PT_LOAD) && (coreSegment->p_align > pageSize)
+            && !(coreSegment->p_align & (coreSegment->p_align - 1)))
+            pageSize = coreSegment->p_align;
+    }
+
+    if (pageSize <= 1)
+        pageSize = sysconf(_SC_PAGESIZE);
+    return pageSize;
+}
+
 void Reducer::copyInitalSegmentsToOutput(bool stacksOnly)
 {
-    int fileSize = 0;
+    //The notes added by the reducer are a segment of their own after the notes of the origional core
+    Phdr richCoreNotesHeader;
+    memset(&richCoreNotesHeader, 0, sizeof(Phdr));
+    richCoreNotesHeader.p_type = PT_NOTE;
+    richCoreNotesHeader.p_filesz = richCoreNotes.size();
+    richCoreNotesHeader.p_align = 4;
+
+    //The notes come first and then the kept memory in the order of its addresses
+    std::vector<const Phdr *> headers(wantedHeaders);
+    std::vector<const char *> data;
     for (unsigned int i = 0; i < wantedHeaders.size(); i++)
-        fileSize += ((Phdr *)wantedHeaders.at(i))->p_filesz;
+    {
+        //the rewritten notes are the only segment that is not in the core as it is
+        data.push_back((wantedHeaders.at(i) == &filteredNotesHeader) ? &filteredNotes[0]
+                       : coreReader->getDataByOffset(((Phdr *)wantedHeaders.at(i))->p_offset));
+    }
+    if (!richCoreNotes.empty())
+    {
+        headers.push_back(&richCoreNotesHeader);
+        data.push_back(&richCoreNotes[0]);
+    }
 
-    //Setup a writer to store the newly created core file
-    coreWriter = new RawElfWriter();
+    size_t pageSize = getPageSize();
+    regionHeaders.resize(keptRegions.size());
+    size_t n = 0;
+    for (RegionSet::const_iterator i = keptRegions.begin(); i != keptRegions.end(); ++i, n++)
+    {
+        Phdr &header = regionHeaders.at(n);
+        memset(&header, 0, sizeof(Phdr));
+        header.p_type = PT_LOAD;
+        header.p_flags = i->second.flags;
+        header.p_vaddr = i->second.start;
+        header.p_filesz = i->second.end - i->second.start;
+        header.p_memsz = header.p_filesz;
+        header.p_align = pageSize;
+        headers.push_back(&header);
+        data.push_back(i->second.data);
+    }
 
+    size_t fileSize = 0;
+    for (unsigned int i = 0; i < headers.size(); i++)
+        fileSize += headers.at(i)->p_filesz;
+
+    //Setup a writer to store the newly created core file
     int additionalHeaders = 0;
-    //In addition to the Notes and stacks we want 2 headers reserved for the the dynamic section
-    //information and the heap segment (by default)
-    if (!stacksOnly)
-        additionalHeaders = 2;
-    if (!coreWriter->initalize(output, wantedHeaders.size() + additionalHeaders , fileSize))
+    if (outputFormat == MinidumpFormat)
+    {
+        coreWriter = new MinidumpWriter();
+    }
+    else
+    {
+        elfWriter = new RawElfWriter();
+        coreWriter = elfWriter;
+        //In addition to the Notes and the kept memory we want a header reserved for the link map,
+        //the dynamic section is one of the kept regions
+        if (!stacksOnly)
+            additionalHeaders = 1;
+        //With thousands of threads the stacks are copied by as many threads as there are processors
+        elfWriter->setThreads(threadCount);
+        if (isPageAligned)
+            elfWriter->setPageSize(pageSize);
+    }
+    if (!coreWriter->initalize(output, headers.size() + additionalHeaders, fileSize))
         return;
 
     coreWriter->copyElfHeader(coreReader->elfFileHeader());
-    for (unsigned int i = 0; i < wantedHeaders.size(); i++)
-    {
-        coreWriter->copySegment(wantedHeaders.at(i),
-                                coreReader->getDataByOffset(((Phdr *)wantedHeaders.at(i))->p_offset));
-    }
+    coreWriter->copySegments(headers, data);
 }
 
 
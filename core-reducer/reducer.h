@@ -56,12 +56,15 @@
 #ifndef REDUCER_H
 #define REDUCER_H
 #include "defines.h"
+#include "elfcorereader.h"
+#include "regionset.h"
+#include <map>
 #include <vector>
 #include <string>
 
 //forward declerations
-class ElfCoreReader;
 class ElfBinaryReader;
+class CoreWriter;
 class RawElfWriter;
 
 class Reducer
@@ -90,6 +93,15 @@ public:
       */
     bool initalize(const char *core, const char *binary);
 
+    /*!
+      * \brief Initalize the internal structures from a core image in memory
+      * \param image The core image, such as the one created by ProcessSnapshot
+      * \param size The size of the image in bytes
+      * \param binary The name of the executable of the process
+      * \return true on success false otherwise.
+      */
+    bool initalize(char *image, size_t size, const char *binary);
+
     /*!
       * \brief Run the algorithm that reduces the input core file and produces a shrunken core
       * that contains only the wanted data.
@@ -98,7 +110,131 @@ public:
       */
     void run(bool stacksOnly=false, const char *mapsFile=NULL);
 
+    /*!
+      * \brief Limit the amount of stack that is kept for threads other than the crashing thread
+      * \param depth The number of bytes above the stack pointer to keep, 0 keeps the whole live stack
+      * The crashing thread is always given its full live stack.
+      */
+    void setStackDepth(size_t depth) { stackDepth = depth; }
+
+    /*!
+      * \brief Set the amount of code that is kept around the program counters that are in anonymous memory
+      * \param window The number of bytes to keep on each side of the address, 0 disables the code windows
+      * Code generated at runtime (e.g. by a JIT) has no file on disk, so the only copy of it is in the core.
+      */
+    void setCodeWindow(size_t window) { codeWindow = window; }
+
+    /*!
+      * \brief The formats in which the reduced core can be written
+      */
+    enum OutputFormat
+    {
+        ElfFormat,     //!< An elf core file that can be loaded by gdb
+        MinidumpFormat //!< A Breakpad/Crashpad minidump
+    };
+
+    /*!
+      * \brief Set the format of the reduced core, the default is an elf core file
+      * \param format The format to write
+      * The link map information is only added to elf output, the minidump module list is taken from the notes.
+      */
+    void setOutputFormat(OutputFormat format) { outputFormat = format; }
+
+    /*!
+      * \brief Set the limits of the unwinder that makes the backtraces of the threads
+      * \param frames The maximum number of frames for each thread, 0 disables the backtraces
+      * \param timeLimit The number of microseconds that the unwinding of all the threads may take
+      */
+    void setUnwindLimits(size_t frames, long timeLimit) { unwindFrames = frames; unwindTimeLimit = timeLimit; }
+
+    /*!
+      * \brief Set a file to which the backtraces are written as text, in addition to the note in the reduced core
+      * \param fileName The file to write the backtraces to, NULL for none
+      */
+    void setBacktraceFile(const char *fileName) { backtraceFile = fileName; }
+
+    /*!
+      * \brief Limit the memory that is kept besides the stack of the crashing thread
+      * \param bytes The most bytes of stacks, code, mappings and heap to keep, 0 for no limit
+      * The stacks are kept first, then the code windows, the mappings and the heap.
+      */
+    void setByteBudget(size_t bytes) { byteBudget = bytes; }
+
+    /*!
+      * \brief Set how many levels of pointers are followed from the kept stacks in to the heap
+      * \param depth The number of levels, 0 keeps no heap
+      * A word that points in to writable anonymous memory other than a stack keeps the object it points to.
+      */
+    void setHeapDepth(unsigned int depth) { heapDepth = depth; }
+
+    /*!
+      * \brief Set the mapped files whose memory in the core is kept whole
+      * \param patterns Globs matched against the path of the file if they have a '/', else its file name
+      */
+    void setMappingPatterns(const std::vector<std::string> &patterns) { mappingPatterns = patterns; }
+
+    /*!
+      * \brief Lay the reduced core out so that its memory segments can be mapped from the file
+      * \param aligned true to give each memory segment a file offset congruent to its address modulo
+      * the page size, as the kernel does, false to store the segments back to back
+      * The page size is taken from the segments of the core.  Only elf output has a layout.
+      */
+    void setPageAligned(bool aligned) { isPageAligned = aligned; }
+
+    /*!
+      * \brief Set the number of threads that find the stacks and copy the segments to the reduced core
+      * \param count The number of threads, 0 for one per processor
+      * The reduced core is the same whatever the number of threads.
+      */
+    void setThreads(unsigned int count) { threadCount = count; }
+
+    /*!
+      * \brief Set the notes of the core that are copied to the reduced core
+      * \param notes A comma separated list of note types, by name (e.g. fpregset, xstate) or number.
+      * A type followed by ":crashing" is only kept for the crashing thread, "all" keeps every note as it is.
+      * \return true on success, false if a type is not known
+      * NT_PRSTATUS is always kept for every thread.  Process wide notes are kept if they are listed.
+      */
+    bool setNoteFilter(const std::string &notes);
+
+    /*!
+      * \brief Determine if a list of note types can be given to setNoteFilter()
+      */
+    static bool isNoteFilterValid(const std::string &notes);
+
+    /*!
+      * \brief The register state of a single thread, as read from its NT_PRSTATUS note
+      */
+    struct ThreadState
+    {
+        int pid;                //!< The id of the thread
+        ADDRESS stackPointer;   //!< The value of the stack pointer register
+        ADDRESS programCounter; //!< The value of the program counter register
+        ADDRESS linkRegister;   //!< The value of the link register, 0 on architectures that do not have one
+        ADDRESS framePointer;   //!< The value of the frame pointer register
+    };
+
+    //! A file backed memory mapping of the process, as read from the NT_FILE note
+    typedef ElfCoreReader::FileMapping FileMapping;
+
 private:
+    /*!
+      * \brief The part of a core segment that is kept as the stack of a thread
+      */
+    struct StackRange
+    {
+        const Phdr *segment;    //!< The core segment that has the stack pointer, NULL if there is none
+        ADDRESS start;          //!< The first address that is kept
+        ADDRESS end;            //!< The address after the last one that is kept
+    };
+
+    /*!
+      * \brief Read the notes of the core and the executable, once \a coreReader is initalized
+      * \param binary The name of the executable that has crashed
+      * \return true on success false otherwise.
+      */
+    bool readCore(const char *binary);
+
     /*!
       * \brief Find the note section in the origional core file and store a reference to it
       * \return true on success, false otherwise
@@ -108,21 +244,148 @@ private:
       */
     bool getNotes();
 
+    /*!
+      * \brief Rewrite the notes segment with only the notes that are in \a keptNotes
+      * The notes of a thread follow its NT_PRSTATUS note.  The new segment replaces the origional
+      * one in \a wantedHeaders.
+      */
+    void filterNotes();
+
+    /*!
+      * \brief Get the dynamic segment and the interpreter of the executable from its program headers
+      * \param binary The name of the executable that has crashed
+      * \return true on success, false if the program headers can not be used
+      * Only the elf header and the program headers are read, so it also works for files without sections.
+      */
+    bool probeExecutable(const char *binary);
+
+    /*!
+      * \brief Get the dynamic section and the interpreter of the executable from its section headers
+      * \param binary The name of the executable that has crashed
+      * \return true on success, false otherwise
+      */
+    bool readExecutableSections(const char *binary);
+
+    /*!
+      * \brief Get the difference between the address the executable was loaded at and its link address
+      * \param headers The program headers of the executable
+      * \param count The number of program headers
+      * \param headersOffset The offset of the program headers in the file
+      * \return The load bias, 0 if it can not be determined
+      */
+    ADDRESS getLoadBias(const Phdr *headers, size_t count, ADDRESS headersOffset);
+
     /*!
       * \brief Find the memory areas in the core file that represent the stacks in the crashed application
+      * The crashing thread keeps its whole live stack, the other threads are limited to \a stackDepth bytes.
+      * Threads whose stack windows fall in the same memory area and overlap are collapsed into one segment.
       */
     void getStacks();
 
+    /*!
+      * \brief Find the stacks of a part of the threads in to \a stackRanges, run by ParallelRange
+      * \param context The reducer
+      * \param begin The first thread, in the order of \a stackRanges
+      * \param end The thread after the last one
+      */
+    static void findStacks(void *context, size_t begin, size_t end);
+
+    /*!
+      * \brief Find the code around the program counter and link register of each thread that is in
+      * anonymous executable memory.
+      * A window of \a codeWindow bytes on either side of the address is kept, or the whole memory area if it is small.
+      */
+    void getCodeWindows();
+
+    /*!
+      * \brief Keep the whole memory of the mapped files that match \a mappingPatterns
+      */
+    void getNamedMappings();
+
+    /*!
+      * \brief Keep the heap objects that can be reached from the kept stacks, up to \a heapDepth pointers away
+      */
+    void getReachableHeap();
+
+    /*!
+      * \brief Determine if a segment of the core is heap, writable anonymous memory that is not a stack
+      */
+    bool isHeapSegment(const Phdr *coreSegment);
+
+    /*!
+      * \brief Add a range of a segment within the byte budget, cut from its end if the budget runs out
+      * \return false if the budget had run out, true otherwise
+      */
+    bool addBudgetedRange(const Phdr *coreSegment, ADDRESS start, ADDRESS end);
+
+    /*!
+      * \brief Walk the frame pointers of the threads and create the backtrace note
+      * The crashing thread is unwound first.  The note is written to the output after the wanted segments.
+      * \sa Unwinder
+      */
+    void getBacktraces();
+
+    /*!
+      * \brief Create the NT_RICHCORE_MODULES note that lists the elf files mapped in to the process
+      * with their build id, load address and mapped size.
+      */
+    void getModuleManifest();
+
+    /*!
+      * \brief Determine if any part of an address range was mapped executable
+      * \param start The first address of the range
+      * \param end The address one past the end of the range
+      * \return true if a PT_LOAD segment with PF_X starts within the range
+      */
+    bool isExecutableMapping(ADDRESS start, ADDRESS end);
+
+    /*!
+      * \brief Read the build id of an elf file from the notes of its loaded image in the core file
+      * \param base The address at which the start of the file is mapped
+      * \return The build id as a hex string, or an empty string if it is not in the core file
+      */
+    std::string getBuildIdFromCore(ADDRESS base);
+
+    /*!
+      * \brief Add a note owned by RICH_CORE_NOTE_NAME to the notes written by the reducer
+      * \param type The type of the note
+      * \param desc The description of the note
+      */
+    void addRichCoreNote(Elf_Word type, const std::vector<char> &desc);
+
+    /*!
+      * \brief Determine if a segment of the core file holds anonymous executable memory
+      * \param coreSegment The segment to check
+      * \return true if the segment is executable, present in the core file and not backed by a file
+      */
+    bool isAnonymousCode(const Phdr *coreSegment);
+
+    /*!
+      * \brief Add a range of a core segment to the regions that are copied to the reduced core file
+      * \param coreSegment The segment of the origional core file that contains the range
+      * \param start The first address of the range
+      * \param end The address one past the end of the range
+      * \return The number of bytes that were not kept before
+      * A range that overlaps or touches a kept region with the same flags and contiguous data is merged with it.
+      */
+    size_t addSegmentRange(const Phdr *coreSegment, ADDRESS start, ADDRESS end);
+
     /*!
       * \brief Check is heap address setted, if not - try to set up it automatically.
       */
     void checkHeapAddress();
 
     /*!
-      * \brief Copy the memory area fro the core file that contains the dynamic section information
+      * \brief Keep the memory area fro the core file that contains the dynamic section information
+      * \param mapsFile Maps (or smaps etc) file for the process
+      * The memory location referenced by DT_DEBUG must be overwritten to point to the r_debug section in
+      * our new reduced core file, this is done by copyDynamicSectionInformation() once the area is copied.
+      */
+    void getDynamicSection(const char *mapsFile=NULL);
+
+    /*!
+      * \brief Overwrite DT_DEBUG in the copied dynamic section and add the link map to the reduced core file
       * \param mapsFile Maps (or smaps etc) file for the process
-      * When copying the dynamic section the memory location referenced by DT_DEBUG must be overwritten
-      * to point to the r_debug section in our new reduced core file.
       */
     void copyDynamicSectionInformation(const char *mapsFile=NULL);
 
@@ -141,6 +404,12 @@ private:
       */
     void copyInitalSegmentsToOutput(bool stacksOnly=false);
 
+    /*!
+      * \brief Get the page size of the process, from the alignment of the memory segments of the core
+      * \return The page size, that of this system if the core does not have it
+      */
+    size_t getPageSize();
+
     /*!
       * \brief Copy the r_debug and link_map information to the reduced core file
       * \param start The address within the origional core file where we can find the the start of
@@ -162,17 +431,35 @@ private:
       */
     const char *getBufferAtAddress(ADDRESS start);
 
+    /*!
+      * \brief Get a pointer to a range of memory in the origional core file
+      * \param start The virtual memory address of the range
+      * \param size The size of the range
+      * \return A pointer to the data if the whole range is in the core file, NULL otherwise
+      */
+    const char *getBufferAtAddress(ADDRESS start, size_t size);
+
 private:
     //! A pointer to the class that will handle the reading of the core dump file
     ElfCoreReader *coreReader;
     //! A pointer to the class that will read the executable file associated with the crashed application
     ElfBinaryReader *binaryReader;
     //! A pointer to the class that will be used to write the reduced core file
-    RawElfWriter *coreWriter;
+    CoreWriter *coreWriter;
+    //! \a coreWriter when the output is an elf file, NULL otherwise
+    RawElfWriter *elfWriter;
     //! A vector that contains a reference to each of the program headers that we want to copy to the reduced core file
     std::vector<const Phdr *> wantedHeaders;
-    //! A vector to store the headers that are created, and must be deleted after use.
-    std::vector<Phdr *> dynamiclyCreatedHeaders;
+    //! The memory that is kept in the reduced core file, one segment is written for each region
+    RegionSet keptRegions;
+    //! The program headers of \a keptRegions, created when the reduced core file is written
+    std::vector<Phdr> regionHeaders;
+    //! The dynamic section made by generateDynamicSectionInformation()
+    std::vector<Elf_Dyn> generatedDynamic;
+    //! The address of the DT_DEBUG pointer that is overwritten in the reduced core, 0 for none
+    ADDRESS debugPointerAddress;
+    //! The address of the r_debug struct that the link map is taken from, 0 for none
+    ADDRESS linkMapAddress;
     //! The address of the dynamic section as read from the executable file
     ADDRESS dynamicAddressFromExecutable;
     //! The size of the dynamic section as read from the executable file
@@ -185,8 +472,46 @@ private:
     const char *output;
     //! A virtual memory address into which we can store the link map data.
     ADDRESS heapAddress;
-    //! A vector of stack pointers that is used by the process
-    std::vector<ADDRESS> stackPointerAddresses;
+    //! The state of each thread in the order in which they appear in the notes segment
+    std::vector<ThreadState> threads;
+    //! The number of bytes of stack to keep for threads other than the crashing thread, 0 for all
+    size_t stackDepth;
+    //! The number of bytes of anonymous code to keep on each side of a program counter, 0 for none
+    size_t codeWindow;
+    //! The format of the reduced core
+    OutputFormat outputFormat;
+    //! The maximum number of frames in a backtrace, 0 for no backtraces
+    size_t unwindFrames;
+    //! The number of microseconds the unwinding of all threads may take
+    long unwindTimeLimit;
+    //! The file to write the backtraces to as text, or NULL
+    const char *backtraceFile;
+    //! The most bytes kept besides the stack of the crashing thread, 0 for no limit
+    size_t byteBudget;
+    //! The bytes of \a byteBudget that are used
+    size_t bytesKept;
+    //! The levels of pointers followed in to the heap
+    unsigned int heapDepth;
+    //! The globs of the mapped files that are kept whole
+    std::vector<std::string> mappingPatterns;
+    //! true if the memory segments are aligned to pages in the reduced core
+    bool isPageAligned;
+    //! The number of threads that find the stacks and copy the segments, 0 for one per processor
+    unsigned int threadCount;
+    //! The stack of each thread, the crashing thread first
+    std::vector<StackRange> stackRanges;
+    //! The note types that are kept, true for those kept only for the crashing thread
+    std::map<Elf_Word, bool> keptNotes;
+    //! true if the notes of the core are copied as they are
+    bool isEveryNoteKept;
+    //! The notes of the core that pass \a keptNotes
+    std::vector<char> filteredNotes;
+    //! The header of \a filteredNotes
+    Phdr filteredNotesHeader;
+    //! The notes that the reducer adds to the output, such as NT_RICHCORE_BACKTRACE
+    std::vector<char> richCoreNotes;
+    //! The file backed mappings of the process
+    std::vector<FileMapping> fileMappings;
     //! The id of the process
     int processId;
     //! The name and path of the application that crashed
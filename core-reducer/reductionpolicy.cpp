@@ -0,0 +1,303 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "reductionpolicy.h"
+#include "reducer.h"
+#include "defines.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fnmatch.h>
+
+//The characters that make a pattern a glob
+#define GLOB_CHARACTERS "*?["
+
+/*!
+  * \brief Remove the white space from both ends of a string
+  */
+static std::string trim(const std::string &text)
+{
+    size_t start = text.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos)
+        return "";
+    return text.substr(start, text.find_last_not_of(" \t\r\n") - start + 1);
+}
+
+ReductionPolicy::Settings::Settings()
+    : fields(0),
+    isReduced(true),
+    stackDepth(0),
+    byteBudget(0),
+    heapDepth(0),
+    codeWindow(0),
+    isLinkMapIncluded(true),
+    compression(0),
+    notes("all"),
+    isPageAligned(false)
+{
+}
+
+void ReductionPolicy::Settings::apply(const Settings &other)
+{
+    if (other.has(Reduce))
+        isReduced = other.isReduced;
+    if (other.has(StackDepth))
+        stackDepth = other.stackDepth;
+    if (other.has(ByteBudget))
+        byteBudget = other.byteBudget;
+    if (other.has(HeapDepth))
+        heapDepth = other.heapDepth;
+    if (other.has(CodeWindow))
+        codeWindow = other.codeWindow;
+    if (other.has(Mappings))
+        mappings = other.mappings;
+    if (other.has(LinkMap))
+        isLinkMapIncluded = other.isLinkMapIncluded;
+    if (other.has(Compression))
+        compression = other.compression;
+    if (other.has(Notes))
+        notes = other.notes;
+    if (other.has(Layout))
+        isPageAligned = other.isPageAligned;
+    fields |= other.fields;
+}
+
+bool ReductionPolicy::Settings::set(const std::string &key, const std::string &value)
+{
+    size_t size = 0;
+    Field field;
+    if (key == "reduce")
+    {
+        field = Reduce;
+        if (!parseBool(value, isReduced))
+            return false;
+    }
+    else if (key == "stack-depth")
+    {
+        field = StackDepth;
+        if (!parseSize(value, stackDepth))
+            return false;
+    }
+    else if (key == "byte-budget")
+    {
+        field = ByteBudget;
+        if (!parseSize(value, byteBudget))
+            return false;
+    }
+    else if (key == "code-window")
+    {
+        field = CodeWindow;
+        if (!parseSize(value, codeWindow))
+            return false;
+    }
+    else if (key == "heap-depth")
+    {
+        if (!parseSize(value, size))
+            return false;
+        field = HeapDepth;
+        heapDepth = size;
+    }
+    else if (key == "mappings")
+    {
+        //a comma separated list of globs, empty for none
+        field = Mappings;
+        mappings.clear();
+        for (size_t start = 0; start <= value.size();)
+        {
+            size_t end = value.find(',', start);
+            if (end == std::string::npos)
+                end = value.size();
+            std::string pattern = trim(value.substr(start, end - start));
+            if (!pattern.empty())
+                mappings.push_back(pattern);
+            start = end + 1;
+        }
+    }
+    else if (key == "link-map")
+    {
+        field = LinkMap;
+        if (!parseBool(value, isLinkMapIncluded))
+            return false;
+    }
+    else if (key == "compression")
+    {
+        char *end = NULL;
+        long level = strtol(value.c_str(), &end, 10);
+        if ((end == value.c_str()) || *end || (level < 1) || (level > 9))
+            return false;
+        field = Compression;
+        compression = level;
+    }
+    else if (key == "notes")
+    {
+        //the note types, as the core-reducer option
+        if (!Reducer::isNoteFilterValid(value))
+            return false;
+        field = Notes;
+        notes = value;
+    }
+    else if (key == "layout")
+    {
+        if ((value != "packed") && (value != "aligned"))
+            return false;
+        field = Layout;
+        isPageAligned = (value == "aligned");
+    }
+    else
+    {
+        return false;
+    }
+
+    fields |= field;
+    return true;
+}
+
+ReductionPolicy::ReductionPolicy()
+{
+}
+
+bool ReductionPolicy::load(const char *fileName)
+{
+    FILE *file = fopen(fileName, "r");
+    if (!file)
+        return false;
+
+    char buffer[1024];
+    unsigned int lineNumber = 0;
+    bool isSkipped = true;
+    while (fgets(buffer, sizeof(buffer), file))
+    {
+        lineNumber++;
+        std::string line = trim(buffer);
+        if (line.empty() || (line[0] == '#'))
+            continue;
+
+        if (line[0] == '[')
+        {
+            //a rule starts, with its pattern in brackets
+            isSkipped = (line.size() < 3) || (line[line.size() - 1] != ']');
+            if (isSkipped)
+            {
+                LOG(LOG_WARNING, "%s:%u: not a valid rule", fileName, lineNumber);
+                continue;
+            }
+            Rule rule;
+            rule.pattern = trim(line.substr(1, line.size() - 2));
+            rule.isPath = (rule.pattern.find('/') != std::string::npos);
+            rules.push_back(rule);
+            compileRule();
+            continue;
+        }
+
+        size_t equals = line.find('=');
+        if (isSkipped || (equals == std::string::npos)
+            || !rules.back().settings.set(trim(line.substr(0, equals)), trim(line.substr(equals + 1))))
+            LOG(LOG_WARNING, "%s:%u: not a valid setting", fileName, lineNumber);
+    }
+    fclose(file);
+    return true;
+}
+
+void ReductionPolicy::compileRule()
+{
+    size_t index = rules.size() - 1;
+    const Rule &rule = rules.back();
+    if (rule.pattern.find_first_of(GLOB_CHARACTERS) != std::string::npos)
+        globs.push_back(index);
+    else if (rule.isPath)
+        exactPaths[rule.pattern].push_back(index);
+    else
+        exactNames[rule.pattern].push_back(index);
+}
+
+ReductionPolicy::Settings ReductionPolicy::match(const std::string &path, const std::string &name) const
+{
+    std::string processName = name.empty() ? path.substr(path.rfind('/') + 1) : name;
+    std::vector<size_t> matching;
+
+    std::map<std::string, std::vector<size_t> >::const_iterator exact = exactPaths.find(path);
+    if (exact != exactPaths.end())
+        matching.insert(matching.end(), exact->second.begin(), exact->second.end());
+    exact = exactNames.find(processName);
+    if (exact != exactNames.end())
+        matching.insert(matching.end(), exact->second.begin(), exact->second.end());
+
+    for (unsigned int i = 0; i < globs.size(); i++)
+    {
+        const Rule &rule = rules.at(globs.at(i));
+        if (fnmatch(rule.pattern.c_str(), (rule.isPath ? path : processName).c_str(), 0) == 0)
+            matching.push_back(globs.at(i));
+    }
+
+    //The rules are applied in the order of the file, whichever way they were found
+    std::sort(matching.begin(), matching.end());
+    Settings settings;
+    for (unsigned int i = 0; i < matching.size(); i++)
+        settings.apply(rules.at(matching.at(i)).settings);
+    return settings;
+}
+
+bool ReductionPolicy::isMappingWanted(const std::vector<std::string> &patterns, const std::string &path)
+{
+    std::string fileName = path.substr(path.rfind('/') + 1);
+    for (unsigned int i = 0; i < patterns.size(); i++)
+    {
+        bool isPath = (patterns.at(i).find('/') != std::string::npos);
+        if (fnmatch(patterns.at(i).c_str(), (isPath ? path : fileName).c_str(), 0) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool ReductionPolicy::parseSize(const std::string &value, size_t &size)
+{
+    char *end = NULL;
+    unsigned long long number = strtoull(value.c_str(), &end, 0);
+    if ((end == value.c_str()) || (value[0] == '-'))
+        return false;
+
+    int shift = 0;
+    if ((*end == 'k') || (*end == 'K'))
+        shift = 10;
+    else if (*end == 'M')
+        shift = 20;
+    else if (*end == 'G')
+        shift = 30;
+    if (shift)
+        end++;
+    if (*end)
+        return false;
+
+    size = number << shift;
+    return true;
+}
+
+bool ReductionPolicy::parseBool(const std::string &value, bool &result)
+{
+    if ((value != "true") && (value != "false"))
+        return false;
+    result = (value == "true");
+    return true;
+}
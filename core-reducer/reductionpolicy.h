@@ -0,0 +1,186 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file reductionpolicy.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class ReductionPolicy
+  * \brief The per executable settings of the core reducer, read from a policy file.
+  * The file has a rule for each pattern in brackets, followed by its settings as key = value lines:
+  *
+  * \code
+  * # the settings of every application
+  * [*]
+  * stack-depth = 16k
+  * [/usr/bin/Xorg]
+  * stack-depth = 64k
+  * byte-budget = 4M
+  * heap-depth = 2
+  * mappings = *.so*
+  * compression = 7
+  * notes = prpsinfo,auxv,file,fpregset:crashing,xstate:crashing
+  * \endcode
+  *
+  * A pattern with a '/' is matched against the path of the executable, any other pattern against the name
+  * of the process, both as shell globs.  Every rule that matches is applied in the order of the file, so
+  * the later rules override the earlier ones.  The rules are compiled when the file is loaded: the
+  * patterns without wildcards are looked up from maps and only the others are matched one by one.
+  */
+
+#ifndef REDUCTIONPOLICY_H
+#define REDUCTIONPOLICY_H
+
+#include <stddef.h>
+#include <map>
+#include <string>
+#include <vector>
+
+//! The policy file that the collector reads
+#define DEFAULT_POLICY_FILE "/etc/rich-core/reduction-policy"
+
+class ReductionPolicy
+{
+public:
+    /*!
+      * \brief The settings of a rule, only those that are listed in \a fields are set
+      */
+    struct Settings
+    {
+        //! The settings a rule can have
+        enum Field
+        {
+            Reduce = 1 << 0,        //!< reduce
+            StackDepth = 1 << 1,    //!< stack-depth
+            ByteBudget = 1 << 2,    //!< byte-budget
+            HeapDepth = 1 << 3,     //!< heap-depth
+            CodeWindow = 1 << 4,    //!< code-window
+            Mappings = 1 << 5,      //!< mappings
+            LinkMap = 1 << 6,       //!< link-map
+            Compression = 1 << 7,   //!< compression
+            Notes = 1 << 8,         //!< notes
+            Layout = 1 << 9         //!< layout
+        };
+
+        unsigned int fields;                //!< The settings that are set, as Field bits
+        bool isReduced;                     //!< Reduce the core, false includes the whole core
+        size_t stackDepth;                  //!< Bytes of stack kept for the threads that did not crash, 0 for all
+        size_t byteBudget;                  //!< The most bytes of memory kept besides the stack of the crashing thread
+        unsigned int heapDepth;             //!< The levels of pointers followed from the stacks in to the heap
+        size_t codeWindow;                  //!< Bytes of code kept around the program counters in anonymous memory
+        std::vector<std::string> mappings;  //!< Globs of the mapped files whose memory is kept whole
+        bool isLinkMapIncluded;             //!< Include the link map in an elf core
+        int compression;                    //!< The compression level of the rich core, 1 to 9
+        std::string notes;                  //!< The note types kept, as given to Reducer::setNoteFilter()
+        bool isPageAligned;                 //!< Align the memory segments of an elf core to pages
+
+        /*!
+          * \brief Constructor, no setting is set
+          */
+        Settings();
+
+        /*!
+          * \brief Determine if a setting is set
+          */
+        bool has(Field field) const { return (fields & field) != 0; }
+
+        /*!
+          * \brief Take the settings that are set in another settings
+          */
+        void apply(const Settings &other);
+
+        /*!
+          * \brief Set a setting from its key and value, as written in the policy file
+          * \return true on success, false if the key is not known or the value is not valid
+          */
+        bool set(const std::string &key, const std::string &value);
+    };
+
+    /*!
+      * \brief Constructor, an empty policy
+      */
+    ReductionPolicy();
+
+    /*!
+      * \brief Read and compile the rules of a policy file
+      * \param fileName The policy file
+      * \return true on success, false if the file can not be read.  Lines that are not valid are skipped.
+      */
+    bool load(const char *fileName);
+
+    /*!
+      * \brief Get the settings for an executable
+      * \param path The path of the executable
+      * \param name The name of the process, the file name of \a path if empty
+      * \return The settings of every matching rule, applied in order
+      */
+    Settings match(const std::string &path, const std::string &name) const;
+
+    /*!
+      * \brief Determine if a mapped file matches the mappings setting
+      * \param patterns The globs, matched against the path if they have a '/', else against the file name
+      * \param path The path of the mapped file
+      */
+    static bool isMappingWanted(const std::vector<std::string> &patterns, const std::string &path);
+
+    /*!
+      * \brief Get the number of rules
+      */
+    size_t size() const { return rules.size(); }
+
+private:
+    //! A rule of the policy file
+    struct Rule
+    {
+        std::string pattern;    //!< The glob of the rule
+        bool isPath;            //!< true if the pattern is matched against the path
+        Settings settings;      //!< The settings of the rule
+    };
+
+    /*!
+      * \brief Add the last rule to the matcher
+      */
+    void compileRule();
+
+    /*!
+      * \brief Parse a size with an optional k, M or G suffix
+      * \return true on success, false if the value is not a size
+      */
+    static bool parseSize(const std::string &value, size_t &size);
+
+    /*!
+      * \brief Parse true or false
+      */
+    static bool parseBool(const std::string &value, bool &result);
+
+private:
+    //! The rules in the order of the file
+    std::vector<Rule> rules;
+    //! The rules with no wildcards by the path they match
+    std::map<std::string, std::vector<size_t> > exactPaths;
+    //! The rules with no wildcards by the name they match
+    std::map<std::string, std::vector<size_t> > exactNames;
+    //! The rules that are matched with fnmatch
+    std::vector<size_t> globs;
+};
+
+#endif // REDUCTIONPOLICY_H
@@ -0,0 +1,96 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "regionset.h"
+
+#include <stdint.h>
+
+RegionSet::RegionSet()
+    : totalBytes(0)
+{
+}
+
+size_t RegionSet::add(ADDRESS start, ADDRESS end, Elf_Word flags, const char *data)
+{
+    if (start >= end)
+        return 0;
+
+    size_t bytesBefore = totalBytes;
+    Region region;
+    region.start = start;
+    region.end = end;
+    region.flags = flags;
+    region.data = data;
+
+    //The region before the new one may reach in to it, the ones after it start at most at its end
+    std::map<ADDRESS, Region>::iterator i = regions.upper_bound(start);
+    if (i != regions.begin())
+        --i;
+    while ((i != regions.end()) && (i->second.start <= region.end))
+    {
+        const Region &existing = i->second;
+        if (existing.end < region.start)
+        {
+            ++i;
+            continue;
+        }
+
+        if (!isMergeable(existing, region))
+        {
+            //Regions that only touch stay apart
+            if ((existing.end == region.start) || (existing.start == region.end))
+            {
+                ++i;
+                continue;
+            }
+            //The region that is kept already wins, the new one is added around it
+            Region overlapped = existing;
+            if (region.start < overlapped.start)
+                add(region.start, overlapped.start, region.flags, region.data);
+            if (overlapped.end < region.end)
+                add(overlapped.end, region.end, region.flags, region.data + (overlapped.end - region.start));
+            return totalBytes - bytesBefore;
+        }
+
+        if (existing.start < region.start)
+        {
+            region.data = existing.data;
+            region.start = existing.start;
+        }
+        if (existing.end > region.end)
+            region.end = existing.end;
+        totalBytes -= existing.end - existing.start;
+        regions.erase(i++);
+    }
+
+    regions[region.start] = region;
+    totalBytes += region.end - region.start;
+    return totalBytes - bytesBefore;
+}
+
+bool RegionSet::isMergeable(const Region &first, const Region &second)
+{
+    //The data is contiguous if the two regions are at the same distance in memory and in the data
+    return (first.flags == second.flags)
+           && ((intptr_t)second.data - (intptr_t)first.data == (intptr_t)second.start - (intptr_t)first.start);
+}
@@ -0,0 +1,107 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file regionset.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class RegionSet
+  * \brief The memory regions that are kept in the reduced core, sorted by address.
+  * A region that overlaps or touches a region already in the set is merged with it when both have the
+  * same flags and their data is contiguous, as it is for two parts of the same core segment.  So the
+  * stacks, code windows, mappings and heap objects that are found one by one become as few segments as
+  * possible.  Where a region overlaps one it can not be merged with, the region that was added first is kept.
+  */
+
+#ifndef REGIONSET_H
+#define REGIONSET_H
+
+#include "defines.h"
+#include <stddef.h>
+#include <map>
+
+class RegionSet
+{
+public:
+    /*!
+      * \brief A range of memory and the data it has
+      */
+    struct Region
+    {
+        ADDRESS start;      //!< The first address of the region
+        ADDRESS end;        //!< The address one past the end of the region
+        Elf_Word flags;     //!< The PF_ flags of the memory
+        const char *data;   //!< The contents of the memory from \a start
+    };
+
+    //! Iterates the regions in the order of their addresses
+    typedef std::map<ADDRESS, Region>::const_iterator const_iterator;
+
+    /*!
+      * \brief Constructor, an empty set
+      */
+    RegionSet();
+
+    /*!
+      * \brief Add a region, merging it with the regions it overlaps or touches
+      * \param start The first address of the region
+      * \param end The address one past the end of the region
+      * \param flags The PF_ flags of the memory
+      * \param data The contents of the memory from \a start, valid as long as the set is used
+      * \return The number of bytes that were not in the set before
+      */
+    size_t add(ADDRESS start, ADDRESS end, Elf_Word flags, const char *data);
+
+    /*!
+      * \brief Get the number of regions
+      */
+    size_t size() const { return regions.size(); }
+
+    /*!
+      * \brief Get the number of bytes in all the regions
+      */
+    size_t bytes() const { return totalBytes; }
+
+    /*!
+      * \brief Get the first region
+      */
+    const_iterator begin() const { return regions.begin(); }
+
+    /*!
+      * \brief Get the end of the regions
+      */
+    const_iterator end() const { return regions.end(); }
+
+private:
+    /*!
+      * \brief Determine if two regions can be merged, they have the same flags and contiguous data
+      */
+    static bool isMergeable(const Region &first, const Region &second);
+
+private:
+    //! The regions by their start address, they do not overlap
+    std::map<ADDRESS, Region> regions;
+    //! The number of bytes in \a regions
+    size_t totalBytes;
+};
+
+#endif // REGIONSET_H
@@ -0,0 +1,303 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "symbolindex.h"
+#include "elfbinaryreader.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+//! The identifier at the start of an index file
+#define INDEX_MAGIC "RCSYMIDX"
+//! The version of the index file layout
+#define INDEX_VERSION 2
+
+/*!
+  * \brief The header of an index file, it is followed by the segments, the entries and then by the names
+  */
+typedef struct
+{
+    char magic[8];         //!< INDEX_MAGIC
+    uint32_t version;      //!< INDEX_VERSION
+    uint32_t count;        //!< The number of entries
+    uint64_t stringsSize;  //!< The size of the names
+    uint32_t segmentCount; //!< The number of segments
+    uint32_t reserved;     //!< Keeps the segments 8 byte aligned, 0
+} IndexHeader;
+
+SymbolIndex::SymbolIndex()
+    : segments(NULL),
+    segmentCount(0),
+    entries(NULL),
+    count(0),
+    strings(NULL),
+    stringsSize(0),
+    mapping(NULL),
+    mappingSize(0)
+{
+}
+
+SymbolIndex::~SymbolIndex()
+{
+    clear();
+}
+
+void SymbolIndex::clear()
+{
+    if (mapping)
+    {
+        munmap(mapping, mappingSize);
+        mapping = NULL;
+        mappingSize = 0;
+    }
+    ownSegments.clear();
+    ownEntries.clear();
+    ownStrings.clear();
+    segments = NULL;
+    segmentCount = 0;
+    entries = NULL;
+    strings = NULL;
+    count = 0;
+    stringsSize = 0;
+}
+
+bool SymbolIndex::compare(const Entry &first, const Entry &second)
+{
+    if (first.start != second.start)
+        return first.start < second.start;
+    return first.size > second.size;
+}
+
+bool SymbolIndex::isSameStart(const Entry &first, const Entry &second)
+{
+    return first.start == second.start;
+}
+
+bool SymbolIndex::create(ElfBinaryReader *reader)
+{
+    if (!reader || !reader->elfHeader())
+        LOG_RETURN(LOG_ERR, false, "The elf file is not initalized");
+
+    clear();
+    //The dynamic symbols are a subset of the full table, but they are all a stripped file has
+    bool found = addSymbols(reader, SHT_SYMTAB, ownStrings);
+    found = addSymbols(reader, SHT_DYNSYM, ownStrings) || found;
+    if (!found)
+        LOG_RETURN(LOG_INFO, false, "There are no symbol tables in the file");
+
+    //The backtraces give file offsets, the layout is kept to turn them in to addresses
+    const Phdr *headers = reader->programHeader();
+    for (int i = 0; headers && (i < reader->elfHeader()->e_phnum); i++)
+    {
+        if (headers[i].p_type != PT_LOAD)
+            continue;
+
+        Segment segment;
+        segment.fileOffset = headers[i].p_offset;
+        segment.address = headers[i].p_vaddr;
+        segment.size = headers[i].p_filesz;
+        ownSegments.push_back(segment);
+    }
+
+    //Sort by address, an alias of a function is dropped in favour of the larger or the first symbol
+    std::stable_sort(ownEntries.begin(), ownEntries.end(), compare);
+    std::vector<Entry>::iterator last = std::unique(ownEntries.begin(), ownEntries.end(), isSameStart);
+    ownEntries.erase(last, ownEntries.end());
+
+    segments = ownSegments.empty() ? NULL : &ownSegments[0];
+    segmentCount = ownSegments.size();
+    entries = ownEntries.empty() ? NULL : &ownEntries[0];
+    count = ownEntries.size();
+    strings = ownStrings.empty() ? NULL : &ownStrings[0];
+    stringsSize = ownStrings.size();
+    return true;
+}
+
+bool SymbolIndex::addSymbols(ElfBinaryReader *reader, Elf_Word type, std::vector<char> &names)
+{
+    const CurrentSectionData *sectionData = reader->getSectionByType(type);
+    if (!sectionData)
+        return false;
+
+    //The reader only tracks one section at a time, so take what is needed before finding the string table
+    Elf_Scn *symbolSection = sectionData->section;
+    size_t stringIndex = sectionData->sectionHeader->sh_link;
+
+    Elf_Data *symbolData = elf_getdata(symbolSection, NULL);
+    if (!symbolData || !symbolData->d_buf)
+        return false;
+
+    if (!(sectionData = reader->getSectionByIndex(stringIndex)))
+        return false;
+    Elf_Data *stringData = elf_getdata(sectionData->section, NULL);
+    if (!stringData || !stringData->d_buf)
+        return false;
+
+    const char *symbolNames = (const char *)stringData->d_buf;
+    const Sym *symbol = (const Sym *)symbolData->d_buf;
+    const Sym *end = symbol + (symbolData->d_size / sizeof(Sym));
+    bool isArm = (reader->elfHeader()->e_machine == EM_ARM);
+
+    for (; symbol < end; symbol++)
+    {
+        //ELF32_ST_TYPE and ELF64_ST_TYPE are the same
+        int symbolType = ELF32_ST_TYPE(symbol->st_info);
+        if (((symbolType != STT_FUNC) && (symbolType != STT_GNU_IFUNC)) || (symbol->st_shndx == SHN_UNDEF)
+            || !symbol->st_value || (symbol->st_name >= stringData->d_size))
+            continue;
+
+        Entry entry;
+        entry.start = symbol->st_value;
+        //The lowest bit of an arm function address selects the thumb instruction set
+        if (isArm)
+            entry.start &= ~(uint64_t)1;
+        entry.size = symbol->st_size;
+        entry.name = names.size();
+        const char *name = symbolNames + symbol->st_name;
+        names.insert(names.end(), name, name + strnlen(name, stringData->d_size - symbol->st_name));
+        names.push_back('\0');
+        ownEntries.push_back(entry);
+    }
+
+    return true;
+}
+
+const char *SymbolIndex::findSymbol(ADDRESS address, ADDRESS *offset) const
+{
+    if (!count || (address < entries[0].start))
+        return NULL;
+
+    //Find the last entry that starts at or below the address, the loop has no data dependent branches
+    const Entry *base = entries;
+    size_t length = count;
+    while (length > 1)
+    {
+        size_t half = length / 2;
+        base = (base[half].start <= address) ? base + half : base;
+        length -= half;
+    }
+
+    //A function of unknown size is assumed to reach the next function
+    if ((base->size && (address >= base->start + base->size)) || (base->name >= stringsSize))
+        return NULL;
+
+    if (offset)
+        *offset = address - base->start;
+    return strings + base->name;
+}
+
+bool SymbolIndex::toAddress(ADDRESS fileOffset, ADDRESS *address) const
+{
+    for (size_t i = 0; i < segmentCount; i++)
+    {
+        if ((fileOffset >= segments[i].fileOffset) && (fileOffset - segments[i].fileOffset < segments[i].size))
+        {
+            if (address)
+                *address = segments[i].address + (fileOffset - segments[i].fileOffset);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SymbolIndex::save(const char *fileName) const
+{
+    if (!fileName)
+        LOG_RETURN(LOG_ERR, false, "Uninitalized pointer for fileName");
+
+    IndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.count = count;
+    header.stringsSize = stringsSize;
+    header.segmentCount = segmentCount;
+
+    //write to a temporary file and rename it, another process may be loading the same index
+    char temporary[PATH_MAX];
+    snprintf(temporary, sizeof(temporary), "%s.%d", fileName, getpid());
+    int fd = open(temporary, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        LOG_RETURN(LOG_ERR, false, "Opening file '%s' failed.", temporary);
+
+    bool success = (write(fd, &header, sizeof(header)) == (ssize_t)sizeof(header))
+                   && (write(fd, segments, segmentCount * sizeof(Segment)) == (ssize_t)(segmentCount * sizeof(Segment)))
+                   && (write(fd, entries, count * sizeof(Entry)) == (ssize_t)(count * sizeof(Entry)))
+                   && (write(fd, strings, stringsSize) == (ssize_t)stringsSize);
+    ::close(fd);
+
+    if (!success || (rename(temporary, fileName) != 0))
+    {
+        unlink(temporary);
+        LOG_RETURN(LOG_ERR, false, "Error writing the index '%s'", fileName);
+    }
+    return true;
+}
+
+bool SymbolIndex::load(const char *fileName)
+{
+    if (!fileName)
+        LOG_RETURN(LOG_ERR, false, "Uninitalized pointer for fileName");
+
+    int fd = open(fileName, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat buf;
+    if ((fstat(fd, &buf) != 0) || ((size_t)buf.st_size < sizeof(IndexHeader)))
+    {
+        ::close(fd);
+        LOG_RETURN(LOG_ERR, false, "'%s' is not a symbol index", fileName);
+    }
+
+    void *map = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        LOG_RETURN(LOG_ERR, false, "Can not map the symbol index '%s'", fileName);
+
+    const IndexHeader *header = (const IndexHeader *)map;
+    if ((memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) != 0) || (header->version != INDEX_VERSION)
+        || (sizeof(IndexHeader) + (header->segmentCount * sizeof(Segment)) + (header->count * sizeof(Entry))
+            + header->stringsSize != (size_t)buf.st_size))
+    {
+        munmap(map, buf.st_size);
+        LOG_RETURN(LOG_ERR, false, "'%s' is not a valid symbol index", fileName);
+    }
+
+    clear();
+    mapping = map;
+    mappingSize = buf.st_size;
+    segmentCount = header->segmentCount;
+    segments = (const Segment *)(header + 1);
+    count = header->count;
+    entries = (const Entry *)(segments + segmentCount);
+    stringsSize = header->stringsSize;
+    strings = (const char *)(entries + count);
+    return true;
+}
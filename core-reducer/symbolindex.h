@@ -0,0 +1,165 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file symbolindex.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class SymbolIndex
+  * \brief A sorted address to function name index of an elf file.
+  * The index is built from the .symtab and .dynsym sections and holds the PT_LOAD layout of the file, one
+  * (start, size, name offset) entry per function, sorted by address, and the names.  It can be saved to a file and mapped back in
+  * to memory without any parsing, so that the index of a build is only created once.
+  */
+
+#ifndef SYMBOLINDEX_H
+#define SYMBOLINDEX_H
+
+#include "defines.h"
+#include <stddef.h>
+#include <vector>
+
+//forward declerations
+class ElfBinaryReader;
+
+class SymbolIndex
+{
+public:
+    /*!
+      * \brief Constructor, the index is empty until create() or load() is called
+      */
+    SymbolIndex();
+
+    /*!
+      * \brief Destructor
+      */
+    ~SymbolIndex();
+
+    /*!
+      * \brief Build the index from the symbol tables of an elf file
+      * \param reader An initalized reader of the elf file
+      * \return true on success, false if the file has no symbol table
+      */
+    bool create(ElfBinaryReader *reader);
+
+    /*!
+      * \brief Map an index that was written by save() in to memory
+      * \param fileName The path of the index file
+      * \return true on success, false if the file is missing or not a valid index
+      */
+    bool load(const char *fileName);
+
+    /*!
+      * \brief Write the index to a file, the file is replaced atomically so that readers never see a partial index
+      * \param fileName The path of the index file
+      * \return true on success, false otherwise
+      */
+    bool save(const char *fileName) const;
+
+    /*!
+      * \brief Find the function that contains an address
+      * \param address The address to look up, relative to the link address of the file
+      * \param offset If not NULL set to the offset of \a address from the start of the function
+      * \return The name of the function, or NULL if the address is not in a known function
+      */
+    const char *findSymbol(ADDRESS address, ADDRESS *offset = NULL) const;
+
+    /*!
+      * \brief Convert an offset in the file to the address it is loaded at, relative to the link address
+      * \param fileOffset The offset in the file
+      * \param address Set to the address of \a fileOffset
+      * \return true if the offset is in a PT_LOAD segment of the file, false otherwise
+      */
+    bool toAddress(ADDRESS fileOffset, ADDRESS *address) const;
+
+    /*!
+      * \brief The number of functions in the index
+      */
+    size_t size() const { return count; }
+
+private:
+    /*!
+      * \brief An entry of the index, the layout is also the layout of the index file
+      */
+    struct Entry
+    {
+        uint64_t start; //!< The first address of the function
+        uint32_t size;  //!< The size of the function, 0 if unknown
+        uint32_t name;  //!< The offset of the name of the function in the string table
+    };
+
+    /*!
+      * \brief A PT_LOAD segment of the file, the layout is also the layout of the index file
+      */
+    struct Segment
+    {
+        uint64_t fileOffset; //!< The offset in the file of the segment
+        uint64_t address;    //!< The link address of the segment
+        uint64_t size;       //!< The size of the segment in the file
+    };
+
+    /*!
+      * \brief Add the functions of a symbol table section
+      * \param reader The reader of the elf file
+      * \param type SHT_SYMTAB or SHT_DYNSYM
+      * \param names The names of the functions that have been added
+      * \return true if the section exists
+      */
+    bool addSymbols(ElfBinaryReader *reader, Elf_Word type, std::vector<char> &names);
+
+    /*!
+      * \brief Release the memory of the index
+      */
+    void clear();
+
+    //! Comparison used to sort the entries by address, the larger entry first
+    static bool compare(const Entry &first, const Entry &second);
+
+    //! Comparison used to remove the aliases that start at the same address
+    static bool isSameStart(const Entry &first, const Entry &second);
+
+private:
+    //! The PT_LOAD segments, either in \a ownSegments or in the mapped file
+    const Segment *segments;
+    //! The number of segments
+    size_t segmentCount;
+    //! The sorted entries, either in \a ownEntries or in the mapped file
+    const Entry *entries;
+    //! The number of entries
+    size_t count;
+    //! The names of the functions
+    const char *strings;
+    //! The size of \a strings
+    size_t stringsSize;
+    //! The segments of an index created by create()
+    std::vector<Segment> ownSegments;
+    //! The entries of an index created by create()
+    std::vector<Entry> ownEntries;
+    //! The names of an index created by create()
+    std::vector<char> ownStrings;
+    //! The mapping of an index loaded by load()
+    void *mapping;
+    //! The size of \a mapping
+    size_t mappingSize;
+};
+
+#endif // SYMBOLINDEX_H
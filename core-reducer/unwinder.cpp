@@ -0,0 +1,220 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "unwinder.h"
+#include "elfcorereader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ARM_REGS
+/*!
+  * \brief The position of the saved frame pointer relative to the frame pointer
+  * The gcc arm frame is set up with "push {fp, lr}; add fp, sp, #4" so fp points to the saved lr
+  */
+#define SAVED_FP_OFFSET (-(int)sizeof(ADDRESS))
+/*!
+  * \brief The position of the return address relative to the frame pointer
+  */
+#define RETURN_ADDRESS_OFFSET 0
+#else
+/*!
+  * \brief The position of the saved frame pointer relative to the frame pointer
+  * The x86 frame is set up with "push %ebp; mov %esp, %ebp" so the return address is above it
+  */
+#define SAVED_FP_OFFSET 0
+/*!
+  * \brief The position of the return address relative to the frame pointer
+  */
+#define RETURN_ADDRESS_OFFSET ((int)sizeof(ADDRESS))
+#endif
+
+#define align_power(address, alignSize) \
+(((address) + ((ADDRESS) 1 << (alignSize)) - 1) & ((ADDRESS) -1 << (alignSize)))
+
+
+Unwinder::Unwinder(ElfCoreReader *coreReader, size_t maxFrames, long timeLimit)
+    : coreReader(coreReader),
+    maxFrames(maxFrames)
+{
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += timeLimit / 1000000;
+    deadline.tv_nsec += (timeLimit % 1000000) * 1000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+}
+
+void Unwinder::addModule(const char *name, ADDRESS start, ADDRESS end, ADDRESS fileOffset)
+{
+    Mapping mapping;
+    mapping.start = start;
+    mapping.end = end;
+    mapping.fileOffset = fileOffset;
+    mapping.module = modules.size();
+    //A file has a mapping for each of its segments, they all refer to the same module
+    for (unsigned int i = modules.size(); i > 0; i--)
+    {
+        if (modules.at(i - 1) == name)
+        {
+            mapping.module = i - 1;
+            break;
+        }
+    }
+    if (mapping.module == modules.size())
+        modules.push_back(name);
+
+    mappings.push_back(mapping);
+}
+
+void Unwinder::unwind(int pid, bool crashed, ADDRESS programCounter, ADDRESS stackPointer, ADDRESS framePointer)
+{
+    Backtrace backtrace;
+    backtrace.pid = pid;
+    backtrace.flags = crashed ? BACKTRACE_CRASHED : 0;
+    if (maxFrames)
+        backtrace.frames.push_back(resolve(programCounter));
+
+    //Only the stack that the thread is running on is followed
+    const Phdr *stack = coreReader->getSegmentByAddress(stackPointer);
+    ADDRESS lowest = stackPointer;
+
+    while (stack && (backtrace.frames.size() < maxFrames))
+    {
+        if (isTimeUp())
+        {
+            backtrace.flags |= BACKTRACE_TRUNCATED;
+            break;
+        }
+
+        //The frames are above the stack pointer and each is above the one it was called from
+        if ((framePointer < lowest) || (framePointer & (sizeof(ADDRESS) - 1)))
+            break;
+
+        ADDRESS savedFramePointer = 0;
+        ADDRESS returnAddress = 0;
+        if (!readAddress(framePointer + SAVED_FP_OFFSET, stack, &savedFramePointer)
+            || !readAddress(framePointer + RETURN_ADDRESS_OFFSET, stack, &returnAddress) || !returnAddress)
+            break;
+
+        backtrace.frames.push_back(resolve(returnAddress));
+        lowest = framePointer + sizeof(ADDRESS);
+        framePointer = savedFramePointer;
+    }
+
+    backtraces.push_back(backtrace);
+}
+
+bool Unwinder::readAddress(ADDRESS address, const Phdr *stack, ADDRESS *value) const
+{
+    if ((address < stack->p_vaddr) || (address + sizeof(ADDRESS) > stack->p_vaddr + stack->p_filesz))
+        return false;
+
+    const char *data = coreReader->getDataByOffset(stack->p_offset + (address - stack->p_vaddr));
+    if (!data)
+        return false;
+
+    memcpy(value, data, sizeof(ADDRESS));
+    return true;
+}
+
+Unwinder::Frame Unwinder::resolve(ADDRESS address) const
+{
+    Frame frame;
+    frame.module = BACKTRACE_NO_MODULE;
+    frame.offset = address;
+    for (unsigned int i = 0; i < mappings.size(); i++)
+    {
+        if ((mappings.at(i).start <= address) && (address < mappings.at(i).end))
+        {
+            frame.module = mappings.at(i).module;
+            frame.offset = address - mappings.at(i).start + mappings.at(i).fileOffset;
+            break;
+        }
+    }
+    return frame;
+}
+
+bool Unwinder::isTimeUp() const
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec > deadline.tv_sec)
+            || ((now.tv_sec == deadline.tv_sec) && (now.tv_nsec >= deadline.tv_nsec));
+}
+
+void Unwinder::createNoteDescription(std::vector<char> &desc) const
+{
+    desc.clear();
+    uint32_t value = modules.size();
+    desc.insert(desc.end(), (char *)&value, (char *)&value + sizeof(value));
+    value = backtraces.size();
+    desc.insert(desc.end(), (char *)&value, (char *)&value + sizeof(value));
+
+    for (unsigned int i = 0; i < modules.size(); i++)
+        desc.insert(desc.end(), modules.at(i).c_str(), modules.at(i).c_str() + modules.at(i).size() + 1);
+    desc.resize(align_power(desc.size(), 2), 0);
+
+    for (unsigned int i = 0; i < backtraces.size(); i++)
+    {
+        const Backtrace &backtrace = backtraces.at(i);
+        uint32_t header[] = { (uint32_t)backtrace.pid, backtrace.flags, (uint32_t)backtrace.frames.size() };
+        desc.insert(desc.end(), (char *)header, (char *)header + sizeof(header));
+        for (unsigned int j = 0; j < backtrace.frames.size(); j++)
+        {
+            uint32_t module = backtrace.frames.at(j).module;
+            uint64_t offset = backtrace.frames.at(j).offset;
+            desc.insert(desc.end(), (char *)&module, (char *)&module + sizeof(module));
+            desc.insert(desc.end(), (char *)&offset, (char *)&offset + sizeof(offset));
+        }
+    }
+}
+
+bool Unwinder::writeText(const char *fileName) const
+{
+    FILE *file = fopen(fileName, "w");
+    if (!file)
+        LOG_RETURN(LOG_ERR, false, "Opening file '%s' failed.", fileName);
+
+    for (unsigned int i = 0; i < backtraces.size(); i++)
+    {
+        const Backtrace &backtrace = backtraces.at(i);
+        fprintf(file, "thread %d%s%s\n", backtrace.pid,
+                (backtrace.flags & BACKTRACE_CRASHED) ? " crashed" : "",
+                (backtrace.flags & BACKTRACE_TRUNCATED) ? " truncated" : "");
+        for (unsigned int j = 0; j < backtrace.frames.size(); j++)
+        {
+            const Frame &frame = backtrace.frames.at(j);
+            if (frame.module == BACKTRACE_NO_MODULE)
+                fprintf(file, "#%u 0x%llx\n", j, (unsigned long long)frame.offset);
+            else
+                fprintf(file, "#%u %s+0x%llx\n", j, modules.at(frame.module).c_str(),
+                        (unsigned long long)frame.offset);
+        }
+    }
+
+    fclose(file);
+    return true;
+}
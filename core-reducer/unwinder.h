@@ -0,0 +1,180 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file unwinder.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Unwinder
+  * \brief A small frame pointer unwinder that walks the stacks in the origional core file.
+  * The frames are given as a module and an offset into the file of the module, so that the crashes
+  * can be grouped without loading the core in to a debugger.  The unwinder is bounded by a maximum
+  * number of frames for each thread and by a time limit for all the threads, after which the remaining
+  * backtraces are marked as truncated.
+  *
+  * The description of the NT_RICHCORE_BACKTRACE note has the following layout, all values are in the
+  * byte order of the core:
+  * \code
+  * uint32_t moduleCount
+  * uint32_t threadCount
+  * moduleCount NUL terminated module names, padded to a multiple of 4 bytes
+  * threadCount times:
+  *     uint32_t pid
+  *     uint32_t flags            (BACKTRACE_CRASHED, BACKTRACE_TRUNCATED)
+  *     uint32_t frameCount
+  *     frameCount times:
+  *         uint32_t module       (index in to the module names, BACKTRACE_NO_MODULE for an absolute address)
+  *         uint64_t offset
+  * \endcode
+  * The first frame is the program counter, the others are return addresses.
+  */
+
+#ifndef UNWINDER_H
+#define UNWINDER_H
+
+#include "defines.h"
+#include <string>
+#include <vector>
+#include <time.h>
+
+//! The thread received the fatal signal
+#define BACKTRACE_CRASHED 0x1
+//! The unwinding of the thread was stopped by the time limit
+#define BACKTRACE_TRUNCATED 0x2
+//! The frame is not in a file mapping, the offset is the address of the frame
+#define BACKTRACE_NO_MODULE 0xffffffff
+
+//forward declerations
+class ElfCoreReader;
+
+class Unwinder
+{
+public:
+    /*!
+      * \brief Constructor, the time limit starts to run when the object is created
+      * \param coreReader The origional core file, its memory is used to follow the frames
+      * \param maxFrames The maximum number of frames that are taken for a thread
+      * \param timeLimit The number of microseconds that all of the threads may take to unwind
+      */
+    Unwinder(ElfCoreReader *coreReader, size_t maxFrames, long timeLimit);
+
+    /*!
+      * \brief Add a file mapping of the process that frames are resolved against
+      * \param name The path of the mapped file
+      * \param start The first address of the mapping
+      * \param end The address one past the end of the mapping
+      * \param fileOffset The offset in the file in bytes at which the mapping starts
+      */
+    void addModule(const char *name, ADDRESS start, ADDRESS end, ADDRESS fileOffset);
+
+    /*!
+      * \brief Walk the frame pointer chain of a thread and store its backtrace
+      * \param pid The id of the thread
+      * \param crashed true if this is the thread that received the fatal signal
+      * \param programCounter The value of the program counter of the thread
+      * \param stackPointer The value of the stack pointer of the thread
+      * \param framePointer The value of the frame pointer of the thread
+      */
+    void unwind(int pid, bool crashed, ADDRESS programCounter, ADDRESS stackPointer, ADDRESS framePointer);
+
+    /*!
+      * \brief Create the description of a NT_RICHCORE_BACKTRACE note from the backtraces of all the threads
+      * \param desc The buffer to which the description is written
+      */
+    void createNoteDescription(std::vector<char> &desc) const;
+
+    /*!
+      * \brief Write the backtraces as text, one frame per line
+      * \param fileName The file to write to
+      * \return true on success, false otherwise
+      */
+    bool writeText(const char *fileName) const;
+
+private:
+    /*!
+      * \brief A frame of a backtrace
+      */
+    struct Frame
+    {
+        uint32_t module; //!< The index of the module or BACKTRACE_NO_MODULE
+        ADDRESS offset;  //!< The offset in the file of the module, or the address
+    };
+
+    /*!
+      * \brief The backtrace of a thread
+      */
+    struct Backtrace
+    {
+        int pid;                   //!< The id of the thread
+        uint32_t flags;            //!< BACKTRACE_CRASHED and BACKTRACE_TRUNCATED
+        std::vector<Frame> frames; //!< The frames, starting at the program counter
+    };
+
+    /*!
+      * \brief A file mapping of the process
+      */
+    struct Mapping
+    {
+        ADDRESS start;      //!< The first address of the mapping
+        ADDRESS end;        //!< The address one past the end of the mapping
+        ADDRESS fileOffset; //!< The offset in the file in bytes at which the mapping starts
+        uint32_t module;    //!< The index of the name of the file in \a modules
+    };
+
+    /*!
+      * \brief Read an address sized value from the memory of the core file
+      * \param address The address to read from
+      * \param stack The segment that holds the stack, the value must be within it
+      * \param value Set to the value that was read
+      * \return true if the memory is in the stack segment, false otherwise
+      */
+    bool readAddress(ADDRESS address, const Phdr *stack, ADDRESS *value) const;
+
+    /*!
+      * \brief Convert an address into a module and offset
+      * \param address The address to resolve
+      * \return The frame for the address
+      */
+    Frame resolve(ADDRESS address) const;
+
+    /*!
+      * \brief Check if the time limit has passed
+      * \return true if there is no time left for unwinding
+      */
+    bool isTimeUp() const;
+
+private:
+    //! The origional core file
+    ElfCoreReader *coreReader;
+    //! The maximum number of frames of a thread
+    size_t maxFrames;
+    //! The time after which no more frames are read
+    struct timespec deadline;
+    //! The names of the mapped files
+    std::vector<std::string> modules;
+    //! The file mappings of the process
+    std::vector<Mapping> mappings;
+    //! The backtraces in the order the threads were unwound
+    std::vector<Backtrace> backtraces;
+};
+
+#endif // UNWINDER_H
@@ -0,0 +1,162 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "symbolizer.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <libelf.h>
+#include <pthread.h>
+
+#include "../config.h"
+
+/*!
+  * \brief The work that is shared by the symbolizing threads
+  */
+typedef struct
+{
+    Symbolizer *symbolizer;              //!< The symbolizer shared by all threads
+    std::vector<std::string> inputs;     //!< The files to symbolize
+    std::vector<std::string> results;    //!< The symbolized backtraces of each of the files
+    std::vector<bool> isSymbolized;      //!< true for the files that had backtraces
+    size_t next;                         //!< The index of the next file to be symbolized
+    pthread_mutex_t lock;                //!< Protects \a next
+} Work;
+
+void printUsage(char *progName)
+{
+    std::cout << "\n\nUsage:" << std::endl;
+    std::cout << "\t" << progName << " [-options] [reduced core or backtrace file...]" << std::endl;
+    std::cout << "Options:\n"
+            "\t[-r root directory of the device file system]\n"
+            "\t[-c cache directory for the symbol indexes]\n"
+            "\t[-j number of threads]\n"
+            "\t[-C demangle C++ function names]\n"
+            "\tWithout files the names of the files are read from stdin, one per line.";
+    std::cout << std::endl;
+}
+
+void *symbolizeFiles(void *data)
+{
+    Work *work = (Work *)data;
+    while (true)
+    {
+        pthread_mutex_lock(&work->lock);
+        size_t index = work->next++;
+        pthread_mutex_unlock(&work->lock);
+        if (index >= work->inputs.size())
+            break;
+
+        work->isSymbolized[index] = work->symbolizer->symbolize(work->inputs.at(index).c_str(),
+                                                                work->results.at(index));
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    char *progName = argv[0];
+    const char *root = NULL;
+    const char *cacheDirectory = NULL;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    bool demangle = false;
+    int c;
+
+    while ((c = getopt(argc, argv, "hCr:c:j:")) != -1)
+    {
+        switch (c)
+        {
+        case 'r':
+            root = optarg;
+            break;
+        case 'c':
+            cacheDirectory = optarg;
+            break;
+        case 'j':
+            jobs = strtol(optarg, NULL, 0);
+            break;
+        case 'C':
+            demangle = true;
+            break;
+        case 'h':
+        default:
+            printUsage(progName);
+            return -1;
+        }
+    }
+
+    Work work;
+    for (int i = optind; i < argc; i++)
+        work.inputs.push_back(argv[i]);
+    if (work.inputs.empty())
+    {
+        char line[PATH_MAX];
+        while (fgets(line, sizeof(line), stdin))
+        {
+            line[strcspn(line, "\n")] = '\0';
+            if (line[0])
+                work.inputs.push_back(line);
+        }
+    }
+    if (jobs < 1)
+        jobs = 1;
+    if ((size_t)jobs > work.inputs.size())
+        jobs = work.inputs.size();
+
+    //The elf library keeps global state, set it up before the threads start
+    if (elf_version(EV_CURRENT) == EV_NONE)
+        return -1;
+
+    Symbolizer symbolizer(root, cacheDirectory, demangle);
+    work.symbolizer = &symbolizer;
+    work.results.resize(work.inputs.size());
+    work.isSymbolized.resize(work.inputs.size(), false);
+    work.next = 0;
+    pthread_mutex_init(&work.lock, NULL);
+
+    std::vector<pthread_t> threads(jobs);
+    for (long i = 0; i < jobs; i++)
+        pthread_create(&threads[i], NULL, symbolizeFiles, &work);
+    for (long i = 0; i < jobs; i++)
+        pthread_join(threads[i], NULL);
+    pthread_mutex_destroy(&work.lock);
+
+    //The results are written in the order of the input
+    int failed = 0;
+    for (unsigned int i = 0; i < work.inputs.size(); i++)
+    {
+        if (!work.isSymbolized[i])
+        {
+            std::cerr << work.inputs.at(i) << ": no backtraces found" << std::endl;
+            failed++;
+            continue;
+        }
+        std::cout << "==> " << work.inputs.at(i) << " <==\n" << work.results.at(i);
+    }
+
+    return failed ? -1 : 0;
+}
@@ -0,0 +1,360 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "symbolizer.h"
+#include "elfbinaryreader.h"
+#include "elfcorereader.h"
+#include "unwinder.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#define align_power(address, alignSize) \
+(((address) + ((ADDRESS) 1 << (alignSize)) - 1) & ((ADDRESS) -1 << (alignSize)))
+
+//! The size of a frame in the backtrace note
+#define NOTE_FRAME_SIZE (sizeof(uint32_t) + sizeof(uint64_t))
+
+Symbolizer::Symbolizer(const char *root, const char *cacheDirectory, bool demangle)
+    : root(root ? root : ""),
+    cacheDirectory(cacheDirectory ? cacheDirectory : ""),
+    isDemangled(demangle)
+{
+    pthread_mutex_init(&modulesLock, NULL);
+}
+
+Symbolizer::~Symbolizer()
+{
+    for (std::map<std::string, Module *>::iterator i = modules.begin(); i != modules.end(); ++i)
+    {
+        pthread_mutex_destroy(&i->second->lock);
+        delete i->second;
+    }
+    pthread_mutex_destroy(&modulesLock);
+}
+
+bool Symbolizer::symbolize(const char *fileName, std::string &result)
+{
+    std::vector<std::string> names;
+    std::vector<Backtrace> backtraces;
+    std::map<std::string, std::string> buildIds;
+    if (!readCore(fileName, names, backtraces, buildIds) && !readText(fileName, names, backtraces))
+        return false;
+
+    char line[PATH_MAX + 256];
+    for (unsigned int i = 0; i < backtraces.size(); i++)
+    {
+        const Backtrace &backtrace = backtraces.at(i);
+        snprintf(line, sizeof(line), "thread %d%s%s\n", backtrace.pid,
+                 (backtrace.flags & BACKTRACE_CRASHED) ? " crashed" : "",
+                 (backtrace.flags & BACKTRACE_TRUNCATED) ? " truncated" : "");
+        result += line;
+
+        for (unsigned int j = 0; j < backtrace.frames.size(); j++)
+        {
+            const Frame &frame = backtrace.frames.at(j);
+            if ((frame.module == BACKTRACE_NO_MODULE) || (frame.module >= names.size()))
+            {
+                snprintf(line, sizeof(line), "#%u 0x%llx\n", j, (unsigned long long)frame.offset);
+                result += line;
+                continue;
+            }
+
+            snprintf(line, sizeof(line), "#%u %s+0x%llx", j, names.at(frame.module).c_str(),
+                     (unsigned long long)frame.offset);
+            result += line;
+
+            const std::string &name = names.at(frame.module);
+            std::map<std::string, std::string>::const_iterator id = buildIds.find(name);
+            Module *module = getModule(name, (id != buildIds.end()) ? id->second : std::string());
+            ADDRESS address = 0;
+            if (module && module->index.toAddress(frame.offset, &address))
+            {
+                //A return address is the instruction after the call, which may be in the next function
+                ADDRESS adjust = j ? 1 : 0;
+                ADDRESS offset = 0;
+                const char *function = module->index.findSymbol(address - adjust, &offset);
+                if (function)
+                {
+                    result += ' ';
+                    result += isDemangled ? ElfBinaryReader::demangle(function) : function;
+                    snprintf(line, sizeof(line), "+0x%llx", (unsigned long long)(offset + adjust));
+                    result += line;
+                }
+            }
+            result += '\n';
+        }
+    }
+    return true;
+}
+
+bool Symbolizer::readCore(const char *fileName, std::vector<std::string> &names, std::vector<Backtrace> &backtraces,
+                          std::map<std::string, std::string> &buildIds)
+{
+    ElfCoreReader reader;
+    if (!reader.initalize(fileName) || (reader.elfFileHeader()->e_type != ET_CORE))
+        return false;
+
+    const Phdr *headers = reader.programHeader();
+    for (int i = 0; i < reader.elfFileHeader()->e_phnum; i++)
+    {
+        if (headers[i].p_type != PT_NOTE)
+            continue;
+
+        const char *current = reader.getDataByOffset(headers[i].p_offset);
+        if (!current || !reader.getDataByOffset(headers[i].p_offset + headers[i].p_filesz - 1))
+            continue;
+        const char *end = current + headers[i].p_filesz;
+
+        while (current + sizeof(Nhdr) <= end)
+        {
+            const Nhdr *note = (const Nhdr *)current;
+            const char *name = current + sizeof(Nhdr);
+            const char *desc = name + align_power(note->n_namesz, 2);
+            current = desc + align_power(note->n_descsz, 2);
+            if ((note->n_namesz != sizeof(RICH_CORE_NOTE_NAME))
+                || (memcmp(name, RICH_CORE_NOTE_NAME, sizeof(RICH_CORE_NOTE_NAME)) != 0) || (current > end))
+                continue;
+
+            const char *descEnd = desc + note->n_descsz;
+            if (note->n_type == NT_RICHCORE_MODULES)
+            {
+                readModules(desc, descEnd, buildIds);
+                continue;
+            }
+            if ((note->n_type != NT_RICHCORE_BACKTRACE) || !backtraces.empty())
+                continue;
+
+            //see unwinder.h for the layout of the note
+            uint32_t counts[2];
+            if (desc + sizeof(counts) > descEnd)
+                return false;
+            memcpy(counts, desc, sizeof(counts));
+            desc += sizeof(counts);
+
+            for (uint32_t j = 0; j < counts[0]; j++)
+            {
+                size_t length = strnlen(desc, descEnd - desc);
+                if (desc + length >= descEnd)
+                    return false;
+                names.push_back(std::string(desc, length));
+                desc += length + 1;
+            }
+            desc = (const char *)note + align_power(desc - (const char *)note, 2);
+
+            for (uint32_t j = 0; j < counts[1]; j++)
+            {
+                uint32_t header[3];
+                if (desc + sizeof(header) > descEnd)
+                    return false;
+                memcpy(header, desc, sizeof(header));
+                desc += sizeof(header);
+                if (header[2] > (size_t)(descEnd - desc) / NOTE_FRAME_SIZE)
+                    return false;
+
+                Backtrace backtrace;
+                backtrace.pid = header[0];
+                backtrace.flags = header[1];
+                for (uint32_t k = 0; k < header[2]; k++)
+                {
+                    Frame frame;
+                    memcpy(&frame.module, desc, sizeof(frame.module));
+                    memcpy(&frame.offset, desc + sizeof(frame.module), sizeof(frame.offset));
+                    desc += NOTE_FRAME_SIZE;
+                    backtrace.frames.push_back(frame);
+                }
+                backtraces.push_back(backtrace);
+            }
+        }
+    }
+    return !backtraces.empty();
+}
+
+bool Symbolizer::readModules(const char *desc, const char *descEnd, std::map<std::string, std::string> &buildIds)
+{
+    //see defines.h for the layout of the note
+    const char *start = desc;
+    uint32_t count;
+    if (desc + sizeof(count) > descEnd)
+        return false;
+    memcpy(&count, desc, sizeof(count));
+    desc += sizeof(count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        //The load address and size are not needed, the frames are already file offsets
+        desc += 2 * sizeof(uint64_t);
+        if (desc >= descEnd)
+            return false;
+
+        size_t idLength = strnlen(desc, descEnd - desc);
+        if (desc + idLength >= descEnd)
+            return false;
+        std::string id(desc, idLength);
+        desc += idLength + 1;
+
+        size_t nameLength = strnlen(desc, descEnd - desc);
+        if (desc + nameLength >= descEnd)
+            return false;
+        if (!id.empty())
+            buildIds[std::string(desc, nameLength)] = id;
+        desc += nameLength + 1;
+        desc = start + align_power(desc - start, 2);
+    }
+    return true;
+}
+
+bool Symbolizer::readText(const char *fileName, std::vector<std::string> &names, std::vector<Backtrace> &backtraces)
+{
+    FILE *file = fopen(fileName, "r");
+    if (!file)
+        LOG_RETURN(LOG_ERR, false, "Opening file '%s' failed.", fileName);
+
+    char line[PATH_MAX + 256];
+    while (fgets(line, sizeof(line), file))
+    {
+        int pid = 0;
+        unsigned int index = 0;
+        unsigned long long offset = 0;
+        if (sscanf(line, "thread %d", &pid) == 1)
+        {
+            Backtrace backtrace;
+            backtrace.pid = pid;
+            backtrace.flags = (strstr(line, " crashed") ? BACKTRACE_CRASHED : 0)
+                              | (strstr(line, " truncated") ? BACKTRACE_TRUNCATED : 0);
+            backtraces.push_back(backtrace);
+        }
+        else if (!backtraces.empty() && (sscanf(line, "#%u 0x%llx", &index, &offset) == 2))
+        {
+            Frame frame;
+            frame.module = BACKTRACE_NO_MODULE;
+            frame.offset = offset;
+            backtraces.back().frames.push_back(frame);
+        }
+        else if (!backtraces.empty() && (line[0] == '#'))
+        {
+            //"#index module+0xoffset", the module path may itself contain a '+'
+            char *name = strchr(line, ' ');
+            char *plus = strrchr(line, '+');
+            if (!name || !plus || (plus < name) || (sscanf(plus, "+0x%llx", &offset) != 1))
+                continue;
+
+            std::string module(name + 1, plus);
+            Frame frame;
+            frame.module = names.size();
+            for (unsigned int i = 0; i < names.size(); i++)
+            {
+                if (names.at(i) == module)
+                {
+                    frame.module = i;
+                    break;
+                }
+            }
+            if (frame.module == names.size())
+                names.push_back(module);
+            frame.offset = offset;
+            backtraces.back().frames.push_back(frame);
+        }
+    }
+
+    fclose(file);
+    return !backtraces.empty();
+}
+
+Symbolizer::Module *Symbolizer::getModule(const std::string &name, const std::string &id)
+{
+    //A module of a known build is shared by all the paths it was loaded from
+    pthread_mutex_lock(&modulesLock);
+    Module *&module = modules[id.empty() ? "path:" + name : "id:" + id];
+    if (!module)
+    {
+        module = new Module;
+        pthread_mutex_init(&module->lock, NULL);
+        module->isLoaded = false;
+        module->isValid = false;
+    }
+    Module *found = module;
+    pthread_mutex_unlock(&modulesLock);
+
+    //Only the first user of a module loads it, the others wait for it to complete
+    pthread_mutex_lock(&found->lock);
+    if (!found->isLoaded)
+    {
+        loadModule(found, name, id);
+        found->isLoaded = true;
+    }
+    pthread_mutex_unlock(&found->lock);
+
+    return found->isValid ? found : NULL;
+}
+
+void Symbolizer::loadModule(Module *module, const std::string &name, const std::string &knownId)
+{
+    std::string id = knownId;
+    ElfBinaryReader reader;
+    std::string path = root + name;
+    //The file is only needed for its build id when the core did not record it
+    if (id.empty())
+    {
+        if (!reader.initalize(path.c_str()))
+            return;
+        id = reader.buildId();
+    }
+
+    std::string cacheFile;
+    if (!cacheDirectory.empty() && !id.empty())
+    {
+        cacheFile = cacheDirectory + "/" + id + ".symidx";
+        if (module->index.load(cacheFile.c_str()))
+        {
+            module->isValid = true;
+            return;
+        }
+    }
+
+    //Prefer the separate debug file, it has the full symbol table of a stripped library
+    if (id.size() > 2)
+    {
+        std::string debugPath = root + "/usr/lib/debug/.build-id/" + id.substr(0, 2) + "/" + id.substr(2) + ".debug";
+        ElfBinaryReader debugReader;
+        if ((access(debugPath.c_str(), R_OK) == 0) && debugReader.initalize(debugPath.c_str()))
+            module->isValid = module->index.create(&debugReader);
+    }
+
+    if (!module->isValid && !knownId.empty())
+    {
+        //A file of another build would give wrong function names
+        if (!reader.initalize(path.c_str()) || (reader.buildId() != knownId))
+        {
+            LOG(LOG_INFO, "No symbols for '%s' with build id %s", name.c_str(), knownId.c_str());
+            return;
+        }
+    }
+    if (!module->isValid)
+        module->isValid = module->index.create(&reader);
+
+    if (module->isValid && !cacheFile.empty())
+        module->index.save(cacheFile.c_str());
+}
@@ -0,0 +1,152 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file symbolizer.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Symbolizer
+  * \brief Turn the backtraces that the core reducer stores in to function names.
+  * The backtraces are read from the NT_RICHCORE_BACKTRACE note of a reduced core, or from the text of a
+  * backtrace section of a rich core.  The symbol index of every module is created once and shared by all
+  * the threads that use the Symbolizer.  When a cache directory is given the indexes are stored there by
+  * build id, so later runs only have to map them in.  The build ids of the modules are taken from the
+  * NT_RICHCORE_MODULES note when the core has one, then the exact build that crashed is used even when the
+  * file in the root directory is missing or of a different version.
+  */
+
+#ifndef SYMBOLIZER_H
+#define SYMBOLIZER_H
+
+#include "defines.h"
+#include "symbolindex.h"
+#include <pthread.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Symbolizer
+{
+public:
+    /*!
+      * \brief Constructor
+      * \param root The directory that holds a copy of the root file system of the device, the module
+      * paths of the backtraces are relative to it.  NULL for the root of the host.
+      * \param cacheDirectory The directory in which the symbol indexes are stored, NULL to not store them
+      * \param demangle true to demangle the names of C++ functions
+      */
+    Symbolizer(const char *root, const char *cacheDirectory, bool demangle);
+
+    /*!
+      * \brief Destructor
+      */
+    ~Symbolizer();
+
+    /*!
+      * \brief Symbolize the backtraces of a reduced core or of a backtrace text file
+      * \param fileName The file to read the backtraces from
+      * \param result Set to the symbolized backtraces, one frame per line
+      * \return true on success, false if the file does not contain any backtraces
+      */
+    bool symbolize(const char *fileName, std::string &result);
+
+private:
+    /*!
+      * \brief A frame of a backtrace
+      */
+    struct Frame
+    {
+        uint32_t module; //!< The index of the module name or BACKTRACE_NO_MODULE
+        uint64_t offset; //!< The offset in the file of the module, or the address
+    };
+
+    /*!
+      * \brief The backtrace of a thread
+      */
+    struct Backtrace
+    {
+        int pid;                   //!< The id of the thread
+        uint32_t flags;            //!< BACKTRACE_CRASHED and BACKTRACE_TRUNCATED
+        std::vector<Frame> frames; //!< The frames, starting at the program counter
+    };
+
+    /*!
+      * \brief The symbols and the loadable segments of a module
+      */
+    struct Module
+    {
+        pthread_mutex_t lock;      //!< Held while the module is loaded
+        bool isLoaded;             //!< true once loading has been attempted
+        bool isValid;              //!< true if \a index can be used
+        SymbolIndex index;         //!< The functions and the PT_LOAD segments of the module
+    };
+
+    /*!
+      * \brief Read the backtraces and the build ids of the modules from the notes of a reduced core file
+      * \param buildIds Set to the build ids of the modules by their path, if the core has a module note
+      * \return true if the file is an elf file with a backtrace note
+      */
+    bool readCore(const char *fileName, std::vector<std::string> &modules, std::vector<Backtrace> &backtraces,
+                  std::map<std::string, std::string> &buildIds);
+
+    /*!
+      * \brief Read the build ids of a NT_RICHCORE_MODULES note
+      * \return false if the note is malformed
+      */
+    bool readModules(const char *desc, const char *descEnd, std::map<std::string, std::string> &buildIds);
+
+    /*!
+      * \brief Read the backtraces from a text file as written by core-reducer -b
+      * \return true if any backtraces were found
+      */
+    bool readText(const char *fileName, std::vector<std::string> &modules, std::vector<Backtrace> &backtraces);
+
+    /*!
+      * \brief Get the module for a path, loading it if it has not been used before
+      * \param name The path of the module on the device
+      * \param id The build id of the module, empty if it is not known
+      * \return The module or NULL if it can not be used
+      */
+    Module *getModule(const std::string &name, const std::string &id);
+
+    /*!
+      * \brief Read the segments and the symbols of a module, from the cache if it is there
+      * \param module The module to fill in
+      * \param name The path of the module on the device
+      * \param id The build id of the module, empty if it is not known
+      */
+    void loadModule(Module *module, const std::string &name, const std::string &id);
+
+private:
+    //! The prefix of the module paths
+    std::string root;
+    //! The directory of the stored indexes, empty if they are not stored
+    std::string cacheDirectory;
+    //! true to demangle the names of C++ functions
+    bool isDemangled;
+    //! Protects \a modules
+    pthread_mutex_t modulesLock;
+    //! The modules by their build id, or by their path on the device if the build id is not known
+    std::map<std::string, Module *> modules;
+};
+
+#endif // SYMBOLIZER_H
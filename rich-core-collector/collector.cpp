@@ -0,0 +1,1977 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "collector.h"
+#include "reducer.h"
+#include "smapsencoder.h"
+#include "crc32c.h"
+
+#include <set>
+#include <algorithm>
+#include <functional>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <mntent.h>
+#include <pwd.h>
+#include <grp.h>
+#include <syslog.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netpacket/packet.h>
+#include <linux/if_link.h>
+#include <sys/ioctl.h>
+#include <sys/klog.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/wait.h>
+#include <signal.h>
+
+//! The directory the rich cores are written to
+#define CORE_LOCATION "/home/user/MyDocs/core-dumps"
+//! The kilobytes that must be free in the core location
+#define MIN_FREE_SPACE 20000
+//! The kilobytes that must be left free after the temporary copy of the core is written
+#define MIN_SPACE_LEFT 50000
+//! The largest core in kilobytes that is copied for reducing
+#define CORE_SIZE_LIMIT 500000
+//! Written with the software version if it does not exist
+#define PRODUCT_INFO_FILE "/tmp/osso-product-info"
+//! The static values cached by sysinfod
+#define SYSINFOD_VALUES "/var/cache/sysinfod/values"
+//! The sysinfo daemon, run to create \a SYSINFOD_VALUES
+#define SYSINFOD "/usr/sbin/sysinfod"
+//! The static system information of this boot, as name=value lines, written once by updateSysinfo()
+#define SYSINFO_SNAPSHOT "/var/run/rich-core-sysinfo"
+//! Identifies the boot, so that a snapshot of an earlier boot is not used
+#define BOOT_ID_FILE "/proc/sys/kernel/random/boot_id"
+//! The name of the boot id in the snapshot
+#define BOOT_ID_KEY "boot-id"
+//! The manufacturer of the flash chip, part of the rich core name
+#define MANFID_FILE "/sys/devices/platform/omap2-onenand/manfid"
+//! The name of the manufacturer id in the snapshot
+#define MANFID_KEY "onenand-manfid"
+//! The state of the installed packages
+#define DPKG_STATUS "/var/lib/dpkg/status"
+//! The directory of the caches of the collector
+#define CACHE_DIRECTORY "/var/cache/rich-core"
+//! The sorted package list, preceded by the packageListKey() of the dpkg status it was created from
+#define PACKAGE_LIST_CACHE CACHE_DIRECTORY "/packagelist"
+//! The directory of the rich core counters
+#define COUNTER_DIRECTORY "/var/lib/dsme/rich-cores"
+//! Bytes of runtime generated code kept around the program counters, the default of core-reducer
+#define CODE_WINDOW 4096
+//! The default limits of the logs: lines, bytes and seconds, 0 for no limit
+static const TailReader::Limits defaultSyslogLimits = { 4000, 1024 * 1024, 0 };
+static const TailReader::Limits defaultXorgLimits = { 1000, 256 * 1024, 0 };
+static const TailReader::Limits defaultDmesgLimits = { 0, 128 * 1024, 0 };
+
+//! The stack kept for the threads other than the crashing one when the capture is degraded
+#define DEGRADED_STACK_DEPTH 4096
+//! The memory that the core reducer is estimated to use for the stacks and the unwind tables
+#define REDUCER_MEMORY (4 * 1024 * 1024)
+
+//! The most threads that compress the rich core by default
+#define MAX_COMPRESS_THREADS 4
+
+//! The size of the buffer used to copy data
+#define COPY_BUFFER_SIZE (64 * 1024)
+//! The stack size of the section threads
+#define SECTION_STACK_SIZE (256 * 1024)
+
+//! The section that the calling thread collects, not set for the main thread
+static pthread_key_t sectionKey;
+//! Creates \a sectionKey once
+static pthread_once_t sectionKeyOnce = PTHREAD_ONCE_INIT;
+
+static void createSectionKey()
+{
+    pthread_key_create(&sectionKey, NULL);
+}
+
+const Collector::SectionType Collector::sectionTypes[] = {
+    //name, collect, timeout in ms, size limit, process section, core section
+    //The process sections come first, they are finished before the core is read
+    { "cmdline", &Collector::sectionCmdline, 1000, 64 * 1024, true, true },
+    { "ls_proc", &Collector::sectionListProc, 1000, 64 * 1024, true, true },
+    { "fd", &Collector::sectionListFd, 1000, 256 * 1024, true, true },
+    { "smaps", &Collector::sectionSmaps, 2000, 4 * 1024 * 1024, true, true },
+    { "date", &Collector::sectionDate, 1000, 4 * 1024, false, false },
+    { "component_version", &Collector::sectionComponentVersion, 1000, 4 * 1024, false, false },
+    { "df", &Collector::sectionDf, 2000, 64 * 1024, false, false },
+    { "ifconfig", &Collector::sectionIfconfig, 1000, 64 * 1024, false, false },
+    { "extra files", &Collector::sectionExtraFiles, 3000, 1024 * 1024, false, false },
+    { "slabinfo", &Collector::sectionSlabinfo, 1000, 256 * 1024, false, true },
+    { "proc2csv", &Collector::sectionProc2csv, 5000, 1024 * 1024, false, true },
+    { "syslog", &Collector::sectionSyslog, 5000, 4 * 1024 * 1024, false, false },
+    { "product info", &Collector::sectionProductInfo, 1000, 4 * 1024, false, false },
+    { "packagelist", &Collector::sectionPackageList, 3000, 512 * 1024, false, false }
+};
+
+Collector::Collector()
+    : isDegraded(false),
+    pid(0),
+    signal(0),
+    defaultName("unknown"),
+    isNoSectionHeader(false),
+    isOopsLog(false),
+    isCoreIncluded(true),
+    isCoreReduced(true),
+    isSyslogIncluded(true),
+    isPackageListIncluded(true),
+    stackDepth(0),
+    coreFormat("elf"),
+    compressThreads(0),
+    smapsFormat("binary"),
+    syslogLimits(defaultSyslogLimits),
+    xorgLimits(defaultXorgLimits),
+    dmesgLimits(defaultDmesgLimits),
+    isCoreOmitted(false),
+    freeSpaceKb(0),
+    coreSizeKb(0),
+    vmSize(0),
+    vmExe(0),
+    vmLib(0),
+    isSysinfoRead(false),
+    isCoreSaved(false),
+    isMemoryReduced(true),
+    isCopyOmitted(false),
+    isCoreSnapshot(false),
+    policyFile(DEFAULT_POLICY_FILE),
+    isSummed(false),
+    sectionChecksum(0),
+    sectionSize(0)
+{
+    reduction.codeWindow = CODE_WINDOW;
+    collectionStart.tv_sec = 0;
+    collectionStart.tv_nsec = 0;
+    pthread_once(&sectionKeyOnce, createSectionKey);
+}
+
+Collector::~Collector()
+{
+}
+
+void Collector::setProcess(int pid, int signal, const char *name)
+{
+    this->pid = pid;
+    this->signal = signal;
+    this->name = name ? name : "";
+}
+
+void Collector::setIncludes(bool core, bool reduce, bool syslog, bool packageList)
+{
+    isCoreIncluded = core;
+    isCoreReduced = reduce;
+    isSyslogIncluded = syslog;
+    isPackageListIncluded = packageList;
+}
+
+void Collector::setCompressThreads(unsigned int count)
+{
+    compressThreads = count;
+}
+
+void Collector::setReducedCore(size_t stackDepth, const char *format)
+{
+    this->stackDepth = stackDepth;
+    coreFormat = format ? format : "elf";
+}
+
+bool Collector::setSmapsFormat(const char *format)
+{
+    if ((strcmp(format, "binary") != 0) && (strcmp(format, "summary") != 0) && (strcmp(format, "text") != 0))
+        return false;
+    smapsFormat = format;
+    return true;
+}
+
+bool Collector::setTailLimits(const char *source, const TailReader::Limits &limits)
+{
+    if (strcmp(source, "syslog") == 0)
+        syslogLimits = limits;
+    else if (strcmp(source, "xorg") == 0)
+        xorgLimits = limits;
+    else if (strcmp(source, "dmesg") == 0)
+        dmesgLimits = limits;
+    else
+        return false;
+    return true;
+}
+
+int Collector::run()
+{
+    //before any threads are started, so that they inherit the priority
+    governor.applyPriority();
+
+    if (!findCoreLocation())
+    {
+        discardInput();
+        return 0;
+    }
+
+    //when core reducing is enabled, the core is written temporarily on disk
+    if ((pid > 0) && isCoreReduced && !checkCoreSize())
+    {
+        syslog(LOG_NOTICE, "rich-core: could not get virtual memory information of process - not dumping");
+        discardInput();
+        return 0;
+    }
+
+    findProcessName();
+    if (executable.substr(executable.rfind('/') + 1) == "invoker")
+    {
+        discardInput();
+        return 0;
+    }
+
+    if (!isWanted())
+    {
+        discardInput();
+        return 0;
+    }
+
+    //core reducing can be disabled for certain executables
+    struct stat buf;
+    if ((stat(("/etc/rich-core/disable-reducer/" + name).c_str(), &buf) == 0) && S_ISREG(buf.st_mode))
+        isCoreReduced = false;
+    applyPolicy();
+
+    //The compression keeps up with the copying of a large core only if it is spread over the processors
+    unsigned int threads = compressThreads;
+    if (!threads)
+    {
+        long processors = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (processors > MAX_COMPRESS_THREADS) ? MAX_COMPRESS_THREADS : ((processors > 0) ? processors : 1);
+    }
+
+    if (!admitCapture(threads))
+    {
+        discardInput();
+        return 0;
+    }
+
+    createFileName();
+    std::string temporary = richCoreName + ".tmp";
+    output.setThreads(threads);
+    output.setLevel(reduction.compression);
+    if (!output.open(temporary.c_str()))
+    {
+        governor.release();
+        discardInput();
+        return -1;
+    }
+
+    //The sections are collected at the same time
+    clock_gettime(CLOCK_MONOTONIC, &collectionStart);
+    std::vector<Section *> sections;
+    for (unsigned int i = 0; i < sizeof(sectionTypes) / sizeof(sectionTypes[0]); i++)
+    {
+        if (isSectionWanted(sectionTypes[i], isDegraded))
+            sections.push_back(startSection(sectionTypes[i]));
+    }
+
+    //The kernel holds on to the crashed process only until the core is read, so the process specific
+    //sections that read /proc/<pid> are finished first.  The others are collected while the core is read.
+    unsigned int finished = 0;
+    while ((finished < sections.size()) && sections.at(finished)->type->isProcessSection)
+        finishSection(sections.at(finished++));
+
+    if (isCoreReducing())
+    {
+        if (isMemoryReduced && snapshotCore())
+            isCoreSnapshot = true;
+        else if (isCopyOmitted)
+            isCoreOmitted = true;
+        else
+            isCoreSaved = saveInput((richCoreName + ".core.in").c_str(), coreStart);
+    }
+
+    for (unsigned int i = finished; i < sections.size(); i++)
+        finishSection(sections.at(i));
+
+    sectionCore();
+    sectionRichCoreErrors();
+    sectionChecksums();
+
+    bool isWritten = output.close();
+    governor.release();
+    if (!isWritten || (rename(temporary.c_str(), (richCoreName + ".rcore.lzo").c_str()) != 0))
+    {
+        unlink(temporary.c_str());
+        syslog(LOG_ERR, "rich-core: writing %s failed", temporary.c_str());
+        return -1;
+    }
+
+    countRichCore();
+    return 0;
+}
+
+bool Collector::isSectionWanted(const SectionType &type, bool degraded) const
+{
+    if ((type.isProcessSection && (isOopsLog || (pid <= 0))) || (type.isCoreSection && isOopsLog))
+        return false;
+    if (degraded)
+        return type.isProcessSection;
+    return ((type.collect != &Collector::sectionSyslog) || isSyslogIncluded)
+           && ((type.collect != &Collector::sectionPackageList) || isPackageListIncluded);
+}
+
+unsigned long Collector::estimateMemoryKb(bool degraded, unsigned int threads) const
+{
+    //the sections are buffered until they are written, at most up to their size limits
+    size_t memory = LzopWriter::memoryUse(threads, reduction.compression);
+    for (unsigned int i = 0; i < sizeof(sectionTypes) / sizeof(sectionTypes[0]); i++)
+    {
+        if (isSectionWanted(sectionTypes[i], degraded))
+            memory += sectionTypes[i].sizeLimit;
+    }
+
+    //a core that is not reduced is copied a block at a time
+    if (isCoreReducing() || (degraded && !isNoSectionHeader && !isOopsLog && isCoreIncluded && !executable.empty()))
+        memory += REDUCER_MEMORY;
+    return memory / 1024;
+}
+
+bool Collector::admitCapture(unsigned int &threads)
+{
+    Governor::Admission admission = governor.admit(pid, name.empty() ? defaultName : name,
+                                                   estimateMemoryKb(false, threads), estimateMemoryKb(true, 1));
+    if (admission == Governor::REJECTED)
+    {
+        syslog(LOG_NOTICE, "rich-core: %u captures already running - not dumping", governor.runningCaptures());
+        return false;
+    }
+    if (admission == Governor::ADMITTED)
+        return true;
+
+    //only the process and the stacks of its threads, compressed in this thread
+    isDegraded = true;
+    threads = 1;
+    if (!isNoSectionHeader && !isOopsLog && isCoreIncluded)
+    {
+        if (executable.empty())
+            isCoreIncluded = false;
+        else if (!isCoreReduced)
+        {
+            isCoreReduced = true;
+            if ((pid > 0) && !checkCoreSize())
+                isCoreIncluded = false;
+        }
+        if (!stackDepth || (stackDepth > DEGRADED_STACK_DEPTH))
+            stackDepth = DEGRADED_STACK_DEPTH;
+    }
+
+    char error[256];
+    snprintf(error, sizeof(error), "capture degraded to the process and its stacks: %u captures using %lu kB"
+             " were running", governor.runningCaptures(), governor.runningMemoryKb());
+    errors.push_back(error);
+    syslog(LOG_NOTICE, "rich-core: %s", error);
+    return true;
+}
+
+Collector::Section *Collector::startSection(const SectionType &type)
+{
+    Section *section = new Section;
+    section->type = &type;
+    section->collector = this;
+    section->isFinished = false;
+    section->isTruncated = false;
+    section->isAbandoned = false;
+    section->child = 0;
+    pthread_mutex_init(&section->lock, NULL);
+
+    //The deadlines are on the monotonic clock so that setting the time does not affect them
+    pthread_condattr_t conditionAttributes;
+    pthread_condattr_init(&conditionAttributes);
+    pthread_condattr_setclock(&conditionAttributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&section->finished, &conditionAttributes);
+    pthread_condattr_destroy(&conditionAttributes);
+
+    pthread_attr_t attributes;
+    pthread_t thread;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attributes, SECTION_STACK_SIZE);
+    int result = pthread_create(&thread, &attributes, collectSection, section);
+    pthread_attr_destroy(&attributes);
+
+    //Without a thread the section is collected right away
+    if (result != 0)
+    {
+        LOG(LOG_ERR, "Unable to start a thread for %s", type.name);
+        collectSection(section);
+        pthread_setspecific(sectionKey, NULL);
+    }
+    return section;
+}
+
+void *Collector::collectSection(void *data)
+{
+    Section *section = (Section *)data;
+    pthread_setspecific(sectionKey, section);
+    (section->collector->*section->type->collect)();
+
+    pthread_mutex_lock(&section->lock);
+    section->isFinished = true;
+    bool isAbandoned = section->isAbandoned;
+    pthread_cond_signal(&section->finished);
+    pthread_mutex_unlock(&section->lock);
+
+    //Nobody is waiting for a section that was given up
+    if (isAbandoned)
+        deleteSection(section);
+    return NULL;
+}
+
+void Collector::finishSection(Section *section)
+{
+    //An abandoned section is deleted by its thread, so nothing of it is used after it is unlocked
+    const SectionType &type = *section->type;
+    struct timespec deadline = collectionStart;
+    deadline.tv_sec += type.timeout / 1000;
+    deadline.tv_nsec += (type.timeout % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&section->lock);
+    int result = 0;
+    while (!section->isFinished && (result != ETIMEDOUT))
+        result = pthread_cond_timedwait(&section->finished, &section->lock, &deadline);
+
+    bool isTimedOut = !section->isFinished;
+    if (isTimedOut)
+    {
+        //The thread keeps running until the source it waits for returns, a command is stopped right away
+        section->isAbandoned = true;
+        if (section->child > 0)
+            kill(-section->child, SIGKILL);
+    }
+    std::string data;
+    data.swap(section->data);
+    std::vector<SectionHeader> headers;
+    headers.swap(section->headers);
+    bool isTruncated = section->isTruncated;
+    pthread_mutex_unlock(&section->lock);
+
+    writeSection(data, headers);
+    char error[128];
+    if (isTruncated)
+    {
+        print("\n--- truncated at %lu bytes ---\n", (unsigned long)type.sizeLimit);
+        snprintf(error, sizeof(error), "Section %s was truncated at %lu bytes.", type.name,
+                 (unsigned long)type.sizeLimit);
+        errors.push_back(error);
+    }
+    if (isTimedOut)
+    {
+        print("\n--- timed out after %ld ms ---\n", type.timeout);
+        snprintf(error, sizeof(error), "Section %s timed out after %ld ms.", type.name,
+                 type.timeout);
+        errors.push_back(error);
+        syslog(LOG_NOTICE, "rich-core: %s", error);
+    }
+    else
+    {
+        deleteSection(section);
+    }
+}
+
+void Collector::deleteSection(Section *section)
+{
+    pthread_cond_destroy(&section->finished);
+    pthread_mutex_destroy(&section->lock);
+    delete section;
+}
+
+bool Collector::findCoreLocation()
+{
+    struct stat buf;
+    if ((stat(CORE_LOCATION, &buf) == 0) && S_ISDIR(buf.st_mode))
+    {
+        freeSpaceKb = freeSpace(CORE_LOCATION);
+        if (freeSpaceKb > MIN_FREE_SPACE)
+            coreLocation = CORE_LOCATION;
+        else
+            syslog(LOG_NOTICE, "rich-core: less than 20M free in core location");
+    }
+
+    if (coreLocation.empty())
+    {
+        syslog(LOG_NOTICE, "rich-core: no core location - not dumping");
+        return false;
+    }
+
+    //check that the vfat partition is mounted before trying to dump to it
+    bool isVfat = false;
+    FILE *mounts = setmntent("/proc/mounts", "r");
+    struct mntent *entry;
+    while (mounts && !isVfat && (entry = getmntent(mounts)))
+        isVfat = strstr(entry->mnt_dir, "MyDocs") && (strcmp(entry->mnt_type, "vfat") == 0);
+    if (mounts)
+        endmntent(mounts);
+
+    if (!isVfat)
+    {
+        syslog(LOG_NOTICE, "rich-core: MyDocs not mounted to vfat partition - not dumping");
+        return false;
+    }
+    return true;
+}
+
+bool Collector::checkCoreSize()
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return false;
+
+    bool found[3] = { false, false, false };
+    char line[256];
+    while (fgets(line, sizeof(line), file))
+    {
+        if (sscanf(line, "VmSize: %lld", &vmSize) == 1)
+            found[0] = true;
+        else if (sscanf(line, "VmExe: %lld", &vmExe) == 1)
+            found[1] = true;
+        else if (sscanf(line, "VmLib: %lld", &vmLib) == 1)
+            found[2] = true;
+    }
+    fclose(file);
+
+    if (!found[0] || !found[1] || !found[2])
+        return false;
+
+    coreSizeKb = vmSize - vmLib - vmExe;
+    if ((freeSpaceKb - coreSizeKb >= MIN_SPACE_LEFT) && (coreSizeKb <= CORE_SIZE_LIMIT))
+        return true;
+
+    //Reducing from the memory of the process needs the copy only if the memory can not be read
+    if (isMemoryReduced)
+        isCopyOmitted = true;
+    else
+        isCoreOmitted = true;
+
+    if (freeSpaceKb - coreSizeKb < MIN_SPACE_LEFT)
+    {
+        //not enough free space for the input core file and the required extra space
+        syslog(LOG_NOTICE, "rich-core: dumping core might fill up disk - %s", isCoreOmitted ? "not dumping"
+               : "reducing from memory only");
+    }
+    else
+    {
+        syslog(LOG_NOTICE, "rich-core: approximate of core size is greater than %d kB - %s", CORE_SIZE_LIMIT,
+               isCoreOmitted ? "not dumping" : "reducing from memory only");
+    }
+    return true;
+}
+
+void Collector::findProcessName()
+{
+    char path[PATH_MAX];
+    char resolved[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/%d/exe", pid);
+    if (realpath(path, resolved))
+        executable = resolved;
+    std::string executableName = executable.substr(executable.rfind('/') + 1);
+
+    //Only look for the name if there is a valid pid, it is the first word of the command line
+    if (pid > 0)
+    {
+        snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+        std::string command = readLine(path);
+        command = command.substr(0, command.find_first_of(std::string(" \0", 2)));
+        command = command.substr(command.rfind('/') + 1);
+        if (!command.empty())
+            name = command;
+    }
+
+    if (name.empty())
+        name = executableName.empty() ? defaultName : executableName;
+}
+
+bool Collector::isWanted()
+{
+    const char *lists[] = { "/etc/rich-core.include", "/etc/rich-core.exclude" };
+    for (int i = 0; i < 2; i++)
+    {
+        FILE *file = fopen(lists[i], "r");
+        if (!file)
+            continue;
+
+        bool isListed = false;
+        char line[PATH_MAX];
+        while (!isListed && fgets(line, sizeof(line), file))
+        {
+            //A line holds one name, surrounded by any amount of white space
+            char *start = line;
+            while (isspace(*start))
+                start++;
+            char *end = start + strlen(start);
+            while ((end > start) && isspace(end[-1]))
+                end--;
+            isListed = (name == std::string(start, end));
+        }
+        fclose(file);
+
+        //A process has to be in the white list and not in the black list
+        if (isListed == (i != 0))
+            return false;
+    }
+    return true;
+}
+
+void Collector::createFileName()
+{
+    //Make a unique HW ID from IMEI
+    std::string imei = sysinfoValue("/certs/npc/esn/gsm");
+    if (imei.empty() || (imei == "<error>"))
+        imei = "xxxx";
+
+    std::string vendor = sysinfoValue(MANFID_KEY);
+    if (vendor.empty())
+        vendor = "NA";
+
+    std::string hwid = sysinfoValue("/component/hw-build");
+
+    //Make a naming distinction between oopslogs and rich cores
+    char suffix[64];
+    if (isOopsLog)
+    {
+        time_t now = time(NULL);
+        strftime(suffix, sizeof(suffix), "%F-%S", localtime(&now));
+        richCoreName = coreLocation + "/oopslog-" + imei + "-" + vendor + "-" + hwid + "-" + suffix;
+    }
+    else
+    {
+        snprintf(suffix, sizeof(suffix), "%d-%d", signal, pid);
+        richCoreName = coreLocation + "/" + name + "-" + imei + "-" + vendor + "-" + hwid + "-" + suffix;
+    }
+}
+
+void Collector::sectionCmdline()
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/%d/cmdline", pid);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return;
+
+    printHeader(path);
+    //the arguments are separated by null characters, replace them with spaces
+    char buffer[4096];
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        std::replace(buffer, buffer + length, '\0', ' ');
+        write(buffer, length);
+    }
+    close(fd);
+}
+
+void Collector::sectionListProc()
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/%d/", pid);
+    listDirectory("ls_proc", path);
+}
+
+void Collector::sectionListFd()
+{
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/proc/%d/fd/", pid);
+    listDirectory("fd", path);
+}
+
+void Collector::sectionSmaps()
+{
+    char path[PATH_MAX];
+    if (smapsFormat == "summary")
+    {
+        //The mappings without their details and the totals of the details
+        snprintf(path, sizeof(path), "/proc/%d/maps", pid);
+        printFile(path, true);
+        snprintf(path, sizeof(path), "/proc/%d/smaps_rollup", pid);
+        if (printFile(path, true))
+            return;
+    }
+
+    //The text repeats the same names in every mapping, the table written instead is a fraction of it
+    snprintf(path, sizeof(path), "/proc/%d/smaps", pid);
+    std::string text;
+    std::string table;
+    if (!readFile(path, text))
+        return;
+    if ((smapsFormat != "text") && SmapsEncoder::encode(text, table))
+    {
+        printHeader("smaps.bin");
+        write(table.data(), table.size());
+        return;
+    }
+
+    printHeader(path);
+    write(text.data(), text.size());
+}
+
+void Collector::sectionSlabinfo()
+{
+    printFile("/proc/slabinfo", true);
+}
+
+void Collector::sectionProc2csv()
+{
+    const char *proc2csv[] = { "/usr/bin/proc2csv", NULL };
+    printCommand(proc2csv, true);
+}
+
+/*!
+  * \brief Create the file type and permissions column of ls -l
+  */
+static std::string modeString(mode_t mode)
+{
+    std::string result = "?rwxrwxrwx";
+    if (S_ISREG(mode)) result[0] = '-';
+    else if (S_ISDIR(mode)) result[0] = 'd';
+    else if (S_ISLNK(mode)) result[0] = 'l';
+    else if (S_ISCHR(mode)) result[0] = 'c';
+    else if (S_ISBLK(mode)) result[0] = 'b';
+    else if (S_ISFIFO(mode)) result[0] = 'p';
+    else if (S_ISSOCK(mode)) result[0] = 's';
+
+    for (int i = 0; i < 9; i++)
+    {
+        if (!(mode & (0400 >> i)))
+            result[i + 1] = '-';
+    }
+    if (mode & S_ISUID)
+        result[3] = (mode & S_IXUSR) ? 's' : 'S';
+    if (mode & S_ISGID)
+        result[6] = (mode & S_IXGRP) ? 's' : 'S';
+    if (mode & S_ISVTX)
+        result[9] = (mode & S_IXOTH) ? 't' : 'T';
+    return result;
+}
+
+void Collector::listDirectory(const char *header, const std::string &directory)
+{
+    printHeader(header);
+
+    struct dirent **entries = NULL;
+    int count = scandir(directory.c_str(), &entries, NULL, alphasort);
+    if (count < 0)
+    {
+        print("ls: %s: %s\n", directory.c_str(), strerror(errno));
+        return;
+    }
+
+    //The same lines as ls -l, the total is in kilobytes
+    std::string lines;
+    long long total = 0;
+    time_t now = time(NULL);
+    for (int i = 0; i < count; i++)
+    {
+        std::string path = directory + entries[i]->d_name;
+        struct stat buf;
+        if ((entries[i]->d_name[0] == '.') || (lstat(path.c_str(), &buf) != 0))
+        {
+            free(entries[i]);
+            continue;
+        }
+        total += buf.st_blocks / 2;
+
+        //The sections are collected in parallel, so only the reentrant lookups are used
+        char owner[32];
+        char group[32];
+        char lookupBuffer[1024];
+        struct passwd userEntry;
+        struct passwd *user = NULL;
+        struct group groupEntry;
+        struct group *userGroup = NULL;
+        getpwuid_r(buf.st_uid, &userEntry, lookupBuffer, sizeof(lookupBuffer), &user);
+        if (user)
+            snprintf(owner, sizeof(owner), "%s", user->pw_name);
+        else
+            snprintf(owner, sizeof(owner), "%u", (unsigned int)buf.st_uid);
+        getgrgid_r(buf.st_gid, &groupEntry, lookupBuffer, sizeof(lookupBuffer), &userGroup);
+        if (userGroup)
+            snprintf(group, sizeof(group), "%s", userGroup->gr_name);
+        else
+            snprintf(group, sizeof(group), "%u", (unsigned int)buf.st_gid);
+
+        //Files older than half a year are shown with the year instead of the time
+        char date[32];
+        bool isRecent = (buf.st_mtime <= now) && (now - buf.st_mtime < 365 * 24 * 60 * 60 / 2);
+        struct tm modified;
+        strftime(date, sizeof(date), isRecent ? "%b %e %H:%M" : "%b %e  %Y", localtime_r(&buf.st_mtime, &modified));
+
+        char line[PATH_MAX * 2 + 128];
+        int length = snprintf(line, sizeof(line), "%s %2lu %-8s %-8s %8lld %s %s", modeString(buf.st_mode).c_str(),
+                              (unsigned long)buf.st_nlink, owner, group, (long long)buf.st_size, date,
+                              entries[i]->d_name);
+        lines.append(line, std::min(length, (int)sizeof(line) - 1));
+
+        if (S_ISLNK(buf.st_mode))
+        {
+            char target[PATH_MAX];
+            ssize_t targetLength = readlink(path.c_str(), target, sizeof(target) - 1);
+            if (targetLength >= 0)
+            {
+                lines += " -> ";
+                lines.append(target, targetLength);
+            }
+        }
+        lines += '\n';
+        free(entries[i]);
+    }
+    free(entries);
+
+    print("total %lld\n", total);
+    write(lines.data(), lines.size());
+}
+
+void Collector::sectionDate()
+{
+    char date[64];
+    time_t now = time(NULL);
+    struct tm local;
+    strftime(date, sizeof(date), "%a %b %e %H:%M:%S %Z %Y", localtime_r(&now, &local));
+    printHeader("date");
+    print("%s\n", date);
+}
+
+void Collector::sectionComponentVersion()
+{
+    const char *keys[] = { "/component/product", "/component/hw-build", "/component/nolo", "/component/boot-mode" };
+    printHeader("/proc/component_version");
+    for (unsigned int i = 0; i < sizeof(keys) / sizeof(keys[0]); i++)
+    {
+        std::string value = sysinfoValue(keys[i]);
+        print("%-11s %s\n", strrchr(keys[i], '/') + 1, value.c_str());
+    }
+}
+
+void Collector::sectionDf()
+{
+    FILE *mounts = setmntent("/proc/mounts", "r");
+    if (!mounts)
+        return;
+
+    printHeader("df");
+    print("Filesystem           1K-blocks      Used Available Use%% Mounted on\n");
+    struct mntent *entry;
+    while ((entry = getmntent(mounts)))
+    {
+        //Like df, the pseudo file systems without any blocks are not shown
+        struct statvfs buf;
+        if ((statvfs(entry->mnt_dir, &buf) != 0) || !buf.f_blocks)
+            continue;
+
+        unsigned long long total = (unsigned long long)buf.f_blocks * buf.f_frsize / 1024;
+        unsigned long long used = (unsigned long long)(buf.f_blocks - buf.f_bfree) * buf.f_frsize / 1024;
+        unsigned long long available = (unsigned long long)buf.f_bavail * buf.f_frsize / 1024;
+        unsigned int percent = (used + available) ? (used * 100 + used + available - 1) / (used + available) : 0;
+        print("%-20s %9llu %9llu %9llu %3u%% %s\n", entry->mnt_fsname, total, used, available, percent, entry->mnt_dir);
+    }
+    endmntent(mounts);
+}
+
+void Collector::sectionIfconfig()
+{
+    struct ifaddrs *addresses = NULL;
+    if (getifaddrs(&addresses) != 0)
+        return;
+
+    printHeader("ifconfig");
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+    //Each interface has one link entry with the statistics, followed by entries for its addresses
+    for (struct ifaddrs *link = addresses; link; link = link->ifa_next)
+    {
+        if (!link->ifa_addr || (link->ifa_addr->sa_family != AF_PACKET))
+            continue;
+
+        const struct sockaddr_ll *hardware = (const struct sockaddr_ll *)link->ifa_addr;
+        if (hardware->sll_hatype == ARPHRD_LOOPBACK)
+        {
+            print("%-10sLink encap:Local Loopback\n", link->ifa_name);
+        }
+        else
+        {
+            print("%-10sLink encap:%s  HWaddr ", link->ifa_name,
+                  (hardware->sll_hatype == ARPHRD_ETHER) ? "Ethernet" : "UNSPEC");
+            for (int i = 0; i < hardware->sll_halen; i++)
+                print("%s%02X", i ? ":" : "", hardware->sll_addr[i]);
+            print("\n");
+        }
+
+        for (struct ifaddrs *address = addresses; address; address = address->ifa_next)
+        {
+            if (!address->ifa_addr || (strcmp(address->ifa_name, link->ifa_name) != 0))
+                continue;
+
+            char text[INET6_ADDRSTRLEN];
+            if (address->ifa_addr->sa_family == AF_INET)
+            {
+                inet_ntop(AF_INET, &((struct sockaddr_in *)address->ifa_addr)->sin_addr, text, sizeof(text));
+                print("          inet addr:%s", text);
+                if ((address->ifa_flags & IFF_BROADCAST) && address->ifa_broadaddr)
+                {
+                    inet_ntop(AF_INET, &((struct sockaddr_in *)address->ifa_broadaddr)->sin_addr, text, sizeof(text));
+                    print("  Bcast:%s", text);
+                }
+                if (address->ifa_netmask)
+                {
+                    inet_ntop(AF_INET, &((struct sockaddr_in *)address->ifa_netmask)->sin_addr, text, sizeof(text));
+                    print("  Mask:%s", text);
+                }
+                print("\n");
+            }
+            else if (address->ifa_addr->sa_family == AF_INET6)
+            {
+                inet_ntop(AF_INET6, &((struct sockaddr_in6 *)address->ifa_addr)->sin6_addr, text, sizeof(text));
+                print("          inet6 addr: %s\n", text);
+            }
+        }
+
+        const struct { unsigned int flag; const char *name; } flags[] = {
+            { IFF_UP, "UP" }, { IFF_BROADCAST, "BROADCAST" }, { IFF_LOOPBACK, "LOOPBACK" },
+            { IFF_POINTOPOINT, "POINTOPOINT" }, { IFF_RUNNING, "RUNNING" }, { IFF_NOARP, "NOARP" },
+            { IFF_PROMISC, "PROMISC" }, { IFF_MULTICAST, "MULTICAST" }
+        };
+        print("         ");
+        for (unsigned int i = 0; i < sizeof(flags) / sizeof(flags[0]); i++)
+        {
+            if (link->ifa_flags & flags[i].flag)
+                print(" %s", flags[i].name);
+        }
+
+        struct ifreq request;
+        memset(&request, 0, sizeof(request));
+        strncpy(request.ifr_name, link->ifa_name, IFNAMSIZ - 1);
+        int mtu = ((sock >= 0) && (ioctl(sock, SIOCGIFMTU, &request) == 0)) ? request.ifr_mtu : 0;
+        print("  MTU:%d  Metric:1\n", mtu);
+
+        const struct rtnl_link_stats *stats = (const struct rtnl_link_stats *)link->ifa_data;
+        if (stats)
+        {
+            print("          RX packets:%u errors:%u dropped:%u overruns:%u frame:%u\n", stats->rx_packets,
+                  stats->rx_errors, stats->rx_dropped, stats->rx_over_errors, stats->rx_frame_errors);
+            print("          TX packets:%u errors:%u dropped:%u overruns:%u carrier:%u\n", stats->tx_packets,
+                  stats->tx_errors, stats->tx_dropped, stats->tx_fifo_errors, stats->tx_carrier_errors);
+            print("          collisions:%u\n", stats->collisions);
+            print("          RX bytes:%u  TX bytes:%u\n", stats->rx_bytes, stats->tx_bytes);
+        }
+        print("\n");
+    }
+
+    if (sock >= 0)
+        close(sock);
+    freeifaddrs(addresses);
+}
+
+void Collector::findExtraLists(const std::string &directory, std::vector<std::string> &lists)
+{
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        return;
+
+    std::string ownList = name + ".extras";
+    struct dirent *entry;
+    while ((entry = readdir(dir)))
+    {
+        if ((strcmp(entry->d_name, ".") == 0) || (strcmp(entry->d_name, "..") == 0))
+            continue;
+
+        std::string path = directory + "/" + entry->d_name;
+        struct stat buf;
+        if (lstat(path.c_str(), &buf) != 0)
+            continue;
+
+        if (S_ISDIR(buf.st_mode))
+            findExtraLists(path, lists);
+        else if (S_ISREG(buf.st_mode) && ((strcmp(entry->d_name, "default.extras") == 0) || (ownList == entry->d_name)))
+            lists.push_back(path);
+    }
+    closedir(dir);
+}
+
+void Collector::sectionExtraFiles()
+{
+    std::vector<std::string> lists;
+    findExtraLists("/etc/rich-core", lists);
+
+    //The lists hold file names and wild cards separated by white space, each is included once
+    std::set<std::string> patterns;
+    for (unsigned int i = 0; i < lists.size(); i++)
+    {
+        FILE *file = fopen(lists.at(i).c_str(), "r");
+        char word[PATH_MAX];
+        while (file && (fscanf(file, "%4095s", word) == 1))
+            patterns.insert(word);
+        if (file)
+            fclose(file);
+    }
+
+    for (std::set<std::string>::const_iterator i = patterns.begin(); i != patterns.end(); ++i)
+    {
+        glob_t matches;
+        if (glob(i->c_str(), GLOB_NOCHECK, NULL, &matches) != 0)
+            continue;
+        for (size_t j = 0; j < matches.gl_pathc; j++)
+            printFile(matches.gl_pathv[j], true);
+        globfree(&matches);
+    }
+}
+
+void Collector::sectionSyslog()
+{
+    //as syslog has existed in two different places, try the old one first to support older releases
+    std::vector<std::string> files;
+    if (access("/var/ftd-log/syslog", F_OK) == 0)
+    {
+        files.push_back("/var/ftd-log/syslog");
+    }
+    else
+    {
+        files.push_back("/var/log/syslog");
+        files.push_back("/var/log/syslog.old");
+    }
+
+    printHeader(files.front());
+
+    //Only the end of the logs is included, so they are read newest first until the limits are reached
+    //and written in the usual order.  Of the rotated Xorg logs only the newest one is read.
+    const char *xorgLogs[] = { "/tmp/Xorg.0.log", "/tmp/Xorg.0.log.old" };
+    std::vector<std::string> xorgFiles(xorgLogs, xorgLogs + 2);
+    glob_t matches;
+    if (glob("/var/log/Xorg.0.log.*.gz", 0, NULL, &matches) == 0)
+    {
+        std::string newest;
+        time_t newestTime = 0;
+        for (size_t i = 0; i < matches.gl_pathc; i++)
+        {
+            struct stat buf;
+            if ((stat(matches.gl_pathv[i], &buf) == 0) && S_ISREG(buf.st_mode)
+                && (newest.empty() || (buf.st_mtime > newestTime)))
+            {
+                newest = matches.gl_pathv[i];
+                newestTime = buf.st_mtime;
+            }
+        }
+        globfree(&matches);
+        if (!newest.empty())
+            xorgFiles.push_back(newest);
+    }
+
+    TailReader xorgReader(xorgLimits, TailReader::NO_TIME);
+    std::vector<std::string> xorgTexts(xorgFiles.size());
+    std::vector<bool> isXorgRead(xorgFiles.size(), false);
+    for (unsigned int i = 0; (i < xorgFiles.size()) && !xorgReader.isFull(); i++)
+    {
+        struct stat buf;
+        if ((stat(xorgFiles.at(i).c_str(), &buf) != 0) || !S_ISREG(buf.st_mode))
+            continue;
+        if (i < 2)
+            isXorgRead[i] = xorgReader.readFile(xorgFiles.at(i), xorgTexts.at(i));
+        else
+            isXorgRead[i] = xorgReader.readGzipFile(xorgFiles.at(i), xorgTexts.at(i));
+    }
+    for (int i = xorgFiles.size() - 1; i >= 0; i--)
+    {
+        if (!isXorgRead[i])
+            continue;
+        printSeparator(xorgFiles.at(i));
+        write(xorgTexts.at(i).data(), xorgTexts.at(i).size());
+    }
+
+    //The kernel log buffer, as dmesg prints it
+    int size = klogctl(10, NULL, 0);
+    if (size > 0)
+    {
+        std::vector<char> log(size);
+        int length = klogctl(3, &log[0], size);
+        if (length > 0)
+        {
+            printSeparator("dmesg");
+            std::string text;
+            for (int i = 0; i < length;)
+            {
+                //drop the <level> at the start of the lines
+                int end = i;
+                while ((end < length) && (log[end] != '\n'))
+                    end++;
+                int start = i;
+                if ((end - i >= 3) && (log[i] == '<'))
+                {
+                    const char *close = (const char *)memchr(&log[i], '>', end - i);
+                    if (close)
+                        start = close + 1 - &log[0];
+                }
+                text.append(&log[start], end - start);
+                text += '\n';
+                i = end + 1;
+            }
+            TailReader dmesgReader(dmesgLimits, TailReader::KERNEL_TIME);
+            std::string tail;
+            dmesgReader.readBuffer(text.data(), text.size(), tail);
+            write(tail.data(), tail.size());
+        }
+    }
+
+    TailReader syslogReader(syslogLimits, TailReader::SYSLOG_TIME);
+    std::vector<std::string> syslogTexts(files.size());
+    std::vector<bool> isSyslogRead(files.size(), false);
+    for (unsigned int i = 0; (i < files.size()) && !syslogReader.isFull(); i++)
+    {
+        struct stat buf;
+        if ((stat(files.at(i).c_str(), &buf) == 0) && S_ISREG(buf.st_mode))
+            isSyslogRead[i] = syslogReader.readFile(files.at(i), syslogTexts.at(i));
+    }
+    for (unsigned int i = 0; i < files.size(); i++)
+    {
+        if (!isSyslogRead[i])
+            continue;
+        printSeparator(files.at(i));
+        write(syslogTexts.at(i).data(), syslogTexts.at(i).size());
+    }
+}
+
+void Collector::sectionProductInfo()
+{
+    //create the file if it does not exist or is empty
+    struct stat buf;
+    if ((stat(PRODUCT_INFO_FILE, &buf) != 0) || !buf.st_size)
+    {
+        FILE *file = fopen(PRODUCT_INFO_FILE, "w");
+        if (file)
+        {
+            fprintf(file, "OSSO_VERSION='%s'\n", sysinfoValue("/device/sw-release-ver").c_str());
+            fclose(file);
+        }
+    }
+    printFile(PRODUCT_INFO_FILE, true);
+}
+
+void Collector::sectionPackageList()
+{
+    printHeader("packagelist");
+    std::string key = packageListKey();
+    if (key.empty())
+        return;
+
+    //The packages seldom change between crashes, so the list is usually copied from the cache
+    int fd = openPackageList(key);
+    if (fd >= 0)
+    {
+        copyFd(fd);
+        close(fd);
+        return;
+    }
+
+    std::string list;
+    createPackageList(list);
+    write(list.data(), list.size());
+    savePackageList(key, list);
+}
+
+void Collector::sectionCore()
+{
+    if (isNoSectionHeader && !isCoreOmitted)
+    {
+        copyFd(STDIN_FILENO);
+        return;
+    }
+
+    if (isOopsLog)
+    {
+        printHeader("oopslog");
+        copyFd(STDIN_FILENO);
+        return;
+    }
+
+    if (!isCoreIncluded || isCoreOmitted)
+        return;
+
+    printHeader((isCoreReduced && (coreFormat == "minidump")) ? "minidump" : "coredump");
+    if (isCoreReducing())
+        reduceCore();
+    else
+        copyCore(STDIN_FILENO);
+}
+
+bool Collector::isCoreReducing() const
+{
+    return !isNoSectionHeader && !isOopsLog && isCoreIncluded && !isCoreOmitted && isCoreReduced
+           && !executable.empty();
+}
+
+bool Collector::reduceCore()
+{
+    //The reducer needs random access to the core, so it was copied to a file first unless the memory was read
+    std::string input = richCoreName + ".core.in";
+    std::string reduced = richCoreName + ".core.out";
+    std::string backtrace = richCoreName + ".backtrace";
+    if (!isCoreSaved && !isCoreSnapshot)
+    {
+        unlink(input.c_str());
+        return false;
+    }
+
+    Reducer *reducer = new Reducer(reduced.c_str(), 0);
+    reducer->setStackDepth(stackDepth);
+    reducer->setCodeWindow(reduction.codeWindow);
+    reducer->setByteBudget(reduction.byteBudget);
+    reducer->setHeapDepth(reduction.heapDepth);
+    reducer->setMappingPatterns(reduction.mappings);
+    reducer->setNoteFilter(reduction.notes);
+    reducer->setPageAligned(reduction.isPageAligned);
+    //the threads admitted for the compression reduce the core before it
+    reducer->setThreads(output.getThreads());
+    reducer->setOutputFormat((coreFormat == "minidump") ? Reducer::MinidumpFormat : Reducer::ElfFormat);
+    reducer->setBacktraceFile(backtrace.c_str());
+    bool success = isCoreSnapshot ? reducer->initalize(snapshot.image(), snapshot.imageSize(), executable.c_str())
+                                  : reducer->initalize(input.c_str(), executable.c_str());
+    if (success)
+        reducer->run(!reduction.isLinkMapIncluded, NULL);
+    delete(reducer);
+    unlink(input.c_str());
+
+    int fd = open(reduced.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        if (success)
+            copyCore(fd);
+        close(fd);
+    }
+    unlink(reduced.c_str());
+
+    struct stat buf;
+    if (success && (stat(backtrace.c_str(), &buf) == 0) && buf.st_size)
+    {
+        printHeader("backtrace");
+        printFile(backtrace, false);
+    }
+    unlink(backtrace.c_str());
+    return success;
+}
+
+void Collector::sectionRichCoreErrors()
+{
+    if (!isCoreOmitted && errors.empty())
+        return;
+
+    printHeader("rich-core-errors");
+    for (unsigned int i = 0; i < errors.size(); i++)
+        print("%s\n", errors.at(i).c_str());
+    if (!isCoreOmitted)
+        return;
+
+    print("Core dumping was omitted due to lack of free space on device or core size greater than %d kB.\n",
+          CORE_SIZE_LIMIT);
+    print("Free space on device = %lld kB\n", freeSpaceKb);
+    print("Approximate size of core = %lld kB\n", coreSizeKb);
+    print("VmSize = %lld kB\n", vmSize);
+    print("VmExe  = %lld kB\n", vmExe);
+    print("VmLib  = %lld kB\n", vmLib);
+}
+
+void Collector::sectionChecksums()
+{
+    //Without section headers there is nothing to sum
+    endChecksum();
+    if (checksums.empty())
+        return;
+
+    //The checksums section is the last one and it is not summed itself
+    print("\n[---rich-core: %s---]\n", "checksums");
+    write(checksums.data(), checksums.size());
+}
+
+bool Collector::updatePackageList()
+{
+    std::string key = packageListKey();
+    if (key.empty())
+        return false;
+
+    int fd = openPackageList(key);
+    if (fd >= 0)
+    {
+        close(fd);
+        return true;
+    }
+
+    std::string list;
+    createPackageList(list);
+    return savePackageList(key, list);
+}
+
+std::string Collector::packageListKey()
+{
+    struct stat buf;
+    if ((stat(DPKG_STATUS, &buf) != 0) || !S_ISREG(buf.st_mode))
+        return "";
+
+    char key[128];
+    snprintf(key, sizeof(key), "dpkg-status %llu %llu %lld %ld.%09ld\n", (unsigned long long)buf.st_dev,
+             (unsigned long long)buf.st_ino, (long long)buf.st_size, (long)buf.st_mtim.tv_sec,
+             (long)buf.st_mtim.tv_nsec);
+    return key;
+}
+
+void Collector::createPackageList(std::string &list)
+{
+    FILE *file = fopen(DPKG_STATUS, "r");
+    if (!file)
+        return;
+
+    //One "package version" line per package, without the translations and the debug symbols
+    std::vector<std::string> packages;
+    std::string package;
+    char line[4096];
+    while (fgets(line, sizeof(line), file))
+    {
+        char value[4096];
+        if (sscanf(line, "Package: %4095s", value) == 1)
+        {
+            package = value;
+        }
+        else if ((sscanf(line, "Version: %4095s", value) == 1) && !package.empty())
+        {
+            std::string entry = package + " " + value;
+            if ((entry.find("-l10n") == std::string::npos) && (entry.find("-dbg") == std::string::npos))
+                packages.push_back(entry);
+            package.clear();
+        }
+    }
+    fclose(file);
+
+    std::sort(packages.begin(), packages.end());
+    for (unsigned int i = 0; i < packages.size(); i++)
+    {
+        list += packages.at(i);
+        list += '\n';
+    }
+}
+
+bool Collector::savePackageList(const std::string &key, const std::string &list)
+{
+    //Written to a temporary file and renamed, so a crash at the same time never sees half a list
+    mkdir(CACHE_DIRECTORY, 0755);
+    char temporary[PATH_MAX];
+    snprintf(temporary, sizeof(temporary), "%s.%d", PACKAGE_LIST_CACHE, (int)getpid());
+    FILE *file = fopen(temporary, "w");
+    if (!file)
+        return false;
+
+    bool success = (fwrite(key.data(), 1, key.size(), file) == key.size())
+                   && (fwrite(list.data(), 1, list.size(), file) == list.size());
+    success = (fclose(file) == 0) && success;
+    if (!success || (rename(temporary, PACKAGE_LIST_CACHE) != 0))
+    {
+        unlink(temporary);
+        return false;
+    }
+    return true;
+}
+
+int Collector::openPackageList(const std::string &key)
+{
+    int fd = open(PACKAGE_LIST_CACHE, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    std::string header(key.size(), '\0');
+    if ((read(fd, &header[0], header.size()) != (ssize_t)header.size()) || (header != key))
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void Collector::countRichCore()
+{
+    mkdir("/var/lib/dsme", 0755);
+    mkdir(COUNTER_DIRECTORY, 0755);
+
+    std::string counterFile = std::string(COUNTER_DIRECTORY "/") + name;
+    long count = strtol(readLine(counterFile.c_str()).c_str(), NULL, 10);
+    FILE *file = fopen(counterFile.c_str(), "w");
+    if (!file)
+        return;
+    fprintf(file, "%ld\n", count + 1);
+    fclose(file);
+}
+
+std::string Collector::sysinfoValue(const char *key)
+{
+    //The values do not change until the next boot, so they are normally read from the snapshot
+    if (!isSysinfoRead)
+    {
+        isSysinfoRead = true;
+        if (!readSysinfoSnapshot())
+        {
+            collectSysinfo();
+            writeSysinfoSnapshot();
+        }
+    }
+
+    std::map<std::string, std::string>::const_iterator value = sysinfo.find(key);
+    return (value != sysinfo.end()) ? value->second : std::string();
+}
+
+bool Collector::updateSysinfo()
+{
+    collectSysinfo();
+    isSysinfoRead = true;
+    return writeSysinfoSnapshot();
+}
+
+bool Collector::readSysinfoSnapshot()
+{
+    int fd = open(SYSINFO_SNAPSHOT, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct stat buf;
+    void *data = MAP_FAILED;
+    if ((fstat(fd, &buf) == 0) && (buf.st_size > 0))
+        data = mmap(NULL, buf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+
+    //name=value lines
+    std::map<std::string, std::string> values;
+    const char *position = (const char *)data;
+    const char *end = position + buf.st_size;
+    while (position < end)
+    {
+        const char *lineEnd = (const char *)memchr(position, '\n', end - position);
+        if (!lineEnd)
+            lineEnd = end;
+        const char *separator = (const char *)memchr(position, '=', lineEnd - position);
+        if (separator)
+            values[std::string(position, separator)] = std::string(separator + 1, lineEnd);
+        position = lineEnd + 1;
+    }
+    munmap(data, buf.st_size);
+
+    std::string bootId = readLine(BOOT_ID_FILE);
+    if (bootId.empty() || (values[BOOT_ID_KEY] != bootId))
+        return false;
+
+    sysinfo.swap(values);
+    return true;
+}
+
+void Collector::collectSysinfo()
+{
+    sysinfo.clear();
+    if (access(SYSINFOD_VALUES, F_OK) != 0)
+    {
+        const char *sysinfod[] = { SYSINFOD, "--static", NULL };
+        runQuietly(sysinfod);
+    }
+
+    //The values are stored one per line as name=value
+    FILE *file = fopen(SYSINFOD_VALUES, "r");
+    char line[1024];
+    while (file && fgets(line, sizeof(line), file))
+    {
+        char *separator = strchr(line, '=');
+        if (!separator)
+            continue;
+        line[strcspn(line, "\n")] = '\0';
+        sysinfo[std::string(line, separator)] = separator + 1;
+    }
+    if (file)
+        fclose(file);
+
+    sysinfo[MANFID_KEY] = readLine(MANFID_FILE);
+    sysinfo[BOOT_ID_KEY] = readLine(BOOT_ID_FILE);
+}
+
+bool Collector::writeSysinfoSnapshot() const
+{
+    std::map<std::string, std::string>::const_iterator bootId = sysinfo.find(BOOT_ID_KEY);
+    if ((bootId == sysinfo.end()) || bootId->second.empty())
+        return false;
+
+    //Written to a temporary file and renamed, a crash at the same time reads either snapshot in full
+    char temporary[PATH_MAX];
+    snprintf(temporary, sizeof(temporary), "%s.%d", SYSINFO_SNAPSHOT, (int)getpid());
+    FILE *file = fopen(temporary, "w");
+    if (!file)
+        return false;
+
+    for (std::map<std::string, std::string>::const_iterator i = sysinfo.begin(); i != sysinfo.end(); ++i)
+        fprintf(file, "%s=%s\n", i->first.c_str(), i->second.c_str());
+    if ((fclose(file) != 0) || (rename(temporary, SYSINFO_SNAPSHOT) != 0))
+    {
+        unlink(temporary);
+        return false;
+    }
+    return true;
+}
+
+long long Collector::freeSpace(const char *path)
+{
+    struct statvfs buf;
+    if (statvfs(path, &buf) != 0)
+        return -1;
+    return (long long)buf.f_bavail * buf.f_frsize / 1024;
+}
+
+bool Collector::readFile(const char *fileName, std::string &contents)
+{
+    int fd = open(fileName, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    //The files in /proc have a size of 0, so they are read to the end
+    contents.clear();
+    char buffer[COPY_BUFFER_SIZE];
+    ssize_t length;
+    while (((length = read(fd, buffer, sizeof(buffer))) > 0) || ((length < 0) && (errno == EINTR)))
+    {
+        if (length > 0)
+            contents.append(buffer, length);
+    }
+    close(fd);
+    return length == 0;
+}
+
+std::string Collector::readLine(const char *fileName)
+{
+    FILE *file = fopen(fileName, "r");
+    if (!file)
+        return std::string();
+
+    std::string result;
+    char buffer[4096];
+    if (fgets(buffer, sizeof(buffer), file))
+        result = buffer;
+    fclose(file);
+
+    return result.substr(0, result.find('\n'));
+}
+
+void Collector::print(const char *format, ...)
+{
+    char *text = NULL;
+    va_list args;
+    va_start(args, format);
+    int length = vasprintf(&text, format, args);
+    va_end(args);
+
+    if (length > 0)
+        write(text, length);
+    free(text);
+}
+
+bool Collector::write(const char *data, size_t size)
+{
+    //The section threads collect in to their own buffer, only the main thread writes to the rich core
+    Section *section = (Section *)pthread_getspecific(sectionKey);
+    if (!section)
+    {
+        if (isSummed)
+        {
+            sectionChecksum = crc32c_update(sectionChecksum, data, size);
+            sectionSize += size;
+        }
+        return output.write(data, size);
+    }
+
+    pthread_mutex_lock(&section->lock);
+    bool isFull = section->isAbandoned || section->isTruncated;
+    if (!isFull)
+    {
+        size_t room = section->type->sizeLimit - section->data.size();
+        if (size > room)
+        {
+            size = room;
+            section->isTruncated = isFull = true;
+        }
+        section->data.append(data, size);
+    }
+    pthread_mutex_unlock(&section->lock);
+    return !isFull;
+}
+
+void Collector::printHeader(const std::string &name)
+{
+    //A section thread marks its headers, the checksums are made when the main thread writes its output
+    Section *section = (Section *)pthread_getspecific(sectionKey);
+    if (section)
+    {
+        SectionHeader header;
+        header.name = name;
+        std::string text = "\n[---rich-core: " + name + "---]\n";
+        header.size = text.size();
+        pthread_mutex_lock(&section->lock);
+        header.position = section->data.size();
+        section->headers.push_back(header);
+        pthread_mutex_unlock(&section->lock);
+        write(text.data(), text.size());
+        return;
+    }
+
+    //The header and the newline before it are not part of the section when it is extracted
+    endChecksum();
+    print("\n[---rich-core: %s---]\n", name.c_str());
+    startChecksum(name);
+}
+
+void Collector::writeSection(const std::string &data, const std::vector<SectionHeader> &headers)
+{
+    size_t written = 0;
+    for (unsigned int i = 0; i < headers.size(); i++)
+    {
+        //A header that was cut off by the size limit is just data
+        const SectionHeader &header = headers.at(i);
+        if (header.position + header.size > data.size())
+            break;
+        write(data.data() + written, header.position - written);
+        endChecksum();
+        write(data.data() + header.position, header.size);
+        startChecksum(header.name);
+        written = header.position + header.size;
+    }
+    write(data.data() + written, data.size() - written);
+}
+
+void Collector::endChecksum()
+{
+    if (!isSummed)
+        return;
+
+    char line[64];
+    snprintf(line, sizeof(line), "%08x %llu ", (unsigned int)sectionChecksum, sectionSize);
+    checksums += line;
+    checksums += summedSection;
+    checksums += '\n';
+    isSummed = false;
+}
+
+void Collector::startChecksum(const std::string &name)
+{
+    summedSection = name;
+    sectionChecksum = 0;
+    sectionSize = 0;
+    isSummed = true;
+}
+
+void Collector::printSeparator(const std::string &name)
+{
+    print("\n--- %s ---\n", name.c_str());
+}
+
+bool Collector::printFile(const std::string &fileName, bool withHeader)
+{
+    //Only regular files, the files in /proc have a size of 0 so they are read to the end
+    struct stat buf;
+    if ((stat(fileName.c_str(), &buf) != 0) || !S_ISREG(buf.st_mode))
+        return false;
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    if (withHeader)
+        printHeader(fileName);
+    bool success = copyFd(fd);
+    close(fd);
+    return success;
+}
+
+bool Collector::copyCore(int fd)
+{
+    //The core starts a block, and so does each of its segments if it is an ELF core
+    output.endBlock();
+    std::vector<off_t> boundaries;
+    std::vector<char> buffer(COPY_BUFFER_SIZE);
+    off_t offset = 0;
+    bool isFirst = true;
+    while (true)
+    {
+        ssize_t length = read(fd, &buffer[0], buffer.size());
+        if (length == 0)
+            return true;
+        if (length < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+
+        //The program headers follow the ELF header in the cores written by the kernel and the reducer
+        if (isFirst)
+        {
+            isFirst = false;
+            findSegmentBoundaries(&buffer[0], length, boundaries);
+        }
+
+        const char *data = &buffer[0];
+        while (length > 0)
+        {
+            while (!boundaries.empty() && (boundaries.back() <= offset))
+                boundaries.pop_back();
+            ssize_t part = length;
+            if (!boundaries.empty() && (boundaries.back() < offset + length))
+                part = boundaries.back() - offset;
+            if (!write(data, part))
+                return false;
+            data += part;
+            length -= part;
+            offset += part;
+            if (!boundaries.empty() && (boundaries.back() == offset))
+                output.endBlock();
+        }
+    }
+}
+
+void Collector::findSegmentBoundaries(const char *data, size_t size, std::vector<off_t> &boundaries)
+{
+    //Only cores of the native class are split
+    const Ehdr *header = (const Ehdr *)data;
+    if ((size < sizeof(Ehdr)) || (memcmp(header->e_ident, ELFMAG, SELFMAG) != 0)
+        || (header->e_ident[EI_CLASS] != ((sizeof(Ehdr) == sizeof(Elf64_Ehdr)) ? ELFCLASS64 : ELFCLASS32))
+        || (header->e_phentsize != sizeof(Phdr)) || (header->e_phoff > size)
+        || (header->e_phnum > (size - header->e_phoff) / sizeof(Phdr)))
+        return;
+
+    const Phdr *headers = (const Phdr *)(data + header->e_phoff);
+    for (unsigned int i = 0; i < header->e_phnum; i++)
+    {
+        if (headers[i].p_filesz && headers[i].p_offset)
+            boundaries.push_back(headers[i].p_offset);
+    }
+
+    //Sorted from the last to the first, so the next one can be taken from the back
+    std::sort(boundaries.begin(), boundaries.end(), std::greater<off_t>());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+}
+
+bool Collector::copyFd(int fd)
+{
+    char buffer[COPY_BUFFER_SIZE];
+    while (true)
+    {
+        ssize_t length = read(fd, buffer, sizeof(buffer));
+        if (length == 0)
+            return true;
+        if (length < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        //Stop reading once the section is full
+        if (!write(buffer, length))
+            return false;
+    }
+}
+
+void Collector::printCommand(const char *const argv[], bool withHeader)
+{
+    if (access(argv[0], X_OK) != 0)
+        return;
+
+    //Not inherited by the commands of the other sections, or they would keep the pipe open
+    int pipes[2];
+    if (pipe2(pipes, O_CLOEXEC) != 0)
+        return;
+
+    pid_t child = fork();
+    if (child == 0)
+    {
+        //In its own process group so that whatever the command starts is stopped with it
+        setpgid(0, 0);
+        dup2(pipes[1], STDOUT_FILENO);
+        dup2(pipes[1], STDERR_FILENO);
+        close(pipes[0]);
+        close(pipes[1]);
+        execv(argv[0], (char *const *)argv);
+        _exit(127);
+    }
+
+    close(pipes[1]);
+    if (child > 0)
+    {
+        //Also set here, so the group exists before the command could be killed
+        setpgid(child, child);
+
+        //The command is killed if the section runs out of time
+        Section *section = (Section *)pthread_getspecific(sectionKey);
+        if (section)
+        {
+            pthread_mutex_lock(&section->lock);
+            section->child = child;
+            if (section->isAbandoned)
+                kill(-child, SIGKILL);
+            pthread_mutex_unlock(&section->lock);
+        }
+
+        if (withHeader)
+            printHeader(strrchr(argv[0], '/') + 1);
+        if (!copyFd(pipes[0]))
+            kill(-child, SIGKILL);
+        waitpid(child, NULL, 0);
+
+        if (section)
+        {
+            pthread_mutex_lock(&section->lock);
+            section->child = 0;
+            pthread_mutex_unlock(&section->lock);
+        }
+    }
+    close(pipes[0]);
+}
+
+void Collector::runQuietly(const char *const argv[])
+{
+    pid_t child = fork();
+    if (child == 0)
+    {
+        int null = open("/dev/null", O_RDWR);
+        if (null >= 0)
+        {
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+        execv(argv[0], (char *const *)argv);
+        _exit(127);
+    }
+    if (child > 0)
+        waitpid(child, NULL, 0);
+}
+
+void Collector::applyPolicy()
+{
+    ReductionPolicy policy;
+    if (!policy.load(policyFile.c_str()))
+        return;
+
+    ReductionPolicy::Settings settings = policy.match(executable, name);
+    reduction.apply(settings);
+    if (settings.has(ReductionPolicy::Settings::Reduce))
+        isCoreReduced = settings.isReduced;
+    if (settings.has(ReductionPolicy::Settings::StackDepth))
+        stackDepth = settings.stackDepth;
+    //The heap is only in the whole core, the memory read from the process has just what the reducer always keeps
+    if (reduction.heapDepth)
+        isMemoryReduced = false;
+}
+
+bool Collector::snapshotCore()
+{
+    //The kernel writes the notes first and keeps the memory of the process until the rest of the core is read
+    snapshot.setCodeWindow(reduction.codeWindow);
+    snapshot.setMappingPatterns(reduction.mappings);
+    if (!ProcessSnapshot::readCoreStart(STDIN_FILENO, coreStart)
+        || !snapshot.capture(pid, coreStart.data(), coreStart.size()))
+    {
+        char error[128];
+        snprintf(error, sizeof(error), "The memory of process %d could not be read, the core was %s.", pid,
+                 isCopyOmitted ? "left out" : "copied");
+        errors.push_back(error);
+        return false;
+    }
+
+    discardInput();
+    return true;
+}
+
+bool Collector::saveInput(const char *fileName, const std::string &start)
+{
+    int fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0)
+        LOG_RETURN(LOG_ERR, false, "Opening file '%s' failed.", fileName);
+
+    char buffer[COPY_BUFFER_SIZE];
+    bool success = true;
+    for (size_t written = 0; written < start.size();)
+    {
+        ssize_t result = ::write(fd, start.data() + written, start.size() - written);
+        if (result > 0)
+            written += result;
+        else if ((result < 0) && (errno != EINTR))
+        {
+            success = false;
+            break;
+        }
+    }
+
+    while (success)
+    {
+        ssize_t length = read(STDIN_FILENO, buffer, sizeof(buffer));
+        if ((length < 0) && (errno == EINTR))
+            continue;
+        if (length <= 0)
+        {
+            success = (length == 0);
+            break;
+        }
+
+        for (ssize_t written = 0; success && (written < length);)
+        {
+            ssize_t result = ::write(fd, buffer + written, length - written);
+            if (result > 0)
+                written += result;
+            else if ((result < 0) && (errno != EINTR))
+                success = false;
+        }
+    }
+
+    if ((close(fd) != 0) || !success)
+        LOG_RETURN(LOG_ERR, false, "Writing the core to '%s' failed.", fileName);
+    return true;
+}
+
+void Collector::discardInput()
+{
+    char buffer[COPY_BUFFER_SIZE];
+    ssize_t length;
+    while (((length = read(STDIN_FILENO, buffer, sizeof(buffer))) > 0) || ((length < 0) && (errno == EINTR)))
+        ;
+}
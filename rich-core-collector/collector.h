@@ -0,0 +1,569 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file collector.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Collector
+  * \brief Create a rich core from a core dump that is piped in on stdin.
+  * The sections that rich-core-dumper used to gather with shell commands are read directly from /proc,
+  * /sys and the file system and written with the [---rich-core: name---] framing to an lzop compressed
+  * file.  The core itself is reduced in the same process.  Only the tools that have no file to read
+  * from (proc2csv and sysinfod) are still run as commands.  Only the end of the logs is included.
+  * The sections are collected at the same time, each by a thread of its own, and are written in their
+  * fixed order.  The sections of the process are finished before the core is read, as the kernel keeps
+  * the crashed process only until then.  Each section has a deadline and a size limit, a section that does not finish in time
+  * or grows too large is cut short and marked as such instead of holding up the rich core.
+  * The collectors of crashes that happen at the same time are limited by a Governor, a capture that
+  * does not fit in the limits waits for the others and is then degraded to the process sections and
+  * the stacks of the reduced core.
+  * The CRC-32C of each section is calculated as it is written and the checksums are listed in a last
+  * checksums section, so that rich-core-extract can find a damaged rich core.
+  */
+
+#ifndef COLLECTOR_H
+#define COLLECTOR_H
+
+#include "governor.h"
+#include "lzopwriter.h"
+#include "processsnapshot.h"
+#include "reductionpolicy.h"
+#include "tailreader.h"
+#include <pthread.h>
+#include <time.h>
+#include <sys/types.h>
+#include <map>
+#include <string>
+#include <vector>
+
+class Collector
+{
+public:
+    /*!
+      * \brief Constructor
+      */
+    Collector();
+
+    /*!
+      * \brief Destructor
+      */
+    ~Collector();
+
+    /*!
+      * \brief Set the crashed process
+      * \param pid The process id, 0 if not known
+      * \param signal The signal that the process was killed with
+      * \param name The name of the process, NULL to take it from the command line of the process
+      */
+    void setProcess(int pid, int signal, const char *name);
+
+    /*!
+      * \brief Set the name to use when the name of the process can not be found
+      */
+    void setDefaultName(const char *name) { defaultName = name; }
+
+    /*!
+      * \brief Copy the input as it is, without a section header, after the other sections
+      */
+    void setNoSectionHeader(bool enable) { isNoSectionHeader = enable; }
+
+    /*!
+      * \brief The input is a kernel oops log instead of a core dump
+      */
+    void setOopsLog(bool enable) { isOopsLog = enable; }
+
+    /*!
+      * \brief Select the optional parts of the rich core
+      * \param core Include the core dump
+      * \param reduce Reduce the core dump with the core reducer
+      * \param syslog Include the system logs
+      * \param packageList Include the list of installed packages
+      */
+    void setIncludes(bool core, bool reduce, bool syslog, bool packageList);
+
+    /*!
+      * \brief Set the options of the core reducer
+      * \param stackDepth Bytes of stack kept for the threads other than the crashing one, 0 keeps all
+      * \param format The format of the reduced core, "elf" or "minidump"
+      */
+    void setReducedCore(size_t stackDepth, const char *format);
+
+    /*!
+      * \brief Set where the core reducer reads the memory of the process from
+      * \param memory true to take only the notes of the core and the memory from /proc/pid/mem,
+      * false to copy the whole core to a file first
+      */
+    void setMemoryReduced(bool memory) { isMemoryReduced = memory; }
+
+    /*!
+      * \brief Set the policy file with the reducer settings of each executable
+      */
+    void setPolicyFile(const char *fileName) { policyFile = fileName; }
+
+    /*!
+      * \brief Set the note types of the core that are kept in the reduced core, the policy file overrides them
+      * \param notes The types as given to Reducer::setNoteFilter()
+      * \return true on success, false if a type is not known
+      */
+    bool setReducedNotes(const char *notes) { return reduction.set("notes", notes); }
+
+    /*!
+      * \brief Set the number of threads that compress the rich core
+      * \param count The number of threads, 1 compresses in the main thread, 0 uses a thread per processor
+      */
+    void setCompressThreads(unsigned int count);
+
+    /*!
+      * \brief Set the limits of the captures that run at the same time
+      */
+    void setCaptureLimits(const Governor::Limits &limits) { governor.setLimits(limits); }
+
+    /*!
+      * \brief Set the CPU and I/O priority and the cgroup of the capture
+      */
+    void setCapturePriority(const Governor::Priority &priority) { governor.setPriority(priority); }
+
+    /*!
+      * \brief Set how much of a log is included
+      * \param source The log, "syslog", "xorg" or "dmesg"
+      * \param limits The lines, bytes and seconds from the end of the log to include
+      * \return true on success, false if \a source is not known
+      */
+    bool setTailLimits(const char *source, const TailReader::Limits &limits);
+
+    /*!
+      * \brief Set how the memory mappings of the process are included
+      * \param format "binary" for smaps as a binary table, "summary" for maps and smaps_rollup, "text" for
+      *        smaps as it is
+      * \return true on success, false if \a format is not known
+      */
+    bool setSmapsFormat(const char *format);
+
+    /*!
+      * \brief Create the rich core
+      * \return 0 when the rich core was written or was not wanted, -1 on errors
+      */
+    int run();
+
+    /*!
+      * \brief Bring the cached package list up to date with the dpkg status
+      * Run at boot, so that the list does not need to be created when something crashes.
+      * \return true if the cache is up to date, false if it could not be written
+      */
+    static bool updatePackageList();
+
+    /*!
+      * \brief Write the snapshot of the static system information for the rich cores of this boot
+      * Run at boot, so that the values do not need to be collected when something crashes.
+      * \return true on success, false if the snapshot could not be written
+      */
+    bool updateSysinfo();
+
+private:
+    /*!
+      * \brief A kind of section and the limits of collecting it
+      */
+    struct SectionType
+    {
+        const char *name;              //!< The name used in the error messages
+        void (Collector::*collect)();  //!< Writes the section
+        long timeout;                  //!< Milliseconds from the start of the collection until it is given up
+        size_t sizeLimit;              //!< The largest size of the section in bytes
+        bool isProcessSection;         //!< Only collected when there is a crashed process
+        bool isCoreSection;            //!< Not collected for oopslogs
+    };
+
+    /*!
+      * \brief A section header that a section thread wrote in to its output
+      */
+    struct SectionHeader
+    {
+        size_t position;           //!< The position of the header in the output
+        size_t size;               //!< The size of the header
+        std::string name;          //!< The name of the section that the header starts
+    };
+
+    /*!
+      * \brief A section that is being collected by a thread of its own
+      * The section is deleted by the collector once it is written, or by its thread if it was given up.
+      */
+    struct Section
+    {
+        const SectionType *type;   //!< The kind of the section
+        Collector *collector;      //!< The collector the section belongs to
+        pthread_mutex_t lock;      //!< Protects the rest of the members
+        pthread_cond_t finished;   //!< Signaled when \a isFinished is set
+        std::string data;          //!< The collected output
+        std::vector<SectionHeader> headers; //!< The headers in \a data, the checksums restart at each
+        bool isFinished;           //!< true once the thread is done
+        bool isTruncated;          //!< true if the output reached the size limit
+        bool isAbandoned;          //!< true if the deadline passed, later output is dropped
+        pid_t child;               //!< A command that the section is running, 0 if none
+    };
+
+    /*!
+      * \brief Start collecting a section in a new thread
+      * \return The section, collected already if no thread could be started
+      */
+    Section *startSection(const SectionType &type);
+
+    /*!
+      * \brief Wait until a section is finished or its deadline passes and write it to the rich core
+      */
+    void finishSection(Section *section);
+
+    /*!
+      * \brief The thread function that collects a section
+      */
+    static void *collectSection(void *data);
+
+    /*!
+      * \brief Release a section
+      */
+    static void deleteSection(Section *section);
+
+    /*!
+      * \brief Determine if the core is to be reduced
+      */
+    bool isCoreReducing() const;
+
+    /*!
+      * \brief Determine if a section is collected
+      * \param type The kind of the section
+      * \param degraded true if the capture is degraded
+      */
+    bool isSectionWanted(const SectionType &type, bool degraded) const;
+
+    /*!
+      * \brief Estimate the memory that the capture uses at most
+      * \param degraded true to estimate the degraded capture
+      * \param threads The number of threads that compress the rich core
+      * \return The memory in kilobytes
+      */
+    unsigned long estimateMemoryKb(bool degraded, unsigned int threads) const;
+
+    /*!
+      * \brief Wait for the governor to admit the capture and degrade it if it has to
+      * \param threads The number of threads that compress the rich core, set to 1 if the capture is degraded
+      * \return true if the capture is done, false if it was rejected
+      */
+    bool admitCapture(unsigned int &threads);
+
+    /*!
+      * \brief Find the directory to write the rich core to
+      * \return true if there is a directory with enough space on a vfat file system
+      */
+    bool findCoreLocation();
+
+    /*!
+      * \brief Check if there is room for the temporary copy of the core that the reducer needs
+      * Sets \a isCoreOmitted if there is not, or \a isCopyOmitted when the copy is only a fallback.
+      * \return false if the memory use of the process can not be read
+      */
+    bool checkCoreSize();
+
+    /*!
+      * \brief Find the executable and the name of the crashed process
+      */
+    void findProcessName();
+
+    /*!
+      * \brief Check the name of the process against /etc/rich-core.include and /etc/rich-core.exclude
+      * \return true if a rich core should be created
+      */
+    bool isWanted();
+
+    /*!
+      * \brief Create the name of the rich core from the process and device information
+      */
+    void createFileName();
+
+    //! \name Sections of the rich core, in the order they are written
+    //@{
+    void sectionCmdline();
+    void sectionListProc();
+    void sectionListFd();
+    void sectionSmaps();
+    void sectionDate();
+    void sectionComponentVersion();
+    void sectionDf();
+    void sectionIfconfig();
+    void sectionExtraFiles();
+    void sectionSlabinfo();
+    void sectionProc2csv();
+    void sectionSyslog();
+    void sectionProductInfo();
+    void sectionPackageList();
+    void sectionCore();
+    void sectionRichCoreErrors();
+    void sectionChecksums();
+    //@}
+
+    /*!
+      * \brief Write the ls -l listing of a directory as a section
+      */
+    void listDirectory(const char *header, const std::string &directory);
+
+    /*!
+      * \brief Reduce the core dump that is piped in and add it to the rich core
+      * \return true on success, false if the core was not reduced
+      */
+    bool reduceCore();
+
+    /*!
+      * \brief Read a value from the static values cached by sysinfod
+      * \param key The name of the value, e.g. /component/hw-build
+      * \return The value or an empty string if it is not known
+      */
+    std::string sysinfoValue(const char *key);
+
+    /*!
+      * \brief Read the snapshot of the static system information
+      * \return true if the snapshot exists and was written during this boot, false otherwise
+      */
+    bool readSysinfoSnapshot();
+
+    /*!
+      * \brief Collect the static system information from sysinfod and /sys
+      */
+    void collectSysinfo();
+
+    /*!
+      * \brief Write the static system information to the snapshot
+      * \return true on success, false otherwise
+      */
+    bool writeSysinfoSnapshot() const;
+
+    /*!
+      * \brief Identify the current dpkg status by its device, inode, size and modification time
+      * \return The first line of a package list cache that matches the status, empty if there is no status
+      */
+    static std::string packageListKey();
+
+    /*!
+      * \brief Create the sorted package list from the dpkg status
+      * \param list Set to one "package version" line per package
+      */
+    static void createPackageList(std::string &list);
+
+    /*!
+      * \brief Replace the package list cache
+      * \param key The dpkg status the list was created from, see packageListKey()
+      * \param list The package list
+      * \return true on success, false otherwise
+      */
+    static bool savePackageList(const std::string &key, const std::string &list);
+
+    /*!
+      * \brief Open the package list cache if it matches the dpkg status
+      * \param key The current dpkg status, see packageListKey()
+      * \return A descriptor positioned at the start of the list, -1 if the cache is missing or out of date
+      */
+    static int openPackageList(const std::string &key);
+
+    /*!
+      * \brief Get the space available to users in a file system in kilobytes
+      * \param path A path on the file system
+      * \return The available space, or -1 on error
+      */
+    static long long freeSpace(const char *path);
+
+    /*!
+      * \brief Read a whole file
+      * \return true on success, false if the file can not be read
+      */
+    static bool readFile(const char *fileName, std::string &contents);
+
+    /*!
+      * \brief Read the first line of a file
+      * \return The line without the new line, empty if the file can not be read
+      */
+    static std::string readLine(const char *fileName);
+
+    //! \name Writing to the rich core
+    //@{
+    void print(const char *format, ...) __attribute__ ((format (printf, 2, 3)));
+    bool write(const char *data, size_t size);
+    void printHeader(const std::string &name);
+    void printSeparator(const std::string &name);
+    bool printFile(const std::string &fileName, bool withHeader);
+    bool copyFd(int fd);
+    bool copyCore(int fd);
+    void printCommand(const char *const argv[], bool withHeader);
+    //@}
+
+    /*!
+      * \brief Write the output of a section thread, restarting the checksum at each of its headers
+      */
+    void writeSection(const std::string &data, const std::vector<SectionHeader> &headers);
+
+    /*!
+      * \brief Add the checksum of the section that is being written to \a checksums
+      */
+    void endChecksum();
+
+    /*!
+      * \brief Start the checksum of a section, all that is written until the next header is summed
+      */
+    void startChecksum(const std::string &name);
+
+    /*!
+      * \brief Find the file offsets of the segments of an ELF core
+      * \param data The start of the core, with the program headers
+      * \param size The size of \a data in bytes
+      * \param boundaries Set to the offsets, from the last to the first
+      */
+    static void findSegmentBoundaries(const char *data, size_t size, std::vector<off_t> &boundaries);
+
+    /*!
+      * \brief Run a command with its output discarded
+      * \param argv The path of the command and its arguments, NULL terminated
+      */
+    static void runQuietly(const char *const argv[]);
+
+    /*!
+      * \brief Copy the input to a file
+      * \param fileName The file to write
+      * \param start What was already read of the input, written first
+      * \return true on success, false otherwise
+      */
+    static bool saveInput(const char *fileName, const std::string &start);
+
+    /*!
+      * \brief Apply the rules of the policy file that match the process
+      */
+    void applyPolicy();
+
+    /*!
+      * \brief Read the notes of the core and the memory the reducer needs from the process, then drain the input
+      * \return true if the memory was read, false if the core has to be copied instead
+      */
+    bool snapshotCore();
+
+    /*!
+      * \brief Find the lists of extra files for the process under a directory
+      * \param directory The directory to search, including its sub directories
+      * \param lists Set to the paths of the lists that were found
+      */
+    void findExtraLists(const std::string &directory, std::vector<std::string> &lists);
+
+    /*!
+      * \brief Count the rich cores of each application in /var/lib/dsme/rich-cores
+      */
+    void countRichCore();
+
+    /*!
+      * \brief Read and discard the input, the kernel waits for it to be read
+      */
+    static void discardInput();
+
+private:
+    //! The compressed rich core
+    LzopWriter output;
+    //! Limits the captures that run at the same time
+    Governor governor;
+    //! true if the capture was degraded by the governor
+    bool isDegraded;
+    //! The process id of the crashed process, 0 if not known
+    int pid;
+    //! The signal the process was killed with
+    int signal;
+    //! The name of the process
+    std::string name;
+    //! The name used when the name of the process is not known
+    std::string defaultName;
+    //! The full path of the executable
+    std::string executable;
+    //! The directory the rich core is written to
+    std::string coreLocation;
+    //! The name of the rich core without the .rcore.lzo suffix
+    std::string richCoreName;
+    //! true to copy the input without a section header
+    bool isNoSectionHeader;
+    //! true if the input is an oops log
+    bool isOopsLog;
+    //! Include the core dump
+    bool isCoreIncluded;
+    //! Reduce the core dump
+    bool isCoreReduced;
+    //! Include the system logs
+    bool isSyslogIncluded;
+    //! Include the list of installed packages
+    bool isPackageListIncluded;
+    //! Bytes of stack kept for the threads that did not crash
+    size_t stackDepth;
+    //! The format of the reduced core
+    std::string coreFormat;
+    //! The number of threads that compress the rich core
+    unsigned int compressThreads;
+    //! How the memory mappings are included, "binary", "summary" or "text"
+    std::string smapsFormat;
+    //! The parts of the logs that are included
+    TailReader::Limits syslogLimits, xorgLimits, dmesgLimits;
+    //! true if the core is left out because it would not fit
+    bool isCoreOmitted;
+    //! The free space in the core location in kilobytes
+    long long freeSpaceKb;
+    //! The approximate size of the core in kilobytes
+    long long coreSizeKb;
+    //! The VmSize, VmExe and VmLib of the process in kilobytes
+    long long vmSize, vmExe, vmLib;
+    //! The static values of sysinfod by their name
+    std::map<std::string, std::string> sysinfo;
+    //! true once \a sysinfo has been read
+    bool isSysinfoRead;
+    //! true if the core was copied to a file while the sections were collected
+    bool isCoreSaved;
+    //! Reduce the core from the memory of the process instead of a copy of the core
+    bool isMemoryReduced;
+    //! true if the copy of the core would not fit, in case reading the memory of the process fails
+    bool isCopyOmitted;
+    //! true if \a snapshot holds the memory of the process that the reducer needs
+    bool isCoreSnapshot;
+    //! What was read of the core before the memory of the process
+    std::string coreStart;
+    //! The notes of the core and the memory of the process that the reducer needs
+    ProcessSnapshot snapshot;
+    //! The policy file with the reducer settings of each executable
+    std::string policyFile;
+    //! The settings of the reducer for the process
+    ReductionPolicy::Settings reduction;
+    //! The time the collection of the sections started, the deadlines are relative to it
+    struct timespec collectionStart;
+    //! The sections that were cut short
+    std::vector<std::string> errors;
+    //! true while a section is being written, false before the first header and while a header is written
+    bool isSummed;
+    //! The name of the section that is being written
+    std::string summedSection;
+    //! The CRC-32C of what has been written of the section
+    uint32_t sectionChecksum;
+    //! The bytes that have been written of the section
+    unsigned long long sectionSize;
+    //! The text of the checksums section, a line for each section that has been written
+    std::string checksums;
+    //! The kinds of sections, in the order they are written
+    static const SectionType sectionTypes[];
+};
+
+#endif // COLLECTOR_H
@@ -0,0 +1,390 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "governor.h"
+#include "defines.h"
+
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+#ifndef GOVERNOR_STATE
+//! The state of the captures, shared by all of the collectors and cleared at boot, the unit tests use their own
+#define GOVERNOR_STATE "/var/run/rich-core-captures"
+#endif
+//! Milliseconds between the checks of a queued capture
+#define QUEUE_POLL_INTERVAL 100
+
+//! The values of the ioprio_set system call, there is no header for them in the C library
+#define IOPRIO_WHO_PROCESS 1
+#define IOPRIO_CLASS_SHIFT 13
+#define IOPRIO_CLASS_NONE 0
+#define IOPRIO_CLASS_RT 1
+#define IOPRIO_CLASS_BE 2
+#define IOPRIO_CLASS_IDLE 3
+//! The level of a class when none is given, the middle one as the kernel uses
+#define IOPRIO_DEFAULT_LEVEL 4
+
+//! The names of the states in the state file, indexed by Governor::Admission
+static const char *const stateNames[] = { "admitted", "degraded", "rejected", "queued" };
+
+Governor::Governor()
+    : isRegistered(false),
+    running(0),
+    runningMemory(0)
+{
+    limits.captures = 0;
+    limits.memoryKb = 0;
+    limits.queueTimeout = 0;
+    priority.nice = 0;
+    priority.ioClass = IOPRIO_CLASS_NONE;
+    priority.ioLevel = 0;
+}
+
+Governor::~Governor()
+{
+    release();
+}
+
+bool Governor::parseIoClass(const char *ioClass, Priority &priority)
+{
+    static const char *const classNames[] = { "none", "realtime", "best-effort", "idle" };
+    const char *level = strchr(ioClass, ':');
+    size_t length = level ? (size_t)(level - ioClass) : strlen(ioClass);
+
+    for (int i = 0; i < (int)(sizeof(classNames) / sizeof(classNames[0])); i++)
+    {
+        if ((strlen(classNames[i]) != length) || (strncmp(classNames[i], ioClass, length) != 0))
+            continue;
+
+        char *end = NULL;
+        long value = level ? strtol(level + 1, &end, 10) : IOPRIO_DEFAULT_LEVEL;
+        if (level && ((end == level + 1) || *end || (value < 0) || (value > 7)))
+            return false;
+
+        priority.ioClass = i;
+        priority.ioLevel = value;
+        return true;
+    }
+    return false;
+}
+
+bool Governor::applyPriority() const
+{
+    bool success = true;
+
+    //On Linux both of these apply to the calling thread, the threads and processes it starts inherit them
+    if (priority.nice && (setpriority(PRIO_PROCESS, 0, priority.nice) != 0))
+    {
+        LOG(LOG_WARNING, "Setting the nice value %d failed: %s", priority.nice, strerror(errno));
+        success = false;
+    }
+
+    if ((priority.ioClass != IOPRIO_CLASS_NONE)
+        && (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, (priority.ioClass << IOPRIO_CLASS_SHIFT) | priority.ioLevel) != 0))
+    {
+        LOG(LOG_WARNING, "Setting the I/O priority failed: %s", strerror(errno));
+        success = false;
+    }
+
+    if (!priority.cgroup.empty())
+    {
+        //cgroup.procs of the unified hierarchy moves the whole process, tasks of the version 1 hierarchies
+        int fd = open((priority.cgroup + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd < 0)
+            fd = open((priority.cgroup + "/tasks").c_str(), O_WRONLY | O_CLOEXEC);
+
+        char pid[32];
+        int length = snprintf(pid, sizeof(pid), "%d\n", getpid());
+        if ((fd < 0) || (::write(fd, pid, length) != length))
+        {
+            LOG(LOG_WARNING, "Joining the cgroup %s failed: %s", priority.cgroup.c_str(), strerror(errno));
+            success = false;
+        }
+        if (fd >= 0)
+            close(fd);
+    }
+    return success;
+}
+
+Governor::Admission Governor::admit(pid_t crashedPid, const std::string &name, unsigned long memoryKb,
+                                    unsigned long degradedMemoryKb)
+{
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (;;)
+    {
+        int fd = lockState();
+        if (fd < 0)
+            LOG_RETURN(LOG_WARNING, ADMITTED, "The state of the captures can not be read, capturing without limits");
+
+        State state;
+        readState(fd, state);
+        state.limits = limits;
+
+        int index = findCapture(state);
+        if (index < 0)
+        {
+            Capture capture = { getpid(), QUEUED, memoryKb, crashedPid, name };
+            std::replace(capture.name.begin(), capture.name.end(), '\n', ' ');
+            state.captures.push_back(capture);
+            index = state.captures.size() - 1;
+            isRegistered = true;
+        }
+
+        //the queued captures are admitted in the order they arrived in
+        bool isFirst = true;
+        running = 0;
+        runningMemory = 0;
+        for (int i = 0; i < (int)state.captures.size(); i++)
+        {
+            const Capture &capture = state.captures.at(i);
+            if (i == index)
+                continue;
+            if (capture.state == QUEUED)
+                isFirst = isFirst && (i > index);
+            else
+            {
+                running++;
+                runningMemory += capture.memoryKb;
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        unsigned long waited = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+        bool isCountAllowed = !limits.captures || (running < limits.captures);
+        Admission decision = QUEUED;
+        if (isFirst && isCountAllowed && (!limits.memoryKb || (runningMemory + memoryKb <= limits.memoryKb)))
+            decision = ADMITTED;
+        else if (limits.queueTimeout && (waited >= limits.queueTimeout))
+        {
+            //a degraded capture needs little, so it only has to fit in the number of captures
+            decision = isCountAllowed ? DEGRADED : REJECTED;
+        }
+
+        if (decision == REJECTED)
+        {
+            state.captures.erase(state.captures.begin() + index);
+            isRegistered = false;
+        }
+        else if (decision != QUEUED)
+        {
+            state.captures.at(index).state = decision;
+            if (decision == DEGRADED)
+                state.captures.at(index).memoryKb = degradedMemoryKb;
+        }
+        if (decision != QUEUED)
+            state.decisions[decision]++;
+
+        writeState(fd, state);
+        unlockState(fd);
+        if (decision != QUEUED)
+            return decision;
+
+        usleep(QUEUE_POLL_INTERVAL * 1000);
+    }
+}
+
+void Governor::release()
+{
+    if (!isRegistered)
+        return;
+    isRegistered = false;
+
+    int fd = lockState();
+    if (fd < 0)
+        return;
+
+    State state;
+    readState(fd, state);
+    int index = findCapture(state);
+    if (index >= 0)
+    {
+        state.captures.erase(state.captures.begin() + index);
+        writeState(fd, state);
+    }
+    unlockState(fd);
+}
+
+bool Governor::printStatus(FILE *file)
+{
+    int fd = lockState();
+    if (fd < 0)
+        return false;
+
+    State state;
+    readState(fd, state);
+    unlockState(fd);
+
+    unsigned int runningCount = 0, queuedCount = 0;
+    unsigned long memoryKb = 0;
+    for (unsigned int i = 0; i < state.captures.size(); i++)
+    {
+        if (state.captures.at(i).state == QUEUED)
+            queuedCount++;
+        else
+        {
+            runningCount++;
+            memoryKb += state.captures.at(i).memoryKb;
+        }
+    }
+
+    fprintf(file, "captures: %u running, %u queued, limit %u\n", runningCount, queuedCount, state.limits.captures);
+    fprintf(file, "memory: %lu kB, limit %lu kB\n", memoryKb, state.limits.memoryKb);
+    fprintf(file, "queue timeout: %lu ms\n", state.limits.queueTimeout);
+    fprintf(file, "since boot: %lu admitted, %lu degraded, %lu rejected\n", state.decisions[ADMITTED],
+            state.decisions[DEGRADED], state.decisions[REJECTED]);
+    for (unsigned int i = 0; i < state.captures.size(); i++)
+    {
+        const Capture &capture = state.captures.at(i);
+        fprintf(file, "%d %s %lu kB, pid %d %s\n", capture.pid, stateNames[capture.state], capture.memoryKb,
+                capture.crashedPid, capture.name.c_str());
+    }
+    return !ferror(file);
+}
+
+int Governor::lockState()
+{
+    int fd = open(GOVERNOR_STATE, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0)
+        return -1;
+
+    //a record lock is released by the kernel if its owner is killed
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    int result;
+    while (((result = fcntl(fd, F_SETLKW, &lock)) < 0) && (errno == EINTR))
+        ;
+    if (result < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+void Governor::readState(int fd, State &state)
+{
+    memset(&state.limits, 0, sizeof(state.limits));
+    memset(state.decisions, 0, sizeof(state.decisions));
+    state.captures.clear();
+
+    std::string contents;
+    char buffer[4096];
+    ssize_t count;
+    off_t offset = 0;
+    while ((count = pread(fd, buffer, sizeof(buffer), offset)) > 0)
+    {
+        contents.append(buffer, count);
+        offset += count;
+    }
+
+    //limits captures memory-kb queue-ms
+    //decisions admitted degraded rejected
+    //capture pid state memory-kb crashed-pid name
+    size_t start = 0;
+    while (start < contents.size())
+    {
+        size_t end = contents.find('\n', start);
+        if (end == std::string::npos)
+            end = contents.size();
+        std::string line = contents.substr(start, end - start);
+        start = end + 1;
+
+        char stateName[16];
+        int nameStart = 0;
+        Capture capture;
+        if (sscanf(line.c_str(), "limits %u %lu %lu", &state.limits.captures, &state.limits.memoryKb,
+                   &state.limits.queueTimeout) == 3)
+            continue;
+        if (sscanf(line.c_str(), "decisions %lu %lu %lu", &state.decisions[ADMITTED], &state.decisions[DEGRADED],
+                   &state.decisions[REJECTED]) == 3)
+            continue;
+        if (sscanf(line.c_str(), "capture %d %15s %lu %d %n", &capture.pid, stateName, &capture.memoryKb,
+                   &capture.crashedPid, &nameStart) < 4 || !nameStart)
+            continue;
+
+        //a collector that was killed can not remove its capture
+        if ((kill(capture.pid, 0) < 0) && (errno == ESRCH))
+            continue;
+
+        capture.state = QUEUED;
+        for (int i = ADMITTED; i <= QUEUED; i++)
+        {
+            if (strcmp(stateName, stateNames[i]) == 0)
+                capture.state = (Admission)i;
+        }
+        capture.name = line.substr(nameStart);
+        state.captures.push_back(capture);
+    }
+}
+
+bool Governor::writeState(int fd, const State &state)
+{
+    char line[256];
+    std::string contents;
+    snprintf(line, sizeof(line), "limits %u %lu %lu\n", state.limits.captures, state.limits.memoryKb,
+             state.limits.queueTimeout);
+    contents += line;
+    snprintf(line, sizeof(line), "decisions %lu %lu %lu\n", state.decisions[ADMITTED], state.decisions[DEGRADED],
+             state.decisions[REJECTED]);
+    contents += line;
+    for (unsigned int i = 0; i < state.captures.size(); i++)
+    {
+        const Capture &capture = state.captures.at(i);
+        snprintf(line, sizeof(line), "capture %d %s %lu %d ", capture.pid, stateNames[capture.state],
+                 capture.memoryKb, capture.crashedPid);
+        contents += line + capture.name + "\n";
+    }
+
+    if ((ftruncate(fd, 0) != 0)
+        || (pwrite(fd, contents.data(), contents.size(), 0) != (ssize_t)contents.size()))
+        LOG_RETURN(LOG_ERR, false, "Writing the state of the captures failed: %s", strerror(errno));
+    return true;
+}
+
+void Governor::unlockState(int fd)
+{
+    //closing the file releases the lock
+    close(fd);
+}
+
+int Governor::findCapture(const State &state)
+{
+    for (unsigned int i = 0; i < state.captures.size(); i++)
+    {
+        if (state.captures.at(i).pid == getpid())
+            return i;
+    }
+    return -1;
+}
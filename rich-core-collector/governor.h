@@ -0,0 +1,207 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file governor.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Governor
+  * \brief Limit the resources that the rich cores of several crashes take at the same time.
+  * A crashing daemon often takes its clients down with it, and every crash starts a collector of its
+  * own.  The collectors register in a state file that is shared by all of them, under a lock, and a
+  * collector is admitted only while the number of captures and their estimated memory use stay within
+  * the limits.  A collector that is not admitted waits in a queue, in the order of arrival, and when
+  * its wait runs out it is degraded to a capture that needs less, or rejected if there are already
+  * too many captures.  The kernel holds on to the crashed process until its core is read, so the wait
+  * is kept short.  The state file also counts the decisions since boot, it is shown with printStatus().
+  * The collector itself runs with a lower CPU and I/O priority and optionally in a cgroup, the threads
+  * and the commands that it starts afterwards inherit them.
+  */
+
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+class Governor
+{
+public:
+    /*!
+      * \brief The limits of the captures, 0 for no limit
+      */
+    struct Limits
+    {
+        unsigned int captures;        //!< The most captures running at the same time
+        unsigned long memoryKb;       //!< The most memory that the running captures are estimated to use
+        unsigned long queueTimeout;   //!< Milliseconds to wait in the queue before being degraded or rejected
+    };
+
+    /*!
+      * \brief The priority of the capture
+      */
+    struct Priority
+    {
+        int nice;             //!< The nice value
+        int ioClass;          //!< The I/O scheduling class, 1 realtime, 2 best-effort, 3 idle, 0 to leave it as it is
+        int ioLevel;          //!< The level within the best-effort and realtime classes, 0 to 7
+        std::string cgroup;   //!< The directory of a cgroup to join, empty for none
+    };
+
+    //! The decision on a capture
+    enum Admission
+    {
+        ADMITTED,   //!< The capture is done as configured
+        DEGRADED,   //!< The capture is done with the least resources
+        REJECTED,   //!< The capture is not done
+        QUEUED      //!< The capture waits for the others, only used in the state
+    };
+
+    /*!
+      * \brief Constructor
+      */
+    Governor();
+
+    /*!
+      * \brief Destructor, releases the capture
+      */
+    ~Governor();
+
+    /*!
+      * \brief Set the limits of the captures
+      */
+    void setLimits(const Limits &limits) { this->limits = limits; }
+
+    /*!
+      * \brief Set the priority of the capture
+      */
+    void setPriority(const Priority &priority) { this->priority = priority; }
+
+    /*!
+      * \brief Parse an I/O scheduling class
+      * \param ioClass "none", "idle", "best-effort" or "realtime", optionally followed by ":level"
+      * \param priority Set to the class and the level
+      * \return true on success, false if the class is not known
+      */
+    static bool parseIoClass(const char *ioClass, Priority &priority);
+
+    /*!
+      * \brief Apply the priority to the calling thread, before it starts any threads or processes
+      * \return true on success, false if any of the settings could not be applied
+      */
+    bool applyPriority() const;
+
+    /*!
+      * \brief Wait until the capture can be done within the limits
+      * \param crashedPid The process id of the crashed process
+      * \param name The name of the crashed process
+      * \param memoryKb The memory that the capture is estimated to use
+      * \param degradedMemoryKb The memory that the capture is estimated to use when it is degraded
+      * \return The decision, ADMITTED if the state of the captures can not be read
+      */
+    Admission admit(pid_t crashedPid, const std::string &name, unsigned long memoryKb,
+                    unsigned long degradedMemoryKb);
+
+    /*!
+      * \brief Remove the capture from the state so that the next ones can be admitted
+      */
+    void release();
+
+    /*!
+      * \brief Get the number of other captures that were running when the decision was made
+      */
+    unsigned int runningCaptures() const { return running; }
+
+    /*!
+      * \brief Get the memory of the other captures that were running when the decision was made
+      */
+    unsigned long runningMemoryKb() const { return runningMemory; }
+
+    /*!
+      * \brief Print the limits, the running and queued captures and the decisions since boot
+      * \param file The file to print to
+      * \return true on success, false if the state can not be read
+      */
+    static bool printStatus(FILE *file);
+
+private:
+    //! A capture in the state file
+    struct Capture
+    {
+        pid_t pid;               //!< The process id of the collector
+        Admission state;         //!< ADMITTED or DEGRADED when running, QUEUED while waiting
+        unsigned long memoryKb;  //!< The estimated memory use
+        pid_t crashedPid;        //!< The process id of the crashed process
+        std::string name;        //!< The name of the crashed process
+    };
+
+    //! The contents of the state file
+    struct State
+    {
+        Limits limits;                    //!< The limits of the latest collector
+        unsigned long decisions[QUEUED];  //!< The number of each decision since boot
+        std::vector<Capture> captures;    //!< The running and queued captures, in the order of arrival
+    };
+
+    /*!
+      * \brief Open and lock the state file
+      * \return The descriptor, -1 on errors
+      */
+    static int lockState();
+
+    /*!
+      * \brief Read the state and drop the captures whose collector has exited
+      */
+    static void readState(int fd, State &state);
+
+    /*!
+      * \brief Replace the contents of the state file
+      * \return true on success, false otherwise
+      */
+    static bool writeState(int fd, const State &state);
+
+    /*!
+      * \brief Unlock and close the state file
+      */
+    static void unlockState(int fd);
+
+    /*!
+      * \brief Find the capture of this process
+      * \return The index of the capture, -1 if it is not in the state
+      */
+    static int findCapture(const State &state);
+
+    //! The limits of the captures
+    Limits limits;
+    //! The priority of the capture
+    Priority priority;
+    //! true while the capture is in the state file
+    bool isRegistered;
+    //! The captures that were running when the decision was made
+    unsigned int running;
+    //! The memory of the captures that were running when the decision was made
+    unsigned long runningMemory;
+};
+
+#endif // GOVERNOR_H
@@ -0,0 +1,392 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "lzopwriter.h"
+#include "defines.h"
+
+#include <algorithm>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <lzo/lzo1x.h>
+
+//! The size of the uncompressed blocks, the same as lzop uses
+#define BLOCK_SIZE (256 * 1024)
+//! The largest size of a compressed block
+#define COMPRESSED_SIZE (BLOCK_SIZE + BLOCK_SIZE / 16 + 64 + 3)
+
+//! The lzop version that the file format matches
+#define LZOP_VERSION 0x1030
+//! The lowest lzop version that can extract the file
+#define LZOP_VERSION_NEEDED 0x0940
+//! LZO1X-1 compression
+#define LZOP_METHOD_LZO1X_1 1
+//! LZO1X-999 compression
+#define LZOP_METHOD_LZO1X_999 3
+//! The compression level that lzop reports for its default method
+#define LZOP_LEVEL 3
+//! The lowest level that lzop compresses with LZO1X-999
+#define LZOP_LEVEL_999 7
+//! Each block has an adler32 checksum of the uncompressed data
+#define LZOP_FLAG_ADLER32_D 0x00000001
+//! The file was created on unix
+#define LZOP_FLAG_OS_UNIX 0x03000000
+
+//! The most blocks per worker that are compressed or waiting to be written at a time
+#define BLOCKS_PER_WORKER 2
+
+//! The magic bytes at the start of every lzop file
+static const unsigned char lzopMagic[] = { 0x89, 0x4c, 0x5a, 0x4f, 0x00, 0x0d, 0x0a, 0x1a, 0x0a };
+
+LzopWriter::LzopWriter()
+    : fd(-1),
+    isFailed(false),
+    current(NULL),
+    threadCount(0),
+    level(LZOP_LEVEL),
+    isStopping(false)
+{
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&workQueued, NULL);
+    pthread_cond_init(&blockCompressed, NULL);
+}
+
+LzopWriter::~LzopWriter()
+{
+    if (fd >= 0)
+        close();
+    pthread_cond_destroy(&blockCompressed);
+    pthread_cond_destroy(&workQueued);
+    pthread_mutex_destroy(&lock);
+}
+
+void LzopWriter::setThreads(unsigned int count)
+{
+    threadCount = count;
+}
+
+void LzopWriter::setLevel(int level)
+{
+    this->level = level ? std::max(1, std::min(level, 9)) : LZOP_LEVEL;
+}
+
+size_t LzopWriter::memoryUse(unsigned int threads, int level)
+{
+    //the current block and the ones queued for the workers, every thread has its own work memory
+    size_t blocks = (threads > 1) ? threads * BLOCKS_PER_WORKER + 1 : 1;
+    return blocks * (BLOCK_SIZE + COMPRESSED_SIZE) + std::max(threads, 1U) * workMemorySize(level);
+}
+
+size_t LzopWriter::workMemorySize(int level)
+{
+    return (level >= LZOP_LEVEL_999) ? LZO1X_999_MEM_COMPRESS : LZO1X_1_MEM_COMPRESS;
+}
+
+bool LzopWriter::open(const char *fileName)
+{
+    if (!fileName)
+        LOG_RETURN(LOG_ERR, false, "Uninitalized pointer for fileName");
+
+    if (lzo_init() != LZO_E_OK)
+        LOG_RETURN(LOG_ERR, false, "Unable to initalize the lzo library");
+
+    if ((fd = ::open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+        LOG_RETURN(LOG_ERR, false, "Opening file '%s' failed.", fileName);
+
+    workMemory.resize(workMemorySize(level));
+    isFailed = false;
+    current = newBlock();
+    if (threadCount > 1)
+        startWorkers();
+
+    //The header fields from the version to the name are covered by the header checksum
+    std::vector<unsigned char> header;
+    putUint16(header, LZOP_VERSION);
+    putUint16(header, lzo_version() & 0xffff);
+    putUint16(header, LZOP_VERSION_NEEDED);
+    header.push_back((level >= LZOP_LEVEL_999) ? LZOP_METHOD_LZO1X_999 : LZOP_METHOD_LZO1X_1);
+    header.push_back(level);
+    putUint32(header, LZOP_FLAG_ADLER32_D | LZOP_FLAG_OS_UNIX);
+    putUint32(header, 0100644);
+    putUint32(header, time(NULL));
+    putUint32(header, 0);
+    //The data does not come from a named file
+    header.push_back(0);
+    putUint32(header, lzo_adler32(1, &header[0], header.size()));
+
+    if (!writeAll(lzopMagic, sizeof(lzopMagic)) || !writeAll(&header[0], header.size()))
+        isFailed = true;
+    return !isFailed;
+}
+
+bool LzopWriter::write(const void *data, size_t size)
+{
+    const unsigned char *position = (const unsigned char *)data;
+    while (size && !isFailed)
+    {
+        size_t length = std::min(size, (size_t)BLOCK_SIZE - current->used);
+        memcpy(&current->data[current->used], position, length);
+        current->used += length;
+        position += length;
+        size -= length;
+
+        if ((current->used == BLOCK_SIZE) && !submitBlock())
+            isFailed = true;
+    }
+    return !isFailed;
+}
+
+bool LzopWriter::endBlock()
+{
+    if (!isFailed && current && current->used && !submitBlock())
+        isFailed = true;
+    return !isFailed;
+}
+
+bool LzopWriter::close()
+{
+    if (fd < 0)
+        return false;
+
+    if (!isFailed && current->used && !submitBlock())
+        isFailed = true;
+    if (!writeCompressedBlocks(true, 0))
+        isFailed = true;
+    stopWorkers();
+
+    //A block with an uncompressed size of 0 ends the file
+    std::vector<unsigned char> end;
+    putUint32(end, 0);
+    if (!isFailed && !writeAll(&end[0], end.size()))
+        isFailed = true;
+
+    if ((::close(fd) != 0) && !isFailed)
+        isFailed = true;
+    fd = -1;
+
+    delete current;
+    current = NULL;
+    for (unsigned int i = 0; i < freeBlocks.size(); i++)
+        delete freeBlocks.at(i);
+    freeBlocks.clear();
+    workMemory.clear();
+    return !isFailed;
+}
+
+bool LzopWriter::submitBlock()
+{
+    Block *block = current;
+    current = newBlock();
+
+    if (workers.empty())
+    {
+        compressBlock(block, workMemory);
+        bool success = writeBlock(block);
+        freeBlocks.push_back(block);
+        return success;
+    }
+
+    pthread_mutex_lock(&lock);
+    pending.push_back(block);
+    queue.push_back(block);
+    pthread_cond_signal(&workQueued);
+    pthread_mutex_unlock(&lock);
+
+    //Only a bounded number of blocks is kept in memory, the writer waits for the oldest one
+    return writeCompressedBlocks(false, workers.size() * BLOCKS_PER_WORKER);
+}
+
+bool LzopWriter::writeCompressedBlocks(bool isWaiting, size_t limit)
+{
+    bool success = true;
+    pthread_mutex_lock(&lock);
+    while (!pending.empty())
+    {
+        Block *block = pending.front();
+        if (!block->isCompressed)
+        {
+            if (!isWaiting && (pending.size() < limit))
+                break;
+            pthread_cond_wait(&blockCompressed, &lock);
+            continue;
+        }
+        pending.pop_front();
+
+        //The file is written without holding the lock, so the workers can go on
+        pthread_mutex_unlock(&lock);
+        if (success && !writeBlock(block))
+            success = false;
+        pthread_mutex_lock(&lock);
+        freeBlocks.push_back(block);
+    }
+    pthread_mutex_unlock(&lock);
+    return success;
+}
+
+void LzopWriter::compressBlock(Block *block, std::vector<unsigned char> &workMemory) const
+{
+    //Both methods produce LZO1X data, which lzop decompresses the same way
+    lzo_uint compressedSize = 0;
+    if (level >= LZOP_LEVEL_999)
+        block->isFailed = (lzo1x_999_compress_level(&block->data[0], block->used, &block->compressed[0],
+                                                    &compressedSize, &workMemory[0], NULL, 0, NULL, level)
+                           != LZO_E_OK);
+    else
+        block->isFailed = (lzo1x_1_compress(&block->data[0], block->used, &block->compressed[0], &compressedSize,
+                                            &workMemory[0]) != LZO_E_OK);
+    block->compressedSize = compressedSize;
+    block->checksum = lzo_adler32(1, &block->data[0], block->used);
+}
+
+bool LzopWriter::writeBlock(const Block *block)
+{
+    if (block->isFailed)
+        LOG_RETURN(LOG_ERR, false, "Compressing a block failed");
+
+    //Data that does not compress is stored, lzop knows it from the sizes being equal
+    bool isStored = (block->compressedSize >= block->used);
+    std::vector<unsigned char> header;
+    putUint32(header, block->used);
+    putUint32(header, isStored ? block->used : block->compressedSize);
+    putUint32(header, block->checksum);
+
+    return writeAll(&header[0], header.size())
+           && writeAll(isStored ? &block->data[0] : &block->compressed[0],
+                       isStored ? block->used : block->compressedSize);
+}
+
+LzopWriter::Block *LzopWriter::newBlock()
+{
+    Block *block = NULL;
+    pthread_mutex_lock(&lock);
+    if (!freeBlocks.empty())
+    {
+        block = freeBlocks.back();
+        freeBlocks.pop_back();
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (!block)
+    {
+        block = new Block;
+        block->data.resize(BLOCK_SIZE);
+        block->compressed.resize(COMPRESSED_SIZE);
+    }
+    block->used = 0;
+    block->compressedSize = 0;
+    block->checksum = 0;
+    block->isCompressed = false;
+    block->isFailed = false;
+    return block;
+}
+
+void LzopWriter::startWorkers()
+{
+    isStopping = false;
+    for (unsigned int i = 0; i < threadCount; i++)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, compressBlocks, this) != 0)
+        {
+            //Fewer workers, or none, still work
+            LOG(LOG_ERR, "Unable to start a compressing thread");
+            break;
+        }
+        workers.push_back(thread);
+    }
+}
+
+void LzopWriter::stopWorkers()
+{
+    pthread_mutex_lock(&lock);
+    isStopping = true;
+    pthread_cond_broadcast(&workQueued);
+    pthread_mutex_unlock(&lock);
+
+    for (unsigned int i = 0; i < workers.size(); i++)
+        pthread_join(workers.at(i), NULL);
+    workers.clear();
+}
+
+void *LzopWriter::compressBlocks(void *data)
+{
+    LzopWriter *writer = (LzopWriter *)data;
+    std::vector<unsigned char> workMemory(workMemorySize(writer->level));
+
+    pthread_mutex_lock(&writer->lock);
+    while (true)
+    {
+        if (writer->queue.empty())
+        {
+            if (writer->isStopping)
+                break;
+            pthread_cond_wait(&writer->workQueued, &writer->lock);
+            continue;
+        }
+        Block *block = writer->queue.front();
+        writer->queue.pop_front();
+        pthread_mutex_unlock(&writer->lock);
+
+        writer->compressBlock(block, workMemory);
+
+        pthread_mutex_lock(&writer->lock);
+        block->isCompressed = true;
+        pthread_cond_broadcast(&writer->blockCompressed);
+    }
+    pthread_mutex_unlock(&writer->lock);
+    return NULL;
+}
+
+bool LzopWriter::writeAll(const void *data, size_t size)
+{
+    const char *current = (const char *)data;
+    while (size)
+    {
+        ssize_t written = ::write(fd, current, size);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            LOG_RETURN(LOG_ERR, false, "Writing the compressed file failed: %s", strerror(errno));
+        }
+        current += written;
+        size -= written;
+    }
+    return true;
+}
+
+void LzopWriter::putUint32(std::vector<unsigned char> &buffer, unsigned int value)
+{
+    buffer.push_back((value >> 24) & 0xff);
+    buffer.push_back((value >> 16) & 0xff);
+    buffer.push_back((value >> 8) & 0xff);
+    buffer.push_back(value & 0xff);
+}
+
+void LzopWriter::putUint16(std::vector<unsigned char> &buffer, unsigned int value)
+{
+    buffer.push_back((value >> 8) & 0xff);
+    buffer.push_back(value & 0xff);
+}
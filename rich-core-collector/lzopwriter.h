@@ -0,0 +1,218 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file lzopwriter.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class LzopWriter
+  * \brief Write a file in the lzop format without running lzop.
+  * The data is collected in to blocks that are compressed with LZO1X-1, as lzop does by default, so
+  * the file can be read by lzop -d and by rich-core-extract.  A block that does not get smaller is
+  * stored as it is.
+  * The blocks are independent of each other, so with more than one thread they are compressed in
+  * parallel by a pool of workers and written in their order.  A block can be ended early with
+  * endBlock(), so that data such as a section or an ELF segment starts at the start of a block.
+  */
+
+#ifndef LZOPWRITER_H
+#define LZOPWRITER_H
+
+#include <stddef.h>
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+class LzopWriter
+{
+public:
+    /*!
+      * \brief Constructor
+      */
+    LzopWriter();
+
+    /*!
+      * \brief Destructor, closes the file if it is still open
+      */
+    ~LzopWriter();
+
+    /*!
+      * \brief Set the number of threads that compress the blocks, before the file is opened
+      * \param count The number of worker threads, 0 or 1 compresses in the calling thread
+      */
+    void setThreads(unsigned int count);
+
+    /*!
+      * \brief Get the number of threads that compress the blocks
+      */
+    unsigned int getThreads() const { return threadCount; }
+
+    /*!
+      * \brief Set the compression level as lzop has it, before the file is opened
+      * \param level 1 to 6 compress with LZO1X-1, 7 to 9 with the slower and tighter LZO1X-999, 0 for the default
+      */
+    void setLevel(int level);
+
+    /*!
+      * \brief Get the most memory that the blocks and the workers use
+      * \param threads The number of threads that compress the blocks
+      * \param level The compression level
+      * \return The size in bytes
+      */
+    static size_t memoryUse(unsigned int threads, int level);
+
+    /*!
+      * \brief Create the file and write the lzop header to it
+      * \param fileName The name of the file to create
+      * \return true on success, false otherwise
+      */
+    bool open(const char *fileName);
+
+    /*!
+      * \brief Add data to the file
+      * \param data The data to compress
+      * \param size The size of \a data in bytes
+      * \return true on success, false if an earlier or this write failed
+      */
+    bool write(const void *data, size_t size);
+
+    /*!
+      * \brief End the current block, the next data starts a new block
+      * \return true on success, false if an earlier or this write failed
+      */
+    bool endBlock();
+
+    /*!
+      * \brief Compress the last block and write the end of file marker
+      * \return true if all of the data was written, false otherwise
+      */
+    bool close();
+
+private:
+    //! A block of data, compressed by a worker
+    struct Block
+    {
+        std::vector<unsigned char> data;        //!< The uncompressed data
+        size_t used;                            //!< The number of bytes used in \a data
+        std::vector<unsigned char> compressed;  //!< The compressed data
+        size_t compressedSize;                  //!< The number of bytes used in \a compressed
+        unsigned int checksum;                  //!< The adler32 checksum of the uncompressed data
+        bool isCompressed;                      //!< true once the block is ready to be written
+        bool isFailed;                          //!< true if compressing failed
+    };
+
+    /*!
+      * \brief Hand the current block over to be compressed and written
+      */
+    bool submitBlock();
+
+    /*!
+      * \brief Write the blocks that are compressed, in order
+      * \param isWaiting true to wait until all of the blocks are written
+      * \param limit Wait until fewer than this many blocks are not written
+      */
+    bool writeCompressedBlocks(bool isWaiting, size_t limit);
+
+    /*!
+      * \brief Compress a block
+      * \param block The block
+      * \param workMemory The work memory of the compressor, as given by workMemorySize
+      */
+    void compressBlock(Block *block, std::vector<unsigned char> &workMemory) const;
+
+    /*!
+      * \brief Get the size of the work memory of the compressor of a level
+      */
+    static size_t workMemorySize(int level);
+
+    /*!
+      * \brief Write a compressed block
+      */
+    bool writeBlock(const Block *block);
+
+    /*!
+      * \brief Get an empty block
+      */
+    Block *newBlock();
+
+    /*!
+      * \brief Start the worker threads
+      */
+    void startWorkers();
+
+    /*!
+      * \brief Stop the worker threads
+      */
+    void stopWorkers();
+
+    /*!
+      * \brief The thread function of a worker
+      */
+    static void *compressBlocks(void *data);
+
+    /*!
+      * \brief Write a buffer to the file, retrying after short writes
+      */
+    bool writeAll(const void *data, size_t size);
+
+    /*!
+      * \brief Append a 32 bit big endian value to a buffer
+      */
+    static void putUint32(std::vector<unsigned char> &buffer, unsigned int value);
+
+    /*!
+      * \brief Append a 16 bit big endian value to a buffer
+      */
+    static void putUint16(std::vector<unsigned char> &buffer, unsigned int value);
+
+private:
+    //! The file descriptor of the output file, -1 if not open
+    int fd;
+    //! true once a write has failed, the rest of the data is dropped
+    bool isFailed;
+    //! The block that is being collected
+    Block *current;
+    //! The work memory of the compressor when there are no workers
+    std::vector<unsigned char> workMemory;
+    //! The number of worker threads requested
+    unsigned int threadCount;
+    //! The compression level
+    int level;
+    //! The worker threads
+    std::vector<pthread_t> workers;
+    //! Protects the members below
+    pthread_mutex_t lock;
+    //! Signaled when a block is queued or the workers are stopped
+    pthread_cond_t workQueued;
+    //! Signaled when a block has been compressed
+    pthread_cond_t blockCompressed;
+    //! The blocks that are not written yet, in order
+    std::deque<Block *> pending;
+    //! The blocks that are waiting for a worker
+    std::deque<Block *> queue;
+    //! Blocks that have been written and can be used again
+    std::vector<Block *> freeBlocks;
+    //! true when the workers are to exit
+    bool isStopping;
+};
+
+#endif // LZOPWRITER_H
@@ -0,0 +1,254 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "collector.h"
+
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "../config.h"
+
+void printUsage(char *progName)
+{
+    std::cout << "\n\nUsage:" << std::endl;
+    std::cout << "\t" << progName << " [-options] < core" << std::endl;
+    std::cout << "Options:\n"
+            "\t[--pid=process id of the crashed process]\n"
+            "\t[--signal=signal that killed the process]\n"
+            "\t[--name=name of the process]\n"
+            "\t[--default-name name used when the name of the process is not known]\n"
+            "\t[--no-section-header]\n"
+            "\t[--include-core=true|false]\n"
+            "\t[--reduce-core=true|false]\n"
+            "\t[--reduce-from-memory=true|false]\n"
+            "\t[--policy=policy file with the reducer settings of each executable]\n"
+            "\t[--include-syslog=true|false]\n"
+            "\t[--include-pkglist=true|false]\n"
+            "\t[--stack-depth=stack depth of non crashing threads]\n"
+            "\t[--core-format=elf|minidump]\n"
+            "\t[--core-notes=note types kept in the reduced core, all keeps every note]\n"
+            "\t[--smaps=binary|summary|text]\n"
+            "\t[--compress-threads=threads compressing the rich core, 0 for one per processor]\n"
+            "\t[--capture-limits=captures,memory in kB,queue timeout in ms, 0 for no limit]\n"
+            "\t[--nice=nice value of the capture]\n"
+            "\t[--ionice=none|idle|best-effort|realtime[:level] I/O scheduling class of the capture]\n"
+            "\t[--cgroup=directory of the cgroup the capture joins]\n"
+            "\t[--tail=syslog|xorg|dmesg:lines,bytes,seconds of the end of the log to include, 0 for no limit]\n"
+            "\t[--update-package-list only bring the cached package list up to date]\n"
+            "\t[--update-sysinfo only write the snapshot of the static system information]\n"
+            "\t[--capture-status only show the running and queued captures and the decisions since boot]\n"
+            "\tAn oopslog is created instead of a rich core when IS_OOPSLOG is set in the environment.";
+    std::cout << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    char *progName = argv[0];
+    int pid = 0;
+    int signal = 0;
+    const char *name = NULL;
+    bool includeCore = true;
+    bool reduceCore = true;
+    bool reduceFromMemory = true;
+    bool includeSyslog = true;
+    bool includePackageList = true;
+    size_t stackDepth = 16384;
+    const char *coreFormat = "elf";
+    const char *coreNotes = "prpsinfo,siginfo,auxv,file,fpregset:crashing,prxfpreg:crashing,xstate:crashing,"
+                            "arm-vfp:crashing,arm-sve:crashing";
+    Governor::Limits captureLimits = { 2, 32768, 10000 };
+    Governor::Priority capturePriority;
+    Collector collector;
+    int c;
+
+    capturePriority.nice = 0;
+    capturePriority.ioClass = 0;
+    capturePriority.ioLevel = 0;
+
+    //the settings of rich-core-dumper are passed as --setting=true|false
+    enum { PID = 256, SIGNAL, NAME, DEFAULT_NAME, NO_SECTION_HEADER, INCLUDE_CORE, REDUCE_CORE, REDUCE_FROM_MEMORY,
+           POLICY, INCLUDE_SYSLOG, INCLUDE_PKGLIST, STACK_DEPTH, CORE_FORMAT, CORE_NOTES, SMAPS, COMPRESS_THREADS, CAPTURE_LIMITS,
+           NICE, IONICE, CGROUP, TAIL, UPDATE_PACKAGE_LIST, UPDATE_SYSINFO, CAPTURE_STATUS };
+    static const struct option options[] = {
+        { "pid", required_argument, NULL, PID },
+        { "signal", required_argument, NULL, SIGNAL },
+        { "name", required_argument, NULL, NAME },
+        { "default-name", required_argument, NULL, DEFAULT_NAME },
+        { "no-section-header", no_argument, NULL, NO_SECTION_HEADER },
+        { "include-core", required_argument, NULL, INCLUDE_CORE },
+        { "reduce-core", required_argument, NULL, REDUCE_CORE },
+        { "reduce-from-memory", required_argument, NULL, REDUCE_FROM_MEMORY },
+        { "policy", required_argument, NULL, POLICY },
+        { "include-syslog", required_argument, NULL, INCLUDE_SYSLOG },
+        { "include-pkglist", required_argument, NULL, INCLUDE_PKGLIST },
+        { "stack-depth", required_argument, NULL, STACK_DEPTH },
+        { "core-format", required_argument, NULL, CORE_FORMAT },
+        { "core-notes", required_argument, NULL, CORE_NOTES },
+        { "smaps", required_argument, NULL, SMAPS },
+        { "compress-threads", required_argument, NULL, COMPRESS_THREADS },
+        { "capture-limits", required_argument, NULL, CAPTURE_LIMITS },
+        { "nice", required_argument, NULL, NICE },
+        { "ionice", required_argument, NULL, IONICE },
+        { "cgroup", required_argument, NULL, CGROUP },
+        { "tail", required_argument, NULL, TAIL },
+        { "update-package-list", no_argument, NULL, UPDATE_PACKAGE_LIST },
+        { "update-sysinfo", no_argument, NULL, UPDATE_SYSINFO },
+        { "capture-status", no_argument, NULL, CAPTURE_STATUS },
+        { "help", no_argument, NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+    {
+        switch (c)
+        {
+        case PID:
+            pid = strtol(optarg, NULL, 10);
+            break;
+        case SIGNAL:
+            signal = strtol(optarg, NULL, 10);
+            break;
+        case NAME:
+            name = optarg;
+            break;
+        case DEFAULT_NAME:
+            collector.setDefaultName(optarg);
+            break;
+        case NO_SECTION_HEADER:
+            collector.setNoSectionHeader(true);
+            break;
+        case INCLUDE_CORE:
+            includeCore = (strcmp(optarg, "true") == 0);
+            break;
+        case REDUCE_CORE:
+            reduceCore = (strcmp(optarg, "true") == 0);
+            break;
+        case REDUCE_FROM_MEMORY:
+            reduceFromMemory = (strcmp(optarg, "true") == 0);
+            break;
+        case POLICY:
+            collector.setPolicyFile(optarg);
+            break;
+        case INCLUDE_SYSLOG:
+            includeSyslog = (strcmp(optarg, "true") == 0);
+            break;
+        case INCLUDE_PKGLIST:
+            includePackageList = (strcmp(optarg, "true") == 0);
+            break;
+        case STACK_DEPTH:
+            stackDepth = strtoul(optarg, NULL, 0);
+            break;
+        case CORE_FORMAT:
+            if ((strcmp(optarg, "elf") != 0) && (strcmp(optarg, "minidump") != 0))
+            {
+                printUsage(progName);
+                return -1;
+            }
+            coreFormat = optarg;
+            break;
+        case CORE_NOTES:
+            coreNotes = optarg;
+            break;
+        case SMAPS:
+            if (!collector.setSmapsFormat(optarg))
+            {
+                printUsage(progName);
+                return -1;
+            }
+            break;
+        case COMPRESS_THREADS:
+            collector.setCompressThreads(strtoul(optarg, NULL, 10));
+            break;
+        case CAPTURE_LIMITS:
+            if (sscanf(optarg, "%u,%lu,%lu", &captureLimits.captures, &captureLimits.memoryKb,
+                       &captureLimits.queueTimeout) != 3)
+            {
+                printUsage(progName);
+                return -1;
+            }
+            break;
+        case NICE:
+            capturePriority.nice = strtol(optarg, NULL, 10);
+            break;
+        case IONICE:
+            if (!Governor::parseIoClass(optarg, capturePriority))
+            {
+                printUsage(progName);
+                return -1;
+            }
+            break;
+        case CGROUP:
+            capturePriority.cgroup = optarg;
+            break;
+        case TAIL:
+        {
+            //source:lines,bytes,seconds
+            char *limits = strchr(optarg, ':');
+            TailReader::Limits tail;
+            if (!limits)
+            {
+                printUsage(progName);
+                return -1;
+            }
+            *limits++ = '\0';
+            if ((sscanf(limits, "%lu,%lu,%lu", &tail.lines, &tail.bytes, &tail.seconds) != 3)
+                || !collector.setTailLimits(optarg, tail))
+            {
+                printUsage(progName);
+                return -1;
+            }
+            break;
+        }
+        case UPDATE_PACKAGE_LIST:
+            return Collector::updatePackageList() ? 0 : -1;
+        case UPDATE_SYSINFO:
+            return collector.updateSysinfo() ? 0 : -1;
+        case CAPTURE_STATUS:
+            return Governor::printStatus(stdout) ? 0 : -1;
+        case 'h':
+        default:
+            printUsage(progName);
+            return -1;
+        }
+    }
+
+    const char *oopsLog = getenv("IS_OOPSLOG");
+    collector.setOopsLog(oopsLog && *oopsLog);
+    collector.setProcess(pid, signal, name);
+    collector.setIncludes(includeCore, reduceCore, includeSyslog, includePackageList);
+    collector.setReducedCore(stackDepth, coreFormat);
+    if (!collector.setReducedNotes(coreNotes))
+    {
+        printUsage(progName);
+        return -1;
+    }
+    collector.setMemoryReduced(reduceFromMemory);
+    collector.setCaptureLimits(captureLimits);
+    collector.setCapturePriority(capturePriority);
+
+    //exit() does not destroy the collector, a section thread that ran out of time may still be using it
+    exit(collector.run());
+}
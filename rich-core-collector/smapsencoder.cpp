@@ -0,0 +1,234 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "smapsencoder.h"
+#include "smapsdecoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+//! The most digits of a number in an attribute line that is stored as a number
+#define MAX_NUMBER_DIGITS 19
+//! The largest column a number can be aligned to, it is stored in a byte
+#define MAX_NUMBER_COLUMN 255
+
+SmapsEncoder::SmapsEncoder()
+{
+}
+
+bool SmapsEncoder::encode(const std::string &text, std::string &table)
+{
+    SmapsEncoder encoder;
+    if (!encoder.parse(text))
+        return false;
+
+    table.clear();
+    encoder.write(table);
+
+    //The text is kept as it is rather than losing anything the format does not expect
+    std::string decoded;
+    if ((smaps_decode((const unsigned char *)table.data(), table.size(), appendText, &decoded) != 0)
+        || (decoded != text))
+        return false;
+    return true;
+}
+
+bool SmapsEncoder::parse(const std::string &text)
+{
+    if (text.empty() || (text[text.size() - 1] != '\n'))
+        return false;
+
+    size_t position = 0;
+    while (position < text.size())
+    {
+        size_t end = text.find('\n', position);
+        std::string line = text.substr(position, end - position);
+        position = end + 1;
+
+        if (parseHeader(line))
+            continue;
+        if (mappings.empty())
+            return false;
+        parseAttribute(line);
+    }
+    return true;
+}
+
+bool SmapsEncoder::parseHeader(const std::string &line)
+{
+    //start-end perms offset major:minor inode, then the name padded to a column
+    if (line.empty() || !isxdigit((unsigned char)line[0]))
+        return false;
+
+    Mapping mapping;
+    char perms[5];
+    int length = 0;
+    if ((sscanf(line.c_str(), "%llx-%llx %4s %llx %llx:%llx %llu%n", &mapping.start, &mapping.end, perms,
+                &mapping.offset, &mapping.major, &mapping.minor, &mapping.inode, &length) != 7)
+        || (mapping.end < mapping.start))
+        return false;
+
+    mapping.perms = intern(perms);
+    mapping.name = intern(line.substr(length));
+    mappings.push_back(mapping);
+    return true;
+}
+
+void SmapsEncoder::parseAttribute(const std::string &line)
+{
+    //The first number after the name is cut out of the line, e.g. "Rss:" + spaces + number + " kB"
+    Mapping &mapping = mappings.back();
+    size_t colon = line.find(':');
+    size_t start = (colon == std::string::npos) ? std::string::npos : line.find_first_of("0123456789", colon);
+    size_t end = (start == std::string::npos) ? start : line.find_first_not_of("0123456789", start);
+    if (end == std::string::npos)
+        end = line.size();
+
+    bool isNumber = (start != std::string::npos) && (end - start <= MAX_NUMBER_DIGITS)
+                    && ((line[start] != '0') || (end - start == 1));
+    if (!isNumber)
+    {
+        mapping.lines.push_back(intern(line));
+        mapping.values.push_back(0);
+        return;
+    }
+
+    //The kernel right aligns the numbers, so the spaces before them are stored as the column they end at
+    size_t prefix = line.find_last_not_of(' ', start - 1) + 1;
+    size_t spaces = start - prefix;
+    if (end > MAX_NUMBER_COLUMN)
+        prefix = start;
+    std::string lineTemplate = line.substr(0, prefix);
+    lineTemplate += '\0';
+    lineTemplate += (char)((spaces && (prefix != start)) ? end : 0);
+    lineTemplate += line.substr(end);
+    mapping.lines.push_back(intern(lineTemplate));
+    mapping.values.push_back(strtoull(line.c_str() + start, NULL, 10));
+}
+
+void SmapsEncoder::write(std::string &table) const
+{
+    table.append(SMAPS_MAGIC, SMAPS_MAGIC_SIZE);
+    putVarint(table, strings.size());
+    for (unsigned int i = 0; i < strings.size(); i++)
+    {
+        putVarint(table, strings.at(i).size());
+        table += strings.at(i);
+    }
+
+    //The columns of the first lines of the mappings
+    putVarint(table, mappings.size());
+    unsigned long long previousEnd = 0;
+    for (unsigned int i = 0; i < mappings.size(); i++)
+    {
+        long long delta = (long long)(mappings.at(i).start - previousEnd);
+        putVarint(table, ((unsigned long long)delta << 1) ^ (unsigned long long)(delta >> 63));
+        previousEnd = mappings.at(i).end;
+    }
+    for (unsigned int i = 0; i < mappings.size(); i++)
+        putVarint(table, mappings.at(i).end - mappings.at(i).start);
+    for (unsigned int i = 0; i < mappings.size(); i++)
+        putVarint(table, mappings.at(i).perms);
+    for (unsigned int i = 0; i < mappings.size(); i++)
+        putVarint(table, mappings.at(i).offset);
+    for (unsigned int i = 0; i < mappings.size(); i++)
+        putVarint(table, mappings.at(i).major);
+    for (unsigned int i = 0; i < mappings.size(); i++)
+        putVarint(table, mappings.at(i).minor);
+    for (unsigned int i = 0; i < mappings.size(); i++)
+        putVarint(table, mappings.at(i).inode);
+    for (unsigned int i = 0; i < mappings.size(); i++)
+        putVarint(table, mappings.at(i).name);
+
+    size_t maxLines = 0;
+    for (unsigned int i = 0; i < mappings.size(); i++)
+    {
+        putVarint(table, mappings.at(i).lines.size());
+        if (mappings.at(i).lines.size() > maxLines)
+            maxLines = mappings.at(i).lines.size();
+    }
+
+    //The attribute lines column by column, so the same attribute of all of the mappings is together
+    for (size_t line = 0; line < maxLines; line++)
+    {
+        //Usually every mapping has the same template in a column, which is then stored once
+        unsigned long long shared = 0;
+        bool isShared = true;
+        for (unsigned int i = 0; i < mappings.size(); i++)
+        {
+            if (line >= mappings.at(i).lines.size())
+                continue;
+            if (!shared)
+                shared = mappings.at(i).lines.at(line) + 1;
+            else if (shared != mappings.at(i).lines.at(line) + 1)
+                isShared = false;
+        }
+        putVarint(table, isShared ? shared : 0);
+        for (unsigned int i = 0; (i < mappings.size()) && !isShared; i++)
+        {
+            if (line < mappings.at(i).lines.size())
+                putVarint(table, mappings.at(i).lines.at(line));
+        }
+
+        for (unsigned int i = 0; i < mappings.size(); i++)
+        {
+            const Mapping &mapping = mappings.at(i);
+            if ((line < mapping.lines.size()) && hasNumber(strings.at(mapping.lines.at(line))))
+                putVarint(table, mapping.values.at(line));
+        }
+    }
+}
+
+bool SmapsEncoder::hasNumber(const std::string &lineTemplate)
+{
+    size_t number = lineTemplate.find('\0');
+    return (number != std::string::npos) && (number + 1 < lineTemplate.size());
+}
+
+unsigned long long SmapsEncoder::intern(const std::string &string)
+{
+    std::map<std::string, unsigned long long>::const_iterator index = stringIndexes.find(string);
+    if (index != stringIndexes.end())
+        return index->second;
+
+    strings.push_back(string);
+    stringIndexes[string] = strings.size() - 1;
+    return strings.size() - 1;
+}
+
+void SmapsEncoder::putVarint(std::string &buffer, unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        buffer += (char)((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    buffer += (char)value;
+}
+
+void SmapsEncoder::appendText(void *context, const char *data, size_t size)
+{
+    ((std::string *)context)->append(data, size);
+}
@@ -0,0 +1,117 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file smapsencoder.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class SmapsEncoder
+  * \brief Encode the text of /proc/pid/smaps as a compact binary table.
+  * The format is described in smapsdecoder.h, rich-core-extract decodes it back to the same text.
+  * A table is only created if it decodes back to exactly the text it was created from.
+  */
+
+#ifndef SMAPSENCODER_H
+#define SMAPSENCODER_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+class SmapsEncoder
+{
+public:
+    /*!
+      * \brief Encode the text of smaps
+      * \param text The text of /proc/pid/smaps
+      * \param table Set to the binary table
+      * \return true on success, false if the text is not in the expected format
+      */
+    static bool encode(const std::string &text, std::string &table);
+
+private:
+    /*!
+      * \brief Constructor
+      */
+    SmapsEncoder();
+
+    /*!
+      * \brief Split the text in to the columns of the table
+      * \return true on success, false if a line is not in the expected format
+      */
+    bool parse(const std::string &text);
+
+    /*!
+      * \brief Parse the first line of a mapping
+      * \return true if the line is the first line of a mapping, false otherwise
+      */
+    bool parseHeader(const std::string &line);
+
+    /*!
+      * \brief Parse an attribute line of the last mapping
+      */
+    void parseAttribute(const std::string &line);
+
+    /*!
+      * \brief Write the columns as a table
+      */
+    void write(std::string &table) const;
+
+    /*!
+      * \brief Get the index of a string in the string table, adding it if it is not there yet
+      */
+    unsigned long long intern(const std::string &string);
+
+    /*!
+      * \brief Determine if a template has a number
+      */
+    static bool hasNumber(const std::string &lineTemplate);
+
+    /*!
+      * \brief Append an unsigned LEB128 varint
+      */
+    static void putVarint(std::string &buffer, unsigned long long value);
+
+    /*!
+      * \brief Collect the text decoded from a table
+      */
+    static void appendText(void *context, const char *data, size_t size);
+
+private:
+    //! The first line of a mapping
+    struct Mapping
+    {
+        unsigned long long start, end, offset, major, minor, inode;
+        unsigned long long perms, name;          //!< String indexes
+        std::vector<unsigned long long> lines;   //!< The templates of the attribute lines
+        std::vector<unsigned long long> values;  //!< The numbers of the attribute lines
+    };
+
+    //! The mappings in their order
+    std::vector<Mapping> mappings;
+    //! The string table
+    std::vector<std::string> strings;
+    //! The indexes of the strings in \a strings
+    std::map<std::string, unsigned long long> stringIndexes;
+};
+
+#endif // SMAPSENCODER_H
@@ -0,0 +1,337 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "tailreader.h"
+
+#include <deque>
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+//! The size of the blocks read from the end of a file
+#define TAIL_BLOCK_SIZE (64 * 1024)
+//! The size of the blocks decompressed from a gzip file
+#define GZIP_BLOCK_SIZE (64 * 1024)
+//! A syslog timestamp this much in the future is from the previous year
+#define FUTURE_TOLERANCE (24 * 60 * 60)
+
+TailReader::TailReader(const Limits &limits, TimeFormat format)
+    : limits(limits),
+    format(format),
+    oldest(0),
+    lineCount(0),
+    byteCount(0),
+    untimedLines(0),
+    isDone(false)
+{
+    if (limits.seconds && (format != NO_TIME))
+        oldest = time(NULL) - limits.seconds;
+}
+
+bool TailReader::readFile(const std::string &fileName, std::string &text)
+{
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat buf;
+    if (fstat(fd, &buf) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    //The data is read backwards, data holds the text from start on that has not been taken yet
+    std::vector<std::string> lines;
+    untimedLines = 0;
+    std::string data;
+    off_t start = buf.st_size;
+    bool isFileEnd = true;
+    while (!isDone && (start > 0))
+    {
+        size_t size = (start > TAIL_BLOCK_SIZE) ? TAIL_BLOCK_SIZE : start;
+        std::string block(size, '\0');
+        ssize_t length = pread(fd, &block[0], size, start - size);
+        if (length != (ssize_t)size)
+            break;
+        start -= size;
+        data.insert(0, block);
+
+        //The line feed at the end of the file does not start a new line
+        size_t end = data.size();
+        if (isFileEnd && (data[end - 1] == '\n'))
+            end--;
+        isFileEnd = false;
+
+        end = takeLines(data, end, start == 0, lines);
+        data.resize(end);
+
+        //A line longer than the byte limit is cut, there is no point in reading its start
+        if (!isDone && limits.bytes && (data.size() >= limits.bytes - byteCount))
+            takeLine(data.data(), data.size(), lines);
+    }
+    close(fd);
+
+    appendLines(lines, text);
+    return true;
+}
+
+bool TailReader::readGzipFile(const std::string &fileName, std::string &text)
+{
+    gzFile file = gzopen(fileName.c_str(), "rb");
+    if (!file)
+        return false;
+
+    //The lines are read oldest first, so the ring drops the oldest ones once it is over the limits
+    std::deque<std::string> ring;
+    unsigned long ringBytes = 0;
+    unsigned long lineLimit = limits.lines ? limits.lines - lineCount : 0;
+    unsigned long byteLimit = limits.bytes ? limits.bytes - byteCount : 0;
+    bool isDropped = false;
+    bool isOld = false;
+    std::string partial;
+    char buffer[GZIP_BLOCK_SIZE];
+    while (true)
+    {
+        int length = gzread(file, buffer, sizeof(buffer));
+        if (length < 0)
+            break;
+
+        const char *position = buffer;
+        const char *bufferEnd = buffer + length;
+        while (position < bufferEnd || ((length == 0) && !partial.empty()))
+        {
+            const char *newline = (const char *)memchr(position, '\n', bufferEnd - position);
+            if (!newline && (length > 0))
+            {
+                //The line continues in the next block
+                partial.append(position, bufferEnd - position);
+                if (byteLimit && (partial.size() > byteLimit))
+                    partial.erase(0, partial.size() - byteLimit);
+                break;
+            }
+            if (newline)
+                partial.append(position, newline - position);
+            position = newline ? newline + 1 : bufferEnd;
+
+            //The lines without a timestamp belong to the line before them
+            time_t logged = lineTime(partial.data(), partial.size());
+            if (logged != (time_t)-1)
+                isOld = oldest && (logged < oldest);
+            if (isOld)
+            {
+                isDropped = true;
+                partial.clear();
+                continue;
+            }
+
+            ringBytes += partial.size() + 1;
+            ring.push_back(std::string());
+            ring.back().swap(partial);
+            while ((lineLimit && (ring.size() > lineLimit)) || (byteLimit && (ringBytes > byteLimit)))
+            {
+                ringBytes -= ring.front().size() + 1;
+                ring.pop_front();
+                isDropped = true;
+            }
+        }
+        if (length == 0)
+            break;
+    }
+    gzclose(file);
+
+    for (std::deque<std::string>::const_iterator i = ring.begin(); i != ring.end(); ++i)
+    {
+        text += *i;
+        text += '\n';
+    }
+    lineCount += ring.size();
+    byteCount += ringBytes;
+    if (isDropped)
+        isDone = true;
+    return true;
+}
+
+void TailReader::readBuffer(const char *data, size_t size, std::string &text)
+{
+    std::vector<std::string> lines;
+    untimedLines = 0;
+    std::string buffer(data, size);
+    size_t end = buffer.size();
+    if ((end > 0) && (buffer[end - 1] == '\n'))
+        end--;
+    if (end > 0)
+        takeLines(buffer, end, true, lines);
+    appendLines(lines, text);
+}
+
+bool TailReader::isFull() const
+{
+    return isDone;
+}
+
+size_t TailReader::takeLines(const std::string &data, size_t end, bool isStart, std::vector<std::string> &lines)
+{
+    while (!isDone)
+    {
+        size_t newline = (end > 0) ? data.rfind('\n', end - 1) : std::string::npos;
+        if (newline == std::string::npos)
+        {
+            //The first line of the file is complete, any other one may start in the previous block
+            if (isStart)
+            {
+                takeLine(data.data(), end, lines);
+                return 0;
+            }
+            break;
+        }
+
+        if (!takeLine(data.data() + newline + 1, end - newline - 1, lines))
+            break;
+        end = newline;
+    }
+    return end;
+}
+
+bool TailReader::takeLine(const char *line, size_t length, std::vector<std::string> &lines)
+{
+    if (limits.lines && (lineCount >= limits.lines))
+    {
+        isDone = true;
+        return false;
+    }
+
+    if (oldest)
+    {
+        time_t logged = lineTime(line, length);
+        if ((logged != (time_t)-1) && (logged < oldest))
+        {
+            //The lines after it without a timestamp belong to it and are too old as well
+            for (; (untimedLines > 0) && !lines.empty(); untimedLines--)
+            {
+                byteCount -= lines.back().size() + 1;
+                lineCount--;
+                lines.pop_back();
+            }
+            isDone = true;
+            return false;
+        }
+        untimedLines = (logged == (time_t)-1) ? untimedLines + 1 : 0;
+    }
+
+    //The newest line that does not fit is cut from its start
+    if (limits.bytes && (byteCount + length + 1 > limits.bytes))
+    {
+        size_t room = limits.bytes - byteCount;
+        if (room > 1)
+            lines.push_back(std::string(line + length - (room - 1), room - 1));
+        byteCount = limits.bytes;
+        isDone = true;
+        return false;
+    }
+
+    lines.push_back(std::string(line, length));
+    lineCount++;
+    byteCount += length + 1;
+    return true;
+}
+
+void TailReader::appendLines(const std::vector<std::string> &lines, std::string &text)
+{
+    for (std::vector<std::string>::const_reverse_iterator i = lines.rbegin(); i != lines.rend(); ++i)
+    {
+        text += *i;
+        text += '\n';
+    }
+}
+
+time_t TailReader::lineTime(const char *line, size_t length) const
+{
+    if (format == SYSLOG_TIME)
+    {
+        //"Mmm dd hh:mm:ss", the year is not logged
+        static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+        if (length < 15)
+            return (time_t)-1;
+
+        int month = -1;
+        for (int i = 0; i < 12; i++)
+        {
+            if (strncmp(line, months + i * 3, 3) == 0)
+            {
+                month = i;
+                break;
+            }
+        }
+        int day, hour, minute, second;
+        char timestamp[16];
+        memcpy(timestamp, line + 3, 12);
+        timestamp[12] = '\0';
+        if ((month < 0) || (sscanf(timestamp, "%d %d:%d:%d", &day, &hour, &minute, &second) != 4))
+            return (time_t)-1;
+
+        time_t now = time(NULL);
+        struct tm logged;
+        localtime_r(&now, &logged);
+        logged.tm_mon = month;
+        logged.tm_mday = day;
+        logged.tm_hour = hour;
+        logged.tm_min = minute;
+        logged.tm_sec = second;
+        logged.tm_isdst = -1;
+        time_t result = mktime(&logged);
+        if (result > now + FUTURE_TOLERANCE)
+        {
+            logged.tm_year--;
+            logged.tm_isdst = -1;
+            result = mktime(&logged);
+        }
+        return result;
+    }
+
+    if (format == KERNEL_TIME)
+    {
+        //"[seconds.microseconds]" since boot, converted to the wall clock time with the uptime
+        if ((length < 3) || (line[0] != '['))
+            return (time_t)-1;
+
+        char timestamp[32];
+        size_t size = (length < sizeof(timestamp)) ? length : sizeof(timestamp) - 1;
+        memcpy(timestamp, line + 1, size - 1);
+        timestamp[size - 1] = '\0';
+        unsigned long seconds;
+        if (sscanf(timestamp, "%lu", &seconds) != 1)
+            return (time_t)-1;
+
+        struct timespec uptime;
+        if (clock_gettime(CLOCK_MONOTONIC, &uptime) != 0)
+            return (time_t)-1;
+        return time(NULL) - uptime.tv_sec + seconds;
+    }
+
+    return (time_t)-1;
+}
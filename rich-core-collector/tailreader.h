@@ -0,0 +1,147 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file tailreader.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class TailReader
+  * \brief Read the end of a log without reading all of it.
+  * A plain file is read backwards from its end in large blocks until enough lines have been found,
+  * a gzip compressed log is decompressed as a stream through a bounded ring of lines.  The lines are
+  * limited by their count, by their size and by their age, as given by the timestamps of the lines.
+  * The limits apply to all of the files read with the same reader, so the rotated logs of a source
+  * are read newest first until the limits are reached.
+  */
+
+#ifndef TAILREADER_H
+#define TAILREADER_H
+
+#include <stddef.h>
+#include <time.h>
+#include <string>
+#include <vector>
+
+class TailReader
+{
+public:
+    //! The timestamps at the start of the lines
+    enum TimeFormat
+    {
+        NO_TIME,      //!< The lines have no timestamps, they are not limited by age
+        SYSLOG_TIME,  //!< "Oct 18 07:57:01", the local time
+        KERNEL_TIME   //!< "[  123.456789]", the seconds since boot
+    };
+
+    /*!
+      * \brief The limits of a tail, 0 for no limit
+      */
+    struct Limits
+    {
+        unsigned long lines;    //!< The most lines to read
+        unsigned long bytes;    //!< The most bytes to read, line feeds included
+        unsigned long seconds;  //!< Only the lines logged during this many seconds before now
+    };
+
+    /*!
+      * \brief Constructor
+      * \param limits The limits of all of the files that are read
+      * \param format The timestamps of the lines, used for the age limit
+      */
+    TailReader(const Limits &limits, TimeFormat format);
+
+    /*!
+      * \brief Read the end of a file
+      * \param fileName The file to read
+      * \param text The lines are appended to this
+      * \return true if the file was read, false if it could not be opened
+      */
+    bool readFile(const std::string &fileName, std::string &text);
+
+    /*!
+      * \brief Read the end of a gzip compressed file
+      * The file is decompressed in full, but only the last lines are kept.
+      * \param fileName The file to read
+      * \param text The lines are appended to this
+      * \return true if the file was read, false if it could not be opened
+      */
+    bool readGzipFile(const std::string &fileName, std::string &text);
+
+    /*!
+      * \brief Read the end of text in memory
+      * \param data The text
+      * \param size The size of \a data in bytes
+      * \param text The lines are appended to this
+      */
+    void readBuffer(const char *data, size_t size, std::string &text);
+
+    /*!
+      * \brief Determine if a limit has been reached, the older files need not be read
+      */
+    bool isFull() const;
+
+private:
+    /*!
+      * \brief Take the complete lines from the end of \a data, newest first
+      * \param data The unprocessed text
+      * \param end The end of the text in \a data
+      * \param isStart true if \a data starts at the beginning of the file
+      * \param lines The lines that were taken, newest first
+      * \return The end of the text that was not taken
+      */
+    size_t takeLines(const std::string &data, size_t end, bool isStart, std::vector<std::string> &lines);
+
+    /*!
+      * \brief Take a line if it fits in the limits
+      * \return true if the line was taken, false if the tail is full
+      */
+    bool takeLine(const char *line, size_t length, std::vector<std::string> &lines);
+
+    /*!
+      * \brief Append the lines that were taken newest first to a text in their original order
+      */
+    static void appendLines(const std::vector<std::string> &lines, std::string &text);
+
+    /*!
+      * \brief Read the timestamp of a line
+      * \return The time the line was logged, (time_t)-1 if it has no timestamp
+      */
+    time_t lineTime(const char *line, size_t length) const;
+
+private:
+    //! The limits of all of the files
+    Limits limits;
+    //! The timestamps of the lines
+    TimeFormat format;
+    //! Lines logged before this are not read, 0 if they are not limited by age
+    time_t oldest;
+    //! The number of lines read so far
+    unsigned long lineCount;
+    //! The number of bytes read so far
+    unsigned long byteCount;
+    //! The number of the last lines taken that have no timestamp
+    unsigned long untimedLines;
+    //! true once a limit has been reached
+    bool isDone;
+};
+
+#endif // TAILREADER_H
@@ -0,0 +1,187 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "crc32c.h"
+
+#include <string.h>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define CRC32C_HARDWARE 1
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_HARDWARE 1
+#elif defined(__x86_64__) && defined(__GNUC__) && ((__GNUC__ > 4) || ((__GNUC__ == 4) && (__GNUC_MINOR__ >= 9)))
+#include <nmmintrin.h>
+/* The instruction is chosen when the program starts */
+#define CRC32C_DISPATCH 1
+#endif
+
+/* The reversed Castagnoli polynomial */
+#define CRC32C_POLYNOMIAL 0x82f63b78
+
+/* The tables for eight bytes at a time, table[0] is the usual byte table */
+static uint32_t table[8][256];
+
+#if defined(CRC32C_HARDWARE) || defined(CRC32C_DISPATCH)
+/* 1 if the CRC32 instruction is used, 0 if the tables are */
+static int use_hardware;
+#endif
+
+/*!
+  * \brief Fill the tables before main() runs, so the threads that use them do not race to do it
+  */
+static void __attribute__((constructor)) crc32c_initialize(void)
+{
+    unsigned int i, j;
+    for (i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLYNOMIAL : 0);
+        table[0][i] = crc;
+    }
+    for (i = 0; i < 256; i++)
+    {
+        for (j = 1; j < 8; j++)
+            table[j][i] = (table[j - 1][i] >> 8) ^ table[0][table[j - 1][i] & 0xff];
+    }
+#if defined(CRC32C_HARDWARE)
+    use_hardware = 1;
+#elif defined(CRC32C_DISPATCH)
+    __builtin_cpu_init();
+    use_hardware = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+/*!
+  * \brief Calculate the checksum from the tables, \a crc is not inverted
+  */
+static uint32_t crc32c_software(uint32_t crc, const unsigned char *data, size_t size)
+{
+    while (size && ((uintptr_t)data & 7))
+    {
+        crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xff];
+        size--;
+    }
+    while (size >= 8)
+    {
+        /* the tables are for little endian words, as the instructions are */
+        uint32_t low = crc ^ ((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16)
+                              | ((uint32_t)data[3] << 24));
+        crc = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^ table[5][(low >> 16) & 0xff]
+              ^ table[4][low >> 24] ^ table[3][data[4]] ^ table[2][data[5]] ^ table[1][data[6]]
+              ^ table[0][data[7]];
+        data += 8;
+        size -= 8;
+    }
+    while (size--)
+        crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xff];
+    return crc;
+}
+
+#if defined(CRC32C_HARDWARE) || defined(CRC32C_DISPATCH)
+/*!
+  * \brief Calculate the checksum with the CRC32 instruction, \a crc is not inverted
+  */
+#if defined(CRC32C_DISPATCH)
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t crc32c_hardware(uint32_t crc, const unsigned char *data, size_t size)
+{
+#if defined(__ARM_FEATURE_CRC32)
+    while (size && ((uintptr_t)data & 7))
+    {
+        crc = __crc32cb(crc, *data++);
+        size--;
+    }
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    while (size--)
+        crc = __crc32cb(crc, *data++);
+#elif defined(__x86_64__)
+    uint64_t crc64 = crc;
+    while (size && ((uintptr_t)data & 7))
+    {
+        crc64 = _mm_crc32_u8((uint32_t)crc64, *data++);
+        size--;
+    }
+    for (; size >= 8; size -= 8, data += 8)
+    {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+    while (size--)
+        crc = _mm_crc32_u8(crc, *data++);
+#else
+    while (size && ((uintptr_t)data & 3))
+    {
+        crc = _mm_crc32_u8(crc, *data++);
+        size--;
+    }
+    for (; size >= 4; size -= 4, data += 4)
+    {
+        uint32_t word;
+        memcpy(&word, data, sizeof(word));
+        crc = _mm_crc32_u32(crc, word);
+    }
+    while (size--)
+        crc = _mm_crc32_u8(crc, *data++);
+#endif
+    return crc;
+}
+#endif
+
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t size)
+{
+    crc = ~crc;
+#if defined(CRC32C_HARDWARE) || defined(CRC32C_DISPATCH)
+    if (use_hardware)
+        crc = crc32c_hardware(crc, (const unsigned char *)data, size);
+    else
+        crc = crc32c_software(crc, (const unsigned char *)data, size);
+#else
+    crc = crc32c_software(crc, (const unsigned char *)data, size);
+#endif
+    return ~crc;
+}
+
+int crc32c_use_hardware(int hardware)
+{
+#if defined(CRC32C_HARDWARE)
+    use_hardware = (hardware != 0);
+    return use_hardware;
+#elif defined(CRC32C_DISPATCH)
+    use_hardware = hardware && __builtin_cpu_supports("sse4.2");
+    return use_hardware;
+#else
+    (void)hardware;
+    return 0;
+#endif
+}
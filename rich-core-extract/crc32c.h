@@ -0,0 +1,65 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file crc32c.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \brief The CRC-32C (Castagnoli) checksum of the reduced cores and of the sections of rich cores.
+  *
+  * The CRC32 instruction of SSE 4.2 or ARMv8 is used when the compiler targets it.  On x86-64 it is
+  * also used when the processor that runs the code has it, otherwise the checksum is calculated
+  * eight bytes at a time from tables.  All of the ways give the same checksum, crc32c_use_hardware()
+  * chooses between them so that they can be compared.
+  */
+
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*!
+  * \brief Add data to a checksum
+  * \param crc The checksum of the data before \a data, 0 for the start
+  * \param data The data
+  * \param size The size of \a data in bytes
+  * \return The checksum of all of the data so far
+  */
+uint32_t crc32c_update(uint32_t crc, const void *data, size_t size);
+
+/*!
+  * \brief Choose between the CRC32 instruction and the tables, before any thread uses the checksums
+  * \param hardware 0 for the tables, otherwise the instruction if the processor has it
+  * \return 1 if the instruction is now used, 0 if the tables are
+  */
+int crc32c_use_hardware(int hardware);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CRC32C_H */
@@ -29,6 +29,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
+
+#include "smapsdecoder.h"
+#include "crc32c.h"
 
 #define RICHCORE_HEADER "[---rich-core: "
 #define RICHCORE_HEADER_END "---]\n"
@@ -45,6 +49,50 @@ const char *usage = "%s <input filename> [<output directory>]\n";
   */
 size_t memcspn(const void *mem, size_t memlen, const void *reject, size_t rejectlen);
 
+/* The binary smaps table written by rich-core-collector and the text it is decoded to */
+#define SMAPS_TABLE_SECTION "smaps.bin"
+#define SMAPS_TEXT_SECTION "smaps"
+
+/*!
+  * \brief Decode the binary smaps table of an extracted rich core back to the text of smaps
+  * \param output_dir The directory the rich core was extracted to
+  * \return 0 if there was no table or it was decoded, -1 on errors
+  */
+int decode_smaps(const char *output_dir);
+
+/* The last section of a rich core written by rich-core-collector, the checksums of the others */
+#define CHECKSUMS_SECTION "checksums"
+
+/*! The checksum of a section as it is extracted */
+struct section_sum
+{
+    char name[128];
+    uint32_t crc;
+    unsigned long long size;
+};
+/* The checksums of the sections in the order of the rich core */
+struct section_sum *sums = NULL;
+/* The number of entries of sums, the last is the section being extracted */
+int sum_count = 0;
+
+/*!
+  * \brief Write data to the section that is being extracted and add it to the checksum of the section
+  */
+void write_section(const char *data, size_t num, FILE *file);
+
+/*!
+  * \brief Start the checksum of a new section
+  * \param name The name the section is extracted to
+  */
+void start_section(const char *name);
+
+/*!
+  * \brief Compare the checksums of the extracted sections with the checksums section of the rich core
+  * \param output_dir The directory the rich core was extracted to
+  * \return 0 if there is no checksums section or all of the sections match it, -1 otherwise
+  */
+int check_sections(const char *output_dir);
+
 /* Buffer variables and functions */
 #define BUFFER_SIZE 4096 + 128
 /* Copy num bytes from data to buffer */
@@ -172,7 +220,7 @@ int main(int argc, char *argv[])
             /* If no start was found or start was after remaining bytes write remaining bytes to output_file, exit loop */
             if(start_of_header == size || start_of_header > remaining) 
             {
-                fwrite(buffer, 1, remaining, output_file);
+                write_section(buffer, remaining, output_file);
                 unbuffer_data(remaining);
 
                 /* If feof is true, process also extra bytes */
@@ -193,7 +241,7 @@ int main(int argc, char *argv[])
             if(start_of_header <= remaining)
             {
                 /* To not break binaries, don't write the \n before header */
-                fwrite(buffer, 1, start_of_header -1, output_file);
+                write_section(buffer, start_of_header -1, output_file);
                 remaining -= start_of_header;
 
                 /* If no end was found change output_file to /dev/null and write remaining bytes, exit loop */
@@ -201,7 +249,7 @@ int main(int argc, char *argv[])
                 {
                     fprintf(stderr, "skipping invalid rich core header\n");
                     output_file = fopen("/dev/null", "w");
-                    fwrite(buffer, 1, remaining, output_file);
+                    write_section(buffer, remaining, output_file);
                     unbuffer_data(remaining);
                     break;
                 }
@@ -225,6 +273,7 @@ int main(int argc, char *argv[])
     #endif
             fclose(output_file);
             output_file = fopen(fn, "w");
+            start_section(c);
             remaining -= (end_of_header - start_of_header);
             unbuffer_data(end_of_header - start_of_header);
 
@@ -239,12 +288,149 @@ int main(int argc, char *argv[])
     }
 
     /* Empty out the buffer */
-    fwrite(buffer, 1, size, output_file);
+    write_section(buffer, size, output_file);
     fclose(output_file);
-    pclose(input_file);
+    /* A rich core that was cut short or damaged makes lzop fail */
+    if (pclose(input_file))
+    {
+        fprintf(stderr, "error decompressing %s\n", input_fn);
+        exit(1);
+    }
+
+    if (check_sections(output_dir))
+        exit(1);
+    if (decode_smaps(output_dir))
+        exit(1);
     exit(0);
 }
 
+void write_section(const char *data, size_t num, FILE *file)
+{
+    fwrite(data, 1, num, file);
+    if (sum_count)
+    {
+        sums[sum_count - 1].crc = crc32c_update(sums[sum_count - 1].crc, data, num);
+        sums[sum_count - 1].size += num;
+    }
+}
+
+void start_section(const char *name)
+{
+    struct section_sum *more = realloc(sums, (sum_count + 1) * sizeof(*sums));
+    if (!more)
+    {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    sums = more;
+    snprintf(sums[sum_count].name, sizeof(sums[sum_count].name), "%s", name);
+    sums[sum_count].crc = 0;
+    sums[sum_count].size = 0;
+    sum_count++;
+}
+
+int check_sections(const char *output_dir)
+{
+    char checksums_fn[PATH_MAX];
+    char line[PATH_MAX + 64];
+    FILE *checksums_file;
+    int i = 0;
+    int result = 0;
+
+    /* The rich cores of rich-core-dumper do not have checksums */
+    if (!sum_count || strcmp(sums[sum_count - 1].name, CHECKSUMS_SECTION))
+        return 0;
+
+    snprintf(checksums_fn, sizeof(checksums_fn), "%s/%s", output_dir, CHECKSUMS_SECTION);
+    checksums_file = fopen(checksums_fn, "r");
+    if (!checksums_file)
+        return 0;
+
+    /* A line for each section before the checksums section: crc size name */
+    while (fgets(line, sizeof(line), checksums_file))
+    {
+        unsigned int crc;
+        unsigned long long section_size;
+        int name_start = 0;
+        const char *name;
+
+        line[strcspn(line, "\n")] = '\0';
+        if ((sscanf(line, "%8x %llu %n", &crc, &section_size, &name_start) < 2) || !name_start)
+            continue;
+        /* the sections are extracted to the base name of the header */
+        name = strrchr(line + name_start, '/');
+        name = name ? name + 1 : line + name_start;
+        if ((i >= sum_count - 1) || strcmp(name, sums[i].name))
+        {
+            fprintf(stderr, "section %s is missing\n", line + name_start);
+            result = -1;
+            break;
+        }
+        if ((crc != sums[i].crc) || (section_size != sums[i].size))
+        {
+            fprintf(stderr, "checksum mismatch in section %s\n", sums[i].name);
+            result = -1;
+        }
+        i++;
+    }
+    fclose(checksums_file);
+    return result;
+}
+
+static void write_smaps(void *context, const char *data, size_t size)
+{
+    fwrite(data, 1, size, (FILE *)context);
+}
+
+int decode_smaps(const char *output_dir)
+{
+    char table_fn[PATH_MAX];
+    char text_fn[PATH_MAX];
+    FILE *table_file;
+    FILE *text_file;
+    unsigned char *table;
+    long table_size;
+    int result;
+
+    snprintf(table_fn, sizeof(table_fn), "%s/%s", output_dir, SMAPS_TABLE_SECTION);
+    snprintf(text_fn, sizeof(text_fn), "%s/%s", output_dir, SMAPS_TEXT_SECTION);
+    table_file = fopen(table_fn, "r");
+    if (!table_file)
+        return 0;
+
+    fseek(table_file, 0, SEEK_END);
+    table_size = ftell(table_file);
+    rewind(table_file);
+    table = malloc(table_size > 0 ? table_size : 1);
+    if (!table || (fread(table, 1, table_size, table_file) != (size_t)table_size))
+    {
+        fprintf(stderr, "error reading %s\n", table_fn);
+        fclose(table_file);
+        free(table);
+        return -1;
+    }
+    fclose(table_file);
+
+    text_file = fopen(text_fn, "w");
+    if (!text_file)
+    {
+        fprintf(stderr, "error creating %s: %s\n", text_fn, strerror(errno));
+        free(table);
+        return -1;
+    }
+    result = smaps_decode(table, table_size, write_smaps, text_file);
+    free(table);
+    if (fclose(text_file) || result)
+    {
+        /* keep the table for inspection */
+        fprintf(stderr, "invalid smaps table in %s\n", table_fn);
+        unlink(text_fn);
+        return -1;
+    }
+    unlink(table_fn);
+    return 0;
+}
+
 void buffer_data(char* data, size_t num)
 {
     memcpy(&buffer[size], data, num);
@@ -0,0 +1,255 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "smapsdecoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*! A string of the string table, not terminated */
+struct smaps_string
+{
+    const char *data;
+    size_t size;
+};
+
+/*! The reading position in a table */
+struct smaps_reader
+{
+    const unsigned char *data;
+    size_t size;
+    size_t position;
+    int failed;
+};
+
+/*! The header line of a mapping */
+struct smaps_mapping
+{
+    unsigned long long start, size, offset, major, minor, inode;
+    unsigned long long perms, name;   /* string indexes */
+    unsigned long long lines;         /* attribute line count */
+    unsigned long long first_line;    /* index of the first attribute line in the line arrays */
+};
+
+/*!
+  * \brief Read an unsigned LEB128 varint, sets failed if it does not fit in the data
+  */
+static unsigned long long read_varint(struct smaps_reader *reader)
+{
+    unsigned long long value = 0;
+    int shift = 0;
+    while (!reader->failed)
+    {
+        unsigned char byte;
+        if ((reader->position >= reader->size) || (shift > 63))
+        {
+            reader->failed = 1;
+            break;
+        }
+        byte = reader->data[reader->position++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return value;
+        shift += 7;
+    }
+    return 0;
+}
+
+/*!
+  * \brief Read a varint that must be an index to the string table
+  */
+static unsigned long long read_index(struct smaps_reader *reader, unsigned long long count)
+{
+    unsigned long long index = read_varint(reader);
+    if (index >= count)
+        reader->failed = 1;
+    return reader->failed ? 0 : index;
+}
+
+/*!
+  * \brief Determine if a template has a number, the '\0' must be followed by the column
+  */
+static const char *template_number(const struct smaps_string *template)
+{
+    const char *number = memchr(template->data, '\0', template->size);
+    return (number && (number + 1 < template->data + template->size)) ? number : NULL;
+}
+
+/*!
+  * \brief Write a string of the string table
+  */
+static void write_string(const struct smaps_string *string, smaps_write_fn write, void *context)
+{
+    write(context, string->data, string->size);
+}
+
+int smaps_decode(const unsigned char *data, size_t size, smaps_write_fn write, void *context)
+{
+    struct smaps_reader reader = { data, size, SMAPS_MAGIC_SIZE, 0 };
+    struct smaps_string *strings = NULL;
+    struct smaps_mapping *mappings = NULL;
+    unsigned long long *templates = NULL;
+    unsigned long long *values = NULL;
+    unsigned long long string_count, mapping_count, line_count = 0, max_lines = 0, i, line;
+    int result = -1;
+
+    if ((size < SMAPS_MAGIC_SIZE) || memcmp(data, SMAPS_MAGIC, SMAPS_MAGIC_SIZE))
+        return -1;
+
+    /* every string, mapping and line takes at least a byte, which bounds the counts */
+    string_count = read_varint(&reader);
+    if (reader.failed || (string_count > size))
+        return -1;
+    strings = calloc(string_count + 1, sizeof(*strings));
+    if (!strings)
+        return -1;
+    for (i = 0; i < string_count; i++)
+    {
+        unsigned long long length = read_varint(&reader);
+        if (reader.failed || (length > reader.size - reader.position))
+            goto out;
+        strings[i].data = (const char *)data + reader.position;
+        strings[i].size = length;
+        reader.position += length;
+    }
+
+    mapping_count = read_varint(&reader);
+    if (reader.failed || (mapping_count > size))
+        goto out;
+    mappings = calloc(mapping_count + 1, sizeof(*mappings));
+    if (!mappings)
+        goto out;
+
+    /* the columns of the header lines */
+    for (i = 0; i < mapping_count; i++)
+        mappings[i].start = read_varint(&reader);
+    for (i = 0; i < mapping_count; i++)
+        mappings[i].size = read_varint(&reader);
+    for (i = 0; i < mapping_count; i++)
+        mappings[i].perms = read_index(&reader, string_count);
+    for (i = 0; i < mapping_count; i++)
+        mappings[i].offset = read_varint(&reader);
+    for (i = 0; i < mapping_count; i++)
+        mappings[i].major = read_varint(&reader);
+    for (i = 0; i < mapping_count; i++)
+        mappings[i].minor = read_varint(&reader);
+    for (i = 0; i < mapping_count; i++)
+        mappings[i].inode = read_varint(&reader);
+    for (i = 0; i < mapping_count; i++)
+        mappings[i].name = read_index(&reader, string_count);
+    for (i = 0; (i < mapping_count) && !reader.failed; i++)
+    {
+        mappings[i].lines = read_varint(&reader);
+        if (mappings[i].lines > size - line_count)
+            reader.failed = 1;
+        mappings[i].first_line = line_count;
+        line_count += mappings[i].lines;
+        if (mappings[i].lines > max_lines)
+            max_lines = mappings[i].lines;
+    }
+    if (reader.failed)
+        goto out;
+
+    /* the start addresses are relative to the end of the previous mapping, zigzag encoded */
+    for (i = 0; i < mapping_count; i++)
+    {
+        unsigned long long delta = mappings[i].start;
+        unsigned long long previous_end = (i > 0) ? mappings[i - 1].start + mappings[i - 1].size : 0;
+        mappings[i].start = previous_end + ((delta >> 1) ^ (0 - (delta & 1)));
+    }
+
+    /* the attribute lines are stored column by column */
+    templates = calloc(line_count + 1, sizeof(*templates));
+    values = calloc(line_count + 1, sizeof(*values));
+    if (!templates || !values)
+        goto out;
+    for (line = 0; (line < max_lines) && !reader.failed; line++)
+    {
+        unsigned long long shared = read_varint(&reader);
+        if (shared > string_count)
+            reader.failed = 1;
+        for (i = 0; (i < mapping_count) && !reader.failed; i++)
+        {
+            if (mappings[i].lines > line)
+                templates[mappings[i].first_line + line] = shared ? shared - 1 : read_index(&reader, string_count);
+        }
+        for (i = 0; (i < mapping_count) && !reader.failed; i++)
+        {
+            unsigned long long slot = mappings[i].first_line + line;
+            if ((mappings[i].lines > line) && template_number(&strings[templates[slot]]))
+                values[slot] = read_varint(&reader);
+        }
+    }
+    if (reader.failed || (reader.position != reader.size))
+        goto out;
+
+    /* and written mapping by mapping, as the kernel prints them */
+    for (i = 0; i < mapping_count; i++)
+    {
+        const struct smaps_mapping *mapping = &mappings[i];
+        char text[160];
+        int length = snprintf(text, sizeof(text), "%08llx-%08llx ", mapping->start, mapping->start + mapping->size);
+        write(context, text, length);
+        write_string(&strings[mapping->perms], write, context);
+        length = snprintf(text, sizeof(text), " %08llx %02llx:%02llx %llu", mapping->offset, mapping->major,
+                          mapping->minor, mapping->inode);
+        write(context, text, length);
+        write_string(&strings[mapping->name], write, context);
+        write(context, "\n", 1);
+
+        for (line = 0; line < mapping->lines; line++)
+        {
+            const struct smaps_string *template = &strings[templates[mapping->first_line + line]];
+            const char *number = template_number(template);
+            if (!number)
+            {
+                write_string(template, write, context);
+            }
+            else
+            {
+                /* right aligned to the column, with at least one space */
+                int prefix = number - template->data;
+                int column = (unsigned char)number[1];
+                int digits = snprintf(text, sizeof(text), "%llu", values[mapping->first_line + line]);
+                int spaces = column ? column - prefix - digits : 0;
+                if (column && (spaces < 1))
+                    spaces = 1;
+                write(context, template->data, prefix);
+                for (; spaces > 0; spaces--)
+                    write(context, " ", 1);
+                write(context, text, digits);
+                write(context, number + 2, template->data + template->size - number - 2);
+            }
+            write(context, "\n", 1);
+        }
+    }
+    result = 0;
+
+out:
+    free(values);
+    free(templates);
+    free(mappings);
+    free(strings);
+    return result;
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file smapsdecoder.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \brief Decode the binary smaps table of a rich core back to the text of /proc/pid/smaps.
+  *
+  * The table is written by rich-core-collector as the smaps.bin section.  All of the numbers are
+  * unsigned LEB128 varints, the signed ones zigzag encoded:
+  *
+  *   "RCSMAPS1"
+  *   string count, then each string as its length and its bytes
+  *   mapping count N
+  *   N start addresses, each as the signed difference to the end of the previous mapping
+  *   N sizes, N permission strings, N offsets, N device majors, N device minors, N inodes
+  *   N name strings, the text after the inode including its padding
+  *   N attribute line counts
+  *   the attribute lines column by column, for each line index:
+  *     the template string + 1 if all of the mappings that have that many lines share it, otherwise
+  *     0 and the template string of each of those mappings
+  *     the number of each of those mappings, if the template has a number
+  *
+  * A template is an attribute line with its number cut out and replaced by a '\0' byte and the
+  * column the number ends at, e.g. "Rss:" + '\0' + 26 + " kB".  The number is right aligned to
+  * the column with at least one space, column 0 means no spaces.  As the same templates repeat in
+  * every mapping, the table is a fraction of the size of the text.
+  */
+
+#ifndef SMAPSDECODER_H
+#define SMAPSDECODER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! The magic bytes at the start of a binary smaps table */
+#define SMAPS_MAGIC "RCSMAPS1"
+/*! The size of \a SMAPS_MAGIC */
+#define SMAPS_MAGIC_SIZE 8
+
+/*! Receives the decoded text */
+typedef void (*smaps_write_fn)(void *context, const char *data, size_t size);
+
+/*!
+  * \brief Decode a binary smaps table
+  * \param data The table
+  * \param size The size of \a data in bytes
+  * \param write Called with the text, in order
+  * \param context Passed to \a write
+  * \return 0 on success, -1 if the table is not valid
+  */
+int smaps_decode(const unsigned char *data, size_t size, smaps_write_fn write, void *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SMAPSDECODER_H */
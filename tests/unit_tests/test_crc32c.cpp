@@ -0,0 +1,113 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "test_crc32c.h"
+#include <string.h>
+
+//! The size of the data of sameChecksum_Test()
+#define CRC_TEST_SIZE 4096
+
+/*****************************************************
+  *
+  * Register tests with the CPPUNIT framework
+  *
+  ***************************************************/
+
+//register Test_Crc32c with the CppUnit testFramework
+CPPUNIT_TEST_SUITE_REGISTRATION (Test_Crc32c);
+
+void Test_Crc32c::setUp()
+{
+    //There is no way to read the choice without making it, the instruction is the default when there is one
+    wasHardware = crc32c_use_hardware(1);
+}
+
+void Test_Crc32c::tearDown()
+{
+    crc32c_use_hardware(wasHardware);
+}
+
+void Test_Crc32c::checkKnownValues()
+{
+    //The check value of CRC-32C
+    const char *check = "123456789";
+    CPPUNIT_ASSERT(crc32c_update(0, check, strlen(check)) == 0xe3069283);
+    uint32_t crc = 0;
+    for (size_t i = 0; i < strlen(check); i++)
+        crc = crc32c_update(crc, check + i, 1);
+    CPPUNIT_ASSERT(crc == 0xe3069283);
+
+    //The values of RFC 3720 B.4, long enough for the eight byte steps
+    unsigned char data[32];
+    memset(data, 0, sizeof(data));
+    CPPUNIT_ASSERT(crc32c_update(0, data, sizeof(data)) == 0x8a9136aa);
+    memset(data, 0xff, sizeof(data));
+    CPPUNIT_ASSERT(crc32c_update(0, data, sizeof(data)) == 0x62a8ab43);
+    for (unsigned int i = 0; i < sizeof(data); i++)
+        data[i] = i;
+    CPPUNIT_ASSERT(crc32c_update(0, data, sizeof(data)) == 0x46dd794e);
+
+    //No data leaves the checksum as it is
+    CPPUNIT_ASSERT(crc32c_update(0, data, 0) == 0);
+    CPPUNIT_ASSERT(crc32c_update(0x12345678, data, 0) == 0x12345678);
+}
+
+void Test_Crc32c::software_Test()
+{
+    CPPUNIT_ASSERT(crc32c_use_hardware(0) == 0);
+    checkKnownValues();
+}
+
+void Test_Crc32c::hardware_Test()
+{
+    if (!crc32c_use_hardware(1))
+        return; // the processor does not have the instruction
+    checkKnownValues();
+}
+
+void Test_Crc32c::sameChecksum_Test()
+{
+    unsigned char data[CRC_TEST_SIZE + 8];
+    uint32_t random = 1;
+    for (unsigned int i = 0; i < sizeof(data); i++)
+    {
+        random = random * 1103515245 + 12345;
+        data[i] = random >> 16;
+    }
+
+    //Every alignment and the sizes around the eight byte steps
+    for (unsigned int start = 0; start < 8; start++)
+    {
+        for (unsigned int size = 0; size <= CRC_TEST_SIZE; size += (size < 64) ? 1 : 509)
+        {
+            crc32c_use_hardware(0);
+            uint32_t software = crc32c_update(0, data + start, size);
+            uint32_t split = crc32c_update(crc32c_update(0, data + start, size / 3), data + start + size / 3,
+                                           size - size / 3);
+            crc32c_use_hardware(1);
+            uint32_t hardware = crc32c_update(0, data + start, size);
+            CPPUNIT_ASSERT(software == hardware);
+            CPPUNIT_ASSERT(software == split);
+        }
+    }
+}
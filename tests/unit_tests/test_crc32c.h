@@ -0,0 +1,82 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file test_crc32c.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Test_Crc32c
+  * \brief Contains the functionality for testing crc32c_update()
+  */
+
+#ifndef TEST_CRC32C_H
+#define TEST_CRC32C_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "crc32c.h"
+
+class Test_Crc32c : public CppUnit::TestFixture
+{
+    //Declare A test suite and the methods that are going to be called from it.
+    CPPUNIT_TEST_SUITE (Test_Crc32c);
+    CPPUNIT_TEST (software_Test);
+    CPPUNIT_TEST (hardware_Test);
+    CPPUNIT_TEST (sameChecksum_Test);
+    CPPUNIT_TEST_SUITE_END ();
+
+public:
+    /*!
+      * \brief Remember which way the checksums are calculated
+      */
+    void setUp();
+
+    /*!
+      * \brief Calculate the checksums the way they were before the test
+      */
+    void tearDown();
+
+protected:
+    /*!
+      * \brief Test the checksums calculated from the tables against known values
+      */
+    void software_Test();
+    /*!
+      * \brief Test the checksums calculated with the CRC32 instruction against known values
+      */
+    void hardware_Test();
+    /*!
+      * \brief Test that both ways give the same checksum for any size and alignment of the data
+      */
+    void sameChecksum_Test();
+
+private:
+    /*!
+      * \brief Check the checksums of the known values, in one piece and byte by byte
+      */
+    static void checkKnownValues();
+
+    //! 1 if the instruction was used before the test
+    int wasHardware;
+};
+
+#endif // TEST_CRC32C_H
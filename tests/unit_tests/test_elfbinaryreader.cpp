@@ -24,7 +24,17 @@
 #include "test_elfbinaryreader.h"
 #include "CppUnitSignalException.h"
 #include <limits.h>
+#include <string.h>
+#include <dlfcn.h>
 #include <exception>
+
+/*!
+  * \brief A function with a known name for the symbol lookup test to find
+  */
+static int symbolLookupTarget(int value)
+{
+    return value * 3;
+}
 /*****************************************************
   *
   * Register tests with the CPPUNIT framework
@@ -119,6 +129,48 @@ void Test_ElfBinaryReader::getSectionByType_Test()
     CPPUNIT_ASSERT((binarySectionData = binaryReader->getSectionByType(21)) == NULL);
 }
 
+void Test_ElfBinaryReader::buildId_Test()
+{
+    //The fixture is linked with the build id that the makefile gives
+    ElfBinaryReader reader;
+    CPPUNIT_ASSERT(reader.initalize("buildid_fixture") == true);
+    CPPUNIT_ASSERT_EQUAL(std::string(FIXTURE_BUILD_ID), reader.buildId());
+    //Asking again must give the same id
+    CPPUNIT_ASSERT_EQUAL(std::string(FIXTURE_BUILD_ID), reader.buildId());
+
+    //A binary linked without a build id has none
+    ElfBinaryReader withoutId;
+    CPPUNIT_ASSERT(withoutId.initalize("nobuildid_fixture") == true);
+    CPPUNIT_ASSERT(withoutId.buildId().empty());
+}
+
+void Test_ElfBinaryReader::findSymbol_Test()
+{
+    ElfBinaryReader reader;
+    CPPUNIT_ASSERT(reader.initalize("/proc/self/exe") == true);
+
+    //Nothing is mapped at address 0
+    CPPUNIT_ASSERT(reader.findSymbol(0) == NULL);
+
+    //The symbols hold link addresses, a position independent test binary is loaded at an offset
+    Dl_info info;
+    CPPUNIT_ASSERT(dladdr((void *)&symbolLookupTarget, &info) != 0);
+    ADDRESS address = (ADDRESS)&symbolLookupTarget;
+    if (reader.elfHeader()->e_type == ET_DYN)
+        address -= (ADDRESS)info.dli_fbase;
+
+    ADDRESS offset = 0;
+    const char *name = reader.findSymbol(address + 1, &offset);
+    CPPUNIT_ASSERT(name != NULL);
+    CPPUNIT_ASSERT(offset == 1);
+    CPPUNIT_ASSERT(ElfBinaryReader::demangle(name) == "symbolLookupTarget(int)");
+    //The second lookup uses the index that was created by the first
+    CPPUNIT_ASSERT(reader.findSymbol(address) == name);
+    //Plain C names are left as they are
+    CPPUNIT_ASSERT(ElfBinaryReader::demangle("main") == "main");
+    CPPUNIT_ASSERT(symbolLookupTarget(1) == 3);
+}
+
 void Test_ElfBinaryReader::close_Test()
 {
     //attempt to close the underlying file handles in the biary reader
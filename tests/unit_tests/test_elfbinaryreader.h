@@ -114,6 +114,8 @@ class Test_ElfBinaryReader : public CppUnit::TestFixture
     CPPUNIT_TEST (getSectionByIndex_Test);
     CPPUNIT_TEST (getSectionByAddress_Test);
     CPPUNIT_TEST (getSectionByType_Test);
+    CPPUNIT_TEST (buildId_Test);
+    CPPUNIT_TEST (findSymbol_Test);
     CPPUNIT_TEST (close_Test);
     CPPUNIT_TEST_SUITE_END ();
 
@@ -150,6 +152,14 @@ protected:
       * \brief Test ElfBinaryReader::getSectionByType()
       */
     void getSectionByType_Test();
+    /*!
+      * \brief Test ElfBinaryReader::buildId()
+      */
+    void buildId_Test();
+    /*!
+      * \brief Test ElfBinaryReader::findSymbol() and ElfBinaryReader::demangle()
+      */
+    void findSymbol_Test();
     /*!
       * \brief Test ElfBinaryReader::close()
       */
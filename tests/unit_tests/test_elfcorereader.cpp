@@ -177,3 +177,42 @@ void Test_ElfCoreReader::getSegmentByIndex_Test()
     segment = NULL;
 }
 
+void Test_ElfCoreReader::readFileNote_Test()
+{
+    //count, page size, then count * (start, end, page offset) and finally count file names
+    ADDRESS header[] = { 2, 0x1000, 0x1000, 0x3000, 0, 0x5000, 0x6000, 2 };
+    const char names[] = "/lib/a.so\0/lib/b.so";
+    std::string note((const char *)header, sizeof(header));
+    note.append(names, sizeof(names));
+
+    std::vector<ElfCoreReader::FileMapping> mappings;
+    CPPUNIT_ASSERT(ElfCoreReader::readFileNote(note.data(), note.size(), mappings));
+    CPPUNIT_ASSERT_EQUAL((size_t)2, mappings.size());
+    CPPUNIT_ASSERT_EQUAL((ADDRESS)0x1000, mappings.at(0).start);
+    CPPUNIT_ASSERT_EQUAL((ADDRESS)0x3000, mappings.at(0).end);
+    CPPUNIT_ASSERT_EQUAL((ADDRESS)0, mappings.at(0).fileOffset);
+    CPPUNIT_ASSERT_EQUAL(std::string("/lib/a.so"), std::string(mappings.at(0).name));
+    CPPUNIT_ASSERT_EQUAL((ADDRESS)0x5000, mappings.at(1).start);
+    CPPUNIT_ASSERT_EQUAL((ADDRESS)0x2000, mappings.at(1).fileOffset);
+    CPPUNIT_ASSERT_EQUAL(std::string("/lib/b.so"), std::string(mappings.at(1).name));
+
+    //The last name is not terminated, the mappings before it are still read
+    mappings.clear();
+    CPPUNIT_ASSERT(!ElfCoreReader::readFileNote(note.data(), note.size() - 1, mappings));
+    CPPUNIT_ASSERT_EQUAL((size_t)1, mappings.size());
+    CPPUNIT_ASSERT_EQUAL(std::string("/lib/a.so"), std::string(mappings.at(0).name));
+
+    //The mappings do not fit in the note
+    mappings.clear();
+    CPPUNIT_ASSERT(!ElfCoreReader::readFileNote(note.data(), sizeof(header) - sizeof(ADDRESS), mappings));
+    CPPUNIT_ASSERT(mappings.empty());
+
+    //A count so large that it wraps around when multiplied
+    header[0] = ~(ADDRESS)0 / 2;
+    CPPUNIT_ASSERT(!ElfCoreReader::readFileNote((const char *)header, sizeof(header), mappings));
+    CPPUNIT_ASSERT(mappings.empty());
+
+    //Too short to even hold the count and the page size
+    CPPUNIT_ASSERT(!ElfCoreReader::readFileNote((const char *)header, sizeof(ADDRESS), mappings));
+    CPPUNIT_ASSERT(mappings.empty());
+}
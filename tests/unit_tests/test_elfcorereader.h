@@ -105,6 +105,7 @@ class Test_ElfCoreReader : public CppUnit::TestFixture
     CPPUNIT_TEST (getSegmentByAddress_Test);
     CPPUNIT_TEST (getSegmentByType_Test);
     CPPUNIT_TEST (getSegmentByIndex_Test);
+    CPPUNIT_TEST (readFileNote_Test);
     CPPUNIT_TEST_SUITE_END ();
 
 public:
@@ -161,6 +162,12 @@ protected:
       */
     void getSegmentByIndex_Test();
 
+    /*!
+      * \brief Test ElfCoreReader::readFileNote()
+      * Test a whole note and notes that are cut or have a count that does not fit
+      */
+    void readFileNote_Test();
+
 private:
     ElfCoreReader *coreReader;
 };
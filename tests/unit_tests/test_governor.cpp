@@ -0,0 +1,261 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "test_governor.h"
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+//! The milliseconds that the capture ahead in the queue of queued_Test() and noQueueTimeout_Test() runs
+#define QUEUE_AHEAD_TIME 300
+
+/*!
+  * \brief Stop the process that holds the capture ahead in the queue after a while
+  */
+static void *stopCaptureAhead(void *argument)
+{
+    pid_t pid = *(pid_t *)argument;
+    usleep(QUEUE_AHEAD_TIME * 1000);
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    return NULL;
+}
+
+/*!
+  * \brief Get the milliseconds since a time
+  */
+static unsigned long elapsed(const struct timespec &start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+}
+
+/*****************************************************
+  *
+  * Register tests with the CPPUNIT framework
+  *
+  ***************************************************/
+
+//register Test_Governor with the CppUnit testFramework
+CPPUNIT_TEST_SUITE_REGISTRATION (Test_Governor);
+
+void Test_Governor::setUp()
+{
+    unlink(GOVERNOR_STATE);
+}
+
+void Test_Governor::tearDown()
+{
+    unlink(GOVERNOR_STATE);
+}
+
+Governor::Limits Test_Governor::limits(unsigned int captures, unsigned long memoryKb, unsigned long queueTimeout)
+{
+    Governor::Limits limits;
+    limits.captures = captures;
+    limits.memoryKb = memoryKb;
+    limits.queueTimeout = queueTimeout;
+    return limits;
+}
+
+void Test_Governor::writeState(const std::string &contents)
+{
+    FILE *file = fopen(GOVERNOR_STATE, "w");
+    CPPUNIT_ASSERT(file != NULL);
+    CPPUNIT_ASSERT(fwrite(contents.data(), 1, contents.size(), file) == contents.size());
+    fclose(file);
+}
+
+std::string Test_Governor::readState()
+{
+    std::string contents;
+    FILE *file = fopen(GOVERNOR_STATE, "r");
+    if (!file)
+        return contents;
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        contents.append(buffer, size);
+    fclose(file);
+    return contents;
+}
+
+std::string Test_Governor::captureLine(pid_t pid, const char *state, unsigned long memoryKb)
+{
+    char line[128];
+    snprintf(line, sizeof(line), "capture %d %s %lu 4242 crashed\n", pid, state, memoryKb);
+    return line;
+}
+
+void Test_Governor::admitted_Test()
+{
+    Governor governor;
+    governor.setLimits(limits(2, 1000, 0));
+    CPPUNIT_ASSERT(governor.admit(4242, "crashed", 100, 10) == Governor::ADMITTED);
+    CPPUNIT_ASSERT(governor.runningCaptures() == 0);
+    CPPUNIT_ASSERT(readState().find(captureLine(getpid(), "admitted", 100)) != std::string::npos);
+    CPPUNIT_ASSERT(readState().find("decisions 1 0 0\n") != std::string::npos);
+
+    //The capture is taken out of the state so that the next one can be admitted
+    governor.release();
+    CPPUNIT_ASSERT(readState().find(captureLine(getpid(), "admitted", 100)) == std::string::npos);
+
+    //Other captures within the limits, init and the parent of the tests are alive as long as the tests
+    writeState(captureLine(1, "admitted", 300) + captureLine(getppid(), "degraded", 10));
+    Governor second;
+    second.setLimits(limits(3, 1000, 0));
+    CPPUNIT_ASSERT(second.admit(4242, "crashed", 600, 10) == Governor::ADMITTED);
+    CPPUNIT_ASSERT(second.runningCaptures() == 2);
+    CPPUNIT_ASSERT(second.runningMemoryKb() == 310);
+}
+
+void Test_Governor::rejected_Test()
+{
+    writeState(captureLine(1, "admitted", 10) + captureLine(getppid(), "admitted", 10));
+    Governor governor;
+    governor.setLimits(limits(2, 0, 1));
+    CPPUNIT_ASSERT(governor.admit(4242, "crashed", 10, 10) == Governor::REJECTED);
+    CPPUNIT_ASSERT(governor.runningCaptures() == 2);
+
+    //A rejected capture is not left in the state
+    std::string state = readState();
+    CPPUNIT_ASSERT(state.find(captureLine(getpid(), "queued", 10)) == std::string::npos);
+    CPPUNIT_ASSERT(state.find("decisions 0 0 1\n") != std::string::npos);
+}
+
+void Test_Governor::degraded_Test()
+{
+    //There is room for another capture, but not for its memory
+    writeState(captureLine(1, "admitted", 600) + captureLine(getppid(), "admitted", 300));
+    Governor governor;
+    governor.setLimits(limits(3, 1000, 1));
+    CPPUNIT_ASSERT(governor.admit(4242, "crashed", 200, 20) == Governor::DEGRADED);
+    CPPUNIT_ASSERT(governor.runningMemoryKb() == 900);
+
+    //The degraded capture is registered with the memory it needs when degraded
+    std::string state = readState();
+    CPPUNIT_ASSERT(state.find(captureLine(getpid(), "degraded", 20)) != std::string::npos);
+    CPPUNIT_ASSERT(state.find("decisions 0 1 0\n") != std::string::npos);
+}
+
+void Test_Governor::queued_Test()
+{
+    //A collector that is alive is queued ahead, it is stopped while this one waits
+    pid_t ahead = fork();
+    CPPUNIT_ASSERT(ahead >= 0);
+    if (ahead == 0)
+    {
+        pause();
+        _exit(0);
+    }
+    writeState(captureLine(ahead, "queued", 10));
+    pthread_t stopper;
+    CPPUNIT_ASSERT(pthread_create(&stopper, NULL, stopCaptureAhead, &ahead) == 0);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Governor governor;
+    governor.setLimits(limits(0, 0, 10000));
+    Governor::Admission decision = governor.admit(4242, "crashed", 10, 10);
+    unsigned long waited = elapsed(start);
+    pthread_join(stopper, NULL);
+    CPPUNIT_ASSERT(decision == Governor::ADMITTED);
+    CPPUNIT_ASSERT(waited >= QUEUE_AHEAD_TIME);
+    CPPUNIT_ASSERT(waited < 10000);
+
+    //A capture that waits for its timeout is degraded
+    governor.release();
+    writeState(captureLine(1, "queued", 10));
+    Governor timedOut;
+    timedOut.setLimits(limits(0, 0, 200));
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    CPPUNIT_ASSERT(timedOut.admit(4242, "crashed", 10, 5) == Governor::DEGRADED);
+    CPPUNIT_ASSERT(elapsed(start) >= 200);
+}
+
+void Test_Governor::noQueueTimeout_Test()
+{
+    //Without a queue timeout a capture over the limits waits until it fits
+    pid_t ahead = fork();
+    CPPUNIT_ASSERT(ahead >= 0);
+    if (ahead == 0)
+    {
+        pause();
+        _exit(0);
+    }
+    writeState(captureLine(ahead, "admitted", 600));
+    pthread_t stopper;
+    CPPUNIT_ASSERT(pthread_create(&stopper, NULL, stopCaptureAhead, &ahead) == 0);
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    Governor governor;
+    governor.setLimits(limits(1, 1000, 0));
+    Governor::Admission decision = governor.admit(4242, "crashed", 600, 10);
+    unsigned long waited = elapsed(start);
+    pthread_join(stopper, NULL);
+    CPPUNIT_ASSERT(decision == Governor::ADMITTED);
+    CPPUNIT_ASSERT(waited >= QUEUE_AHEAD_TIME);
+}
+
+void Test_Governor::exitedCapture_Test()
+{
+    pid_t exited = fork();
+    CPPUNIT_ASSERT(exited >= 0);
+    if (exited == 0)
+        _exit(0);
+    CPPUNIT_ASSERT(waitpid(exited, NULL, 0) == exited);
+
+    //The collector that exited can not remove its capture, it is dropped when the state is read
+    writeState(captureLine(exited, "admitted", 500));
+    Governor governor;
+    governor.setLimits(limits(1, 100, 0));
+    CPPUNIT_ASSERT(governor.admit(4242, "crashed", 50, 5) == Governor::ADMITTED);
+    CPPUNIT_ASSERT(governor.runningCaptures() == 0);
+    CPPUNIT_ASSERT(readState().find(captureLine(exited, "admitted", 500)) == std::string::npos);
+}
+
+void Test_Governor::printStatus_Test()
+{
+    writeState("limits 2 1000 0\ndecisions 3 2 1\n" + captureLine(1, "admitted", 300)
+               + captureLine(getppid(), "queued", 10));
+
+    FILE *file = tmpfile();
+    CPPUNIT_ASSERT(file != NULL);
+    CPPUNIT_ASSERT(Governor::printStatus(file) == true);
+    rewind(file);
+    std::string status;
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        status.append(buffer, size);
+    fclose(file);
+
+    CPPUNIT_ASSERT(status.find("captures: 1 running, 1 queued, limit 2\n") != std::string::npos);
+    CPPUNIT_ASSERT(status.find("memory: 300 kB, limit 1000 kB\n") != std::string::npos);
+    CPPUNIT_ASSERT(status.find("since boot: 3 admitted, 2 degraded, 1 rejected\n") != std::string::npos);
+}
@@ -0,0 +1,116 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file test_governor.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Test_Governor
+  * \brief Contains the functionality for testing Governor
+  * The tests are built with a state file of their own in the current directory, the captures of other
+  * collectors are written in to it with the process ids of processes that are known to be alive.
+  */
+
+#ifndef TEST_GOVERNOR_H
+#define TEST_GOVERNOR_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "governor.h"
+
+class Test_Governor : public CppUnit::TestFixture
+{
+    //Declare A test suite and the methods that are going to be called from it.
+    CPPUNIT_TEST_SUITE (Test_Governor);
+    CPPUNIT_TEST (admitted_Test);
+    CPPUNIT_TEST (rejected_Test);
+    CPPUNIT_TEST (degraded_Test);
+    CPPUNIT_TEST (queued_Test);
+    CPPUNIT_TEST (noQueueTimeout_Test);
+    CPPUNIT_TEST (exitedCapture_Test);
+    CPPUNIT_TEST (printStatus_Test);
+    CPPUNIT_TEST_SUITE_END ();
+
+public:
+    /*!
+      * \brief Start from an empty state file
+      */
+    void setUp();
+
+    /*!
+      * \brief Remove the state file
+      */
+    void tearDown();
+
+protected:
+    /*!
+      * \brief Test Governor::admit() and Governor::release() within the limits
+      */
+    void admitted_Test();
+    /*!
+      * \brief Test that a capture over the count limit is rejected when its wait runs out
+      */
+    void rejected_Test();
+    /*!
+      * \brief Test that a capture over the memory limit is degraded when its wait runs out
+      */
+    void degraded_Test();
+    /*!
+      * \brief Test that a capture waits behind the one that arrived before it and is admitted when it exits
+      */
+    void queued_Test();
+    /*!
+      * \brief Test that a queue timeout of 0 is not applied, the capture waits until it fits
+      */
+    void noQueueTimeout_Test();
+    /*!
+      * \brief Test that the captures of collectors that have exited do not count
+      */
+    void exitedCapture_Test();
+    /*!
+      * \brief Test that Governor::printStatus() shows the captures and the decisions
+      */
+    void printStatus_Test();
+
+private:
+    /*!
+      * \brief Create the limits of a governor
+      */
+    static Governor::Limits limits(unsigned int captures, unsigned long memoryKb, unsigned long queueTimeout);
+
+    /*!
+      * \brief Replace the contents of the state file
+      */
+    static void writeState(const std::string &contents);
+
+    /*!
+      * \brief Read the contents of the state file
+      */
+    static std::string readState();
+
+    /*!
+      * \brief Get the line of a capture in the state file
+      */
+    static std::string captureLine(pid_t pid, const char *state, unsigned long memoryKb);
+};
+
+#endif // TEST_GOVERNOR_H
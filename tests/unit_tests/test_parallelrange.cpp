@@ -0,0 +1,246 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "test_parallelrange.h"
+#include "rawelfwriter.h"
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <pthread.h>
+
+//! The core file that the copy tests write
+#define COPY_TEST_FILE "parallelrange_test.core"
+
+/*!
+  * \brief The results of a run of a range
+  */
+struct RecordedRange
+{
+    pthread_mutex_t mutex;                      //!< Protects \a parts
+    std::vector<std::pair<size_t, size_t> > parts;   //!< The parts the work was run for
+    std::vector<int> counts;                    //!< How many times each item was run, written by its own part
+};
+
+/*****************************************************
+  *
+  * Register tests with the CPPUNIT framework
+  *
+  ***************************************************/
+
+//register Test_ParallelRange with the CppUnit testFramework
+CPPUNIT_TEST_SUITE_REGISTRATION (Test_ParallelRange);
+
+void Test_ParallelRange::setUp()
+{
+    //A note and memory segments of several copy pieces each, one of them with more memory than data
+    static const size_t sizes[] = { 200, 8 * 1024 * 1024 + 5, 1, 7 * 1024 * 1024 + 4095, 4097 };
+    ADDRESS address = 0x10000000;
+    for (unsigned int i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+        Phdr header;
+        memset(&header, 0, sizeof(header));
+        header.p_type = (i == 0) ? PT_NOTE : PT_LOAD;
+        header.p_flags = PF_R | PF_W;
+        header.p_filesz = sizes[i];
+        header.p_memsz = (i == 2) ? 0x3000 : sizes[i];
+        header.p_align = (i == 0) ? 4 : 0x1000;
+        if (i > 0)
+        {
+            header.p_vaddr = address;
+            address += (header.p_memsz + 0xffff) & ~(ADDRESS)0xfff;
+        }
+        headers.push_back(header);
+
+        std::string segment(sizes[i], '\0');
+        for (size_t j = 0; j < sizes[i]; j++)
+            segment[j] = (char)((j * 31 + i * 7) ^ (j >> 11));
+        data.push_back(segment);
+    }
+}
+
+void Test_ParallelRange::tearDown()
+{
+    unlink(COPY_TEST_FILE);
+}
+
+void Test_ParallelRange::recordPart(void *context, size_t begin, size_t end)
+{
+    RecordedRange *range = (RecordedRange *)context;
+    for (size_t i = begin; i < end; i++)
+        range->counts[i]++;
+    pthread_mutex_lock(&range->mutex);
+    range->parts.push_back(std::make_pair(begin, end));
+    pthread_mutex_unlock(&range->mutex);
+}
+
+std::vector<Test_ParallelRange::Part> Test_ParallelRange::runParts(size_t count, unsigned int threads, size_t minimum)
+{
+    RecordedRange range;
+    pthread_mutex_init(&range.mutex, NULL);
+    range.counts.resize(count, 0);
+    ParallelRange::run(count, threads, minimum, recordPart, &range);
+    pthread_mutex_destroy(&range.mutex);
+
+    //Every item is run once, by parts that follow each other without gaps
+    for (size_t i = 0; i < count; i++)
+        CPPUNIT_ASSERT(range.counts[i] == 1);
+    std::sort(range.parts.begin(), range.parts.end());
+    std::vector<Part> parts;
+    size_t next = 0;
+    for (unsigned int i = 0; i < range.parts.size(); i++)
+    {
+        CPPUNIT_ASSERT(range.parts[i].first == next);
+        CPPUNIT_ASSERT(range.parts[i].second > range.parts[i].first);
+        next = range.parts[i].second;
+        Part part = { range.parts[i].first, range.parts[i].second };
+        parts.push_back(part);
+    }
+    CPPUNIT_ASSERT(next == count);
+    return parts;
+}
+
+void Test_ParallelRange::partition_Test()
+{
+    //Nothing to run
+    CPPUNIT_ASSERT(runParts(0, 4, 1).empty());
+
+    //Equal parts
+    std::vector<Part> parts = runParts(1000, 4, 1);
+    CPPUNIT_ASSERT(parts.size() == 4);
+    for (unsigned int i = 0; i < parts.size(); i++)
+        CPPUNIT_ASSERT(parts[i].end - parts[i].begin == 250);
+
+    //Parts that differ by one item at most
+    parts = runParts(1001, 3, 0);
+    CPPUNIT_ASSERT(parts.size() == 3);
+    for (unsigned int i = 0; i < parts.size(); i++)
+        CPPUNIT_ASSERT((parts[i].end - parts[i].begin == 333) || (parts[i].end - parts[i].begin == 334));
+
+    //A single thread runs the whole range at once
+    parts = runParts(1000, 1, 1);
+    CPPUNIT_ASSERT(parts.size() == 1);
+
+    //Not more threads than items
+    parts = runParts(3, 8, 1);
+    CPPUNIT_ASSERT(parts.size() == 3);
+}
+
+void Test_ParallelRange::minimum_Test()
+{
+    //Only as many threads as have the minimum of items each
+    std::vector<Part> parts = runParts(10, 4, 5);
+    CPPUNIT_ASSERT(parts.size() == 2);
+    parts = runParts(100, 4, 16);
+    CPPUNIT_ASSERT(parts.size() == 4);
+    for (unsigned int i = 0; i < parts.size(); i++)
+        CPPUNIT_ASSERT(parts[i].end - parts[i].begin >= 16);
+
+    //Fewer items than the minimum are run in the calling thread
+    parts = runParts(15, 4, 16);
+    CPPUNIT_ASSERT(parts.size() == 1);
+}
+
+void Test_ParallelRange::processors_Test()
+{
+    unsigned int processors = ParallelRange::processors();
+    CPPUNIT_ASSERT(processors >= 1);
+
+    //0 threads is one per processor
+    std::vector<Part> parts = runParts(1000, 0, 1);
+    CPPUNIT_ASSERT(parts.size() == processors);
+}
+
+std::string Test_ParallelRange::writeCore(int threads, size_t pageSize)
+{
+    Ehdr elfHeader;
+    memset(&elfHeader, 0, sizeof(elfHeader));
+    memcpy(elfHeader.e_ident, ELFMAG, SELFMAG);
+    elfHeader.e_type = ET_CORE;
+    elfHeader.e_ehsize = sizeof(Ehdr);
+    elfHeader.e_phentsize = sizeof(Phdr);
+
+    RawElfWriter *writer = new RawElfWriter();
+    CPPUNIT_ASSERT(writer->initalize(COPY_TEST_FILE, headers.size(), 0) == true);
+    writer->copyElfHeader(&elfHeader);
+    writer->setPageSize(pageSize);
+    if (threads < 0)
+    {
+        for (unsigned int i = 0; i < headers.size(); i++)
+            CPPUNIT_ASSERT(writer->copySegment(&headers[i], data[i].data()) != NULL);
+    }
+    else
+    {
+        std::vector<const Phdr *> programHeaders;
+        std::vector<const char *> segmentData;
+        for (unsigned int i = 0; i < headers.size(); i++)
+        {
+            programHeaders.push_back(&headers[i]);
+            segmentData.push_back(data[i].data());
+        }
+        writer->setThreads(threads);
+        CPPUNIT_ASSERT(writer->copySegments(programHeaders, segmentData) == true);
+    }
+    CPPUNIT_ASSERT(writer->write() == true);
+    delete writer;
+
+    std::string contents;
+    FILE *file = fopen(COPY_TEST_FILE, "r");
+    CPPUNIT_ASSERT(file != NULL);
+    char buffer[64 * 1024];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        contents.append(buffer, size);
+    fclose(file);
+    return contents;
+}
+
+void Test_ParallelRange::copySegments_Test()
+{
+    static const size_t pageSizes[] = { 0, 4096 };
+    for (unsigned int i = 0; i < sizeof(pageSizes) / sizeof(pageSizes[0]); i++)
+    {
+        //The segments copied one by one are the reference
+        std::string expected = writeCore(-1, pageSizes[i]);
+        CPPUNIT_ASSERT(expected.size() > 15 * 1024 * 1024);
+        const Ehdr *elfHeader = (const Ehdr *)expected.data();
+        CPPUNIT_ASSERT(elfHeader->e_phnum == headers.size() + 1);
+
+        //The data of each segment is where its program header says, the checksum note follows the note
+        const Phdr *programHeaders = (const Phdr *)(expected.data() + elfHeader->e_phoff);
+        CPPUNIT_ASSERT(programHeaders[1].p_type == PT_NOTE);
+        for (unsigned int j = 0; j < headers.size(); j++)
+        {
+            const Phdr &header = programHeaders[(j == 0) ? 0 : j + 1];
+            CPPUNIT_ASSERT(header.p_filesz == headers[j].p_filesz);
+            CPPUNIT_ASSERT(header.p_vaddr == headers[j].p_vaddr);
+            CPPUNIT_ASSERT(expected.compare(header.p_offset, data[j].size(), data[j]) == 0);
+            if (pageSizes[i] && (headers[j].p_type == PT_LOAD))
+                CPPUNIT_ASSERT((header.p_offset % pageSizes[i]) == (headers[j].p_vaddr % pageSizes[i]));
+        }
+
+        static const int threadCounts[] = { 1, 2, 3, 0, 16 };
+        for (unsigned int j = 0; j < sizeof(threadCounts) / sizeof(threadCounts[0]); j++)
+            CPPUNIT_ASSERT(writeCore(threadCounts[j], pageSizes[i]) == expected);
+    }
+}
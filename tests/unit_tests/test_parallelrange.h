@@ -0,0 +1,114 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file test_parallelrange.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Test_ParallelRange
+  * \brief Contains the functionality for testing ParallelRange and the parallel copy of RawElfWriter
+  */
+
+#ifndef TEST_PARALLELRANGE_H
+#define TEST_PARALLELRANGE_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "parallelrange.h"
+#include "defines.h"
+#include <string>
+#include <vector>
+
+class Test_ParallelRange : public CppUnit::TestFixture
+{
+    //Declare A test suite and the methods that are going to be called from it.
+    CPPUNIT_TEST_SUITE (Test_ParallelRange);
+    CPPUNIT_TEST (partition_Test);
+    CPPUNIT_TEST (minimum_Test);
+    CPPUNIT_TEST (processors_Test);
+    CPPUNIT_TEST (copySegments_Test);
+    CPPUNIT_TEST_SUITE_END ();
+
+public:
+    /*!
+      * \brief Initalize data for the test cases
+      * \details Create segments that are large enough to be copied by several threads
+      */
+    void setUp();
+
+    /*!
+      * \brief Clean up after the tests have been run
+      */
+    void tearDown();
+
+protected:
+    /*!
+      * \brief Test that ParallelRange::run() gives every item to exactly one contiguous part
+      */
+    void partition_Test();
+    /*!
+      * \brief Test that ParallelRange::run() gives each thread at least the minimum of items
+      */
+    void minimum_Test();
+    /*!
+      * \brief Test ParallelRange::processors()
+      */
+    void processors_Test();
+    /*!
+      * \brief Test that RawElfWriter::copySegments() writes the same file with any number of threads
+      */
+    void copySegments_Test();
+
+private:
+    //! A part of the range that the work was run for
+    struct Part
+    {
+        size_t begin;   //!< The first item
+        size_t end;     //!< The item after the last
+    };
+
+    /*!
+      * \brief Run a range and check that the parts cover it
+      * \return The parts, in the order of their items
+      */
+    static std::vector<Part> runParts(size_t count, unsigned int threads, size_t minimum);
+
+    /*!
+      * \brief The work of the range, records its part and counts the items
+      */
+    static void recordPart(void *context, size_t begin, size_t end);
+
+    /*!
+      * \brief Write the test segments to a core file and read the file back
+      * \param threads The threads given to RawElfWriter::setThreads(), or -1 to copy the segments one by one
+      * \param pageSize The page size given to RawElfWriter::setPageSize()
+      * \return The contents of the file
+      */
+    std::string writeCore(int threads, size_t pageSize);
+
+    //! The program headers of the test segments
+    std::vector<Phdr> headers;
+    //! The data of the test segments
+    std::vector<std::string> data;
+};
+
+#endif // TEST_PARALLELRANGE_H
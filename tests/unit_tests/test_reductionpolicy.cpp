@@ -0,0 +1,218 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "test_reductionpolicy.h"
+#include <stdio.h>
+#include <unistd.h>
+
+//! The policy file that the tests write and load
+#define POLICY_TEST_FILE "reductionpolicy_test.policy"
+
+/*****************************************************
+  *
+  * Register tests with the CPPUNIT framework
+  *
+  ***************************************************/
+
+//register Test_ReductionPolicy with the CppUnit testFramework
+CPPUNIT_TEST_SUITE_REGISTRATION (Test_ReductionPolicy);
+
+void Test_ReductionPolicy::setUp()
+{
+    FILE *file = fopen(POLICY_TEST_FILE, "w");
+    CPPUNIT_ASSERT(file != NULL);
+    fputs("# the settings of every application\n"
+          "[*]\n"
+          "stack-depth = 16k\n"
+          "compression = 3\n"
+          "\n"
+          "[/usr/bin/Xorg]\n"
+          "  stack-depth =  64k  \n"
+          "byte-budget = 4M\n"
+          "not a setting\n"
+          "unknown-key = 1\n"
+          "heap-depth = lots\n"
+          "[Xorg]\n"
+          "heap-depth = 2\n"
+          "[/usr/lib/*/helper]\n"
+          "reduce = false\n"
+          "[bro?en\n"
+          "compression = 9\n"
+          "[*d]\n"
+          "stack-depth = 1k\n"
+          "layout = aligned\n", file);
+    fclose(file);
+    CPPUNIT_ASSERT(policy.load(POLICY_TEST_FILE) == true);
+}
+
+void Test_ReductionPolicy::tearDown()
+{
+    unlink(POLICY_TEST_FILE);
+}
+
+void Test_ReductionPolicy::set_Test()
+{
+    ReductionPolicy::Settings settings;
+    CPPUNIT_ASSERT(settings.fields == 0);
+
+    CPPUNIT_ASSERT(settings.set("stack-depth", "16k") == true);
+    CPPUNIT_ASSERT(settings.stackDepth == 16 * 1024);
+    CPPUNIT_ASSERT(settings.set("byte-budget", "4M") == true);
+    CPPUNIT_ASSERT(settings.byteBudget == 4 * 1024 * 1024);
+    CPPUNIT_ASSERT(settings.set("code-window", "0x100") == true);
+    CPPUNIT_ASSERT(settings.codeWindow == 0x100);
+    CPPUNIT_ASSERT(settings.set("heap-depth", "3") == true);
+    CPPUNIT_ASSERT(settings.heapDepth == 3);
+    CPPUNIT_ASSERT(settings.set("reduce", "false") == true);
+    CPPUNIT_ASSERT(settings.isReduced == false);
+    CPPUNIT_ASSERT(settings.set("link-map", "false") == true);
+    CPPUNIT_ASSERT(settings.isLinkMapIncluded == false);
+    CPPUNIT_ASSERT(settings.set("compression", "7") == true);
+    CPPUNIT_ASSERT(settings.compression == 7);
+    CPPUNIT_ASSERT(settings.set("notes", "prpsinfo,auxv") == true);
+    CPPUNIT_ASSERT_EQUAL(std::string("prpsinfo,auxv"), settings.notes);
+    CPPUNIT_ASSERT(settings.set("layout", "aligned") == true);
+    CPPUNIT_ASSERT(settings.isPageAligned == true);
+
+    //The globs are trimmed and the empty ones dropped
+    CPPUNIT_ASSERT(settings.set("mappings", " *.so* , ,/usr/lib/libfoo.so") == true);
+    CPPUNIT_ASSERT(settings.mappings.size() == 2);
+    CPPUNIT_ASSERT_EQUAL(std::string("*.so*"), settings.mappings.at(0));
+    CPPUNIT_ASSERT_EQUAL(std::string("/usr/lib/libfoo.so"), settings.mappings.at(1));
+
+    CPPUNIT_ASSERT(settings.fields == (ReductionPolicy::Settings::Reduce | ReductionPolicy::Settings::StackDepth
+                                       | ReductionPolicy::Settings::ByteBudget | ReductionPolicy::Settings::HeapDepth
+                                       | ReductionPolicy::Settings::CodeWindow | ReductionPolicy::Settings::Mappings
+                                       | ReductionPolicy::Settings::LinkMap | ReductionPolicy::Settings::Compression
+                                       | ReductionPolicy::Settings::Notes | ReductionPolicy::Settings::Layout));
+}
+
+void Test_ReductionPolicy::setInvalid_Test()
+{
+    ReductionPolicy::Settings settings;
+    CPPUNIT_ASSERT(settings.set("no-such-key", "1") == false);
+    CPPUNIT_ASSERT(settings.set("stack-depth", "") == false);
+    CPPUNIT_ASSERT(settings.set("stack-depth", "-1") == false);
+    CPPUNIT_ASSERT(settings.set("stack-depth", "16x") == false);
+    CPPUNIT_ASSERT(settings.set("stack-depth", "16kB") == false);
+    CPPUNIT_ASSERT(settings.set("reduce", "yes") == false);
+    CPPUNIT_ASSERT(settings.set("compression", "0") == false);
+    CPPUNIT_ASSERT(settings.set("compression", "10") == false);
+    CPPUNIT_ASSERT(settings.set("compression", "5a") == false);
+    CPPUNIT_ASSERT(settings.set("notes", "prpsinfo,no-such-note") == false);
+    CPPUNIT_ASSERT(settings.set("layout", "sparse") == false);
+
+    //Nothing was set by the values that are not valid
+    CPPUNIT_ASSERT(settings.fields == 0);
+    CPPUNIT_ASSERT(settings.stackDepth == 0);
+    CPPUNIT_ASSERT(settings.compression == 0);
+    CPPUNIT_ASSERT_EQUAL(std::string("all"), settings.notes);
+}
+
+void Test_ReductionPolicy::apply_Test()
+{
+    ReductionPolicy::Settings base;
+    CPPUNIT_ASSERT(base.set("stack-depth", "1k") == true);
+    CPPUNIT_ASSERT(base.set("compression", "3") == true);
+
+    //Only the settings that are set in the other override
+    ReductionPolicy::Settings other;
+    CPPUNIT_ASSERT(other.set("compression", "9") == true);
+    CPPUNIT_ASSERT(other.set("layout", "aligned") == true);
+    base.apply(other);
+    CPPUNIT_ASSERT(base.stackDepth == 1024);
+    CPPUNIT_ASSERT(base.compression == 9);
+    CPPUNIT_ASSERT(base.isPageAligned == true);
+    CPPUNIT_ASSERT(base.has(ReductionPolicy::Settings::StackDepth));
+    CPPUNIT_ASSERT(base.has(ReductionPolicy::Settings::Layout));
+    CPPUNIT_ASSERT(!base.has(ReductionPolicy::Settings::ByteBudget));
+}
+
+void Test_ReductionPolicy::load_Test()
+{
+    ReductionPolicy missing;
+    CPPUNIT_ASSERT(missing.load("reductionpolicy_test.missing") == false);
+    CPPUNIT_ASSERT(missing.size() == 0);
+
+    //The rule with no closing bracket is skipped along with its settings
+    CPPUNIT_ASSERT(policy.size() == 5);
+    ReductionPolicy::Settings settings = policy.match("/usr/bin/bro?en", "bro?en");
+    CPPUNIT_ASSERT(settings.compression == 3);
+}
+
+void Test_ReductionPolicy::match_Test()
+{
+    //Only [*] matches
+    ReductionPolicy::Settings settings = policy.match("/bin/cat", "");
+    CPPUNIT_ASSERT(settings.stackDepth == 16 * 1024);
+    CPPUNIT_ASSERT(settings.compression == 3);
+    CPPUNIT_ASSERT(settings.fields == (ReductionPolicy::Settings::StackDepth | ReductionPolicy::Settings::Compression));
+
+    //The exact path and the exact name both match, the settings that were not valid are skipped
+    settings = policy.match("/usr/bin/Xorg", "");
+    CPPUNIT_ASSERT(settings.stackDepth == 64 * 1024);
+    CPPUNIT_ASSERT(settings.byteBudget == 4 * 1024 * 1024);
+    CPPUNIT_ASSERT(settings.heapDepth == 2);
+    CPPUNIT_ASSERT(settings.compression == 3);
+    CPPUNIT_ASSERT(!settings.has(ReductionPolicy::Settings::Layout));
+
+    //The name is given apart from the path
+    settings = policy.match("/opt/bin/X", "Xorg");
+    CPPUNIT_ASSERT(settings.stackDepth == 16 * 1024);
+    CPPUNIT_ASSERT(settings.heapDepth == 2);
+    CPPUNIT_ASSERT(!settings.has(ReductionPolicy::Settings::ByteBudget));
+
+    //A path glob, the '*' of fnmatch matches a '/' as well
+    settings = policy.match("/usr/lib/a/b/helper", "");
+    CPPUNIT_ASSERT(settings.isReduced == false);
+    settings = policy.match("/usr/lib/helper2", "");
+    CPPUNIT_ASSERT(settings.isReduced == true);
+
+    //The later rules override the earlier ones, whether they are exact or globs
+    settings = policy.match("/usr/sbin/crashd", "");
+    CPPUNIT_ASSERT(settings.stackDepth == 1024);
+    CPPUNIT_ASSERT(settings.isPageAligned == true);
+    settings = policy.match("/usr/bin/Xorg", "Xorgd");
+    CPPUNIT_ASSERT(settings.stackDepth == 1024);
+    CPPUNIT_ASSERT(settings.byteBudget == 4 * 1024 * 1024);
+    CPPUNIT_ASSERT(!settings.has(ReductionPolicy::Settings::HeapDepth));
+
+    //An empty policy sets nothing
+    ReductionPolicy empty;
+    CPPUNIT_ASSERT(empty.match("/bin/cat", "").fields == 0);
+}
+
+void Test_ReductionPolicy::isMappingWanted_Test()
+{
+    std::vector<std::string> patterns;
+    CPPUNIT_ASSERT(ReductionPolicy::isMappingWanted(patterns, "/usr/lib/libc.so.6") == false);
+
+    //A glob without a '/' is matched against the file name, one with a '/' against the path
+    patterns.push_back("*.so*");
+    patterns.push_back("/opt/*/data");
+    CPPUNIT_ASSERT(ReductionPolicy::isMappingWanted(patterns, "/usr/lib/libc.so.6") == true);
+    CPPUNIT_ASSERT(ReductionPolicy::isMappingWanted(patterns, "/usr/lib/so/libc") == false);
+    CPPUNIT_ASSERT(ReductionPolicy::isMappingWanted(patterns, "/opt/app/data") == true);
+    CPPUNIT_ASSERT(ReductionPolicy::isMappingWanted(patterns, "/var/app/data") == false);
+    CPPUNIT_ASSERT(ReductionPolicy::isMappingWanted(patterns, "data") == false);
+}
@@ -0,0 +1,93 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file test_reductionpolicy.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Test_ReductionPolicy
+  * \brief Contains the functionality for testing ReductionPolicy
+  */
+
+#ifndef TEST_REDUCTIONPOLICY_H
+#define TEST_REDUCTIONPOLICY_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "reductionpolicy.h"
+
+class Test_ReductionPolicy : public CppUnit::TestFixture
+{
+    //Declare A test suite and the methods that are going to be called from it.
+    CPPUNIT_TEST_SUITE (Test_ReductionPolicy);
+    CPPUNIT_TEST (set_Test);
+    CPPUNIT_TEST (setInvalid_Test);
+    CPPUNIT_TEST (apply_Test);
+    CPPUNIT_TEST (load_Test);
+    CPPUNIT_TEST (match_Test);
+    CPPUNIT_TEST (isMappingWanted_Test);
+    CPPUNIT_TEST_SUITE_END ();
+
+public:
+    /*!
+      * \brief Initalize data for the test cases
+      * \details Write a policy file with rules of every kind and lines that are not valid
+      */
+    void setUp();
+
+    /*!
+      * \brief Clean up after the tests have been run
+      */
+    void tearDown();
+
+protected:
+    /*!
+      * \brief Test ReductionPolicy::Settings::set() with valid values
+      */
+    void set_Test();
+    /*!
+      * \brief Test that ReductionPolicy::Settings::set() rejects the keys and values that are not valid
+      */
+    void setInvalid_Test();
+    /*!
+      * \brief Test ReductionPolicy::Settings::apply()
+      */
+    void apply_Test();
+    /*!
+      * \brief Test ReductionPolicy::load()
+      */
+    void load_Test();
+    /*!
+      * \brief Test ReductionPolicy::match() with exact and glob patterns of names and paths
+      */
+    void match_Test();
+    /*!
+      * \brief Test ReductionPolicy::isMappingWanted()
+      */
+    void isMappingWanted_Test();
+
+private:
+    //! The policy loaded from the test file
+    ReductionPolicy policy;
+};
+
+#endif // TEST_REDUCTIONPOLICY_H
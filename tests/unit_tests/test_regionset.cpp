@@ -0,0 +1,138 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "test_regionset.h"
+
+//! The address of the test segment
+#define SEGMENT_ADDRESS 0x10000
+
+/*****************************************************
+  *
+  * Register tests with the CPPUNIT framework
+  *
+  ***************************************************/
+
+//register Test_RegionSet with the CppUnit testFramework
+CPPUNIT_TEST_SUITE_REGISTRATION (Test_RegionSet);
+
+void Test_RegionSet::checkRegion(const RegionSet &set, ADDRESS start, ADDRESS end, const char *data)
+{
+    RegionSet::const_iterator region = set.begin();
+    while ((region != set.end()) && (region->first != start))
+        ++region;
+    CPPUNIT_ASSERT(region != set.end());
+    CPPUNIT_ASSERT(region->second.start == start);
+    CPPUNIT_ASSERT(region->second.end == end);
+    CPPUNIT_ASSERT(region->second.data == data);
+}
+
+void Test_RegionSet::empty_Test()
+{
+    RegionSet set;
+    CPPUNIT_ASSERT(set.size() == 0);
+    CPPUNIT_ASSERT(set.bytes() == 0);
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS, SEGMENT_ADDRESS, PF_R, segment) == 0);
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS + 1, SEGMENT_ADDRESS, PF_R, segment) == 0);
+    CPPUNIT_ASSERT(set.size() == 0);
+}
+
+void Test_RegionSet::adjacent_Test()
+{
+    RegionSet set;
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS + 0x100, SEGMENT_ADDRESS + 0x200, PF_R, segment + 0x100) == 0x100);
+    //After the region
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS + 0x200, SEGMENT_ADDRESS + 0x300, PF_R, segment + 0x200) == 0x100);
+    CPPUNIT_ASSERT(set.size() == 1);
+    //Before the region, the merged region starts with the data of the new one
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS, SEGMENT_ADDRESS + 0x100, PF_R, segment) == 0x100);
+    CPPUNIT_ASSERT(set.size() == 1);
+    CPPUNIT_ASSERT(set.bytes() == 0x300);
+    checkRegion(set, SEGMENT_ADDRESS, SEGMENT_ADDRESS + 0x300, segment);
+}
+
+void Test_RegionSet::overlapping_Test()
+{
+    RegionSet set;
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS + 0x100, SEGMENT_ADDRESS + 0x300, PF_R, segment + 0x100) == 0x200);
+    //Only the bytes that were not in the set are counted
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS + 0x200, SEGMENT_ADDRESS + 0x400, PF_R, segment + 0x200) == 0x100);
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS + 0x80, SEGMENT_ADDRESS + 0x180, PF_R, segment + 0x80) == 0x80);
+    //Inside the region
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS + 0x180, SEGMENT_ADDRESS + 0x190, PF_R, segment + 0x180) == 0);
+    //Around the region
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS, SEGMENT_ADDRESS + 0x500, PF_R, segment) == 0x180);
+    CPPUNIT_ASSERT(set.size() == 1);
+    CPPUNIT_ASSERT(set.bytes() == 0x500);
+    checkRegion(set, SEGMENT_ADDRESS, SEGMENT_ADDRESS + 0x500, segment);
+}
+
+void Test_RegionSet::bridging_Test()
+{
+    //Three stacks apart from each other and a window that reaches from the first to the last
+    RegionSet set;
+    set.add(SEGMENT_ADDRESS + 0x100, SEGMENT_ADDRESS + 0x200, PF_R | PF_W, segment + 0x100);
+    set.add(SEGMENT_ADDRESS + 0x400, SEGMENT_ADDRESS + 0x500, PF_R | PF_W, segment + 0x400);
+    set.add(SEGMENT_ADDRESS + 0x700, SEGMENT_ADDRESS + 0x800, PF_R | PF_W, segment + 0x700);
+    set.add(SEGMENT_ADDRESS + 0xa00, SEGMENT_ADDRESS + 0xb00, PF_R | PF_W, segment + 0xa00);
+    CPPUNIT_ASSERT(set.size() == 4);
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS + 0x180, SEGMENT_ADDRESS + 0x780, PF_R | PF_W, segment + 0x180) == 0x400);
+    CPPUNIT_ASSERT(set.size() == 2);
+    CPPUNIT_ASSERT(set.bytes() == 0x800);
+    checkRegion(set, SEGMENT_ADDRESS + 0x100, SEGMENT_ADDRESS + 0x800, segment + 0x100);
+    checkRegion(set, SEGMENT_ADDRESS + 0xa00, SEGMENT_ADDRESS + 0xb00, segment + 0xa00);
+
+    //A window that only touches the regions on both sides closes the gap between them
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS + 0x800, SEGMENT_ADDRESS + 0xa00, PF_R | PF_W, segment + 0x800) == 0x200);
+    CPPUNIT_ASSERT(set.size() == 1);
+    checkRegion(set, SEGMENT_ADDRESS + 0x100, SEGMENT_ADDRESS + 0xb00, segment + 0x100);
+
+    //No region in the set overlaps another
+    ADDRESS previousEnd = 0;
+    for (RegionSet::const_iterator i = set.begin(); i != set.end(); ++i)
+    {
+        CPPUNIT_ASSERT(i->second.start >= previousEnd);
+        previousEnd = i->second.end;
+    }
+}
+
+void Test_RegionSet::notMergeable_Test()
+{
+    char other[0x1000];
+    RegionSet set;
+    set.add(SEGMENT_ADDRESS + 0x100, SEGMENT_ADDRESS + 0x200, PF_R, segment + 0x100);
+
+    //Touching with other flags or with data from elsewhere, the regions stay apart
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS + 0x200, SEGMENT_ADDRESS + 0x300, PF_R | PF_X, segment + 0x200) == 0x100);
+    CPPUNIT_ASSERT(set.add(SEGMENT_ADDRESS, SEGMENT_ADDRESS + 0x100, PF_R, other) == 0x100);
+    CPPUNIT_ASSERT(set.size() == 3);
+
+    //Overlapping, the region that is already in the set is kept and the new one is added around it
+    RegionSet overlapped;
+    overlapped.add(SEGMENT_ADDRESS + 0x100, SEGMENT_ADDRESS + 0x200, PF_R, segment + 0x100);
+    CPPUNIT_ASSERT(overlapped.add(SEGMENT_ADDRESS, SEGMENT_ADDRESS + 0x300, PF_R, other) == 0x200);
+    CPPUNIT_ASSERT(overlapped.size() == 3);
+    CPPUNIT_ASSERT(overlapped.bytes() == 0x300);
+    checkRegion(overlapped, SEGMENT_ADDRESS, SEGMENT_ADDRESS + 0x100, other);
+    checkRegion(overlapped, SEGMENT_ADDRESS + 0x100, SEGMENT_ADDRESS + 0x200, segment + 0x100);
+    checkRegion(overlapped, SEGMENT_ADDRESS + 0x200, SEGMENT_ADDRESS + 0x300, other + 0x200);
+}
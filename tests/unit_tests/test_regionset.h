@@ -0,0 +1,85 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file test_regionset.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Test_RegionSet
+  * \brief Contains the functionality for testing RegionSet
+  */
+
+#ifndef TEST_REGIONSET_H
+#define TEST_REGIONSET_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "regionset.h"
+
+class Test_RegionSet : public CppUnit::TestFixture
+{
+    //Declare A test suite and the methods that are going to be called from it.
+    CPPUNIT_TEST_SUITE (Test_RegionSet);
+    CPPUNIT_TEST (empty_Test);
+    CPPUNIT_TEST (adjacent_Test);
+    CPPUNIT_TEST (overlapping_Test);
+    CPPUNIT_TEST (bridging_Test);
+    CPPUNIT_TEST (notMergeable_Test);
+    CPPUNIT_TEST_SUITE_END ();
+
+protected:
+    /*!
+      * \brief Test that an empty region is not added
+      */
+    void empty_Test();
+    /*!
+      * \brief Test that regions that touch are merged
+      */
+    void adjacent_Test();
+    /*!
+      * \brief Test that regions that overlap are merged and their bytes are counted once
+      */
+    void overlapping_Test();
+    /*!
+      * \brief Test that a region that reaches over several regions is merged with all of them
+      */
+    void bridging_Test();
+    /*!
+      * \brief Test that regions with different flags or data that is not contiguous are kept apart
+      */
+    void notMergeable_Test();
+
+private:
+    /*!
+      * \brief Check that the set has a region
+      * \param set The set
+      * \param start The first address of the region
+      * \param end The address one past the end of the region
+      * \param data The data that the region must start with
+      */
+    static void checkRegion(const RegionSet &set, ADDRESS start, ADDRESS end, const char *data);
+
+    //! The memory of a segment that the regions are parts of
+    char segment[0x1000];
+};
+
+#endif // TEST_REGIONSET_H
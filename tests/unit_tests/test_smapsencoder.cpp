@@ -0,0 +1,168 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "test_smapsencoder.h"
+#include "smapsdecoder.h"
+#include <stdio.h>
+
+/*!
+  * \brief The smaps of two mappings as the kernel writes them
+  */
+static const char smapsText[] =
+    "00400000-0040b000 r-xp 00000000 08:01 1313577                            /bin/cat\n"
+    "Size:                 44 kB\n"
+    "Rss:                  28 kB\n"
+    "Pss:                  28 kB\n"
+    "Shared_Clean:          0 kB\n"
+    "Private_Dirty:         0 kB\n"
+    "Swap:                  0 kB\n"
+    "THPeligible:           0\n"
+    "VmFlags: rd ex mr mw me dw \n"
+    "7ffd4c1e2000-7ffd4c203000 rw-p 00000000 00:00 0                          [stack]\n"
+    "Size:                132 kB\n"
+    "Rss:                  16 kB\n"
+    "Pss:                  16 kB\n"
+    "Shared_Clean:          0 kB\n"
+    "Private_Dirty:        16 kB\n"
+    "Swap:                  0 kB\n"
+    "THPeligible:           0\n"
+    "VmFlags: rd wr mr mw me gd ac \n";
+
+/*****************************************************
+  *
+  * Register tests with the CPPUNIT framework
+  *
+  ***************************************************/
+
+//register Test_SmapsEncoder with the CppUnit testFramework
+CPPUNIT_TEST_SUITE_REGISTRATION (Test_SmapsEncoder);
+
+int Test_SmapsEncoder::decode(const std::string &table, std::string &text)
+{
+    text.clear();
+    return smaps_decode((const unsigned char *)table.data(), table.size(), appendText, &text);
+}
+
+void Test_SmapsEncoder::appendText(void *context, const char *data, size_t size)
+{
+    ((std::string *)context)->append(data, size);
+}
+
+void Test_SmapsEncoder::roundTrip_Test()
+{
+    std::string text(smapsText);
+    std::string table;
+    CPPUNIT_ASSERT(SmapsEncoder::encode(text, table) == true);
+    CPPUNIT_ASSERT(table.compare(0, SMAPS_MAGIC_SIZE, SMAPS_MAGIC) == 0);
+
+    std::string decoded;
+    CPPUNIT_ASSERT(decode(table, decoded) == 0);
+    CPPUNIT_ASSERT_EQUAL(text, decoded);
+
+    //The templates are shared by the mappings, so many mappings take a fraction of the text
+    std::string many;
+    char header[128];
+    for (int i = 0; i < 100; i++)
+    {
+        snprintf(header, sizeof(header), "%08x-%08x rw-p 00000000 00:00 0 \n", 0x10000000 + i * 0x2000,
+                 0x10001000 + i * 0x2000);
+        many += header;
+        many += "Size:                  4 kB\nRss:                   4 kB\nVmFlags: rd wr mr mw me ac \n";
+    }
+    CPPUNIT_ASSERT(SmapsEncoder::encode(many, table) == true);
+    CPPUNIT_ASSERT(decode(table, decoded) == 0);
+    CPPUNIT_ASSERT(decoded == many);
+    CPPUNIT_ASSERT(table.size() * 4 < many.size());
+}
+
+void Test_SmapsEncoder::unexpectedLines_Test()
+{
+    //Lines without a colon or a number, numbers with leading zeros, numbers too long to store and
+    //numbers that end past the column that can be stored are all kept as whole lines
+    std::string text =
+        "00400000-0040b000 r-xp 00000000 08:01 1313577 /bin/cat\n"
+        "Size:                 44 kB\n"
+        "a line the kernel does not write\n"
+        "Leading:            0042 kB\n"
+        "Long:     123456789012345678901234567890 kB\n"
+        "Wide:" + std::string(300, ' ') + "7 kB\n"
+        "Size:                 44 kB\n"
+        "ProtectionKey:         0\n"
+        "00500000-00600000 rw-p 00000000 00:00 0\n"
+        "Size:               1024 kB\n";
+    std::string table;
+    CPPUNIT_ASSERT(SmapsEncoder::encode(text, table) == true);
+
+    std::string decoded;
+    CPPUNIT_ASSERT(decode(table, decoded) == 0);
+    CPPUNIT_ASSERT_EQUAL(text, decoded);
+}
+
+void Test_SmapsEncoder::notSmaps_Test()
+{
+    std::string table;
+    //Nothing to encode
+    CPPUNIT_ASSERT(SmapsEncoder::encode("", table) == false);
+    //An attribute line before the first mapping
+    CPPUNIT_ASSERT(SmapsEncoder::encode("Size: 4 kB\n00400000-0040b000 r-xp 00000000 08:01 1 /bin/cat\n", table) == false);
+    //The text does not end in a line feed, it is cut
+    CPPUNIT_ASSERT(SmapsEncoder::encode("00400000-0040b000 r-xp 00000000 08:01 1 /bin/cat\nSize: 4 kB", table) == false);
+    //Addresses the decoder would not write back the same way
+    CPPUNIT_ASSERT(SmapsEncoder::encode("00400000-0040B000 r-xp 00000000 08:01 1 /bin/cat\n", table) == false);
+}
+
+void Test_SmapsEncoder::processSmaps_Test()
+{
+    FILE *file = fopen("/proc/self/smaps", "r");
+    if (!file)
+        return; // no smaps in this kernel
+    std::string text;
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        text.append(buffer, size);
+    fclose(file);
+
+    std::string table;
+    CPPUNIT_ASSERT(SmapsEncoder::encode(text, table) == true);
+    std::string decoded;
+    CPPUNIT_ASSERT(decode(table, decoded) == 0);
+    CPPUNIT_ASSERT(decoded == text);
+}
+
+void Test_SmapsEncoder::decodeInvalid_Test()
+{
+    std::string table;
+    CPPUNIT_ASSERT(SmapsEncoder::encode(smapsText, table) == true);
+    std::string decoded;
+
+    //A wrong magic
+    std::string wrongMagic = table;
+    wrongMagic[0] = 'X';
+    CPPUNIT_ASSERT(decode(wrongMagic, decoded) == -1);
+    //A table that is cut anywhere
+    for (size_t size = 0; size < table.size(); size++)
+        CPPUNIT_ASSERT(decode(table.substr(0, size), decoded) == -1);
+    //Extra data after the table
+    CPPUNIT_ASSERT(decode(table + '\0', decoded) == -1);
+}
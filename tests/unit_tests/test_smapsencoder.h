@@ -0,0 +1,86 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file test_smapsencoder.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Test_SmapsEncoder
+  * \brief Contains the functionality for testing SmapsEncoder and smaps_decode()
+  */
+
+#ifndef TEST_SMAPSENCODER_H
+#define TEST_SMAPSENCODER_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "smapsencoder.h"
+
+class Test_SmapsEncoder : public CppUnit::TestFixture
+{
+    //Declare A test suite and the methods that are going to be called from it.
+    CPPUNIT_TEST_SUITE (Test_SmapsEncoder);
+    CPPUNIT_TEST (roundTrip_Test);
+    CPPUNIT_TEST (unexpectedLines_Test);
+    CPPUNIT_TEST (notSmaps_Test);
+    CPPUNIT_TEST (processSmaps_Test);
+    CPPUNIT_TEST (decodeInvalid_Test);
+    CPPUNIT_TEST_SUITE_END ();
+
+protected:
+    /*!
+      * \brief Test that a table decodes back to the text it was encoded from, and that it is smaller
+      */
+    void roundTrip_Test();
+    /*!
+      * \brief Test that the attribute lines that do not have the expected number are kept as they are
+      */
+    void unexpectedLines_Test();
+    /*!
+      * \brief Test that text that is not smaps is not encoded, the collector then keeps the text
+      */
+    void notSmaps_Test();
+    /*!
+      * \brief Test the round trip of the smaps of this process
+      */
+    void processSmaps_Test();
+    /*!
+      * \brief Test that smaps_decode() rejects tables that are not valid
+      */
+    void decodeInvalid_Test();
+
+private:
+    /*!
+      * \brief Decode a table
+      * \param table The table
+      * \param text Set to the decoded text
+      * \return The result of smaps_decode()
+      */
+    static int decode(const std::string &table, std::string &text);
+
+    /*!
+      * \brief Collect the text from smaps_decode()
+      */
+    static void appendText(void *context, const char *data, size_t size);
+};
+
+#endif // TEST_SMAPSENCODER_H
@@ -0,0 +1,215 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+#include "test_tailreader.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <zlib.h>
+
+//! The log that is read as a plain file
+#define TAIL_TEST_FILE "tailreader_test.log"
+//! The log that is read as a gzip compressed file
+#define TAIL_TEST_GZIP_FILE "tailreader_test.log.gz"
+//! The number of lines in the log, each of LOG_LINE_SIZE bytes
+#define LOG_LINES 20000
+//! The size of a line of the log, line feed included
+#define LOG_LINE_SIZE 11
+
+/*****************************************************
+  *
+  * Register tests with the CPPUNIT framework
+  *
+  ***************************************************/
+
+//register Test_TailReader with the CppUnit testFramework
+CPPUNIT_TEST_SUITE_REGISTRATION (Test_TailReader);
+
+void Test_TailReader::setUp()
+{
+    //"line 00000\n" and so on, 220000 bytes is several of the blocks that are read from the end
+    log.clear();
+    char line[LOG_LINE_SIZE + 1];
+    for (int i = 0; i < LOG_LINES; i++)
+    {
+        snprintf(line, sizeof(line), "line %05d\n", i);
+        log += line;
+    }
+
+    FILE *file = fopen(TAIL_TEST_FILE, "w");
+    CPPUNIT_ASSERT(file != NULL);
+    CPPUNIT_ASSERT(fwrite(log.data(), 1, log.size(), file) == log.size());
+    fclose(file);
+
+    gzFile gzipFile = gzopen(TAIL_TEST_GZIP_FILE, "wb");
+    CPPUNIT_ASSERT(gzipFile != NULL);
+    CPPUNIT_ASSERT(gzwrite(gzipFile, log.data(), log.size()) == (int)log.size());
+    gzclose(gzipFile);
+}
+
+void Test_TailReader::tearDown()
+{
+    unlink(TAIL_TEST_FILE);
+    unlink(TAIL_TEST_GZIP_FILE);
+}
+
+TailReader::Limits Test_TailReader::limits(unsigned long lines, unsigned long bytes)
+{
+    TailReader::Limits limits;
+    limits.lines = lines;
+    limits.bytes = bytes;
+    limits.seconds = 0;
+    return limits;
+}
+
+void Test_TailReader::noLimits_Test()
+{
+    TailReader reader(limits(0, 0), TailReader::NO_TIME);
+    std::string text;
+    reader.readBuffer("a\nb\nc\n", 6, text);
+    CPPUNIT_ASSERT_EQUAL(std::string("a\nb\nc\n"), text);
+    CPPUNIT_ASSERT(!reader.isFull());
+
+    //The last line does not need a line feed, one is added
+    text.clear();
+    reader.readBuffer("a\nb", 3, text);
+    CPPUNIT_ASSERT_EQUAL(std::string("a\nb\n"), text);
+
+    //Empty text gives no lines
+    text.clear();
+    reader.readBuffer("", 0, text);
+    CPPUNIT_ASSERT(text.empty());
+}
+
+void Test_TailReader::lineLimit_Test()
+{
+    TailReader reader(limits(2, 0), TailReader::NO_TIME);
+    std::string text;
+    reader.readBuffer("a\nb\nc\nd\n", 8, text);
+    CPPUNIT_ASSERT_EQUAL(std::string("c\nd\n"), text);
+    CPPUNIT_ASSERT(reader.isFull());
+
+    //Exactly as many lines as the limit are all kept
+    TailReader exact(limits(2, 0), TailReader::NO_TIME);
+    text.clear();
+    exact.readBuffer("a\nb\n", 4, text);
+    CPPUNIT_ASSERT_EQUAL(std::string("a\nb\n"), text);
+}
+
+void Test_TailReader::byteLimit_Test()
+{
+    //The lines that fit whole, line feeds included
+    TailReader reader(limits(0, 6), TailReader::NO_TIME);
+    std::string text;
+    reader.readBuffer("aa\nbb\ncc\n", 9, text);
+    CPPUNIT_ASSERT_EQUAL(std::string("bb\ncc\n"), text);
+    CPPUNIT_ASSERT(reader.isFull());
+
+    //The newest line that does not fit is cut from its start to the bytes that are left
+    TailReader cut(limits(0, 5), TailReader::NO_TIME);
+    text.clear();
+    cut.readBuffer("aa\nbc\ncc\n", 9, text);
+    CPPUNIT_ASSERT_EQUAL(std::string("c\ncc\n"), text);
+    CPPUNIT_ASSERT(text.size() == 5);
+
+    //A line that is longer than the limit keeps its end
+    TailReader longLine(limits(0, 4), TailReader::NO_TIME);
+    text.clear();
+    longLine.readBuffer("abcdefgh\n", 9, text);
+    CPPUNIT_ASSERT_EQUAL(std::string("fgh\n"), text);
+}
+
+void Test_TailReader::sharedLimits_Test()
+{
+    //The newest text is read first, the older text only gets what is left of the limits
+    TailReader reader(limits(3, 0), TailReader::NO_TIME);
+    std::string newest, older, oldest;
+    reader.readBuffer("c\nd\n", 4, newest);
+    CPPUNIT_ASSERT(!reader.isFull());
+    reader.readBuffer("a\nb\n", 4, older);
+    CPPUNIT_ASSERT(reader.isFull());
+    reader.readBuffer("x\n", 2, oldest);
+    CPPUNIT_ASSERT_EQUAL(std::string("c\nd\n"), newest);
+    CPPUNIT_ASSERT_EQUAL(std::string("b\n"), older);
+    CPPUNIT_ASSERT(oldest.empty());
+
+    TailReader bytes(limits(0, 6), TailReader::NO_TIME);
+    newest.clear();
+    older.clear();
+    bytes.readBuffer("cc\n", 3, newest);
+    bytes.readBuffer("aa\nbb\n", 6, older);
+    CPPUNIT_ASSERT_EQUAL(std::string("bb\n"), older);
+    CPPUNIT_ASSERT(bytes.isFull());
+}
+
+void Test_TailReader::readFile_Test()
+{
+    //A file that does not exist is not read
+    TailReader missing(limits(0, 0), TailReader::NO_TIME);
+    std::string text;
+    CPPUNIT_ASSERT(missing.readFile("tailreader_test.missing", text) == false);
+
+    //The whole file
+    TailReader whole(limits(0, 0), TailReader::NO_TIME);
+    CPPUNIT_ASSERT(whole.readFile(TAIL_TEST_FILE, text) == true);
+    CPPUNIT_ASSERT(text == log);
+    CPPUNIT_ASSERT(!whole.isFull());
+
+    //A line limit that reaches over the blocks
+    TailReader lines(limits(7000, 0), TailReader::NO_TIME);
+    text.clear();
+    CPPUNIT_ASSERT(lines.readFile(TAIL_TEST_FILE, text) == true);
+    CPPUNIT_ASSERT(text == log.substr(log.size() - 7000 * LOG_LINE_SIZE));
+    CPPUNIT_ASSERT(lines.isFull());
+
+    //A byte limit that cuts a line in a block before the last one
+    TailReader bytes(limits(0, 7000 * LOG_LINE_SIZE + 4), TailReader::NO_TIME);
+    text.clear();
+    CPPUNIT_ASSERT(bytes.readFile(TAIL_TEST_FILE, text) == true);
+    CPPUNIT_ASSERT_EQUAL(std::string("999\n"), text.substr(0, 4));
+    CPPUNIT_ASSERT(text.substr(4) == log.substr(log.size() - 7000 * LOG_LINE_SIZE));
+}
+
+void Test_TailReader::readGzipFile_Test()
+{
+    std::string text;
+    TailReader missing(limits(0, 0), TailReader::NO_TIME);
+    CPPUNIT_ASSERT(missing.readGzipFile("tailreader_test.missing.gz", text) == false);
+
+    TailReader whole(limits(0, 0), TailReader::NO_TIME);
+    CPPUNIT_ASSERT(whole.readGzipFile(TAIL_TEST_GZIP_FILE, text) == true);
+    CPPUNIT_ASSERT(text == log);
+    CPPUNIT_ASSERT(!whole.isFull());
+
+    TailReader lines(limits(3, 0), TailReader::NO_TIME);
+    text.clear();
+    CPPUNIT_ASSERT(lines.readGzipFile(TAIL_TEST_GZIP_FILE, text) == true);
+    CPPUNIT_ASSERT_EQUAL(std::string("line 19997\nline 19998\nline 19999\n"), text);
+    CPPUNIT_ASSERT(lines.isFull());
+
+    //The oldest lines are dropped whole until the rest fits in the byte limit
+    TailReader bytes(limits(0, 2 * LOG_LINE_SIZE + 4), TailReader::NO_TIME);
+    text.clear();
+    CPPUNIT_ASSERT(bytes.readGzipFile(TAIL_TEST_GZIP_FILE, text) == true);
+    CPPUNIT_ASSERT_EQUAL(std::string("line 19998\nline 19999\n"), text);
+    CPPUNIT_ASSERT(bytes.isFull());
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of sp-rich-core
+ *
+ * Copyright (C) 2010 Nokia Corporation and/or its subsidiary(-ies).
+ *
+ * Contact: Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+/*!
+  * \file test_tailreader.h
+  * \author Brian McGillion <brian.mcgillion@symbio.com>, Denis Mingulov <denis.mingulov@symbio.com>
+  * \class Test_TailReader
+  * \brief Contains the functionality for testing TailReader
+  */
+
+#ifndef TEST_TAILREADER_H
+#define TEST_TAILREADER_H
+
+#include <cppunit/TestFixture.h>
+#include <cppunit/extensions/HelperMacros.h>
+#include "tailreader.h"
+
+class Test_TailReader : public CppUnit::TestFixture
+{
+    //Declare A test suite and the methods that are going to be called from it.
+    CPPUNIT_TEST_SUITE (Test_TailReader);
+    CPPUNIT_TEST (noLimits_Test);
+    CPPUNIT_TEST (lineLimit_Test);
+    CPPUNIT_TEST (byteLimit_Test);
+    CPPUNIT_TEST (sharedLimits_Test);
+    CPPUNIT_TEST (readFile_Test);
+    CPPUNIT_TEST (readGzipFile_Test);
+    CPPUNIT_TEST_SUITE_END ();
+
+public:
+    /*!
+      * \brief Initalize data for the test cases
+      * \details Create a log that is larger than the blocks that TailReader reads
+      */
+    void setUp();
+
+    /*!
+      * \brief Clean up after the tests have been run
+      */
+    void tearDown();
+
+protected:
+    /*!
+      * \brief Test TailReader::readBuffer() without limits
+      */
+    void noLimits_Test();
+    /*!
+      * \brief Test the line limit of TailReader::readBuffer()
+      */
+    void lineLimit_Test();
+    /*!
+      * \brief Test the byte limit of TailReader::readBuffer(), the newest line that does not fit is cut
+      */
+    void byteLimit_Test();
+    /*!
+      * \brief Test that the limits apply to all of the text read with the same reader
+      */
+    void sharedLimits_Test();
+    /*!
+      * \brief Test TailReader::readFile() with limits that reach over several blocks of the file
+      */
+    void readFile_Test();
+    /*!
+      * \brief Test TailReader::readGzipFile()
+      */
+    void readGzipFile_Test();
+
+private:
+    /*!
+      * \brief Create the limits for a reader
+      */
+    static TailReader::Limits limits(unsigned long lines, unsigned long bytes);
+
+    //! The text of the log
+    std::string log;
+};
+
+#endif // TEST_TAILREADER_H